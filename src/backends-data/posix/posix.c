@@ -215,6 +215,33 @@ static int fragment_retrieve(esdm_backend_t *backend, esdm_fragment_t *f) {
   return ret;
 }
 
+static int fragment_retrieve_range(esdm_backend_t *backend, esdm_fragment_t *f, int64_t offset, int64_t size, void *buf) {
+  DEBUG_ENTER;
+
+  posix_backend_data_t *data = (posix_backend_data_t *)backend->data;
+  const char *tgt = data->config->target;
+
+  char path[PATH_MAX];
+  sprintfFragmentPath(path, f);
+  DEBUG("retrieve range %ld+%ld of path_fragment: %s", (long) offset, (long) size, path);
+
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    WARN("error on opening file \"%s\": %s", path, strerror(errno));
+    return ESDM_ERROR;
+  }
+  uint64_t epos = *(uint64_t*) f->backend_md + offset;
+  off_t pos = lseek(fd, epos, SEEK_SET);
+  if (epos != pos){
+    WARN("Cannot seek to the expected position: %s", strerror(errno));
+    close(fd);
+    return ESDM_ERROR;
+  }
+  int ret = ea_read_check(fd, buf, size);
+  close(fd);
+  return ret ? ESDM_ERROR : ESDM_SUCCESS;
+}
+
 static int create_posix_id(posix_backend_data_t * b, esdm_fragment_t * f, const char *tgt, int * out_fd){
   char path[PATH_MAX];
   // piggyback on previous fragment
@@ -425,7 +452,8 @@ static esdm_backend_t backend_template = {
     .fragment_metadata_free = fragment_metadata_free,
     .mkfs = mkfs,
     .fsck = fsck,
-    .fragment_write_stream_blocksize = fragment_write_stream_blocksize
+    .fragment_write_stream_blocksize = fragment_write_stream_blocksize,
+    .fragment_retrieve_range = fragment_retrieve_range
   },
 };
 
@@ -42,6 +42,7 @@
 
 #define sprintfDatasetDir(path, d) (sprintf(path, "%s/datasets/%c%c", tgt, d->id[0], d->id[1]))
 #define sprintfDatasetMd(path, d) (sprintf(path, "%s/datasets/%c%c/%s.md", tgt, d->id[0], d->id[1], d->id + 2))
+#define sprintfDatasetJournal(path, d) (sprintf(path, "%s/datasets/%c%c/%s.journal", tgt, d->id[0], d->id[1], d->id + 2))
 
 ///////////////////////////////////////////////////////////////////////////////
 // Helper and utility /////////////////////////////////////////////////////////
@@ -76,6 +77,18 @@ static int entry_create(const char *path, char * const json, int size) {
   return ESDM_SUCCESS;
 }
 
+static int entry_append(const char *path, char * const json, int size) {
+  DEBUG("entry_append(%s)\n", path);
+
+  int fd = open(path, O_WRONLY | O_CREAT | O_APPEND, S_IWUSR | S_IRUSR | S_IWGRP | S_IRGRP | S_IROTH);
+  if (fd < 0) {
+    return ESDM_ERROR;
+  }
+  int ret = ea_write_check(fd, json, size);
+  close(fd);
+  return ret ? ESDM_ERROR : ESDM_SUCCESS;
+}
+
 static int entry_update(const char *path, void *buf, size_t len) {
   DEBUG_ENTER;
 
@@ -95,6 +108,19 @@ static int entry_update(const char *path, void *buf, size_t len) {
 }
 
 
+//Fills two words of a stamp with the modification time and size of a file, a missing file yields -1.
+static int file_stamp(const char *path, int64_t *out_words) {
+  struct stat sb;
+  if (stat(path, &sb) != 0) {
+    if (errno != ENOENT) return ESDM_ERROR;
+    out_words[0] = out_words[1] = -1;
+    return ESDM_SUCCESS;
+  }
+  out_words[0] = sb.st_mtim.tv_sec * (int64_t)1000000000 + sb.st_mtim.tv_nsec;
+  out_words[1] = sb.st_size;
+  return ESDM_SUCCESS;
+}
+
 static int mkfs(esdm_md_backend_t *backend, int format_flags) {
   DEBUG_ENTER;
   // use target directory from backend configuration
@@ -245,6 +271,8 @@ static int dataset_remove(esdm_md_backend_t * backend, esdm_dataset_t *d){
 
   DEBUG("tgt: %p\n", tgt);
 
+  sprintfDatasetJournal(path_metadata, d);
+  unlink(path_metadata);  //the journal may well not exist
   sprintfDatasetMd(path_metadata, d);
   if(unlink(path_metadata) == 0){
     return ESDM_SUCCESS;
@@ -299,6 +327,19 @@ static int container_retrieve(esdm_md_backend_t *backend, esdm_container_t *cont
   return 0;
 }
 
+static int container_stamp(esdm_md_backend_t *backend, esdm_container_t *container, esdm_md_stamp_t *out_stamp) {
+  DEBUG_ENTER;
+  char path_metadata[PATH_MAX];
+
+  metadummy_backend_options_t *options = (metadummy_backend_options_t *)backend->data;
+  const char *tgt = options->target;
+
+  sprintf(path_metadata, "%s/containers/%s.md", tgt, container->name);
+  int ret = file_stamp(path_metadata, out_stamp->words);
+  if (ret == ESDM_SUCCESS && out_stamp->words[1] < 0) return ESDM_ERROR;
+  return ret;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Dataset Helpers ////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
@@ -354,7 +395,71 @@ static int dataset_commit(esdm_md_backend_t *backend, esdm_dataset_t *dataset, c
 
   // create metadata entry
   esdm_status ret = entry_create(path_metadata, json, md_size);
-  return ret;
+  if(ret != ESDM_SUCCESS) return ret;
+
+  // the new snapshot contains everything that was journaled
+  sprintfDatasetJournal(path_metadata, dataset);
+  if(unlink(path_metadata) != 0 && errno != ENOENT) return ESDM_ERROR;
+  return ESDM_SUCCESS;
+}
+
+static int dataset_append(esdm_md_backend_t *backend, esdm_dataset_t *dataset, char * json, int md_size) {
+  DEBUG_ENTER;
+
+  char path_journal[PATH_MAX];
+
+  metadummy_backend_options_t *options = (metadummy_backend_options_t *)backend->data;
+  const char *tgt = options->target;
+
+  sprintfDatasetJournal(path_journal, dataset);
+  return entry_append(path_journal, json, md_size);
+}
+
+static int dataset_retrieve_journal(esdm_md_backend_t *backend, esdm_dataset_t *d, char ** out_json, int * out_size) {
+  DEBUG_ENTER;
+  char path_journal[PATH_MAX];
+
+  metadummy_backend_options_t *options = (metadummy_backend_options_t *)backend->data;
+  const char *tgt = options->target;
+
+  *out_json = NULL;
+  *out_size = 0;
+  sprintfDatasetJournal(path_journal, d);
+  struct stat statbuf;
+  if (stat(path_journal, &statbuf) != 0) {
+    return errno == ENOENT ? ESDM_SUCCESS : ESDM_ERROR;
+  }
+  if (statbuf.st_size == 0) return ESDM_SUCCESS;
+
+  int fd = open(path_journal, O_RDONLY);
+  if (fd < 0) return ESDM_ERROR;
+  char * json = ea_checked_malloc(statbuf.st_size + 1);
+  int ret = ea_read_check(fd, json, statbuf.st_size);
+  close(fd);
+  json[statbuf.st_size] = 0;
+  if (ret != 0){
+    free(json);
+    return ESDM_ERROR;
+  }
+  *out_json = json;
+  *out_size = statbuf.st_size;
+
+  return ESDM_SUCCESS;
+}
+
+static int dataset_stamp(esdm_md_backend_t *backend, esdm_dataset_t *d, esdm_md_stamp_t *out_stamp) {
+  DEBUG_ENTER;
+  char path[PATH_MAX];
+
+  metadummy_backend_options_t *options = (metadummy_backend_options_t *)backend->data;
+  const char *tgt = options->target;
+
+  // the journal changes without touching the snapshot, so both files are part of the stamp
+  sprintfDatasetMd(path, d);
+  int ret = file_stamp(path, out_stamp->words);
+  if (ret != ESDM_SUCCESS || out_stamp->words[1] < 0) return ESDM_ERROR;
+  sprintfDatasetJournal(path, d);
+  return file_stamp(path, out_stamp->words + 2);
 }
 
 static int dataset_retrieve(esdm_md_backend_t *backend, esdm_dataset_t *d, char ** out_json, int * out_size) {
@@ -386,6 +491,77 @@ static int dataset_retrieve(esdm_md_backend_t *backend, esdm_dataset_t *d, char
   return ESDM_SUCCESS;
 }
 
+static int dataset_retrieve_range(esdm_md_backend_t *backend, esdm_dataset_t *d, int64_t offset, int64_t size, char * out_data, int64_t * out_size) {
+  DEBUG_ENTER;
+  char path_metadata[PATH_MAX];
+
+  metadummy_backend_options_t *options = (metadummy_backend_options_t *)backend->data;
+  const char *tgt = options->target;
+
+  sprintfDatasetMd(path_metadata, d);
+  int fd = open(path_metadata, O_RDONLY);
+  if (fd < 0) return ESDM_ERROR;
+  int64_t count = 0;
+  while (count < size) {
+    ssize_t ret = pread(fd, out_data + count, size - count, offset + count);
+    if (ret == 0) break;  //end of file
+    if (ret < 0) {
+      if (errno == EINTR) continue;
+      close(fd);
+      return ESDM_ERROR;
+    }
+    count += ret;
+  }
+  close(fd);
+  *out_size = count;
+
+  return ESDM_SUCCESS;
+}
+
+
+static int performance_model_commit(esdm_md_backend_t *backend, const char *backendId, char *json, int size) {
+  DEBUG_ENTER;
+  metadummy_backend_options_t *options = (metadummy_backend_options_t *)backend->data;
+  const char *tgt = options->target;
+  char path[PATH_MAX];
+
+  sprintf(path, "%s/performance", tgt);
+  if (mkdir(path, 0700) != 0 && errno != EEXIST) return ESDM_ERROR;
+
+  //write a temporary file and rename it, so that concurrent readers never see a partial model
+  char path_tmp[PATH_MAX];
+  sprintf(path, "%s/performance/%s.json", tgt, backendId);
+  sprintf(path_tmp, "%s.%d", path, (int)getpid());
+  if (entry_create(path_tmp, json, size)) {
+    unlink(path_tmp);
+    return ESDM_ERROR;
+  }
+  return rename(path_tmp, path) ? ESDM_ERROR : ESDM_SUCCESS;
+}
+
+static int performance_model_retrieve(esdm_md_backend_t *backend, const char *backendId, char **out_json, int *out_size) {
+  DEBUG_ENTER;
+  metadummy_backend_options_t *options = (metadummy_backend_options_t *)backend->data;
+  const char *tgt = options->target;
+  char path[PATH_MAX];
+  sprintf(path, "%s/performance/%s.json", tgt, backendId);
+
+  struct stat statbuf;
+  if (stat(path, &statbuf) != 0) return ESDM_ERROR;
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return ESDM_ERROR;
+  char *json = ea_checked_malloc(statbuf.st_size + 1);
+  int ret = ea_read_check(fd, json, statbuf.st_size);
+  close(fd);
+  if (ret != 0) {
+    free(json);
+    return ESDM_ERROR;
+  }
+  json[statbuf.st_size] = 0;
+  *out_json = json;
+  *out_size = statbuf.st_size;
+  return ESDM_SUCCESS;
+}
 
 ///////////////////////////////////////////////////////////////////////////////
 // ESDM Callbacks /////////////////////////////////////////////////////////////
@@ -425,11 +601,19 @@ static esdm_md_backend_t backend_template = {
     .container_commit = container_commit,
     .container_retrieve = container_retrieve,
     .container_remove = container_remove,
+    .container_stamp = container_stamp,
 
     .dataset_create = dataset_create,
     .dataset_commit = dataset_commit,
     .dataset_retrieve = dataset_retrieve,
     .dataset_remove = dataset_remove,
+    .dataset_append = dataset_append,
+    .dataset_retrieve_journal = dataset_retrieve_journal,
+    .dataset_stamp = dataset_stamp,
+    .dataset_retrieve_range = dataset_retrieve_range,
+
+    .performance_model_commit = performance_model_commit,
+    .performance_model_retrieve = performance_model_retrieve,
 
     .mkfs = mkfs,
     .fsck = fsck,
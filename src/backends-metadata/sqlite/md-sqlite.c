@@ -0,0 +1,850 @@
+/* This file is part of ESDM.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with ESDM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ * @brief A metadata backend that stores all metadata in an embedded SQLite database.
+ *
+ * The snapshots and journals of the datasets are stored as blobs, just like the POSIX backend stores them in files.
+ * In addition, every fragment that is committed is recorded in the `fragments` table,
+ * and its extends are inserted into the R*Tree `fragment_index`, which has one pair of range columns per dimension.
+ * R*Trees support at most five dimensions, higher dimensions are not indexed but checked when the query results are filtered.
+ * Each fragment row also holds the fragment's metadata as a binary fragment table with a single record,
+ * so that ESDM can load only the fragments of the region it reads instead of decoding entire pages of the snapshot.
+ * Commits only add the fragments that are new since the last commit to the index,
+ * the index of a dataset is only rebuilt if it has lost track of the dataset's fragments.
+ *
+ * Every change of a container or dataset assigns it the next value of a database wide version counter,
+ * which serves as the stamp that the metadata cache uses to detect changes.
+ */
+
+#define _GNU_SOURCE /* See feature_test_macros(7) */
+
+#include <glib.h>
+#include <sqlite3.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "md-sqlite.h"
+#include <esdm-internal.h>
+
+#define DEBUG_ENTER ESDM_DEBUG_COM_FMT("MDSQLITE", "", "")
+#define DEBUG(fmt, ...) ESDM_DEBUG_COM_FMT("MDSQLITE", fmt, __VA_ARGS__)
+
+enum {
+  kIndexDims = 5,  //the maximum dimension count of an SQLite R*Tree
+  kBusyTimeoutMs = 60*1000  //how long we wait for another process to finish its transaction
+};
+
+typedef struct {
+  const char *target;
+  sqlite3 *db;
+  GMutex lock;  //serializes the transactions of the different threads of this process, as they share one connection
+} sqlite_backend_data_t;
+
+static const char* kSchema =
+  "CREATE TABLE esdm(key TEXT PRIMARY KEY, value TEXT);"
+  "INSERT INTO esdm(key, value) VALUES('format', '1');"
+  "CREATE TABLE counters(name TEXT PRIMARY KEY, value INTEGER NOT NULL);"
+  "INSERT INTO counters(name, value) VALUES('version', 0);"
+  "CREATE TABLE containers(name TEXT PRIMARY KEY, json BLOB, version INTEGER NOT NULL);"
+  "CREATE TABLE datasets(id TEXT PRIMARY KEY, snapshot BLOB, version INTEGER NOT NULL);"
+  "CREATE TABLE journal(seq INTEGER PRIMARY KEY AUTOINCREMENT, dataset TEXT NOT NULL, entry BLOB NOT NULL);"
+  "CREATE INDEX journal_dataset ON journal(dataset, seq);"
+  "CREATE TABLE fragments(id INTEGER PRIMARY KEY, dataset TEXT NOT NULL, backend TEXT NOT NULL, fragment TEXT NOT NULL, dims INTEGER NOT NULL, extends BLOB NOT NULL, record BLOB NOT NULL, UNIQUE(dataset, backend, fragment));"
+  "CREATE VIRTUAL TABLE fragment_index USING rtree(id, start0, end0, start1, end1, start2, end2, start3, end3, start4, end4);";
+
+static const char* kDropSchema =
+  "DROP TABLE IF EXISTS fragment_index;"
+  "DROP TABLE IF EXISTS fragments;"
+  "DROP TABLE IF EXISTS journal;"
+  "DROP TABLE IF EXISTS datasets;"
+  "DROP TABLE IF EXISTS containers;"
+  "DROP TABLE IF EXISTS counters;"
+  "DROP TABLE IF EXISTS esdm;";
+
+///////////////////////////////////////////////////////////////////////////////
+// Helper and utility /////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+static int execSql(sqlite_backend_data_t *data, const char *sql) {
+  char *error = NULL;
+  if(sqlite3_exec(data->db, sql, NULL, NULL, &error) != SQLITE_OK) {
+    ESDM_WARN_FMT("SQLite error in \"%s\": %s", data->target, error ? error : sqlite3_errmsg(data->db));
+    sqlite3_free(error);
+    return ESDM_ERROR;
+  }
+  return ESDM_SUCCESS;
+}
+
+//Returns NULL on error.
+static sqlite3_stmt* prepare(sqlite_backend_data_t *data, const char *sql) {
+  sqlite3_stmt *statement = NULL;
+  if(sqlite3_prepare_v2(data->db, sql, -1, &statement, NULL) != SQLITE_OK) {
+    ESDM_WARN_FMT("SQLite error in \"%s\": %s", data->target, sqlite3_errmsg(data->db));
+    return NULL;
+  }
+  return statement;
+}
+
+//Executes a statement that does not return any rows and finalizes it.
+static int stepDone(sqlite_backend_data_t *data, sqlite3_stmt *statement) {
+  int ret = sqlite3_step(statement);
+  if(ret != SQLITE_DONE) ESDM_WARN_FMT("SQLite error in \"%s\": %s", data->target, sqlite3_errmsg(data->db));
+  sqlite3_finalize(statement);
+  return ret == SQLITE_DONE ? ESDM_SUCCESS : ESDM_ERROR;
+}
+
+//Copies the blob in the given column into a newly allocated, null terminated buffer.
+static void columnCopy(sqlite3_stmt *statement, int column, char **out_buffer, int *out_size) {
+  const void *blob = sqlite3_column_blob(statement, column);
+  int size = sqlite3_column_bytes(statement, column);
+  char *buffer = ea_checked_malloc(size + 1);
+  if(size) memcpy(buffer, blob, size);
+  buffer[size] = 0;
+  *out_buffer = buffer;
+  *out_size = size;
+}
+
+//Both functions must be called with the lock held.
+//We use immediate transactions, so that a writer that has to wait for another process does so before it reads anything.
+static int beginTransaction(sqlite_backend_data_t *data) {
+  return execSql(data, "BEGIN IMMEDIATE;");
+}
+
+static int endTransaction(sqlite_backend_data_t *data, int status) {
+  if(status == ESDM_SUCCESS) status = execSql(data, "COMMIT;");
+  if(status != ESDM_SUCCESS) execSql(data, "ROLLBACK;");
+  return status;
+}
+
+//Advances the version counter, statements use kCurrentVersion to assign its value to the objects they change.
+//Must be called within a transaction, so that no other process can hand out the same version.
+static int bumpVersion(sqlite_backend_data_t *data) {
+  return execSql(data, "UPDATE counters SET value = value + 1 WHERE name = 'version';");
+}
+
+#define kCurrentVersion "(SELECT value FROM counters WHERE name = 'version')"
+
+//Reads the version of a container or dataset with a statement that has the object's key as its only parameter.
+static int readVersion(sqlite_backend_data_t *data, const char *sql, const char *key, esdm_md_stamp_t *out_stamp) {
+  g_mutex_lock(&data->lock);
+  sqlite3_stmt *statement = prepare(data, sql);
+  int ret = ESDM_ERROR;
+  if(statement) {
+    sqlite3_bind_text(statement, 1, key, -1, SQLITE_STATIC);
+    if(sqlite3_step(statement) == SQLITE_ROW) {
+      out_stamp->words[0] = sqlite3_column_int64(statement, 0);
+      ret = ESDM_SUCCESS;
+    }
+    sqlite3_finalize(statement);
+  }
+  g_mutex_unlock(&data->lock);
+  return ret;
+}
+
+static bool isEsdmDatabase(sqlite_backend_data_t *data) {
+  sqlite3_stmt *statement = prepare(data, "SELECT count(*) FROM sqlite_master WHERE type = 'table' AND name = 'esdm';");
+  if(!statement) return false;
+  bool result = sqlite3_step(statement) == SQLITE_ROW && sqlite3_column_int(statement, 0) > 0;
+  sqlite3_finalize(statement);
+  return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Fragment Index /////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+//Adds the fragments to the index, fragments that are already indexed are skipped.
+//Must be called within a transaction.
+static int indexFragments(sqlite_backend_data_t *data, esdm_dataset_t *d, int64_t count, esdm_fragment_t **fragments) {
+  if(!count) return ESDM_SUCCESS;
+  sqlite3_stmt *insertFragment = prepare(data, "INSERT OR IGNORE INTO fragments(dataset, backend, fragment, dims, extends, record) VALUES(?1, ?2, ?3, ?4, ?5, ?6);");
+  sqlite3_stmt *insertIndex = prepare(data, "INSERT INTO fragment_index VALUES(?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9, ?10, ?11);");
+  int ret = insertFragment && insertIndex ? ESDM_SUCCESS : ESDM_ERROR;
+
+  for(int64_t i = 0; i < count && ret == ESDM_SUCCESS; i++) {
+    esdm_fragment_t *f = fragments[i];
+    eassert(f->backend);
+    esdm_dataspace_t *space = f->dataspace;
+    int64_t extends[2*space->dims];
+    memcpy(extends, space->offset, space->dims*sizeof(int64_t));
+    memcpy(extends + space->dims, space->size, space->dims*sizeof(int64_t));
+    int64_t recordSize;
+    char *record = esdmI_fragmentTable_encode(space->dims, 1, &f, &recordSize);
+
+    sqlite3_reset(insertFragment);
+    sqlite3_bind_text(insertFragment, 1, d->id, -1, SQLITE_STATIC);
+    sqlite3_bind_text(insertFragment, 2, f->backend->config->id, -1, SQLITE_STATIC);
+    sqlite3_bind_text(insertFragment, 3, f->id, -1, SQLITE_STATIC);
+    sqlite3_bind_int64(insertFragment, 4, space->dims);
+    sqlite3_bind_blob(insertFragment, 5, extends, sizeof(extends), SQLITE_TRANSIENT);
+    sqlite3_bind_blob(insertFragment, 6, record, recordSize, SQLITE_TRANSIENT);
+    int step = sqlite3_step(insertFragment);
+    free(record);
+    if(step != SQLITE_DONE) {
+      ret = ESDM_ERROR;
+      break;
+    }
+    if(!sqlite3_changes(data->db)) continue; //already indexed
+
+    //unused dimensions get the range [0, 1), which intersects the range we use for them in queries
+    sqlite3_reset(insertIndex);
+    sqlite3_bind_int64(insertIndex, 1, sqlite3_last_insert_rowid(data->db));
+    for(int64_t dim = 0; dim < kIndexDims; dim++) {
+      bool used = dim < space->dims;
+      sqlite3_bind_int64(insertIndex, 2 + 2*dim, used ? space->offset[dim] : 0);
+      sqlite3_bind_int64(insertIndex, 3 + 2*dim, used ? space->offset[dim] + space->size[dim] : 1);
+    }
+    if(sqlite3_step(insertIndex) != SQLITE_DONE) ret = ESDM_ERROR;
+  }
+  if(ret != ESDM_SUCCESS) ESDM_WARN_FMT("SQLite error in \"%s\": %s", data->target, sqlite3_errmsg(data->db));
+
+  sqlite3_finalize(insertFragment);
+  sqlite3_finalize(insertIndex);
+  return ret;
+}
+
+//Must be called within a transaction.
+static int unindexDataset(sqlite_backend_data_t *data, esdm_dataset_t *d) {
+  sqlite3_stmt *statement = prepare(data, "DELETE FROM fragment_index WHERE id IN (SELECT id FROM fragments WHERE dataset = ?1);");
+  if(!statement) return ESDM_ERROR;
+  sqlite3_bind_text(statement, 1, d->id, -1, SQLITE_STATIC);
+  int ret = stepDone(data, statement);
+  if(ret != ESDM_SUCCESS) return ret;
+
+  statement = prepare(data, "DELETE FROM fragments WHERE dataset = ?1;");
+  if(!statement) return ESDM_ERROR;
+  sqlite3_bind_text(statement, 1, d->id, -1, SQLITE_STATIC);
+  return stepDone(data, statement);
+}
+
+//Returns the number of fragments of the dataset that are in the index, or -1 on error.
+//Must be called within a transaction.
+static int64_t indexedFragmentCount(sqlite_backend_data_t *data, esdm_dataset_t *d) {
+  sqlite3_stmt *statement = prepare(data, "SELECT count(*) FROM fragments WHERE dataset = ?1;");
+  if(!statement) return -1;
+  sqlite3_bind_text(statement, 1, d->id, -1, SQLITE_STATIC);
+  int64_t result = sqlite3_step(statement) == SQLITE_ROW ? sqlite3_column_int64(statement, 0) : -1;
+  sqlite3_finalize(statement);
+  return result;
+}
+
+//Calls `callback` for each indexed fragment of the dataset that intersects the region, with the statement positioned on the fragment's row.
+//The columns are backend, fragment, record, and the callback receives the exact extends of the fragment, which it may keep.
+//Must be called with the lock held.
+static int queryRegion(sqlite_backend_data_t *data, esdm_dataset_t *d, esdmI_hypercube_t *region, void (*callback)(sqlite3_stmt *statement, esdmI_hypercube_t *extends, void *userData), void *userData) {
+  //the CROSS JOIN forces SQLite to start with the R*Tree, otherwise it prefers to scan all fragments of the dataset
+  sqlite3_stmt *statement = prepare(data,
+    "SELECT f.backend, f.fragment, f.record, f.dims, f.extends FROM fragment_index AS i CROSS JOIN fragments AS f ON f.id = i.id"
+    " WHERE f.dataset = ?1"
+    " AND i.start0 < ?2 AND i.end0 > ?3 AND i.start1 < ?4 AND i.end1 > ?5 AND i.start2 < ?6 AND i.end2 > ?7"
+    " AND i.start3 < ?8 AND i.end3 > ?9 AND i.start4 < ?10 AND i.end4 > ?11;");
+  if(!statement) return ESDM_ERROR;
+  sqlite3_bind_text(statement, 1, d->id, -1, SQLITE_STATIC);
+  for(int64_t dim = 0; dim < kIndexDims; dim++) {
+    bool used = dim < region->dims;
+    sqlite3_bind_int64(statement, 2 + 2*dim, used ? region->ranges[dim].end : 1);
+    sqlite3_bind_int64(statement, 3 + 2*dim, used ? region->ranges[dim].start : 0);
+  }
+
+  //The R*Tree stores its coordinates as rounded floats, and it does not know about the higher dimensions,
+  //so the candidates are checked against the exact extends.
+  int ret;
+  while((ret = sqlite3_step(statement)) == SQLITE_ROW) {
+    int64_t dims = sqlite3_column_int64(statement, 3);
+    if(dims != region->dims || sqlite3_column_bytes(statement, 4) != 2*dims*(int)sizeof(int64_t)) continue;
+    int64_t extends[2*dims];
+    memcpy(extends, sqlite3_column_blob(statement, 4), sizeof(extends));
+    esdmI_hypercube_t *cube = esdmI_hypercube_make(dims, extends, extends + dims);
+    if(!esdmI_hypercube_doesIntersect(cube, region)) {
+      esdmI_hypercube_destroy(cube);
+      continue;
+    }
+    callback(statement, cube, userData);
+  }
+  if(ret != SQLITE_DONE) ESDM_WARN_FMT("SQLite error in \"%s\": %s", data->target, sqlite3_errmsg(data->db));
+  sqlite3_finalize(statement);
+  return ret == SQLITE_DONE ? ESDM_SUCCESS : ESDM_ERROR;
+}
+
+typedef struct {
+  int64_t count, allocated;
+  sqlite_fragment_ref_t *refs;
+} refCollector_t;
+
+static void collectRef(sqlite3_stmt *statement, esdmI_hypercube_t *extends, void *userData) {
+  refCollector_t *me = userData;
+  if(me->count == me->allocated) {
+    me->allocated = me->allocated ? 2*me->allocated : 16;
+    me->refs = ea_checked_realloc(me->refs, me->allocated*sizeof(*me->refs));
+  }
+  me->refs[me->count++] = (sqlite_fragment_ref_t){
+    .backendId = ea_checked_strdup((const char*)sqlite3_column_text(statement, 0)),
+    .fragmentId = ea_checked_strdup((const char*)sqlite3_column_text(statement, 1)),
+    .extends = extends
+  };
+}
+
+esdm_status sqlite_backend_fragmentsInRegion(esdm_md_backend_t *backend, esdm_dataset_t *d, esdmI_hypercube_t *region, int64_t *out_count, sqlite_fragment_ref_t **out_refs) {
+  DEBUG_ENTER;
+  eassert(backend);
+  eassert(d);
+  eassert(region);
+  eassert(out_count);
+  eassert(out_refs);
+
+  sqlite_backend_data_t *data = backend->data;
+  *out_count = 0;
+  *out_refs = NULL;
+
+  refCollector_t collector = {0};
+  g_mutex_lock(&data->lock);
+  int ret = queryRegion(data, d, region, collectRef, &collector);
+  g_mutex_unlock(&data->lock);
+
+  if(ret != ESDM_SUCCESS) {
+    sqlite_backend_freeFragmentRefs(collector.count, collector.refs);
+    return ESDM_ERROR;
+  }
+  *out_count = collector.count;
+  *out_refs = collector.refs;
+  return ESDM_SUCCESS;
+}
+
+void sqlite_backend_freeFragmentRefs(int64_t count, sqlite_fragment_ref_t *refs) {
+  for(int64_t i = 0; i < count; i++) {
+    free(refs[i].backendId);
+    free(refs[i].fragmentId);
+    esdmI_hypercube_destroy(refs[i].extends);
+  }
+  free(refs);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Internal Helpers  //////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+static int mkfs(esdm_md_backend_t *backend, int format_flags) {
+  DEBUG_ENTER;
+  sqlite_backend_data_t *data = backend->data;
+  const char *tgt = data->target;
+  int const ignore_err = format_flags & ESDM_FORMAT_IGNORE_ERRORS;
+  int ret = ESDM_SUCCESS;
+
+  g_mutex_lock(&data->lock);
+  if (format_flags & ESDM_FORMAT_DELETE) {
+    printf("[mkfs] Removing the ESDM tables from %s\n", tgt);
+    if (isEsdmDatabase(data)) {
+      ret = execSql(data, kDropSchema);
+    } else if (! ignore_err) {
+      printf("[mkfs] Error %s is not an ESDM database\n", tgt);
+      ret = ESDM_ERROR;
+    }
+  }
+
+  if (ret == ESDM_SUCCESS && (format_flags & ESDM_FORMAT_CREATE)) {
+    if (isEsdmDatabase(data)) {
+      if (ignore_err) {
+        printf("[mkfs] WARNING %s exists already\n", tgt);
+      } else {
+        printf("[mkfs] Error %s exists already\n", tgt);
+        ret = ESDM_ERROR;
+      }
+    } else {
+      printf("[mkfs] Creating %s\n", tgt);
+      ret = beginTransaction(data);
+      if (ret == ESDM_SUCCESS) ret = endTransaction(data, execSql(data, kSchema));
+    }
+  }
+  g_mutex_unlock(&data->lock);
+
+  return ret;
+}
+
+static int fsck(esdm_md_backend_t* backend) {
+  DEBUG_ENTER;
+  sqlite_backend_data_t *data = backend->data;
+
+  g_mutex_lock(&data->lock);
+  sqlite3_stmt *statement = prepare(data, "PRAGMA integrity_check;");
+  int ret = ESDM_ERROR;
+  if (statement) {
+    if (sqlite3_step(statement) == SQLITE_ROW && !strcmp((const char*)sqlite3_column_text(statement, 0), "ok")) ret = ESDM_SUCCESS;
+    sqlite3_finalize(statement);
+  }
+  g_mutex_unlock(&data->lock);
+
+  return ret;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Container Helpers //////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+static int container_create(esdm_md_backend_t *backend, esdm_container_t *container, int allow_overwrite) {
+  DEBUG_ENTER;
+  sqlite_backend_data_t *data = backend->data;
+
+  g_mutex_lock(&data->lock);
+  int ret = beginTransaction(data);
+  if (ret == ESDM_SUCCESS) {
+    ret = bumpVersion(data);
+    sqlite3_stmt *statement = ret == ESDM_SUCCESS ? prepare(data, allow_overwrite ?
+      "INSERT OR REPLACE INTO containers(name, json, version) VALUES(?1, NULL, " kCurrentVersion ");" :
+      "INSERT INTO containers(name, json, version) VALUES(?1, NULL, " kCurrentVersion ");") : NULL;
+    ret = ESDM_ERROR;
+    if (statement) {
+      sqlite3_bind_text(statement, 1, container->name, -1, SQLITE_STATIC);
+      ret = sqlite3_step(statement) == SQLITE_DONE ? ESDM_SUCCESS : ESDM_ERROR;  //a constraint violation is the expected error for an existing container
+      sqlite3_finalize(statement);
+    }
+    ret = endTransaction(data, ret);
+  }
+  g_mutex_unlock(&data->lock);
+
+  return ret;
+}
+
+static int container_remove(esdm_md_backend_t *backend, esdm_container_t *c){
+  DEBUG_ENTER;
+  sqlite_backend_data_t *data = backend->data;
+
+  g_mutex_lock(&data->lock);
+  sqlite3_stmt *statement = prepare(data, "DELETE FROM containers WHERE name = ?1;");
+  int ret = ESDM_ERROR;
+  if (statement) {
+    sqlite3_bind_text(statement, 1, c->name, -1, SQLITE_STATIC);
+    ret = stepDone(data, statement);
+    if (ret == ESDM_SUCCESS && !sqlite3_changes(data->db)) ret = ESDM_ERROR;
+  }
+  g_mutex_unlock(&data->lock);
+
+  return ret;
+}
+
+static int container_commit(esdm_md_backend_t *backend, esdm_container_t *container, char * json, int md_size) {
+  DEBUG_ENTER;
+  sqlite_backend_data_t *data = backend->data;
+
+  g_mutex_lock(&data->lock);
+  int ret = beginTransaction(data);
+  if (ret == ESDM_SUCCESS) {
+    ret = bumpVersion(data);
+    sqlite3_stmt *statement = ret == ESDM_SUCCESS ? prepare(data, "INSERT OR REPLACE INTO containers(name, json, version) VALUES(?1, ?2, " kCurrentVersion ");") : NULL;
+    ret = ESDM_ERROR;
+    if (statement) {
+      sqlite3_bind_text(statement, 1, container->name, -1, SQLITE_STATIC);
+      sqlite3_bind_blob(statement, 2, json, md_size, SQLITE_STATIC);
+      ret = stepDone(data, statement);
+    }
+    ret = endTransaction(data, ret);
+  }
+  g_mutex_unlock(&data->lock);
+
+  return ret;
+}
+
+static int container_retrieve(esdm_md_backend_t *backend, esdm_container_t *container, char ** out_json, int * out_size) {
+  DEBUG_ENTER;
+  sqlite_backend_data_t *data = backend->data;
+
+  g_mutex_lock(&data->lock);
+  sqlite3_stmt *statement = prepare(data, "SELECT json FROM containers WHERE name = ?1;");
+  int ret = ESDM_ERROR;
+  if (statement) {
+    sqlite3_bind_text(statement, 1, container->name, -1, SQLITE_STATIC);
+    if (sqlite3_step(statement) == SQLITE_ROW) {
+      columnCopy(statement, 0, out_json, out_size);  //a container that was never committed yields an empty string, like an empty file
+      ret = ESDM_SUCCESS;
+    }
+    sqlite3_finalize(statement);
+  }
+  g_mutex_unlock(&data->lock);
+
+  return ret;
+}
+
+static int container_stamp(esdm_md_backend_t *backend, esdm_container_t *container, esdm_md_stamp_t *out_stamp) {
+  DEBUG_ENTER;
+  return readVersion(backend->data, "SELECT version FROM containers WHERE name = ?1;", container->name, out_stamp);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Dataset Helpers ////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+static int dataset_create(esdm_md_backend_t * backend, esdm_dataset_t *d){
+  DEBUG_ENTER;
+  eassert(backend);
+  eassert(d);
+  sqlite_backend_data_t *data = backend->data;
+
+  g_mutex_lock(&data->lock);
+  int ret = beginTransaction(data);
+  if (ret == ESDM_SUCCESS) ret = bumpVersion(data);
+  sqlite3_stmt *statement = ret == ESDM_SUCCESS ? prepare(data, "INSERT OR IGNORE INTO datasets(id, snapshot, version) VALUES(?1, NULL, " kCurrentVersion ");") : NULL;
+  if (!statement) ret = ESDM_ERROR;
+  while(ret == ESDM_SUCCESS) {
+    //the primary key makes the reservation of the ID atomic, even across processes
+    d->id = ea_make_id(ESDM_ID_LENGTH);
+    sqlite3_reset(statement);
+    sqlite3_bind_text(statement, 1, d->id, -1, SQLITE_STATIC);
+    if (sqlite3_step(statement) != SQLITE_DONE) {
+      ESDM_WARN_FMT("SQLite error in \"%s\": %s", data->target, sqlite3_errmsg(data->db));
+      ret = ESDM_ERROR;
+    } else if (sqlite3_changes(data->db)) {
+      break;
+    }
+    free(d->id);  //we'll make a new ID
+    d->id = NULL;
+  }
+  sqlite3_finalize(statement);
+  ret = endTransaction(data, ret);
+  g_mutex_unlock(&data->lock);
+
+  return ret;
+}
+
+static int dataset_remove(esdm_md_backend_t * backend, esdm_dataset_t *d){
+  DEBUG_ENTER;
+  sqlite_backend_data_t *data = backend->data;
+
+  g_mutex_lock(&data->lock);
+  int ret = beginTransaction(data);
+  if (ret == ESDM_SUCCESS) {
+    ret = unindexDataset(data, d);
+    if (ret == ESDM_SUCCESS) {
+      sqlite3_stmt *statement = prepare(data, "DELETE FROM journal WHERE dataset = ?1;");
+      ret = ESDM_ERROR;
+      if (statement) {
+        sqlite3_bind_text(statement, 1, d->id, -1, SQLITE_STATIC);
+        ret = stepDone(data, statement);
+      }
+    }
+    if (ret == ESDM_SUCCESS) {
+      sqlite3_stmt *statement = prepare(data, "DELETE FROM datasets WHERE id = ?1;");
+      ret = ESDM_ERROR;
+      if (statement) {
+        sqlite3_bind_text(statement, 1, d->id, -1, SQLITE_STATIC);
+        ret = stepDone(data, statement);
+        if (ret == ESDM_SUCCESS && !sqlite3_changes(data->db)) ret = ESDM_ERROR;
+      }
+    }
+    ret = endTransaction(data, ret);
+  }
+  g_mutex_unlock(&data->lock);
+
+  return ret;
+}
+
+static int dataset_commit(esdm_md_backend_t *backend, esdm_dataset_t *dataset, char * json, int md_size) {
+  DEBUG_ENTER;
+  sqlite_backend_data_t *data = backend->data;
+
+  g_mutex_lock(&data->lock);
+  int ret = beginTransaction(data);
+  if (ret == ESDM_SUCCESS) {
+    ret = bumpVersion(data);
+    sqlite3_stmt *statement = ret == ESDM_SUCCESS ? prepare(data, "INSERT OR REPLACE INTO datasets(id, snapshot, version) VALUES(?1, ?2, " kCurrentVersion ");") : NULL;
+    ret = ESDM_ERROR;
+    if (statement) {
+      sqlite3_bind_text(statement, 1, dataset->id, -1, SQLITE_STATIC);
+      sqlite3_bind_blob(statement, 2, json, md_size, SQLITE_STATIC);
+      ret = stepDone(data, statement);
+    }
+
+    // the new snapshot contains everything that was journaled
+    if (ret == ESDM_SUCCESS) {
+      statement = prepare(data, "DELETE FROM journal WHERE dataset = ?1;");
+      ret = ESDM_ERROR;
+      if (statement) {
+        sqlite3_bind_text(statement, 1, dataset->id, -1, SQLITE_STATIC);
+        ret = stepDone(data, statement);
+      }
+    }
+    //The index already has all fragments that were committed before, so only the new ones need to be added.
+    //ESDM has loaded all fragments before it creates a snapshot, so if the counts disagree (e.g. because fragments were dropped), the index is rebuilt from memory.
+    if (ret == ESDM_SUCCESS) ret = indexFragments(data, dataset, dataset->fragments.uncommittedCount, dataset->fragments.uncommitted);
+    if (ret == ESDM_SUCCESS && indexedFragmentCount(data, dataset) != g_hash_table_size(dataset->fragments.table)) {
+      DEBUG("rebuilding the fragment index of dataset %s", dataset->id);
+      int64_t fragmentCount;
+      esdm_fragment_t **fragments = esdmI_fragments_list(&dataset->fragments, &fragmentCount);
+      ret = unindexDataset(data, dataset);
+      if (ret == ESDM_SUCCESS) ret = indexFragments(data, dataset, fragmentCount, fragments);
+      free(fragments);
+    }
+    ret = endTransaction(data, ret);
+  }
+  g_mutex_unlock(&data->lock);
+
+  return ret;
+}
+
+static int dataset_append(esdm_md_backend_t *backend, esdm_dataset_t *dataset, char * json, int md_size) {
+  DEBUG_ENTER;
+  sqlite_backend_data_t *data = backend->data;
+
+  //the journal entry and the index entries of its fragments are committed atomically
+  g_mutex_lock(&data->lock);
+  int ret = beginTransaction(data);
+  if (ret == ESDM_SUCCESS) {
+    sqlite3_stmt *statement = prepare(data, "INSERT INTO journal(dataset, entry) VALUES(?1, ?2);");
+    ret = ESDM_ERROR;
+    if (statement) {
+      sqlite3_bind_text(statement, 1, dataset->id, -1, SQLITE_STATIC);
+      sqlite3_bind_blob(statement, 2, json, md_size, SQLITE_STATIC);
+      ret = stepDone(data, statement);
+    }
+    if (ret == ESDM_SUCCESS) ret = bumpVersion(data);
+    if (ret == ESDM_SUCCESS) {
+      statement = prepare(data, "UPDATE datasets SET version = " kCurrentVersion " WHERE id = ?1;");
+      ret = ESDM_ERROR;
+      if (statement) {
+        sqlite3_bind_text(statement, 1, dataset->id, -1, SQLITE_STATIC);
+        ret = stepDone(data, statement);
+      }
+    }
+    if (ret == ESDM_SUCCESS) ret = indexFragments(data, dataset, dataset->fragments.uncommittedCount, dataset->fragments.uncommitted);
+    ret = endTransaction(data, ret);
+  }
+  g_mutex_unlock(&data->lock);
+
+  return ret;
+}
+
+static int dataset_retrieve_journal(esdm_md_backend_t *backend, esdm_dataset_t *d, char ** out_json, int * out_size) {
+  DEBUG_ENTER;
+  sqlite_backend_data_t *data = backend->data;
+
+  *out_json = NULL;
+  *out_size = 0;
+
+  g_mutex_lock(&data->lock);
+  sqlite3_stmt *statement = prepare(data, "SELECT entry FROM journal WHERE dataset = ?1 ORDER BY seq;");
+  if (!statement) {
+    g_mutex_unlock(&data->lock);
+    return ESDM_ERROR;
+  }
+  sqlite3_bind_text(statement, 1, d->id, -1, SQLITE_STATIC);
+
+  //the journal is the concatenation of all entries
+  char *json = NULL;
+  int64_t size = 0;
+  int ret;
+  while ((ret = sqlite3_step(statement)) == SQLITE_ROW) {
+    int entrySize = sqlite3_column_bytes(statement, 0);
+    json = ea_checked_realloc(json, size + entrySize + 1);
+    memcpy(json + size, sqlite3_column_blob(statement, 0), entrySize);
+    size += entrySize;
+    json[size] = 0;
+  }
+  if (ret != SQLITE_DONE) ESDM_WARN_FMT("SQLite error in \"%s\": %s", data->target, sqlite3_errmsg(data->db));
+  sqlite3_finalize(statement);
+  g_mutex_unlock(&data->lock);
+
+  if (ret != SQLITE_DONE) {
+    free(json);
+    return ESDM_ERROR;
+  }
+  if (size) {
+    *out_json = json;
+    *out_size = size;
+  } else {
+    free(json);
+  }
+  return ESDM_SUCCESS;
+}
+
+typedef struct {
+  char *tables;
+  int64_t size, allocated;
+} recordCollector_t;
+
+static void collectRecord(sqlite3_stmt *statement, esdmI_hypercube_t *extends, void *userData) {
+  recordCollector_t *me = userData;
+  int size = sqlite3_column_bytes(statement, 2);
+  if(me->size + size > me->allocated) {
+    me->allocated = me->size + size > 2*me->allocated ? me->size + size : 2*me->allocated;
+    me->tables = ea_checked_realloc(me->tables, me->allocated);
+  }
+  if(size) memcpy(me->tables + me->size, sqlite3_column_blob(statement, 2), size);
+  me->size += size;
+  esdmI_hypercube_destroy(extends);
+}
+
+static int dataset_fragments_in_region(esdm_md_backend_t *backend, esdm_dataset_t *d, esdmI_hypercube_t *region, char **out_tables, int64_t *out_size) {
+  DEBUG_ENTER;
+  sqlite_backend_data_t *data = backend->data;
+
+  //each record is a complete fragment table, so the records just need to be concatenated
+  recordCollector_t collector = { .tables = ea_checked_malloc(1024), .size = 0, .allocated = 1024 };
+  g_mutex_lock(&data->lock);
+  int ret = queryRegion(data, d, region, collectRecord, &collector);
+  g_mutex_unlock(&data->lock);
+
+  if(ret != ESDM_SUCCESS) {
+    free(collector.tables);
+    *out_tables = NULL;
+    *out_size = 0;
+    return ret;
+  }
+  *out_tables = collector.tables;
+  *out_size = collector.size;
+  return ESDM_SUCCESS;
+}
+
+static int dataset_stamp(esdm_md_backend_t *backend, esdm_dataset_t *d, esdm_md_stamp_t *out_stamp) {
+  DEBUG_ENTER;
+  return readVersion(backend->data, "SELECT version FROM datasets WHERE id = ?1 AND snapshot IS NOT NULL;", d->id, out_stamp);
+}
+
+static int dataset_retrieve(esdm_md_backend_t *backend, esdm_dataset_t *d, char ** out_json, int * out_size) {
+  DEBUG_ENTER;
+  sqlite_backend_data_t *data = backend->data;
+
+  g_mutex_lock(&data->lock);
+  sqlite3_stmt *statement = prepare(data, "SELECT snapshot FROM datasets WHERE id = ?1 AND snapshot IS NOT NULL;");
+  int ret = ESDM_ERROR;
+  if (statement) {
+    sqlite3_bind_text(statement, 1, d->id, -1, SQLITE_STATIC);
+    if (sqlite3_step(statement) == SQLITE_ROW) {
+      columnCopy(statement, 0, out_json, out_size);
+      ret = ESDM_SUCCESS;
+    }
+    sqlite3_finalize(statement);
+  }
+  g_mutex_unlock(&data->lock);
+
+  return ret;
+}
+
+//Reads the requested part of the snapshot with SQLite's incremental blob I/O, which does not load the rest of the blob.
+static int dataset_retrieve_range(esdm_md_backend_t *backend, esdm_dataset_t *d, int64_t offset, int64_t size, char * out_data, int64_t * out_size) {
+  DEBUG_ENTER;
+  sqlite_backend_data_t *data = backend->data;
+
+  g_mutex_lock(&data->lock);
+  sqlite3_stmt *statement = prepare(data, "SELECT rowid, length(snapshot) FROM datasets WHERE id = ?1 AND snapshot IS NOT NULL;");
+  int ret = ESDM_ERROR;
+  if (statement) {
+    sqlite3_bind_text(statement, 1, d->id, -1, SQLITE_STATIC);
+    if (sqlite3_step(statement) == SQLITE_ROW) {
+      sqlite3_int64 row = sqlite3_column_int64(statement, 0);
+      int64_t length = sqlite3_column_int64(statement, 1);
+      int64_t count = offset < length ? length - offset : 0;
+      if (count > size) count = size;
+      sqlite3_blob *blob;
+      if (!count) {
+        *out_size = 0;
+        ret = ESDM_SUCCESS;
+      } else if (sqlite3_blob_open(data->db, "main", "datasets", "snapshot", row, 0, &blob) == SQLITE_OK) {
+        if (sqlite3_blob_read(blob, out_data, count, offset) == SQLITE_OK) {
+          *out_size = count;
+          ret = ESDM_SUCCESS;
+        }
+        sqlite3_blob_close(blob);
+      }
+      if (ret != ESDM_SUCCESS) ESDM_WARN_FMT("SQLite error in \"%s\": %s", data->target, sqlite3_errmsg(data->db));
+    }
+    sqlite3_finalize(statement);
+  }
+  g_mutex_unlock(&data->lock);
+
+  return ret;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ESDM Callbacks /////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+static int sqlite_backend_performance_estimate(esdm_md_backend_t *backend, esdm_fragment_t *fragment, float *out_time) {
+  DEBUG_ENTER;
+  *out_time = 0;
+
+  return 0;
+}
+
+static int sqlite_finalize(esdm_md_backend_t *me) {
+  DEBUG_ENTER;
+  sqlite_backend_data_t *data = me->data;
+
+  sqlite3_close(data->db);
+  g_mutex_clear(&data->lock);
+  free(data);
+  free(me->config);
+  free(me);
+
+  return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// ESDM Module Registration ///////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+static esdm_md_backend_t backend_template = {
+  .name = "sqlite",
+  .version = "0.0.1",
+  .data = NULL,
+  .callbacks = {
+    // General for ESDM
+    .finalize = sqlite_finalize,
+    .performance_estimate = sqlite_backend_performance_estimate,
+
+    .container_create = container_create,
+    .container_commit = container_commit,
+    .container_retrieve = container_retrieve,
+    .container_remove = container_remove,
+    .container_stamp = container_stamp,
+
+    .dataset_create = dataset_create,
+    .dataset_commit = dataset_commit,
+    .dataset_retrieve = dataset_retrieve,
+    .dataset_remove = dataset_remove,
+    .dataset_append = dataset_append,
+    .dataset_retrieve_journal = dataset_retrieve_journal,
+    .dataset_stamp = dataset_stamp,
+    .dataset_fragments_in_region = dataset_fragments_in_region,
+    .dataset_retrieve_range = dataset_retrieve_range,
+
+    .mkfs = mkfs,
+    .fsck = fsck,
+  },
+};
+
+esdm_md_backend_t *sqlite_backend_init(esdm_config_backend_t *config) {
+  DEBUG_ENTER;
+
+  esdm_md_backend_t *backend = ea_checked_malloc(sizeof(esdm_md_backend_t));
+  memcpy(backend, &backend_template, sizeof(esdm_md_backend_t));
+
+  sqlite_backend_data_t *data = ea_checked_malloc(sizeof(sqlite_backend_data_t));
+  data->target = config->target;
+  g_mutex_init(&data->lock);
+  if (sqlite3_open_v2(data->target, &data->db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_FULLMUTEX, NULL) != SQLITE_OK) {
+    ESDM_ERROR_FMT("cannot open the SQLite database \"%s\": %s", data->target, sqlite3_errmsg(data->db));
+  }
+  sqlite3_busy_timeout(data->db, kBusyTimeoutMs);
+  //WAL mode allows readers to proceed while a commit is in progress, and a commit only needs to sync the log
+  execSql(data, "PRAGMA journal_mode = WAL; PRAGMA synchronous = NORMAL;");
+
+  backend->data = data;
+  backend->config = config;
+
+  return backend;
+}
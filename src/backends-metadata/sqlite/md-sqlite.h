@@ -0,0 +1,58 @@
+/* This file is part of ESDM.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with ESDM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MD_SQLITE_H
+#define MD_SQLITE_H
+
+#include <esdm-internal.h>
+
+//A reference to a fragment as it is stored in the index of the SQLite backend.
+typedef struct {
+  char* backendId;
+  char* fragmentId;
+  esdmI_hypercube_t* extends;
+} sqlite_fragment_ref_t;
+
+/**
+ * Initializes the SQLite metadata backend.
+ *
+ * The backend keeps all metadata in a single embedded SQLite database at the configured target path,
+ * no external service is required.
+ * The database is opened in WAL mode, so that several processes may read the metadata while another one commits.
+ * In addition to the snapshots and journals that ESDM hands to the backend,
+ * the fragments of each dataset are recorded in an R*Tree index that allows region queries.
+ *
+ * Takes possession of the config argument. Pass a `malloc()`ed object.
+ *
+ * @return pointer to backend struct
+ */
+esdm_md_backend_t *sqlite_backend_init(esdm_config_backend_t *config);
+
+/**
+ * Query the fragment index of the SQLite backend for all committed fragments of a dataset that intersect a region.
+ *
+ * @param [in] backend a backend that was created by `sqlite_backend_init()`
+ * @param [in] dataset the dataset to query
+ * @param [in] region the region to query, must have the dimension count of the dataset
+ * @param [out] out_count the number of returned references
+ * @param [out] out_refs a newly allocated array of fragment references, must be destroyed with `sqlite_backend_freeFragmentRefs()`
+ *
+ * @return status
+ */
+esdm_status sqlite_backend_fragmentsInRegion(esdm_md_backend_t *backend, esdm_dataset_t *dataset, esdmI_hypercube_t *region, int64_t *out_count, sqlite_fragment_ref_t **out_refs);
+
+void sqlite_backend_freeFragmentRefs(int64_t count, sqlite_fragment_ref_t *refs);
+
+#endif
@@ -0,0 +1,134 @@
+/**
+* This test checks that the SQLite metadata backend persists snapshots and journals,
+* and that its fragment index answers region queries.
+* A partial read of a reopened dataset must only load the fragments of its region from the index.
+*/
+
+#include <backends-metadata/sqlite/md-sqlite.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void writeQuadrant(esdm_dataset_t *dataset, int64_t x, int64_t y) {
+  int64_t offset[2] = {x, y}, size[2] = {10, 10};
+  esdm_dataspace_t *space;
+  esdm_status ret = esdm_dataspace_create_full(2, size, offset, SMD_DTYPE_UINT64, &space);
+  eassert(ret == ESDM_SUCCESS);
+  uint64_t data[10][10];
+  for(int64_t i = 0; i < 10; i++) {
+    for(int64_t j = 0; j < 10; j++) data[i][j] = (x + i)*20 + y + j;
+  }
+  ret = esdm_write(dataset, data, space);
+  eassert(ret == ESDM_SUCCESS);
+  esdm_dataspace_destroy(space);
+}
+
+static int64_t countFragments(esdm_dataset_t *dataset, int64_t x, int64_t y, int64_t width, int64_t height) {
+  int64_t offset[2] = {x, y}, size[2] = {width, height};
+  esdmI_hypercube_t *region = esdmI_hypercube_make(2, offset, size);
+  int64_t count;
+  sqlite_fragment_ref_t *refs;
+  esdm_status ret = sqlite_backend_fragmentsInRegion(esdm_get_modules()->metadata_backend, dataset, region, &count, &refs);
+  eassert(ret == ESDM_SUCCESS);
+  for(int64_t i = 0; i < count; i++) {
+    eassert(!strcmp(refs[i].backendId, "p1"));
+    eassert(esdmI_hypercube_doesIntersect(refs[i].extends, region));
+  }
+  sqlite_backend_freeFragmentRefs(count, refs);
+  esdmI_hypercube_destroy(region);
+  return count;
+}
+
+int main() {
+  esdm_status ret;
+  char const * cfg = "{\"esdm\": {\"backends\": ["
+  		"{"
+			"\"type\": \"POSIX\","
+			"\"id\": \"p1\","
+			"\"accessibility\": \"global\","
+			"\"target\": \"./_posix1\""
+			"}"
+    "],"
+		"\"metadata\": {"
+			"\"type\": \"sqlite\","
+			"\"id\": \"md\","
+			"\"target\": \"./_esdm.sqlite\"}}"
+    "}";
+  esdm_load_config_str(cfg);
+  esdm_init();
+
+  ret = esdm_mkfs(ESDM_FORMAT_PURGE_RECREATE, ESDM_ACCESSIBILITY_GLOBAL);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_mkfs(ESDM_FORMAT_PURGE_RECREATE, ESDM_ACCESSIBILITY_NODELOCAL);
+  eassert(ret == ESDM_SUCCESS);
+
+  esdm_simple_dspace_t dataspace = esdm_dataspace_2d(20, 20, SMD_DTYPE_UINT64);
+  eassert(dataspace.ptr);
+  esdm_container_t *container;
+  ret = esdm_container_create("testContainer", 1, &container);
+  eassert(ret == ESDM_SUCCESS);
+  esdm_dataset_t *dataset;
+  ret = esdm_dataset_create(container, "testDataset", dataspace.ptr, &dataset);
+  eassert(ret == ESDM_SUCCESS);
+
+  //the first commit creates a snapshot, the second one only appends to the journal
+  writeQuadrant(dataset, 0, 0);
+  writeQuadrant(dataset, 0, 10);
+  ret = esdm_dataset_commit(dataset);
+  eassert(ret == ESDM_SUCCESS);
+  writeQuadrant(dataset, 10, 0);
+  writeQuadrant(dataset, 10, 10);
+  ret = esdm_dataset_commit(dataset);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_container_commit(container);
+  eassert(ret == ESDM_SUCCESS);
+
+  eassert(countFragments(dataset, 0, 0, 5, 5) == 1);
+  eassert(countFragments(dataset, 8, 8, 4, 4) == 4);
+  eassert(countFragments(dataset, 12, 0, 8, 20) == 2);
+  eassert(countFragments(dataset, 5, 5, 0, 5) == 0);
+
+  ret = esdm_dataset_close(dataset);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_container_close(container);
+  eassert(ret == ESDM_SUCCESS);
+
+  //reopen the dataset from the database and check that all fragments are found
+  ret = esdm_container_open("testContainer", ESDM_MODE_FLAG_READ, &container);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_dataset_open(container, "testDataset", ESDM_MODE_FLAG_READ, &dataset);
+  eassert(ret == ESDM_SUCCESS);
+  eassert(dataset->fragmentPages);  //the snapshot holds the first two quadrants, the other two are replayed from the journal
+  eassert(g_hash_table_size(dataset->fragments.table) == 2);
+  uint64_t corner[5][5];
+  esdm_simple_dspace_t cornerSpace = esdm_dataspace_2do(0, 5, 0, 5, SMD_DTYPE_UINT64);
+  ret = esdm_read(dataset, corner, cornerSpace.ptr);
+  eassert(ret == ESDM_SUCCESS);
+  for(int64_t i = 0; i < 5; i++) {
+    for(int64_t j = 0; j < 5; j++) eassert(corner[i][j] == i*20 + j);
+  }
+  esdm_dataspace_destroy(cornerSpace.ptr);
+  eassert(dataset->fragmentPages);
+  eassert(g_hash_table_size(dataset->fragments.table) == 3);  //only the quadrant that was read has been added
+
+  uint64_t data[20][20];
+  ret = esdm_read(dataset, data, dataspace.ptr);
+  eassert(ret == ESDM_SUCCESS);
+  for(int64_t i = 0; i < 20; i++) {
+    for(int64_t j = 0; j < 20; j++) eassert(data[i][j] == i*20 + j);
+  }
+  eassert(countFragments(dataset, 0, 0, 20, 20) == 4);
+  eassert(!dataset->fragmentPages);  //the read covered the entire page, so it does not need to be decoded anymore
+  eassert(g_hash_table_size(dataset->fragments.table) == 4);
+
+  ret = esdm_dataset_close(dataset);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_container_close(container);
+  eassert(ret == ESDM_SUCCESS);
+
+  esdm_dataspace_destroy(dataspace.ptr);
+  esdm_finalize();
+
+  printf("\nOK\n");
+  return 0;
+}
@@ -0,0 +1,181 @@
+/* This file is part of ESDM.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with ESDM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ * @brief Records the shapes of the regions that are read from a dataset,
+ *        and derives fragment shapes that minimize the expected read amplification.
+ */
+
+#include <esdm-internal.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const double kDecay = 1 - 1.0/64; //weight of the old reads when a new read is recorded
+static const double kMinWeight = 4; //the weighted number of reads that we need to see before we trust the pattern
+
+void esdmI_accessPattern_construct(esdmI_accessPattern_t* me) {
+  eassert(me);
+  *me = (esdmI_accessPattern_t){
+    .dims = 0,
+    .shapeCount = 0,
+    .sizes = NULL
+  };
+}
+
+static void ensureDims(esdmI_accessPattern_t* me, int64_t dims) {
+  if(me->sizes && me->dims == dims) return;
+  free(me->sizes);
+  me->dims = dims;
+  me->shapeCount = 0;
+  me->sizes = ea_checked_malloc(ESDMI_ACCESS_PATTERN_SHAPES*dims*sizeof(*me->sizes));
+}
+
+void esdmI_accessPattern_recordRead(esdmI_accessPattern_t* me, esdmI_hypercube_t* region) {
+  eassert(me);
+  eassert(region);
+  if(region->dims <= 0) return;
+  ensureDims(me, region->dims);
+
+  int64_t size[region->dims];
+  for(int64_t i = 0; i < region->dims; i++) size[i] = esdmI_range_size(region->ranges[i]);
+
+  //age the old reads and search for the shape of this read
+  int64_t match = -1, weakest = 0;
+  for(int64_t i = 0; i < me->shapeCount; i++) {
+    me->weights[i] *= kDecay;
+    if(me->weights[i] < me->weights[weakest]) weakest = i;
+    if(!memcmp(&me->sizes[i*me->dims], size, sizeof(size))) match = i;
+  }
+
+  if(match < 0) {
+    //new shape, add it to the table, replacing the least relevant entry if the table is full
+    match = me->shapeCount < ESDMI_ACCESS_PATTERN_SHAPES ? me->shapeCount++ : weakest;
+    memcpy(&me->sizes[match*me->dims], size, sizeof(size));
+    me->weights[match] = 0;
+  }
+  me->weights[match] += 1;
+}
+
+void esdmI_accessPattern_serialize(smd_string_stream_t* stream, const esdmI_accessPattern_t* me) {
+  eassert(stream);
+  eassert(me);
+
+  smd_string_stream_printf(stream, "{\"shapes\":[");
+  for(int64_t i = 0; i < me->shapeCount; i++) {
+    smd_string_stream_printf(stream, "%s{\"w\":%g,\"size\":[", i ? "," : "", me->weights[i]);
+    for(int64_t d = 0; d < me->dims; d++) {
+      smd_string_stream_printf(stream, "%s%"PRId64, d ? "," : "", me->sizes[i*me->dims + d]);
+    }
+    smd_string_stream_printf(stream, "]}");
+  }
+  smd_string_stream_printf(stream, "]}");
+}
+
+esdm_status esdmI_accessPattern_loadJson(esdmI_accessPattern_t* me, json_t* json) {
+  eassert(me);
+  eassert(json);
+
+  json_t* shapes = jansson_object_get(json, "shapes");
+  if(!shapes || !json_is_array(shapes)) return ESDM_INVALID_DATA_ERROR;
+  me->shapeCount = 0;
+  for(size_t i = 0; i < json_array_size(shapes) && me->shapeCount < ESDMI_ACCESS_PATTERN_SHAPES; i++) {
+    json_t* shape = json_array_get(shapes, i);
+    json_t* weight = jansson_object_get(shape, "w");
+    json_t* size = jansson_object_get(shape, "size");
+    if(!weight || !size || !json_is_array(size) || json_array_size(size) == 0) return ESDM_INVALID_DATA_ERROR;
+    ensureDims(me, json_array_size(size));
+    if(me->dims != json_array_size(size)) return ESDM_INVALID_DATA_ERROR;
+
+    int64_t index = me->shapeCount++;
+    me->weights[index] = json_number_value(weight);
+    for(int64_t d = 0; d < me->dims; d++) {
+      me->sizes[index*me->dims + d] = json_integer_value(json_array_get(size, d));
+      if(me->sizes[index*me->dims + d] <= 0) return ESDM_INVALID_DATA_ERROR;
+    }
+  }
+  return ESDM_SUCCESS;
+}
+
+void esdmI_accessPattern_destruct(esdmI_accessPattern_t* me) {
+  eassert(me);
+  free(me->sizes);
+  esdmI_accessPattern_construct(me);
+}
+
+//The expected read amplification when reading the recorded shapes from fragments of the given shape,
+//i.e. the weighted average of the ratio between the loaded and the requested data.
+//When a read of size r hits randomly aligned fragments of size e, it touches r + e - 1 elements in that dimension on average.
+static double expectedAmplification(const esdmI_accessPattern_t* me, const int64_t* edges) {
+  double result = 0;
+  for(int64_t i = 0; i < me->shapeCount; i++) {
+    double amplification = me->weights[i];
+    for(int64_t d = 0; d < me->dims; d++) {
+      double readSize = me->sizes[i*me->dims + d];
+      amplification *= (readSize + edges[d] - 1)/readSize;
+    }
+    result += amplification;
+  }
+  return result;
+}
+
+bool esdmI_accessPattern_fragmentShape(const esdmI_accessPattern_t* me, esdm_dataspace_t* space, int64_t maxFragmentSize, int64_t* out_edges) {
+  eassert(me);
+  eassert(space);
+  eassert(out_edges);
+
+  if(me->dims != space->dims || !me->shapeCount) return false;
+  double totalWeight = 0;
+  for(int64_t i = 0; i < me->shapeCount; i++) totalWeight += me->weights[i];
+  if(totalWeight < kMinWeight) return false;
+
+  int64_t maxElements = maxFragmentSize/esdm_sizeof(esdm_dataspace_get_type(space));
+  if(maxElements < 1) maxElements = 1;
+
+  //Grow the fragment from a single element, always extending the dimension that increases the expected amplification the least,
+  //until the fragment has reached the max fragment size or covers the entire dataspace.
+  //Ties go to the dimensions that come last, as these are usually the ones with the smallest strides.
+  int64_t elements = 1;
+  for(int64_t d = 0; d < space->dims; d++) out_edges[d] = 1;
+  while(true) {
+    double currentAmplification = expectedAmplification(me, out_edges);
+    int64_t bestDim = -1, bestEdge = 0;
+    double bestCost = 0;
+    for(int64_t d = space->dims; d--; ) {
+      int64_t otherElements = elements/out_edges[d];
+      int64_t newEdge = 2*out_edges[d];
+      if(newEdge > space->size[d]) newEdge = space->size[d];
+      if(newEdge > maxElements/otherElements) newEdge = maxElements/otherElements;
+      if(newEdge <= out_edges[d]) continue;
+
+      int64_t oldEdge = out_edges[d];
+      out_edges[d] = newEdge;
+      double cost = log(expectedAmplification(me, out_edges)/currentAmplification)/log(newEdge/(double)oldEdge); //relative increase of the amplification per relative increase of the fragment volume, as not all dimensions can be doubled
+      out_edges[d] = oldEdge;
+      if(bestDim < 0 || cost < bestCost) {
+        bestDim = d;
+        bestEdge = newEdge;
+        bestCost = cost;
+      }
+    }
+    if(bestDim < 0) break;
+    elements = elements/out_edges[bestDim]*bestEdge;
+    out_edges[bestDim] = bestEdge;
+  }
+
+  return true;
+}
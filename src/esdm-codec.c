@@ -0,0 +1,586 @@
+/* This file is part of ESDM.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with ESDM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ * @brief The built-in lossless compression pipeline.
+ *
+ * A pipeline is a sequence of stages that are applied one after the other when a fragment is packed,
+ * and in reverse order when it is unpacked.
+ * The shuffle and predictor stages do not change the size of the data, they only rearrange it so that the LZ stage finds more redundancy.
+ *
+ * The encoded data starts with a header that describes the pipeline, so decoding does not need any information from the dataset:
+ *
+ *     "ESDC" version stageCount elementSize stage[stageCount] rawSize(8 bytes, little endian) payload
+ *
+ * Large fragments are split into blocks of consecutive slices along one dimension, which are encoded independently,
+ * so that a read can fetch and decode only the blocks that it needs:
+ *
+ *     "ESDB" version splitDim reserved(2 bytes) rowsPerBlock(8 bytes) blockCount(8 bytes) offset[blockCount + 1](8 bytes each) blocks
+ *
+ * The offsets are relative to the start of the container, the last one is the size of the container.
+ * A block is either the output of `esdmI_codec_encode()`, or the raw data if that would not have been smaller.
+ *
+ * The inner loops are written so that the compiler can vectorize them,
+ * the element sizes 2, 4, and 8 are dispatched to specialized instances.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <esdm-internal.h>
+
+#define DEBUG(fmt, ...) ESDM_DEBUG_COM_FMT("CODEC", fmt, __VA_ARGS__)
+
+static const uint8_t kMagic[4] = {'E', 'S', 'D', 'C'};
+static const uint8_t kBlockMagic[4] = {'E', 'S', 'D', 'B'};
+enum {
+  kVersion = 1,
+  kBlockPrefix = 24,  //the part of the block container header that precedes the offsets
+  kMaxStages = 16,
+  kLzMinMatch = 4,
+  kLzHashBits = 14,
+  kLzMaxOffset = 65535,
+  kLzMaxSkip = 16
+};
+
+static int64_t headerSize(int64_t stageCount) {
+  return sizeof(kMagic) + 3 + stageCount + 8;
+}
+
+static void putU64(uint8_t* out, uint64_t value) {
+  for(int i = 0; i < 8; i++) out[i] = value >> 8*i;
+}
+
+static uint64_t getU64(const uint8_t* in) {
+  uint64_t result = 0;
+  for(int i = 0; i < 8; i++) result |= (uint64_t)in[i] << 8*i;
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Shuffle stages //////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//Group the n-th bytes of all elements together, the trailing bytes that do not form a complete element are copied.
+static inline void shuffleBytes(const uint8_t* restrict in, uint8_t* restrict out, int64_t size, int64_t elementSize) {
+  int64_t count = size/elementSize;
+  for(int64_t byte = 0; byte < elementSize; byte++) {
+    const uint8_t* src = in + byte;
+    uint8_t* dst = out + byte*count;
+    for(int64_t i = 0; i < count; i++) dst[i] = src[i*elementSize];
+  }
+  memcpy(out + count*elementSize, in + count*elementSize, size - count*elementSize);
+}
+
+static inline void unshuffleBytes(const uint8_t* restrict in, uint8_t* restrict out, int64_t size, int64_t elementSize) {
+  int64_t count = size/elementSize;
+  for(int64_t byte = 0; byte < elementSize; byte++) {
+    const uint8_t* src = in + byte*count;
+    uint8_t* dst = out + byte;
+    for(int64_t i = 0; i < count; i++) dst[i*elementSize] = src[i];
+  }
+  memcpy(out + count*elementSize, in + count*elementSize, size - count*elementSize);
+}
+
+static void byteShuffle(const uint8_t* in, uint8_t* out, int64_t size, int64_t elementSize, bool inverse) {
+  //constant element sizes allow the compiler to vectorize the strided accesses
+  switch(elementSize) {
+    case 2: inverse ? unshuffleBytes(in, out, size, 2) : shuffleBytes(in, out, size, 2); break;
+    case 4: inverse ? unshuffleBytes(in, out, size, 4) : shuffleBytes(in, out, size, 4); break;
+    case 8: inverse ? unshuffleBytes(in, out, size, 8) : shuffleBytes(in, out, size, 8); break;
+    default: inverse ? unshuffleBytes(in, out, size, elementSize) : shuffleBytes(in, out, size, elementSize);
+  }
+}
+
+//Transpose an 8x8 bit matrix that is stored row by row in the bytes of `x`.
+static uint64_t transposeBits(uint64_t x) {
+  uint64_t t;
+  t = (x ^ (x >> 7)) & 0x00aa00aa00aa00aaull;
+  x ^= t ^ (t << 7);
+  t = (x ^ (x >> 14)) & 0x0000cccc0000ccccull;
+  x ^= t ^ (t << 14);
+  t = (x ^ (x >> 28)) & 0x00000000f0f0f0f0ull;
+  x ^= t ^ (t << 28);
+  return x;
+}
+
+//Group the n-th bits of all elements together.
+//This works on groups of eight elements, the elements that do not form a complete group are copied.
+static void bitShuffle(const uint8_t* in, uint8_t* out, int64_t size, int64_t elementSize, bool inverse) {
+  int64_t count = size/elementSize & ~(int64_t)7, groups = count/8;
+  int64_t bodySize = count*elementSize;
+  uint8_t* planes = ea_checked_malloc(bodySize ? bodySize : 1);  //the byte planes of the body
+
+  if(!inverse) byteShuffle(in, planes, bodySize, elementSize, false);
+  for(int64_t plane = 0; plane < elementSize; plane++) {
+    uint8_t* bytes = planes + plane*count;
+    uint8_t* bits = (inverse ? (uint8_t*)in : out) + plane*count;  //eight bit planes of `groups` bytes each
+    for(int64_t group = 0; group < groups; group++) {
+      uint64_t x = 0;
+      if(inverse) {
+        for(int i = 0; i < 8; i++) x |= (uint64_t)bits[i*groups + group] << 8*i;
+        x = transposeBits(x);
+        for(int i = 0; i < 8; i++) bytes[group*8 + i] = x >> 8*i;
+      } else {
+        for(int i = 0; i < 8; i++) x |= (uint64_t)bytes[group*8 + i] << 8*i;
+        x = transposeBits(x);
+        for(int i = 0; i < 8; i++) bits[i*groups + group] = x >> 8*i;
+      }
+    }
+  }
+  if(inverse) byteShuffle(planes, out, bodySize, elementSize, true);
+  memcpy(out + bodySize, in + bodySize, size - bodySize);
+
+  free(planes);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Predictor stages ////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//Defines the functions that replace each element by the difference/XOR to its predecessor, and the functions to undo that.
+//The encoders only read the input, so they vectorize, the decoders are inherently sequential.
+#define definePredictor(name, type, encodeOp, decodeOp) \
+static void name##Encode(const uint8_t* restrict in, uint8_t* restrict out, int64_t count) { \
+  if(count) memcpy(out, in, sizeof(type)); \
+  for(int64_t i = 1; i < count; i++) { \
+    type cur, prev; \
+    memcpy(&cur, in + i*sizeof(type), sizeof(type)); \
+    memcpy(&prev, in + (i - 1)*sizeof(type), sizeof(type)); \
+    type result = cur encodeOp prev; \
+    memcpy(out + i*sizeof(type), &result, sizeof(type)); \
+  } \
+} \
+static void name##Decode(const uint8_t* restrict in, uint8_t* restrict out, int64_t count) { \
+  type prev = 0; \
+  for(int64_t i = 0; i < count; i++) { \
+    type cur; \
+    memcpy(&cur, in + i*sizeof(type), sizeof(type)); \
+    prev = cur decodeOp prev; \
+    memcpy(out + i*sizeof(type), &prev, sizeof(type)); \
+  } \
+}
+
+definePredictor(delta8, uint8_t, -, +)
+definePredictor(delta16, uint16_t, -, +)
+definePredictor(delta32, uint32_t, -, +)
+definePredictor(delta64, uint64_t, -, +)
+definePredictor(xor8, uint8_t, ^, ^)
+definePredictor(xor16, uint16_t, ^, ^)
+definePredictor(xor32, uint32_t, ^, ^)
+definePredictor(xor64, uint64_t, ^, ^)
+#undef definePredictor
+
+//Element sizes other than 2, 4, and 8 bytes are treated as a sequence of bytes.
+static void predict(esdm_codec_stage_t stage, const uint8_t* in, uint8_t* out, int64_t size, int64_t elementSize, bool inverse) {
+  typedef void (*predictor_t)(const uint8_t* restrict, uint8_t* restrict, int64_t);
+  static const predictor_t deltaEncoders[4] = {delta8Encode, delta16Encode, delta32Encode, delta64Encode};
+  static const predictor_t deltaDecoders[4] = {delta8Decode, delta16Decode, delta32Decode, delta64Decode};
+  static const predictor_t xorEncoders[4] = {xor8Encode, xor16Encode, xor32Encode, xor64Encode};
+  static const predictor_t xorDecoders[4] = {xor8Decode, xor16Decode, xor32Decode, xor64Decode};
+
+  int sizeIndex = elementSize == 8 ? 3 : elementSize == 4 ? 2 : elementSize == 2 ? 1 : 0;
+  if(!sizeIndex) elementSize = 1;
+  const predictor_t* functions = stage == ESDM_CODEC_DELTA ? (inverse ? deltaDecoders : deltaEncoders) : (inverse ? xorDecoders : xorEncoders);
+  int64_t count = size/elementSize;
+  functions[sizeIndex](in, out, count);
+  memcpy(out + count*elementSize, in + count*elementSize, size - count*elementSize);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// LZ stage ////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//The LZ stage produces an 8 byte decoded size followed by a sequence of tokens.
+//Each token byte holds a literal count in its high nibble and the length of the following match minus `kLzMinMatch` in its low nibble.
+//A nibble value of 15 is followed by extension bytes that are added to it, a byte value of 255 means that another extension byte follows.
+//The literals follow the literal count, the two byte match offset follows the literals, and the match length extension bytes follow the offset.
+//The last token contains only literals, it ends with the input.
+
+static int64_t lzBound(int64_t size) {
+  return 8 + size + size/255 + 16;
+}
+
+static uint32_t lzHash(const uint8_t* p) {
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return (value*2654435761u) >> (32 - kLzHashBits);
+}
+
+static uint8_t* lzPutLength(uint8_t* out, int64_t length) {
+  for(length -= 15; length >= 255; length -= 255) *out++ = 255;
+  *out++ = length;
+  return out;
+}
+
+static uint8_t* lzPutLiterals(uint8_t* out, const uint8_t* literals, int64_t count, int64_t matchCode) {
+  *out++ = (count < 15 ? count : 15) << 4 | (matchCode < 15 ? matchCode : 15);
+  if(count >= 15) out = lzPutLength(out, count);
+  memcpy(out, literals, count);
+  return out + count;
+}
+
+//Returns the size of the compressed data, `out` must provide at least `lzBound(size)` bytes.
+static int64_t lzCompress(const uint8_t* in, int64_t size, uint8_t* out) {
+  int64_t* table = ea_checked_calloc(1 << kLzHashBits, sizeof(*table));  //positions + 1 of the last occurrences of the hashed sequences
+  uint8_t* cur = out;
+  putU64(cur, size);
+  cur += 8;
+
+  int64_t pos = 0, anchor = 0;
+  while(pos + kLzMinMatch <= size) {
+    uint32_t hash = lzHash(in + pos);
+    int64_t candidate = table[hash] - 1;
+    table[hash] = pos + 1;
+    if(candidate < 0 || pos - candidate > kLzMaxOffset || memcmp(in + candidate, in + pos, kLzMinMatch)) {
+      //skip faster through incompressible data, but not so fast that we would jump over a compressible region
+      int64_t skip = (pos - anchor) >> 6;
+      pos += 1 + (skip < kLzMaxSkip ? skip : kLzMaxSkip);
+      continue;
+    }
+
+    //extend the match, eight bytes at a time first
+    int64_t length = kLzMinMatch;
+    while(pos + length + 8 <= size && !memcmp(in + candidate + length, in + pos + length, 8)) length += 8;
+    while(pos + length < size && in[candidate + length] == in[pos + length]) length++;
+
+    cur = lzPutLiterals(cur, in + anchor, pos - anchor, length - kLzMinMatch);
+    int64_t offset = pos - candidate;
+    *cur++ = offset;
+    *cur++ = offset >> 8;
+    if(length - kLzMinMatch >= 15) cur = lzPutLength(cur, length - kLzMinMatch);
+    pos += length;
+    anchor = pos;
+  }
+  cur = lzPutLiterals(cur, in + anchor, size - anchor, 0);
+
+  free(table);
+  return cur - out;
+}
+
+static bool lzGetLength(const uint8_t** inout_in, const uint8_t* end, int64_t* inout_length) {
+  if(*inout_length != 15) return true;
+  while(true) {
+    if(*inout_in >= end) return false;
+    uint8_t byte = *(*inout_in)++;
+    *inout_length += byte;
+    if(byte != 255) return true;
+  }
+}
+
+static esdm_status lzDecompress(const uint8_t* in, int64_t size, uint8_t* out, int64_t outSize) {
+  if(size < 8 || (int64_t)getU64(in) != outSize) return ESDM_INVALID_DATA_ERROR;
+  const uint8_t* end = in + size;
+  in += 8;
+  int64_t pos = 0;
+  while(in < end) {
+    uint8_t token = *in++;
+    int64_t literals = token >> 4, length = token & 15;
+    if(!lzGetLength(&in, end, &literals)) return ESDM_INVALID_DATA_ERROR;
+    if(literals > end - in || literals > outSize - pos) return ESDM_INVALID_DATA_ERROR;
+    memcpy(out + pos, in, literals);
+    in += literals;
+    pos += literals;
+    if(in == end) break;  //the last token has no match
+
+    if(end - in < 2) return ESDM_INVALID_DATA_ERROR;
+    int64_t offset = in[0] | in[1] << 8;
+    in += 2;
+    if(!lzGetLength(&in, end, &length)) return ESDM_INVALID_DATA_ERROR;
+    length += kLzMinMatch;
+    if(!offset || offset > pos || length > outSize - pos) return ESDM_INVALID_DATA_ERROR;
+    if(offset >= length) {
+      memcpy(out + pos, out + pos - offset, length);
+    } else {
+      for(int64_t i = 0; i < length; i++) out[pos + i] = out[pos - offset + i];  //overlapping copy repeats the pattern
+    }
+    pos += length;
+  }
+  return pos == outSize ? ESDM_SUCCESS : ESDM_INVALID_DATA_ERROR;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Pipeline ////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+esdm_status esdmI_codec_create(int64_t stageCount, const esdm_codec_stage_t* stages, esdmI_codec_t** out_codec) {
+  eassert(out_codec);
+  if(stageCount <= 0 || stageCount > kMaxStages || !stages) return ESDM_INVALID_ARGUMENT_ERROR;
+  for(int64_t i = 0; i < stageCount; i++) {
+    if(stages[i] < ESDM_CODEC_BYTE_SHUFFLE || stages[i] > ESDM_CODEC_LZ) return ESDM_INVALID_ARGUMENT_ERROR;
+  }
+
+  esdmI_codec_t* result = ea_checked_malloc(sizeof(*result) + stageCount*sizeof(*result->stages));
+  result->stageCount = stageCount;
+  memcpy(result->stages, stages, stageCount*sizeof(*stages));
+  *out_codec = result;
+  return ESDM_SUCCESS;
+}
+
+void esdmI_codec_destroy(esdmI_codec_t* codec) {
+  free(codec);
+}
+
+//Applies one stage, the output must provide the bytes given by `stageOutputBound()`.
+static int64_t applyStage(esdm_codec_stage_t stage, const uint8_t* in, int64_t size, uint8_t* out, int64_t elementSize) {
+  switch(stage) {
+    case ESDM_CODEC_BYTE_SHUFFLE: byteShuffle(in, out, size, elementSize, false); return size;
+    case ESDM_CODEC_BIT_SHUFFLE: bitShuffle(in, out, size, elementSize, false); return size;
+    case ESDM_CODEC_DELTA:
+    case ESDM_CODEC_XOR: predict(stage, in, out, size, elementSize, false); return size;
+    case ESDM_CODEC_LZ: return lzCompress(in, size, out);
+  }
+  eassert(0 && "esdmI_codec_create() must only accept known stages");
+  return -1;
+}
+
+static int64_t stageOutputBound(esdm_codec_stage_t stage, int64_t size) {
+  return stage == ESDM_CODEC_LZ ? lzBound(size) : size;
+}
+
+esdm_status esdmI_codec_encode(const esdmI_codec_t* codec, int64_t elementSize, const void* data, int64_t size, void** out_buffer, int64_t* out_size) {
+  eassert(codec);
+  eassert(data || !size);
+  eassert(out_buffer);
+  eassert(out_size);
+
+  if(elementSize <= 0 || elementSize > 255) elementSize = 1;
+  int64_t header = headerSize(codec->stageCount);
+
+  //every stage writes behind a gap for the header, so that the output of the last stage does not need to be copied
+  const uint8_t* in = data;
+  uint8_t* inBuffer = NULL;
+  int64_t curSize = size;
+  for(int64_t i = 0; i < codec->stageCount; i++) {
+    uint8_t* outBuffer = ea_checked_malloc(header + stageOutputBound(codec->stages[i], curSize));
+    curSize = applyStage(codec->stages[i], in, curSize, outBuffer + header, elementSize);
+    free(inBuffer);
+    inBuffer = outBuffer;
+    in = outBuffer + header;
+  }
+
+  uint8_t* cur = inBuffer;
+  memcpy(cur, kMagic, sizeof(kMagic));
+  cur += sizeof(kMagic);
+  *cur++ = kVersion;
+  *cur++ = codec->stageCount;
+  *cur++ = elementSize;
+  for(int64_t i = 0; i < codec->stageCount; i++) *cur++ = codec->stages[i];
+  putU64(cur, size);
+
+  DEBUG("encoded %"PRId64" bytes into %"PRId64" bytes", size, header + curSize);
+  *out_buffer = inBuffer;
+  *out_size = header + curSize;
+  return ESDM_SUCCESS;
+}
+
+bool esdmI_codec_isEncoded(const void* buffer, int64_t size) {
+  eassert(buffer || !size);
+  return size >= headerSize(0) && !memcmp(buffer, kMagic, sizeof(kMagic));
+}
+
+esdm_status esdmI_codec_decode(const void* buffer, int64_t size, void* out_data, int64_t dataSize) {
+  eassert(buffer || !size);
+  eassert(out_data || !dataSize);
+
+  //parse the header
+  const uint8_t* in = buffer;
+  if(!esdmI_codec_isEncoded(buffer, size)) return ESDM_INVALID_DATA_ERROR;
+  if(in[4] != kVersion) return ESDM_INVALID_DATA_ERROR;
+  int64_t stageCount = in[5], elementSize = in[6];
+  if(!stageCount || stageCount > kMaxStages || !elementSize) return ESDM_INVALID_DATA_ERROR;
+  int64_t header = headerSize(stageCount);
+  if(size < header) return ESDM_INVALID_DATA_ERROR;
+  const uint8_t* stages = in + 7;
+  if((int64_t)getU64(stages + stageCount) != dataSize) return ESDM_INVALID_DATA_ERROR;
+
+  //undo the stages in reverse order, the first stage decodes into the output
+  const uint8_t* cur = in + header;
+  uint8_t* curBuffer = NULL;
+  int64_t curSize = size - header;
+  esdm_status result = ESDM_SUCCESS;
+  for(int64_t i = stageCount; i--; ) {
+    esdm_codec_stage_t stage = stages[i];
+    int64_t outSize = curSize;
+    if(stage == ESDM_CODEC_LZ) {
+      if(curSize < 8) {
+        result = ESDM_INVALID_DATA_ERROR;
+        break;
+      }
+      outSize = getU64(cur);
+    }
+    //an LZ input byte expands to at most 255 output bytes, larger sizes can only come from corrupted data
+    if(outSize < 0 || outSize/255 > curSize || (!i && outSize != dataSize)) {
+      result = ESDM_INVALID_DATA_ERROR;
+      break;
+    }
+
+    uint8_t* outBuffer = i ? ea_checked_malloc(outSize ? outSize : 1) : out_data;
+    switch(stage) {
+      case ESDM_CODEC_BYTE_SHUFFLE: byteShuffle(cur, outBuffer, curSize, elementSize, true); break;
+      case ESDM_CODEC_BIT_SHUFFLE: bitShuffle(cur, outBuffer, curSize, elementSize, true); break;
+      case ESDM_CODEC_DELTA:
+      case ESDM_CODEC_XOR: predict(stage, cur, outBuffer, curSize, elementSize, true); break;
+      case ESDM_CODEC_LZ: result = lzDecompress(cur, curSize, outBuffer, outSize); break;
+      default: result = ESDM_INVALID_DATA_ERROR;
+    }
+    free(curBuffer);
+    curBuffer = i ? outBuffer : NULL;
+    cur = outBuffer;
+    curSize = outSize;
+    if(result != ESDM_SUCCESS) break;
+  }
+  free(curBuffer);
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Block container /////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const int64_t esdmI_codec_blockPrefixBytes = kBlockPrefix;
+
+static int64_t blockHeaderSize(int64_t blockCount) {
+  return kBlockPrefix + 8*(blockCount + 1);
+}
+
+esdm_status esdmI_codec_encodeBlocks(const esdmI_codec_t* codec, int64_t elementSize, const void* data, int64_t splitDim, int64_t rowCount, int64_t rowBytes, int64_t rowsPerBlock, void** out_buffer, int64_t* out_size) {
+  eassert(codec);
+  eassert(data || !rowCount || !rowBytes);
+  eassert(splitDim >= 0 && splitDim <= 255);
+  eassert(rowCount >= 0);
+  eassert(rowBytes >= 0);
+  eassert(rowsPerBlock > 0);
+  eassert(out_buffer);
+  eassert(out_size);
+
+  //blocks that do not compress are stored raw, so the container never needs more than the header plus the raw data
+  int64_t blockCount = (rowCount + rowsPerBlock - 1)/rowsPerBlock;
+  int64_t header = blockHeaderSize(blockCount);
+  uint8_t* result = ea_checked_malloc(header + rowCount*rowBytes);
+  const uint8_t* in = data;
+  int64_t pos = header;
+  for(int64_t i = 0; i < blockCount; i++) {
+    int64_t rows = rowCount - i*rowsPerBlock < rowsPerBlock ? rowCount - i*rowsPerBlock : rowsPerBlock;
+    int64_t rawSize = rows*rowBytes;
+    const uint8_t* rawBlock = in + i*rowsPerBlock*rowBytes;
+    void* encoded;
+    int64_t encodedSize;
+    esdm_status ret = esdmI_codec_encode(codec, elementSize, rawBlock, rawSize, &encoded, &encodedSize);
+    if(ret != ESDM_SUCCESS) {
+      free(result);
+      return ret;
+    }
+    if(encodedSize < rawSize) {
+      memcpy(result + pos, encoded, encodedSize);
+    } else {
+      memcpy(result + pos, rawBlock, rawSize);
+      encodedSize = rawSize;
+    }
+    free(encoded);
+    putU64(result + kBlockPrefix + 8*i, pos);
+    pos += encodedSize;
+  }
+  putU64(result + kBlockPrefix + 8*blockCount, pos);
+
+  memcpy(result, kBlockMagic, sizeof(kBlockMagic));
+  result[4] = kVersion;
+  result[5] = splitDim;
+  result[6] = result[7] = 0;
+  putU64(result + 8, rowsPerBlock);
+  putU64(result + 16, blockCount);
+
+  DEBUG("encoded %"PRId64" bytes into %"PRId64" blocks of %"PRId64" bytes total", rowCount*rowBytes, blockCount, pos);
+  *out_buffer = result;
+  *out_size = pos;
+  return ESDM_SUCCESS;
+}
+
+bool esdmI_codec_isBlocked(const void* buffer, int64_t size) {
+  eassert(buffer || !size);
+  return size >= kBlockPrefix && !memcmp(buffer, kBlockMagic, sizeof(kBlockMagic));
+}
+
+int64_t esdmI_codec_blockHeaderSize(const void* buffer, int64_t size) {
+  if(!esdmI_codec_isBlocked(buffer, size)) return -1;
+  uint64_t blockCount = getU64((const uint8_t*)buffer + 16);
+  if(blockCount > (uint64_t)(INT64_MAX - kBlockPrefix)/8 - 1) return -1;
+  return blockHeaderSize(blockCount);
+}
+
+esdm_status esdmI_codec_parseBlocks(const void* buffer, int64_t size, int64_t totalSize, int64_t dims, const int64_t* sizes, esdmI_codecBlocks_t** out_blocks) {
+  eassert(buffer || !size);
+  eassert(sizes || !dims);
+  eassert(out_blocks);
+
+  const uint8_t* in = buffer;
+  int64_t header = esdmI_codec_blockHeaderSize(buffer, size);
+  if(header < 0 || size < header || totalSize < header || in[4] != kVersion || in[5] >= dims) return ESDM_INVALID_DATA_ERROR;
+  int64_t splitDim = in[5], rowCount = sizes[splitDim];
+  int64_t rowsPerBlock = getU64(in + 8), blockCount = getU64(in + 16);
+  if(rowsPerBlock <= 0 || rowCount < 0 || blockCount != rowCount/rowsPerBlock + (rowCount%rowsPerBlock != 0)) return ESDM_INVALID_DATA_ERROR;
+
+  esdmI_codecBlocks_t* result = ea_checked_malloc(sizeof(*result) + (blockCount + 1)*sizeof(*result->offsets));
+  result->splitDim = splitDim;
+  result->rowsPerBlock = rowsPerBlock;
+  result->blockCount = blockCount;
+  for(int64_t i = 0; i <= blockCount; i++) {
+    result->offsets[i] = getU64(in + kBlockPrefix + 8*i);
+    if(result->offsets[i] < (i ? result->offsets[i - 1] : header)) {
+      free(result);
+      return ESDM_INVALID_DATA_ERROR;
+    }
+  }
+  if(result->offsets[0] != header || result->offsets[blockCount] != totalSize) {
+    free(result);
+    return ESDM_INVALID_DATA_ERROR;
+  }
+  *out_blocks = result;
+  return ESDM_SUCCESS;
+}
+
+esdm_status esdmI_codec_decodeBlock(const void* block, int64_t size, void* out_data, int64_t dataSize) {
+  eassert(block || !size);
+  eassert(out_data || !dataSize);
+  if(size == dataSize) {
+    memcpy(out_data, block, size);
+    return ESDM_SUCCESS;
+  }
+  return esdmI_codec_decode(block, size, out_data, dataSize);
+}
+
+esdm_status esdmI_codec_decodeBlocks(const void* buffer, int64_t size, void* out_data, int64_t dims, const int64_t* sizes, int64_t dataSize) {
+  eassert(out_data || !dataSize);
+
+  esdmI_codecBlocks_t* blocks;
+  esdm_status result = esdmI_codec_parseBlocks(buffer, size, size, dims, sizes, &blocks);
+  if(result != ESDM_SUCCESS) return result;
+  int64_t rowCount = sizes[blocks->splitDim];
+  int64_t rowBytes = rowCount ? dataSize/rowCount : 0;
+  if(rowBytes*rowCount != dataSize) result = ESDM_INVALID_DATA_ERROR;
+
+  const uint8_t* in = buffer;
+  uint8_t* out = out_data;
+  for(int64_t i = 0; i < blocks->blockCount && result == ESDM_SUCCESS; i++) {
+    int64_t firstRow = i*blocks->rowsPerBlock;
+    int64_t rows = rowCount - firstRow < blocks->rowsPerBlock ? rowCount - firstRow : blocks->rowsPerBlock;
+    result = esdmI_codec_decodeBlock(in + blocks->offsets[i], blocks->offsets[i + 1] - blocks->offsets[i], out + firstRow*rowBytes, rows*rowBytes);
+  }
+  free(blocks);
+  return result;
+}
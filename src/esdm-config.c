@@ -61,6 +61,42 @@ esdm_config_t *esdm_config_init_from_str(const char *config_str) {
     }
   }
 
+  config->metadataCacheBytes = 64*1024*1024;  //default
+  json_t* metadataCacheBytes_e = jansson_object_get(esdm_e, "metadata cache bytes");
+  if(metadataCacheBytes_e) {
+    if(!json_is_integer(metadataCacheBytes_e) || json_integer_value(metadataCacheBytes_e) < 0) {
+      ESDM_ERROR("Configuration: \"metadata cache bytes\" tag is not a non-negative integer");
+    }
+    config->metadataCacheBytes = json_integer_value(metadataCacheBytes_e);
+  }
+
+  config->readStreamWindowBytes = 256*1024*1024;  //default
+  json_t* readStreamWindowBytes_e = jansson_object_get(esdm_e, "read stream window bytes");
+  if(readStreamWindowBytes_e) {
+    if(!json_is_integer(readStreamWindowBytes_e) || json_integer_value(readStreamWindowBytes_e) <= 0) {
+      ESDM_ERROR("Configuration: \"read stream window bytes\" tag is not a positive integer");
+    }
+    config->readStreamWindowBytes = json_integer_value(readStreamWindowBytes_e);
+  }
+
+  config->codecBlockBytes = 1024*1024;  //default
+  json_t* codecBlockBytes_e = jansson_object_get(esdm_e, "codec block bytes");
+  if(codecBlockBytes_e) {
+    if(!json_is_integer(codecBlockBytes_e) || json_integer_value(codecBlockBytes_e) <= 0) {
+      ESDM_ERROR("Configuration: \"codec block bytes\" tag is not a positive integer");
+    }
+    config->codecBlockBytes = json_integer_value(codecBlockBytes_e);
+  }
+
+  config->gridSynthesisMinFragments = 4;  //default
+  json_t* gridSynthesisMinFragments_e = jansson_object_get(esdm_e, "grid synthesis min fragments");
+  if(gridSynthesisMinFragments_e) {
+    if(!json_is_integer(gridSynthesisMinFragments_e) || json_integer_value(gridSynthesisMinFragments_e) < 0) {
+      ESDM_ERROR("Configuration: \"grid synthesis min fragments\" tag is not a non-negative integer");
+    }
+    config->gridSynthesisMinFragments = json_integer_value(gridSynthesisMinFragments_e);
+  }
+
   return config;
 }
 
@@ -266,8 +302,19 @@ esdm_config_backends_t *esdm_config_get_backends(esdm_instance_t *esdm) {
           backends[i]->data_accessibility = ESDM_ACCESSIBILITY_GLOBAL;
 
         elem = jansson_object_get(backend, "max-fragment-size");
+        backends[i]->fragment_size_efficiency = 0;
         if (elem == NULL) {
           backends[i]->max_fragment_size = 10 * 1024 * 1024;
+        } else if (json_typeof(elem) == JSON_STRING && !strcmp(json_string_value(elem), "auto")) {
+          backends[i]->max_fragment_size = 10 * 1024 * 1024;
+          backends[i]->fragment_size_efficiency = 0.9;
+          elem = jansson_object_get(backend, "fragment-size-efficiency");
+          if (elem) {
+            backends[i]->fragment_size_efficiency = json_number_value(elem);
+            if (!(backends[i]->fragment_size_efficiency > 0 && backends[i]->fragment_size_efficiency < 1)) {
+              ESDM_ERROR("\"fragment-size-efficiency\" must be a number between 0 and 1");
+            }
+          }
         } else {
           backends[i]->max_fragment_size = json_integer_value(elem);
         }
@@ -25,6 +25,7 @@
 #include <esdm-grid.h>
 #include <esdm.h>
 #include <inttypes.h>
+#include <limits.h>
 #include <smd.h>
 #include <stdbool.h>
 #include <stdio.h>
@@ -130,17 +131,32 @@ void esdmI_container_init(char const * name, esdm_container_t **out_container){
   *out_container = c;
 }
 
-esdm_status esdmI_create_dataset_from_metadata(esdm_container_t *c, json_t * json, esdm_dataset_t ** out){
-  json_t *elem;
-  elem = jansson_object_get(json, "id");
-  char const * id = json_string_value(elem);
-
-  elem = jansson_object_get(json, "name");
-  char const * name = json_string_value(elem);
+//Reads a dataset reference, i.e. the ID and name of a dataset, and creates the corresponding unloaded dataset object.
+esdm_status esdmI_create_dataset_from_reader(esdm_container_t *c, esdmI_jsonReader_t * reader, esdm_dataset_t ** out){
+  char *id = NULL, *name = NULL;
+  if(esdmI_jsonReader_next(reader) == ESDMI_JSON_OBJECT_START) {
+    while(esdmI_jsonReader_nextKey(reader)) {
+      if(esdmI_jsonReader_keyIs(reader, "id")) {
+        free(id);
+        id = esdmI_jsonReader_readString(reader);
+      } else if(esdmI_jsonReader_keyIs(reader, "name")) {
+        free(name);
+        name = esdmI_jsonReader_readString(reader);
+      } else {
+        esdmI_jsonReader_skipValue(reader, NULL, NULL);
+      }
+    }
+  }
+  if(!reader->ok || !id || !name) {
+    free(id);
+    free(name);
+    return ESDM_INVALID_DATA_ERROR;
+  }
 
   esdm_dataset_t *d;
   esdm_dataset_init(c, name, NULL, & d);
-  d->id = ea_checked_strdup((char*) id);
+  free(name);
+  d->id = id;
   d->status = ESDM_DATA_NOT_LOADED;
   *out = d;
 
@@ -148,39 +164,42 @@ esdm_status esdmI_create_dataset_from_metadata(esdm_container_t *c, json_t * jso
 }
 
 esdm_status esdm_container_open_md_parse(esdm_container_t *c, char * md, int size){
-  esdm_status ret;
+  esdm_status ret = ESDM_ERROR;
   char * js = md;
 
-  // first strip the attributes
+  // first strip the attributes, the rest is read token by token without building a JSON tree
   if(c->attr) smd_attr_destroy(c->attr);
   size_t parsed = smd_attr_create_from_json(js + 1, size, & c->attr);
   js += 1 + parsed;
-  js[0] = '{';
-  // for the rest we use JANSSON
-  json_t *root = load_json(js);
-  json_t *elem;
-  elem = jansson_object_get(root, "dsets");
-  if(! elem) {
-    return ESDM_ERROR;
-  }
-  int arrsize = json_array_size(elem);
+  esdmI_jsonReader_t reader;
+  esdmI_jsonReader_init(&reader, js, strnlen(js, md + size - js));
+
   esdm_datasets_t * d = & c->dsets;
-  d->count = arrsize;
-  d->buff_size = arrsize;
-  d->dset = ea_checked_malloc(arrsize*sizeof(void*));
-
-  for (int i = 0; i < arrsize; i++) {
-    json_t * djson = json_array_get(elem, i);
-    esdm_dataset_t * dset;
-    ret = esdmI_create_dataset_from_metadata(c, djson, & dset);
-    if (ret != ESDM_SUCCESS){
-      free(d->dset);
-      return ret;
+  d->count = 0;
+  while(esdmI_jsonReader_nextKey(&reader)) {
+    if(!esdmI_jsonReader_keyIs(&reader, "dsets")) {
+      esdmI_jsonReader_skipValue(&reader, NULL, NULL);
+      continue;
+    }
+    if(esdmI_jsonReader_next(&reader) != ESDMI_JSON_ARRAY_START) return ESDM_ERROR;
+    ret = ESDM_SUCCESS;
+    while(esdmI_jsonReader_nextElement(&reader)) {
+      esdm_dataset_t * dset;
+      ret = esdmI_create_dataset_from_reader(c, &reader, & dset);
+      if (ret != ESDM_SUCCESS) break;
+      if (d->buff_size == d->count){
+        d->buff_size = d->buff_size * 2 + 5;
+        d->dset = ea_checked_realloc(d->dset, sizeof(void*) * d->buff_size);
+      }
+      d->dset[d->count++] = dset;
     }
-    d->dset[i] = dset;
   }
-
-  json_decref(root);
+  if(ret == ESDM_SUCCESS && !reader.ok) ret = ESDM_ERROR;
+  if(ret != ESDM_SUCCESS){
+    for(int i = 0; i < d->count; i++) esdmI_dataset_destroy(d->dset[i]);
+    d->count = 0;
+    return ret;
+  }
 
   c->status = ESDM_DATA_PERSISTENT;
   c->refcount = 1;
@@ -202,18 +221,28 @@ esdm_status esdm_container_open(char const *name, int esdm_mode_flags, esdm_cont
     return ESDM_INVALID_ARGUMENT_ERROR;
   }
 
+  // reopening an unchanged container does not need to touch its metadata
+  esdm_container_t *c = esdmI_mdCache_takeContainer(name);
+  if(c){
+    c->mode_flags = esdm_mode_flags;
+    *out_container = c;
+    return ESDM_SUCCESS;
+  }
+
   esdmI_container_init(name, out_container);
-  esdm_container_t *c = *out_container;
+  c = *out_container;
   c->mode_flags = esdm_mode_flags;
 
   char * buff;
   int size;
 
+  esdmI_mdCache_stampContainer(c);  // before the load, so that a concurrent change cannot slip in between
   esdm_status ret = esdm_container_open_md_load(c, & buff, & size);
   if(ret != ESDM_SUCCESS){
     esdmI_container_destroy(c);
     return ret;
   }
+  c->mdBytes = size;
   ret = esdm_container_open_md_parse(c, buff, size);
   free(buff);
   if(ret != ESDM_SUCCESS){
@@ -279,6 +308,13 @@ esdm_status esdm_container_commit(esdm_container_t *c) {
 
   esdm_modules_t* modules = esdm_get_modules();
   esdm_status ret =  modules->metadata_backend->callbacks.container_commit(modules->metadata_backend, c, buff, md_size);
+  if(ret == ESDM_SUCCESS){
+    // the memory state now matches the new metadata
+    esdmI_mdCache_stampContainer(c);
+    c->mdBytes = md_size;
+  }else{
+    c->mdStamped = false;
+  }
 
   // Also commit uncommited datasets of this container: cannot do this as it depends on how we are called
   esdm_datasets_t * dsets = & c->dsets;
@@ -312,7 +348,7 @@ esdm_status esdm_container_close(esdm_container_t *c) {
       ret = ESDM_ERROR;
     }
   }
-  if(ret == ESDM_SUCCESS){
+  if(ret == ESDM_SUCCESS && ! esdmI_mdCache_parkContainer(c)){
     esdmI_container_destroy(c);
   }
 
@@ -461,7 +497,12 @@ esdm_status esdmI_fragment_create(esdm_dataset_t *d, esdm_dataspace_t *sspace, v
 }
 
 esdm_status esdm_fragment_retrieve(esdm_fragment_t *fragment) {
+  return esdmI_fragment_retrieve(fragment, NULL);
+}
+
+esdm_status esdmI_fragment_retrieve(esdm_fragment_t *fragment, bool *out_cacheHit) {
   ESDM_DEBUG(__func__);
+  if(out_cacheHit) *out_cacheHit = false;
   // Call backend
   switch(fragment->status) {
     case ESDM_DATA_NOT_LOADED: {
@@ -478,10 +519,17 @@ esdm_status esdm_fragment_retrieve(esdm_fragment_t *fragment) {
         fragment->buf = ea_checked_malloc(esdm_dataspace_total_bytes(fragment->dataspace));  //ensure that we have a buffer to write to
         fragment->ownsBuf = true;
       }
+      //other processes on this node may have loaded the same fragment already
+      if(esdmI_shmCache_load(fragment)) {
+        fragment->status = ESDM_DATA_PERSISTENT;
+        if(out_cacheHit) *out_cacheHit = true;
+        return ESDM_SUCCESS;
+      }
       esdm_backend_t *backend = fragment->backend;
       int ret = esdmI_backend_fragment_retrieve(backend, fragment);
       if(ret == ESDM_SUCCESS){
         fragment->status = ESDM_DATA_PERSISTENT;
+        esdmI_shmCache_store(fragment);
       }
       return ret;
     }
@@ -586,13 +634,15 @@ esdm_status esdm_dataset_delete(esdm_dataset_t *d){
   int ret = ESDM_SUCCESS;
   int status;
 
-  if(d->status == ESDM_DATA_NOT_LOADED){
+  if(d->status == ESDM_DATA_NOT_LOADED || ! d->refcount){
     ret = esdm_dataset_ref(d);
     if(ret != ESDM_SUCCESS){
       return ret;
     }
   }
   // TODO check usage of dataset
+  status = esdmI_dataset_loadFragments(d, NULL);
+  if(status != ESDM_SUCCESS) return status;
   status = esdmI_fragments_deleteAll(&d->fragments);
   if(status != ESDM_SUCCESS) return status;
   status = esdmI_fragments_destruct(&d->fragments);
@@ -623,6 +673,7 @@ esdm_status esdm_fragment_destroy(esdm_fragment_t *frag) {
   if(frag->id) free(frag->id);
   if(frag->dataspace) esdm_dataspace_destroy(frag->dataspace);
   if(frag->ownsBuf) free(frag->buf);
+  free(frag->blocks);
   free(frag);
 
   return result;
@@ -675,7 +726,15 @@ int esdm_dataset_probe_region(const char *container_name, const char *dataset_na
     return 0;
   }
   assert(point->dims == d->dataspace->dims);
-  
+
+  esdmI_hypercube_t* extends;
+  esdmI_dataspace_getExtends(point, &extends);
+  ret = esdmI_dataset_loadFragments(d, extends);
+  esdmI_hypercube_destroy(extends);
+  if(ret != ESDM_SUCCESS) {
+    esdm_container_close(c);
+    return 0;
+  }
   int exists = g_hash_table_find(d->fragments.table, is_point_overlapping, point) != NULL;
   esdm_container_close(c);
   return exists;
@@ -707,6 +766,7 @@ void esdm_dataset_init(esdm_container_t *c, const char *name, esdm_dataspace_t *
     }
   }
   esdmI_fragments_construct(&d->fragments);
+  esdmI_accessPattern_construct(&d->accessPattern);
 
   *out_dataset = d;
 }
@@ -761,13 +821,108 @@ esdm_status esdm_dataset_set_compression_hint(esdm_dataset_t * dset, scil_user_h
 #endif
 }
 
-esdm_status esdm_dataset_open_md_load(esdm_dataset_t *dset, char ** out_md, int * out_size){
+esdm_status esdm_dataset_set_codec_hint(esdm_dataset_t * dset, int64_t stageCount, esdm_codec_stage_t const * stages){
+  eassert(dset);
+  esdmI_codec_t * codec = NULL;
+  if(stageCount){
+    esdm_status ret = esdmI_codec_create(stageCount, stages, & codec);
+    if(ret != ESDM_SUCCESS) return ret;
+  }
+  esdmI_codec_destroy(dset->codec);
+  dset->codec = codec;
+  return ESDM_SUCCESS;
+}
+
+//Reads the snapshot up to the end of the index of its paged fragment table, the pages are fetched by esdmI_fragmentPages_load() when they are needed.
+//The whole snapshot is read if it does not contain a paged table.
+static esdm_status retrieveSnapshotHeader(esdm_md_backend_t* backend, esdm_dataset_t* dset, char ** out_md, int * out_size){
+  int64_t size = 0, capacity = 64*1024;
+  char* md = ea_checked_malloc(capacity + 1);
+  while(true) {
+    int64_t count;
+    esdm_status ret = backend->callbacks.dataset_retrieve_range(backend, dset, size, capacity - size, md + size, &count);
+    if(ret != ESDM_SUCCESS) {
+      free(md);
+      return ret;
+    }
+    size += count;
+    if(size < capacity) break;  //we have reached the end of the snapshot
+
+    char* jsonEnd = memchr(md, 0, size);
+    if(jsonEnd) {
+      int64_t tableStart = jsonEnd + 1 - md;
+      int64_t indexSize = esdmI_fragmentPages_truncateToIndex(md + tableStart, size - tableStart);
+      if(indexSize > 0) {
+        size = tableStart + indexSize;
+        break;
+      }
+    }
+    if(capacity > INT_MAX/2) {
+      free(md);
+      return ESDM_ERROR;
+    }
+    capacity *= 2;
+    md = ea_checked_realloc(md, capacity + 1);
+  }
+  md[size] = 0;
+  *out_md = md;
+  *out_size = size;
+  return ESDM_SUCCESS;
+}
+
+esdm_status esdmI_dataset_retrieveSnapshot(esdm_dataset_t* dataset, int64_t offset, int64_t size, char* out_data){
+  eassert(dataset);
+  eassert(out_data);
+
+  esdm_md_backend_t* backend = esdm_get_modules()->metadata_backend;
+  if(!backend->callbacks.dataset_retrieve_range) return ESDM_ERROR;
+  int64_t count;
+  esdm_status ret = backend->callbacks.dataset_retrieve_range(backend, dataset, offset, size, out_data, &count);
+  if(ret != ESDM_SUCCESS) return ret;
+  return count == size ? ESDM_SUCCESS : ESDM_INVALID_DATA_ERROR;  //the snapshot has been replaced since the dataset was opened
+}
+
+static esdm_status loadMetadata(esdm_dataset_t *dset, bool headerOnly, char ** out_md, int * out_size){
   eassert(dset != NULL);
   eassert(out_md != NULL);
   eassert(out_size != NULL);
 
-  esdm_modules_t* modules = esdm_get_modules();
-  return modules->metadata_backend->callbacks.dataset_retrieve(modules->metadata_backend, dset, out_md, out_size);
+  esdm_md_backend_t* backend = esdm_get_modules()->metadata_backend;
+  esdm_status ret;
+  if(headerOnly && backend->callbacks.dataset_retrieve_range) {
+    ret = retrieveSnapshotHeader(backend, dset, out_md, out_size);
+  } else {
+    ret = backend->callbacks.dataset_retrieve(backend, dset, out_md, out_size);
+  }
+  if(ret != ESDM_SUCCESS || !backend->callbacks.dataset_retrieve_journal) return ret;
+
+  char* journal;
+  int journalSize;
+  ret = backend->callbacks.dataset_retrieve_journal(backend, dset, &journal, &journalSize);
+  if(ret != ESDM_SUCCESS) {
+    free(*out_md);
+    *out_md = NULL;
+    return ret;
+  }
+  if(journal) {
+    //append the journal to the snapshot, separated by the terminating null byte of the snapshot
+    int snapshotSize = *out_size;
+    *out_md = ea_checked_realloc(*out_md, snapshotSize + 1 + journalSize + 1);
+    (*out_md)[snapshotSize] = 0;
+    memcpy(*out_md + snapshotSize + 1, journal, journalSize);
+    (*out_md)[snapshotSize + 1 + journalSize] = 0;
+    *out_size = snapshotSize + 1 + journalSize;
+    free(journal);
+  }
+  return ESDM_SUCCESS;
+}
+
+esdm_status esdm_dataset_open_md_load(esdm_dataset_t *dset, char ** out_md, int * out_size){
+  return loadMetadata(dset, true, out_md, out_size);
+}
+
+esdm_status esdmI_dataset_open_md_loadComplete(esdm_dataset_t *dset, char ** out_md, int * out_size){
+  return loadMetadata(dset, false, out_md, out_size);
 }
 
 esdm_backend_t * esdmI_get_backend(char const * plugin_id){
@@ -813,39 +968,142 @@ esdm_status esdmI_create_fragment_from_metadata(esdm_dataset_t *dset, json_t * j
   esdm_status dataspaceStatus = esdmI_dataspace_createFromJson(spaceJson, dset, &space);
   if(dataspaceStatus != ESDM_SUCCESS) goto fail;
   result = esdmI_dataset_lookupFragmentForShape(dset, space);
-  if(result) goto success;  //fast return in case we already have a fragment that matches the given shape
+  if(result) {
+    esdm_dataspace_destroy(space);
+    goto success;  //fast return in case we already have a fragment that matches the given shape
+  }
+
+  esdm_backend_t* backend = esdmI_get_backend(json_string_value(backendJson));
+  if(!backend) {
+    esdm_dataspace_destroy(space);
+    goto fail;
+  }
+  result = esdmI_fragment_createLoaded(dset, space, json_string_value(idJson), backend, json_integer_value(actualSizeJson), jansson_object_get(json, "backend"));
 
-  result = ea_checked_malloc(sizeof(esdm_fragment_t));
+success:
+  status = ESDM_SUCCESS;
+fail:
+  *out_fragment = result;
+  return status;
+}
+
+//Reads a fragment description as produced by esdm_fragment_metadata_create(), and creates a new fragment object from it.
+//This does not access the fragments of the dataset, so it may be called from several threads at once.
+static esdm_status fragmentFromReader(esdm_dataset_t *dset, esdmI_jsonReader_t *reader, esdm_fragment_t **out_fragment) {
+  esdm_status status = ESDM_INVALID_DATA_ERROR;
+  char *id = NULL, *backendId = NULL;
+  int64_t actualBytes = 0;
+  bool hasActualBytes = false;
+  esdm_dataspace_t *space = NULL;
+  const char *backendText = NULL;
+  int64_t backendTextLength = 0;
+  *out_fragment = NULL;
+
+  if(esdmI_jsonReader_next(reader) != ESDMI_JSON_OBJECT_START) goto done;
+  while(esdmI_jsonReader_nextKey(reader)) {
+    if(esdmI_jsonReader_keyIs(reader, "id")) {
+      free(id);
+      id = esdmI_jsonReader_readString(reader);
+    } else if(esdmI_jsonReader_keyIs(reader, "pid")) {
+      free(backendId);
+      backendId = esdmI_jsonReader_readString(reader);
+    } else if(esdmI_jsonReader_keyIs(reader, "act-size")) { // if it is compressed the actual size may differ
+      hasActualBytes = esdmI_jsonReader_readInt(reader, &actualBytes);
+    } else if(esdmI_jsonReader_keyIs(reader, "space")) {
+      if(space) goto done;
+      if(esdmI_dataspace_createFromReader(reader, dset, &space) != ESDM_SUCCESS) goto done;
+    } else if(esdmI_jsonReader_keyIs(reader, "backend")) {
+      esdmI_jsonReader_skipValue(reader, &backendText, &backendTextLength);
+    } else {
+      esdmI_jsonReader_skipValue(reader, NULL, NULL);
+    }
+  }
+  if(!reader->ok || !id || !backendId || !hasActualBytes || !space) goto done;
+
+  esdm_backend_t *backend = esdmI_get_backend(backendId);
+  if(!backend) goto done;
+
+  //the backend specific part is opaque to us, the backends expect it as a jansson object
+  json_t *backendJson = NULL;
+  if(backendText) {
+    char *text = ea_checked_malloc(backendTextLength + 1);
+    memcpy(text, backendText, backendTextLength);
+    text[backendTextLength] = 0;
+    backendJson = load_json(text);
+    free(text);
+  }
+  *out_fragment = esdmI_fragment_createLoaded(dset, space, id, backend, actualBytes, backendJson);
+  if(backendJson) json_decref(backendJson);
+  space = NULL; //the fragment has taken possession
+  status = ESDM_SUCCESS;
+
+done:
+  if(space) esdm_dataspace_destroy(space);
+  free(id);
+  free(backendId);
+  return status;
+}
+
+esdm_status esdmI_create_fragment_from_reader(esdm_dataset_t *dset, esdmI_jsonReader_t *reader, esdm_fragment_t **out_fragment) {
+  eassert(dset);
+  eassert(reader);
+  eassert(out_fragment);
+
+  esdm_fragment_t *fragment;
+  esdm_status status = fragmentFromReader(dset, reader, &fragment);
+  if(status != ESDM_SUCCESS) {
+    *out_fragment = NULL;
+    return status;
+  }
+
+  //return the existing fragment if we already have one that matches the given shape
+  esdm_fragment_t *existing = esdmI_dataset_lookupFragmentForShape(dset, fragment->dataspace);
+  if(existing) {
+    esdm_fragment_destroy(fragment);
+    fragment = existing;
+  }
+  *out_fragment = fragment;
+  return ESDM_SUCCESS;
+}
+
+esdm_fragment_t* esdmI_fragment_createLoaded(esdm_dataset_t *dset, esdm_dataspace_t *space, const char *id, esdm_backend_t *backend, int64_t actualBytes, json_t *backendMetadata) {
+  eassert(dset);
+  eassert(space);
+  eassert(id);
+  eassert(backend);
+
+  esdm_fragment_t* result = ea_checked_malloc(sizeof(esdm_fragment_t));
   *result = (esdm_fragment_t){
-    .id = ea_checked_strdup(json_string_value(idJson)),
+    .id = ea_checked_strdup(id),
     .dataset = dset,
     .dataspace = space,
     .elements = esdm_dataspace_element_count(space),
     .bytes = esdm_dataspace_total_bytes(space),
     .buf = NULL,
     .ownsBuf = false,
-    .backend = esdmI_get_backend(json_string_value(backendJson)),
-    .actual_bytes = json_integer_value(actualSizeJson),
+    .backend = backend,
+    .actual_bytes = actualBytes,
     .status = ESDM_DATA_NOT_LOADED
   };
 
   // deserialize module specific options
-  if(!result->backend) goto fail;
-  if(result->backend->callbacks.fragment_metadata_load) {
-    result->backend_md = esdmI_backend_fragment_metadata_load(result->backend, result, jansson_object_get(json, "backend"));
+  if(backend->callbacks.fragment_metadata_load) {
+    result->backend_md = esdmI_backend_fragment_metadata_load(backend, result, backendMetadata);
   }
+  return result;
+}
 
-success:
-  status = ESDM_SUCCESS;
-fail:
-  if(status != ESDM_SUCCESS && result) {
-    free(result->id);
-    if(result->dataspace) esdm_dataspace_destroy(result->dataspace);
-    free(result);
-    result = NULL;
+esdm_status esdmI_dataset_addLoadedFragment(esdm_dataset_t *d, esdm_fragment_t *frag) {
+  esdm_status status = esdmI_fragments_add(&d->fragments, frag);
+  if(status == ESDM_INVALID_STATE_ERROR) {
+    //we already have a fragment with this shape, which may be the very fragment that esdmI_create_fragment_from_metadata() returned
+    esdmI_hypercube_t* extends;
+    esdmI_dataspace_getExtends(frag->dataspace, &extends);
+    if(esdmI_fragments_lookupForShape(&d->fragments, extends) != frag) esdm_fragment_destroy(frag);
+    esdmI_hypercube_destroy(extends);
+    return ESDM_SUCCESS;
   }
-
-  *out_fragment = result;
+  if(status == ESDM_SUCCESS) esdmI_dataset_update_actual_size(d, frag);
   return status;
 }
 
@@ -908,10 +1166,220 @@ esdm_status esdm_dataspace_copyDatalayout(esdm_dataspace_t* space, esdm_dataspac
   return ESDM_SUCCESS;
 }
 
-//FIXME: Error handling in this method leaks memory.
+//Legacy fragment arrays with more than this many fragments are split into chunks that are parsed in parallel.
+static const int64_t kFragmentParseChunk = 4096;
+
+typedef struct fragmentParseJob_t {
+  esdm_dataset_t *dataset;
+  int64_t count;
+  const char **starts;  //the text of the fragment descriptions
+  int64_t *lengths;
+  esdm_fragment_t **fragments;  //the parsed fragments, NULL for descriptions that could not be parsed
+} fragmentParseJob_t;
+
+static gpointer fragmentParseThread(gpointer data) {
+  fragmentParseJob_t *job = data;
+  for(int64_t i = 0; i < job->count; i++) {
+    esdmI_jsonReader_t reader;
+    esdmI_jsonReader_init(&reader, job->starts[i], job->lengths[i]);
+    if(fragmentFromReader(job->dataset, &reader, &job->fragments[i]) != ESDM_SUCCESS) job->fragments[i] = NULL;
+  }
+  return NULL;
+}
+
+//Adds the fragments described by a JSON array to the dataset.
+//Fragments that cannot be decoded are skipped, fragments that we already have are dropped.
+static esdm_status addFragmentsFromReader(esdm_dataset_t *d, esdmI_jsonReader_t *reader) {
+  if(esdmI_jsonReader_next(reader) != ESDMI_JSON_ARRAY_START) return ESDM_INVALID_DATA_ERROR;
+
+  //First find the text of the individual fragment descriptions, which only requires tokenizing them.
+  int64_t count = 0, slots = 64;
+  const char **starts = ea_checked_malloc(slots*sizeof(*starts));
+  int64_t *lengths = ea_checked_malloc(slots*sizeof(*lengths));
+  while(esdmI_jsonReader_nextElement(reader)) {
+    if(count == slots) {
+      starts = ea_checked_realloc(starts, (slots *= 2)*sizeof(*starts));
+      lengths = ea_checked_realloc(lengths, slots*sizeof(*lengths));
+    }
+    if(!esdmI_jsonReader_skipValue(reader, &starts[count], &lengths[count])) break;
+    count++;
+  }
+  if(!reader->ok) {
+    free(starts);
+    free(lengths);
+    return ESDM_INVALID_DATA_ERROR;
+  }
+
+  //Then parse the descriptions, in parallel if there are enough of them.
+  //The fragments are only added to the dataset afterwards, as the fragment table is not thread safe.
+  esdm_fragment_t **fragments = ea_checked_malloc((count + 1)*sizeof(*fragments));
+  int64_t threadCount = (count + kFragmentParseChunk - 1)/kFragmentParseChunk;
+  if(threadCount > g_get_num_processors()) threadCount = g_get_num_processors();
+  if(threadCount < 1) threadCount = 1;
+  fragmentParseJob_t jobs[threadCount];
+  GThread *threads[threadCount];
+  for(int64_t i = 0; i < threadCount; i++) {
+    int64_t first = count*i/threadCount, last = count*(i + 1)/threadCount;
+    jobs[i] = (fragmentParseJob_t){
+      .dataset = d,
+      .count = last - first,
+      .starts = starts + first,
+      .lengths = lengths + first,
+      .fragments = fragments + first
+    };
+    threads[i] = i ? g_thread_new("esdm-md-parse", fragmentParseThread, &jobs[i]) : NULL;
+  }
+  fragmentParseThread(&jobs[0]);
+  for(int64_t i = 1; i < threadCount; i++) g_thread_join(threads[i]);
+  DEBUG("parsed %"PRId64" fragment descriptions with %"PRId64" threads", count, threadCount);
+
+  esdm_status ret = ESDM_SUCCESS;
+  for(int64_t i = 0; i < count; i++) {
+    if(!fragments[i]) continue;
+    if(ret == ESDM_SUCCESS) {
+      ret = esdmI_dataset_addLoadedFragment(d, fragments[i]);
+    } else {
+      esdm_fragment_destroy(fragments[i]);
+    }
+  }
+  free(fragments);
+  free(starts);
+  free(lengths);
+  return ret;
+}
+
+//Besides binary fragment tables, the journal holds the changes of the header that do not warrant a new snapshot.
+//These records consist of
+//
+//    magic    4 bytes, "ESJG" for grids that were completed after the last commit, "ESJA" for an updated access pattern
+//    length   8 bytes little endian, the size of the entire record including this header
+//    json     a JSON array of the grids that are added to the dataset, or the JSON object of the access pattern that replaces the current one
+static const char kGridRecordMagic[4] = {'E', 'S', 'J', 'G'};
+static const char kAccessRecordMagic[4] = {'E', 'S', 'J', 'A'};
+static const int64_t kJsonRecordHeaderSize = 4 + 8;
+
+//Appends a record to the buffer `*inout_data` of `*inout_size` bytes.
+static void journalRecordAppend(char **inout_data, int64_t *inout_size, const char magic[4], const char *json, int64_t jsonSize) {
+  uint64_t recordSize = kJsonRecordHeaderSize + jsonSize;
+  *inout_data = ea_checked_realloc(*inout_data, *inout_size + recordSize);
+  char *record = *inout_data + *inout_size;
+  memcpy(record, magic, 4);
+  for(int64_t i = 0; i < 8; i++) record[4 + i] = recordSize >> 8*i;
+  memcpy(record + kJsonRecordHeaderSize, json, jsonSize);
+  *inout_size += recordSize;
+}
+
+static void loadAccessPatternJson(esdm_dataset_t *d, const char *start, int64_t length);
+
+//Replays a grid or access pattern record.
+//`out_size` receives the size that is recorded in the header, zero if the record is not recognized.
+static esdm_status replayJsonRecord(esdm_dataset_t *d, const char *record, int64_t available, int64_t *out_size) {
+  *out_size = 0;
+  if(available < kJsonRecordHeaderSize) return ESDM_INVALID_DATA_ERROR;
+  bool isGrids = !memcmp(record, kGridRecordMagic, 4);
+  if(!isGrids && memcmp(record, kAccessRecordMagic, 4)) return ESDM_INVALID_DATA_ERROR;
+  uint64_t recordSize = 0;
+  for(int64_t i = 0; i < 8; i++) recordSize |= (uint64_t)(uint8_t)record[4 + i] << 8*i;
+  if(recordSize < kJsonRecordHeaderSize || recordSize > INT64_MAX) return ESDM_INVALID_DATA_ERROR;
+  *out_size = recordSize;
+  if(recordSize > (uint64_t)available) return ESDM_INVALID_DATA_ERROR;
+
+  const char *json = record + kJsonRecordHeaderSize;
+  int64_t jsonSize = recordSize - kJsonRecordHeaderSize;
+  if(!isGrids) {
+    loadAccessPatternJson(d, json, jsonSize);
+    return ESDM_SUCCESS;
+  }
+  esdm_status ret = ESDM_SUCCESS;
+  esdmI_jsonReader_t reader;
+  esdmI_jsonReader_init(&reader, json, jsonSize);
+  if(esdmI_jsonReader_next(&reader) != ESDMI_JSON_ARRAY_START) ret = ESDM_INVALID_DATA_ERROR;
+  while(ret == ESDM_SUCCESS && esdmI_jsonReader_nextElement(&reader)) {
+    esdm_grid_t *grid;
+    ret = esdmI_grid_createFromReader(&reader, d, NULL, &grid);
+  }
+  if(ret == ESDM_SUCCESS && !reader.ok) ret = ESDM_INVALID_DATA_ERROR;
+  return ret;
+}
+
+//Replays the records of a metadata journal: binary fragment tables, and the grid and access pattern records.
+//Returns the size of the replayed records in out_size.
+static esdm_status replayJournal(esdm_dataset_t *d, const char *journal, int64_t available, int64_t *out_size) {
+  int64_t pos = 0;
+  while(pos < available && journal[pos]) {  //a null byte terminates the journal
+    int64_t recordSize;
+    esdm_status ret;
+    if(esdmI_fragmentTable_isTable(journal + pos, available - pos)) {
+      ret = esdmI_fragmentTable_decode(d, journal + pos, available - pos, &recordSize);
+    } else {
+      ret = replayJsonRecord(d, journal + pos, available - pos, &recordSize);
+    }
+    if(ret != ESDM_SUCCESS) {
+      if(recordSize && pos + recordSize <= available) return ret;
+      //an interrupted append leaves an incomplete last record, the commit that wrote it never returned successfully
+      ESDM_WARN_FMT("ignoring incomplete last record in the metadata journal of dataset \"%s\"", d->name);
+      break;
+    }
+    pos += recordSize;
+  }
+  *out_size = pos;
+  return ESDM_SUCCESS;
+}
+
+static char* datasetHeaderCreate(esdm_dataset_t *d, size_t *out_size);
+static void rememberCommittedHeader(esdm_dataset_t *d);
+
+//Creates the dataspace of a dataset from the header fields, this must happen before any fragments or grids are read.
+static esdm_status datasetSpaceFromHeader(esdm_dataset_t *d, char *typeString, int64_t dims, int64_t *sizes, int64_t sizeCount) {
+  smd_dtype_t *type = typeString ? smd_type_from_ser(typeString) : NULL;
+  if (type == NULL) {
+    DEBUG("Cannot parse type: %s", typeString ? typeString : "(none)");
+    return ESDM_ERROR;
+  }
+  if (dims < 0 || (dims && sizeCount != dims)) return ESDM_ERROR;
+
+  int64_t noSizes = 0;
+  esdm_status ret = esdm_dataspace_create(dims, dims ? sizes : &noSizes, type, &d->dataspace);
+  if (ret != ESDM_SUCCESS) return ret;
+  for (int i = 0; i < dims; i++) {
+    if(sizes[i] == 0){
+      // unlimited dimension, we must reconstruct the domain from the fragments
+      d->actual_size = ea_memdup(sizes, sizeof(*d->actual_size) * dims);
+      break;
+    }
+  }
+  return ESDM_SUCCESS;
+}
+
+//Reads the "dims_dset_id" array, names that are not valid are ignored.
+static esdm_status readDimensionNames(esdm_dataset_t *d, esdmI_jsonReader_t *reader) {
+  int64_t dims = d->dataspace->dims;
+  char *names[dims + 1];
+  int64_t count = 0;
+  if(esdmI_jsonReader_next(reader) != ESDMI_JSON_ARRAY_START) return ESDM_ERROR;
+  while(esdmI_jsonReader_nextElement(reader)) {
+    char *name = esdmI_jsonReader_readString(reader);
+    if(!name) break;
+    if(count < dims) {
+      names[count] = name;
+    } else {
+      free(name);
+    }
+    count++;
+  }
+  esdm_status ret = reader->ok && count == dims ? ESDM_SUCCESS : ESDM_ERROR;
+  if(ret == ESDM_SUCCESS) esdm_dataset_name_dims(d, names);
+  for(int64_t i = 0; i < count && i < dims; i++) free(names[i]);
+  return ret;
+}
+
 esdm_status esdm_dataset_open_md_parse(esdm_dataset_t *d, char * md, int size){
-  esdm_status ret;
+  esdm_status ret = ESDM_SUCCESS;
   char * js = md;
+  //The snapshot starts with the JSON part, which may be followed by a null byte and a binary fragment table or a paged table.
+  //Of a paged table, esdm_dataset_open_md_load() may only have read the header and the index.
+  //esdm_dataset_open_md_load() appends the journal to the snapshot, separated by another null byte.
+  int64_t snapshotSize = strlen(md);
 
   // first strip the attributes
   if(d->attr) smd_attr_destroy(d->attr);
@@ -922,110 +1390,110 @@ esdm_status esdm_dataset_open_md_parse(esdm_dataset_t *d, char * md, int size){
     parsed = smd_attr_create_from_json(js + 1, size, & d->fill_value);
     js += 1 + parsed;
   }
-  js[0] = '{';
-  // for the rest we use JANSSON
-  json_t *root = load_json(js);
-  json_t *elem;
-  elem = jansson_object_get(root, "typ");
-  char *str = (char *)json_string_value(elem);
-  smd_dtype_t *type = smd_type_from_ser(str);
-  if (type == NULL) {
-    DEBUG("Cannot parse type: %s", str);
-    return ESDM_ERROR;
-  }
-  if(d->id) free(d->id);
-  elem = jansson_object_get(root, "id");
-  d->id = ea_checked_strdup(json_string_value(elem));
-  elem = jansson_object_get(root, "dims");
-  int dims = json_integer_value(elem);
-  elem = jansson_object_get(root, "size");
-  int64_t sizes[dims];
-  size_t arrsize;
-  bool has_ulim_dim = FALSE; // if true, then we must reconstruct the domain!
-  if(elem){
-    arrsize = json_array_size(elem);
-    if (dims != arrsize) {
-      json_decref(root);
-      return ESDM_ERROR;
-    }
-    for (int i = 0; i < dims; i++) {
-      sizes[i] = json_integer_value(json_array_get(elem, i));
-      if(sizes[i] == 0){
-        has_ulim_dim = TRUE;
-      }
-    }
-  }
-  if(d->dataspace) esdm_dataspace_destroy(d->dataspace);
-  ret = esdm_dataspace_create(dims, sizes, type, &d->dataspace);
-  if (ret != ESDM_SUCCESS) {
-    json_decref(root);
-    return ret;
-  }
-  if(has_ulim_dim){
-    d->actual_size = ea_checked_malloc(sizeof(*d->actual_size) * dims);
-    memcpy(d->actual_size, sizes, sizeof(*d->actual_size) * dims);
-  }
-  elem = jansson_object_get(root, "dims_dset_id");
-  if (elem){
-    arrsize = json_array_size(elem);
-    if (dims != arrsize) {
-      return ESDM_ERROR;
-    }
-    char *strs[dims];
-    for (int i = 0; i < dims; i++) {
-      strs[i] = (char *)json_string_value(json_array_get(elem, i));
-    }
-    esdm_dataset_name_dims(d, strs);
-  }
 
-  elem = jansson_object_get(root, "fragments");
-  if(! elem) {
-    json_decref(root);
-    return ESDM_ERROR;
-  }
-  arrsize = json_array_size(elem);
-  for (int i = 0; i < arrsize; i++) {
-    json_t * fjson = json_array_get(elem, i);
-    esdm_fragment_t * frag;
-    esdm_status status = esdmI_create_fragment_from_metadata(d, fjson, & frag);
-    if (status != ESDM_SUCCESS) {
-      ret = status;
-    } else {
-      status = esdmI_fragments_add(&d->fragments, frag);
-      if(status == ESDM_INVALID_STATE_ERROR) {
-        esdm_fragment_destroy(frag);  //we already have a fragment with this shape
-      } else if(status == ESDM_SUCCESS) {
-        esdmI_dataset_update_actual_size(d, frag);
+  //forget the state of a previous load
+  esdmI_fragmentPages_destroy(d->fragmentPages);
+  d->fragmentPages = NULL;
+  if(d->dataspace) esdm_dataspace_destroy(d->dataspace);
+  d->dataspace = NULL;
+  free(d->actual_size);
+  d->actual_size = NULL;
+  d->gridCount = d->incompleteGridCount = 0;  //esdmI_grid_createFromReader() will register the grids
+  esdmI_gridIndex_destroy(d->gridIndex);
+  d->gridIndex = NULL;
+
+  //The rest of the JSON is read token by token, creating the grids and fragments directly from the text.
+  //The header fields that define the dataspace precede the grids and fragments.
+  esdmI_jsonReader_t reader;
+  esdmI_jsonReader_init(&reader, js, md + snapshotSize - js);
+  char *typeString = NULL;
+  int64_t dims = -1, sizeCount = 0, *sizes = NULL;
+  bool hasGrids = false, hasFragments = false, hasFragmentTable = false, hasFragmentPages = false;
+  while(ret == ESDM_SUCCESS && esdmI_jsonReader_nextKey(&reader)) {
+    if(esdmI_jsonReader_keyIs(&reader, "typ")) {
+      free(typeString);
+      typeString = esdmI_jsonReader_readString(&reader);
+    } else if(esdmI_jsonReader_keyIs(&reader, "id")) {
+      char *id = esdmI_jsonReader_readString(&reader);
+      if(id) {
+        free(d->id);
+        d->id = id;
+      }
+    } else if(esdmI_jsonReader_keyIs(&reader, "dims")) {
+      esdmI_jsonReader_readInt(&reader, &dims);
+    } else if(esdmI_jsonReader_keyIs(&reader, "size")) {
+      free(sizes);
+      esdmI_jsonReader_readIntArray(&reader, &sizes, &sizeCount);
+    } else if(esdmI_jsonReader_keyIs(&reader, "dims_dset_id") || esdmI_jsonReader_keyIs(&reader, "fragments") || esdmI_jsonReader_keyIs(&reader, "grids")) {
+      if(!d->dataspace) ret = datasetSpaceFromHeader(d, typeString, dims, sizes, sizeCount);
+      if(ret != ESDM_SUCCESS) break;
+      if(esdmI_jsonReader_keyIs(&reader, "dims_dset_id")) {
+        ret = readDimensionNames(d, &reader);
+      } else if(esdmI_jsonReader_keyIs(&reader, "fragments")) {
+        hasFragments = true;
+        ret = addFragmentsFromReader(d, &reader); //metadata written before the introduction of the binary fragment table
       } else {
-        json_decref(root);
-        return status;
+        hasGrids = true;
+        if(esdmI_jsonReader_next(&reader) != ESDMI_JSON_ARRAY_START) ret = ESDM_ERROR;
+        while(ret == ESDM_SUCCESS && esdmI_jsonReader_nextElement(&reader)) {
+          esdm_grid_t *grid;
+          ret = esdmI_grid_createFromReader(&reader, d, NULL, &grid);
+        }
       }
+    } else if(esdmI_jsonReader_keyIs(&reader, "fragment-table")) {
+      hasFragmentTable = true;
+      esdmI_jsonReader_skipValue(&reader, NULL, NULL);
+    } else if(esdmI_jsonReader_keyIs(&reader, "fragment-pages")) {
+      hasFragmentPages = true;
+      esdmI_jsonReader_skipValue(&reader, NULL, NULL);
+    } else if(esdmI_jsonReader_keyIs(&reader, "access")) {
+      const char *start;
+      int64_t length;
+      if(esdmI_jsonReader_skipValue(&reader, &start, &length)) loadAccessPatternJson(d, start, length);
+    } else {
+      esdmI_jsonReader_skipValue(&reader, NULL, NULL);
     }
   }
-
-  elem = jansson_object_get(root, "grids");
-  if(!elem || !json_is_array(elem)) {
-    json_decref(root);
+  if(ret == ESDM_SUCCESS && !reader.ok) ret = ESDM_ERROR;
+  if(ret == ESDM_SUCCESS && !d->dataspace) ret = datasetSpaceFromHeader(d, typeString, dims, sizes, sizeCount);
+  if(ret == ESDM_SUCCESS && !hasGrids) ret = ESDM_ERROR;
+  free(typeString);
+  free(sizes);
+  if(ret != ESDM_SUCCESS) return ret;
+
+  //Paged tables are only opened here, the pages are fetched and decoded when a region that intersects them is accessed.
+  //The grids have already registered their fragments with the dataset, so the copies within the pages will be dropped.
+  int64_t unreadBytes = 0;  //the pages that have not been read with the snapshot
+  if(hasFragmentPages) {
+    int64_t tableSize;
+    esdmI_fragmentPages_t* pages;
+    ret = esdmI_fragmentPages_open(md + snapshotSize + 1, size - snapshotSize - 1, d->dataspace->dims, snapshotSize + 1, &tableSize, &pages);
+    if(ret != ESDM_SUCCESS) return ret;
+    snapshotSize += 1 + tableSize;
+    unreadBytes = esdmI_fragmentPages_tableSize(pages) - tableSize;
+    if(d->actual_size) esdmI_fragmentPages_getEnd(pages, d->actual_size); //the unlimited dimensions extend to the end of the fragments we have not decoded yet
+    d->fragmentPages = pages;
+    if(esdmI_fragmentPages_isComplete(pages)) esdmI_dataset_loadFragments(d, NULL);  //empty table, drop the index right away
+  } else if(hasFragmentTable) {
+    int64_t tableSize;
+    ret = esdmI_fragmentTable_decode(d, md + snapshotSize + 1, size - snapshotSize - 1, &tableSize);
+    if(ret != ESDM_SUCCESS) return ret;
+    snapshotSize += 1 + tableSize;
+  } else if(!hasFragments) {
     return ESDM_ERROR;
   }
-  arrsize = json_array_size(elem);
-  d->gridSlotCount = kInitialGridSlotCount > arrsize ? kInitialGridSlotCount : arrsize;
-  d->gridCount = d->incompleteGridCount = 0;  //esdmI_grid_createFromJson() will register the grids
-  d->grids = ea_checked_malloc(d->gridSlotCount*sizeof*d->grids);
-  for(int64_t i = 0; i < arrsize; i++) {
-    json_t* gridDescription = json_array_get(elem, i);
-    if(!gridDescription) {
-      json_decref(root);
-      return ESDM_ERROR;
-    }
-    esdm_status ret = esdmI_grid_createFromJson(gridDescription, d, NULL, &d->grids[i]);
-    if(ret != ESDM_SUCCESS) {
-      json_decref(root);
-      return ret;
-    }
+
+  int64_t journalSize = 0;
+  if(snapshotSize + 1 < size) {
+    ret = replayJournal(d, md + snapshotSize + 1, size - snapshotSize - 1, &journalSize);
+    if(ret != ESDM_SUCCESS) return ret;
   }
 
-  json_decref(root);
+  //remember what is persistent, so that the next commit only needs to append the changes
+  esdmI_fragments_markCommitted(&d->fragments);
+  rememberCommittedHeader(d);
+  d->snapshotBytes = snapshotSize + unreadBytes;
+  d->journalBytes = journalSize;
 
   d->status = ESDM_DATA_PERSISTENT;
 
@@ -1034,6 +1502,7 @@ esdm_status esdm_dataset_open_md_parse(esdm_dataset_t *d, char * md, int size){
 
 esdm_status esdm_dataset_ref(esdm_dataset_t * d){
   ESDM_DEBUG(__func__);
+  esdmI_mdCache_takeDataset(d);  // a dataset that was kept loaded by the cache is unloaded here if it has changed
   if(d->status != ESDM_DATA_NOT_LOADED){
     d->refcount++;
     return ESDM_SUCCESS;
@@ -1041,6 +1510,7 @@ esdm_status esdm_dataset_ref(esdm_dataset_t * d){
 
   char * buff;
   int size;
+  esdmI_mdCache_stampDataset(d);
   esdm_status ret = esdm_dataset_open_md_load(d, & buff, & size);
   if(ret != ESDM_SUCCESS){
     return ret;
@@ -1096,7 +1566,9 @@ esdm_status esdm_dataset_open(esdm_container_t *c, const char *name, int esdm_mo
   return ret;
 }
 
-void esdmI_dataset_metadata_create(esdm_dataset_t *d, smd_string_stream_t*s){
+//Serializes everything but the fragments, leaving the JSON object open.
+//Only the first `gridCount` grids are included, and the access pattern only if `withAccessPattern` is set.
+static void datasetHeaderSerialize(esdm_dataset_t *d, smd_string_stream_t*s, int64_t gridCount, bool withAccessPattern){
   eassert(d->dataspace != NULL);
 
   smd_string_stream_printf(s, "{");
@@ -1127,16 +1599,133 @@ void esdmI_dataset_metadata_create(esdm_dataset_t *d, smd_string_stream_t*s){
     }
     smd_string_stream_printf(s, "]");
   }
-  smd_string_stream_printf(s, ",\"fragments\":");
-  esdmI_fragments_metadata_create(&d->fragments, s);
   smd_string_stream_printf(s, ",\"grids\":[");
-  for(int64_t i = 0; i < d->gridCount; i++) {
+  for(int64_t i = 0; i < gridCount; i++) {
     if(i) smd_string_stream_printf(s, ",");
     esdmI_grid_serialize(s, d->grids[i]);
   }
-  smd_string_stream_printf(s, "]}");
+  smd_string_stream_printf(s, "]");
+  if(withAccessPattern && d->accessPattern.shapeCount) {
+    smd_string_stream_printf(s, ",\"access\":");
+    esdmI_accessPattern_serialize(s, &d->accessPattern);
+  }
+}
+
+//The header of a snapshot.
+static char* datasetHeaderCreate(esdm_dataset_t *d, size_t *out_size){
+  smd_string_stream_t* stream = smd_string_stream_create();
+  datasetHeaderSerialize(d, stream, d->gridCount, true);
+  return smd_string_stream_close(stream, out_size);
+}
+
+//The part of the header that can only be changed by writing a new snapshot.
+static char* datasetFixedHeaderCreate(esdm_dataset_t *d, int64_t gridCount){
+  smd_string_stream_t* stream = smd_string_stream_create();
+  datasetHeaderSerialize(d, stream, gridCount, false);
+  size_t size;
+  return smd_string_stream_close(stream, &size);
+}
+
+//Returns NULL if no read has been recorded.
+static char* accessPatternCreate(esdm_dataset_t *d){
+  if(!d->accessPattern.shapeCount) return NULL;
+  smd_string_stream_t* stream = smd_string_stream_create();
+  esdmI_accessPattern_serialize(stream, &d->accessPattern);
+  size_t size;
+  return smd_string_stream_close(stream, &size);
+}
+
+//The access pattern is small, and only an optimization hint, so we neither fail if it cannot be parsed, nor bother to avoid jansson for it.
+static void loadAccessPatternJson(esdm_dataset_t *d, const char *start, int64_t length){
+  char *text = ea_checked_malloc(length + 1);
+  memcpy(text, start, length);
+  text[length] = 0;
+  json_t *elem = load_json(text);
+  esdmI_accessPattern_destruct(&d->accessPattern);
+  if(!elem || esdmI_accessPattern_loadJson(&d->accessPattern, elem) != ESDM_SUCCESS) esdmI_accessPattern_destruct(&d->accessPattern);
+  if(elem) json_decref(elem);
+  free(text);
+}
+
+//Records the current header as the persistent one, called after the header has been written or read.
+static void rememberCommittedHeader(esdm_dataset_t *d){
+  free(d->committedHeader);
+  d->committedHeader = datasetFixedHeaderCreate(d, d->gridCount);
+  d->committedGridCount = d->gridCount;
+  free(d->committedAccessPattern);
+  d->committedAccessPattern = accessPatternCreate(d);
 }
 
+void esdmI_dataset_metadata_create(esdm_dataset_t *d, smd_string_stream_t*s){
+  if(esdmI_dataset_loadFragments(d, NULL) != ESDM_SUCCESS) ESDM_WARN_FMT("the fragment metadata of dataset \"%s\" is corrupt, listing only the decodable fragments", d->name);
+  datasetHeaderSerialize(d, s, d->gridCount, true);
+  smd_string_stream_printf(s, ",\"fragments\":");
+  esdmI_fragments_metadata_create(&d->fragments, s);
+  smd_string_stream_printf(s, "}");
+}
+
+//Appends the fragments that were added since the last commit, the grids that were completed since then, and the access pattern if it has changed to the metadata journal.
+//All records go into a single append, so that they become persistent together.
+static esdm_status datasetAppendJournal(esdm_md_backend_t *backend, esdm_dataset_t *d){
+  char* buff = NULL;
+  int64_t md_size = 0;
+  if(d->fragments.uncommittedCount) buff = esdmI_fragmentTable_encode(d->dataspace->dims, d->fragments.uncommittedCount, d->fragments.uncommitted, &md_size);
+  bool newGrids = d->gridCount > d->committedGridCount;
+  if(newGrids) {
+    smd_string_stream_t* grids = smd_string_stream_create();
+    smd_string_stream_printf(grids, "[");
+    for(int64_t i = d->committedGridCount; i < d->gridCount; i++) {
+      if(i > d->committedGridCount) smd_string_stream_printf(grids, ",");
+      esdmI_grid_serialize(grids, d->grids[i]);
+    }
+    smd_string_stream_printf(grids, "]");
+    size_t jsonSize;
+    char* json = smd_string_stream_close(grids, &jsonSize);
+    journalRecordAppend(&buff, &md_size, kGridRecordMagic, json, jsonSize);
+    free(json);
+  }
+  char* accessPattern = accessPatternCreate(d);
+  bool accessPatternChanged = accessPattern && (!d->committedAccessPattern || strcmp(accessPattern, d->committedAccessPattern));
+  if(accessPatternChanged) journalRecordAppend(&buff, &md_size, kAccessRecordMagic, accessPattern, strlen(accessPattern));
+
+  esdm_status ret = ESDM_SUCCESS;
+  if(md_size) ret = backend->callbacks.dataset_append(backend, d, buff, md_size);
+  if(ret == ESDM_SUCCESS) {
+    d->journalBytes += md_size;
+    if(newGrids) {
+      free(d->committedHeader);
+      d->committedHeader = datasetFixedHeaderCreate(d, d->gridCount);
+      d->committedGridCount = d->gridCount;
+    }
+    if(accessPatternChanged) {
+      free(d->committedAccessPattern);
+      d->committedAccessPattern = accessPattern;
+      accessPattern = NULL;
+    }
+  }
+  free(accessPattern);
+  free(buff);
+  return ret;
+}
+
+//Reads do not make a dataset dirty, but they change its access pattern, so we append that to the journal when the last reference is closed.
+//This way, read-only sessions contribute to the access pattern as well. Without journal support, the access pattern is only stored by the next commit.
+static void datasetJournalAccessPattern(esdm_dataset_t *d){
+  esdm_md_backend_t* backend = esdm_get_modules()->metadata_backend;
+  if(!backend->callbacks.dataset_append || !d->committedHeader || d->committedGridCount > d->gridCount || d->fragments.uncommittedCount) return;
+
+  int64_t journalBytes = d->journalBytes;
+  if(datasetAppendJournal(backend, d) != ESDM_SUCCESS) {
+    ESDM_WARN_FMT("cannot store the access pattern of dataset \"%s\"", d->name);
+  } else if(d->journalBytes != journalBytes) {
+    esdmI_mdCache_stampDataset(d);
+  }
+}
+
+//Write a fresh snapshot instead of appending to the journal once the journal has grown larger than both this threshold and the snapshot.
+//Tying the threshold to the snapshot size keeps the amortized cost of a commit proportional to the amount of new metadata.
+static const int64_t kMinJournalCompactionBytes = 1024*1024;
+
 esdm_status esdm_dataset_commit(esdm_dataset_t *d) {
   ESDM_DEBUG(__func__);
   eassert(d);
@@ -1147,17 +1736,59 @@ esdm_status esdm_dataset_commit(esdm_dataset_t *d) {
   }
   d->status = ESDM_DATA_PERSISTENT;
 
-  size_t md_size;
-  smd_string_stream_t* stream = smd_string_stream_create();
-  esdmI_dataset_metadata_create(d, stream);
-  char* buff = smd_string_stream_close(stream, & md_size);
-  // TODO commit each uncommited fragment
+  esdm_md_backend_t* backend = esdm_get_modules()->metadata_backend;
+  esdm_status ret;
 
-  // md callback create/update container
-  esdm_modules_t* modules = esdm_get_modules();
-  esdm_status ret = modules->metadata_backend->callbacks.dataset_commit(modules->metadata_backend, d, buff, md_size);
-  free(buff);
+  //If only fragments or grids were added, or the access pattern has changed, we append the changes to the journal.
+  //Any other change requires a new snapshot, as does a journal that has grown too large.
+  int64_t compactionBytes = d->snapshotBytes > kMinJournalCompactionBytes ? d->snapshotBytes : kMinJournalCompactionBytes;
+  bool canAppend = backend->callbacks.dataset_append && d->committedHeader && d->committedGridCount <= d->gridCount && d->journalBytes < compactionBytes;
+  if(canAppend) {
+    char* fixedHeader = datasetFixedHeaderCreate(d, d->committedGridCount);
+    canAppend = !strcmp(fixedHeader, d->committedHeader);
+    free(fixedHeader);
+  }
+  if(canAppend) {
+    ret = datasetAppendJournal(backend, d);
+  } else {
+    size_t headerSize;
+    char* header = datasetHeaderCreate(d, &headerSize);
+    //the snapshot consists of the JSON header, a null byte, and the paged fragment table
+    ret = esdmI_dataset_loadFragments(d, NULL);
+    if(ret != ESDM_SUCCESS) {
+      free(header);
+      d->status = ESDM_DATA_DIRTY;
+      return ret;
+    }
+    int64_t fragmentCount, tableSize;
+    esdm_fragment_t** fragments = esdmI_fragments_list(&d->fragments, &fragmentCount);
+    char* table = esdmI_fragmentPages_encode(d->dataspace->dims, fragmentCount, fragments, &tableSize);
+    free(fragments);
+    static const char kTableKey[] = ",\"fragment-pages\":1}";
+    int64_t md_size = headerSize + sizeof(kTableKey) + tableSize;
+    char* buff = ea_checked_malloc(md_size);
+    memcpy(buff, header, headerSize);
+    memcpy(buff + headerSize, kTableKey, sizeof(kTableKey)); //includes the null byte
+    memcpy(buff + headerSize + sizeof(kTableKey), table, tableSize);
+    free(table);
+
+    // md callback create/update container
+    ret = backend->callbacks.dataset_commit(backend, d, buff, md_size);
+    free(buff);
+    free(header);
+    if(ret == ESDM_SUCCESS) {
+      rememberCommittedHeader(d);
+      d->snapshotBytes = md_size;
+      d->journalBytes = 0;
+    }
+  }
 
+  if(ret == ESDM_SUCCESS) {
+    esdmI_fragments_markCommitted(&d->fragments);
+    esdmI_mdCache_stampDataset(d);
+  } else {
+    d->status = ESDM_DATA_DIRTY;
+  }
   return ret;
 }
 
@@ -1187,32 +1818,54 @@ static bool fragmentsCoverRegion(esdmI_hypercube_t* region, int64_t fragmentCoun
   return esdmI_hypercubeSet_isEmpty(*out_uncoveredRegion);
 }
 
-static esdm_grid_t* esdmI_dataset_gridCoveringRegion(esdm_dataset_t* dataset, esdmI_hypercube_t* region) {
-  esdm_grid_t* bestGrid = NULL;
-  int64_t regionSize = esdmI_hypercube_size(region);
-  int64_t smallestOverhead = 0x7fffffffffffffff;
-  for(int64_t i = 0; i < dataset->gridCount; i++) {
-    int64_t coverage = esdmI_grid_coverRegionSize(dataset->grids[i], region);
-    if(coverage == regionSize) {
-      int64_t overhead = esdmI_grid_coverRegionOverhead(dataset->grids[i], region);
-      if(overhead <= smallestOverhead) {
-        smallestOverhead = overhead;
-        bestGrid = dataset->grids[i];
-      }
+//Collects the fragments of the grids that intersect the region.
+//Grids may share fragments, so the fragments are deduplicated if there is more than one grid.
+static esdm_status gridFragmentsInRegion(int64_t gridCount, esdm_grid_t** grids, esdmI_hypercube_t* region, int64_t* out_count, esdm_fragment_t*** out_fragments) {
+  if(gridCount == 1) return esdmI_grid_fragmentsInRegion(grids[0], region, out_count, out_fragments);
+
+  GHashTable* seen = g_hash_table_new(g_direct_hash, g_direct_equal);
+  int64_t count = 0, slots = 0;
+  esdm_fragment_t** result = NULL;
+  esdm_status ret = ESDM_SUCCESS;
+  for(int64_t i = 0; i < gridCount && ret == ESDM_SUCCESS; i++) {
+    int64_t gridFragmentCount;
+    esdm_fragment_t** gridFragments;
+    ret = esdmI_grid_fragmentsInRegion(grids[i], region, &gridFragmentCount, &gridFragments);
+    if(ret != ESDM_SUCCESS) break;
+    for(int64_t j = 0; j < gridFragmentCount; j++) {
+      if(!g_hash_table_add(seen, gridFragments[j])) continue;
+      if(count == slots) result = ea_checked_realloc(result, (slots = 2*slots + 8)*sizeof*result);
+      result[count++] = gridFragments[j];
     }
+    free(gridFragments);
   }
-  return bestGrid;
+  g_hash_table_destroy(seen);
+
+  if(ret != ESDM_SUCCESS) {
+    free(result);
+    return ret;
+  }
+  *out_count = count;
+  *out_fragments = result ? result : ea_checked_malloc(sizeof*result);
+  return ESDM_SUCCESS;
 }
 
 esdm_status esdmI_dataset_fragmentsCoveringRegion(esdm_dataset_t* dataset, esdmI_hypercube_t* region, int64_t* out_count, esdm_fragment_t*** out_fragments, esdmI_hypercubeSet_t** out_uncovered, bool* out_fullyCovered) {
-  esdm_grid_t* grid = esdmI_dataset_gridCoveringRegion(dataset, region);
-  if(grid) {
-    esdm_status result = esdmI_grid_fragmentsInRegion(grid, region, out_count, out_fragments);
+  esdmI_gridSynthesis_apply(dataset);
+  int64_t gridCount;
+  esdm_grid_t** grids = esdmI_dataset_gridsCoveringRegion(dataset, region, &gridCount);
+  if(grids) {
+    esdm_status ret = gridFragmentsInRegion(gridCount, grids, region, out_count, out_fragments);
+    free(grids);
+    if(ret != ESDM_SUCCESS) return ret;
     *out_uncovered = esdmI_hypercubeSet_make();
     *out_fullyCovered = true;
   } else {
+    esdm_status ret = esdmI_dataset_loadFragments(dataset, region);
+    if(ret != ESDM_SUCCESS) return ret;
     *out_fragments = esdmI_fragments_makeSetCoveringRegion(&dataset->fragments, region, out_count);
     *out_fullyCovered = fragmentsCoverRegion(region, *out_count, *out_fragments, out_uncovered);
+    esdmI_gridSynthesis_schedule(dataset, *out_count, *out_fragments);  //future reads may be able to use a grid instead of scanning the fragments
   }
   return ESDM_SUCCESS;
 }
@@ -1236,11 +1889,49 @@ esdm_fragment_t* esdmI_dataset_lookupFragmentForShape(esdm_dataset_t* dataset, e
   esdmI_hypercube_t* extends;
   esdm_status status = esdmI_dataspace_getExtends(shape, &extends);
   eassert(status == ESDM_SUCCESS);
+  if(esdmI_dataset_loadFragments(dataset, extends) != ESDM_SUCCESS) ESDM_WARN_FMT("cannot decode the fragment metadata of dataset \"%s\"", dataset->name);
   esdm_fragment_t* result = esdmI_fragments_lookupForShape(&dataset->fragments, extends);
   esdmI_hypercube_destroy(extends);
   return result;
 }
 
+//Loads the fragments that intersect the region from the index of the metadata backend, which only returns the fragments that are actually needed.
+static esdm_status loadIndexedFragments(esdm_dataset_t* dataset, esdm_md_backend_t* backend, esdmI_hypercube_t* region) {
+  if(esdmI_fragmentPages_isRegionLoaded(dataset->fragmentPages, region)) return ESDM_SUCCESS;
+
+  char* tables;
+  int64_t size;
+  esdm_status ret = backend->callbacks.dataset_fragments_in_region(backend, dataset, region, &tables, &size);
+  if(ret != ESDM_SUCCESS) return ret;
+  int64_t fragmentCount = g_hash_table_size(dataset->fragments.table);
+  for(int64_t position = 0, tableSize; position < size && ret == ESDM_SUCCESS; position += tableSize) {
+    ret = esdmI_fragmentTable_decode(dataset, tables + position, size - position, &tableSize);
+  }
+  free(tables);
+  if(ret != ESDM_SUCCESS) return ret;
+  DEBUG("dataset \"%s\": loaded %"PRId64" fragments from the index of the metadata backend", dataset->name, (int64_t)g_hash_table_size(dataset->fragments.table) - fragmentCount);
+  esdmI_fragmentPages_markRegionLoaded(dataset->fragmentPages, region);
+  return ESDM_SUCCESS;
+}
+
+esdm_status esdmI_dataset_loadFragments(esdm_dataset_t* dataset, esdmI_hypercube_t* region) {
+  eassert(dataset);
+  if(!dataset->fragmentPages) return ESDM_SUCCESS;
+
+  int64_t uncommittedCount = dataset->fragments.uncommittedCount;
+  esdm_md_backend_t* backend = esdm_get_modules()->metadata_backend;
+  esdm_status ret = ESDM_ERROR;
+  if(region && backend->callbacks.dataset_fragments_in_region) ret = loadIndexedFragments(dataset, backend, region);
+  if(ret != ESDM_SUCCESS) ret = esdmI_fragmentPages_load(dataset->fragmentPages, dataset, region);  //decode the pages if the backend cannot answer the query
+  dataset->fragments.uncommittedCount = uncommittedCount; //the decoded fragments are already persistent, they must not go into the journal again
+  DEBUG("dataset \"%s\": %"PRId64" of %"PRId64" fragment pages decoded", dataset->name, esdmI_fragmentPages_loadedCount(dataset->fragmentPages), esdmI_fragmentPages_pageCount(dataset->fragmentPages));
+  if(esdmI_fragmentPages_isComplete(dataset->fragmentPages)) {
+    esdmI_fragmentPages_destroy(dataset->fragmentPages);
+    dataset->fragmentPages = NULL;
+  }
+  return ret;
+}
+
 esdm_status esdm_dataset_close(esdm_dataset_t *dset) {
   ESDM_DEBUG(__func__);
   eassert(dset);
@@ -1257,27 +1948,44 @@ esdm_status esdm_dataset_close(esdm_dataset_t *dset) {
     // needs to be synchronized, though
     return ESDM_SUCCESS;
   }
+  if(dset->status == ESDM_DATA_PERSISTENT) datasetJournalAccessPattern(dset);
+
+  if(! esdmI_mdCache_parkDataset(dset)){
+    esdmI_dataset_unload(dset);
+  }
+  return ESDM_SUCCESS;
+}
+
+void esdmI_dataset_unload(esdm_dataset_t *dset) {
+  eassert(dset);
+  eassert(!dset->refcount);
 
   dset->status = ESDM_DATA_NOT_LOADED;
+  dset->mdStamped = false;
+  esdmI_gridSynthesis_cancel(dset);
 
   smd_attr_destroy(dset->attr);
   dset->attr = NULL;
 
   esdmI_fragments_purge(&dset->fragments);
-  return ESDM_SUCCESS;
+  esdmI_fragmentPages_destroy(dset->fragmentPages);
+  dset->fragmentPages = NULL;
 }
 
 esdm_status esdmI_dataset_destroy(esdm_dataset_t *dset) {
   ESDM_DEBUG(__func__);
   eassert(dset);
+  esdmI_mdCache_forgetDataset(dset);
 
   esdm_status ret = esdmI_fragments_destruct(&dset->fragments);
   if (ret != ESDM_SUCCESS) return ret;  // free dataset only if all fragments can be destroyed/are not longer in use
+  esdmI_gridSynthesis_cancel(dset);
 
   for(int64_t i = dset->gridCount + dset->incompleteGridCount; i--; ) {
     esdmI_grid_destroy(dset->grids[i]);
   }
   free(dset->grids);
+  esdmI_gridIndex_destroy(dset->gridIndex);
 
   if(dset->attr) smd_attr_destroy(dset->attr); // maybe unref?
   if(dset->fill_value) smd_attr_destroy(dset->fill_value);
@@ -1286,7 +1994,12 @@ esdm_status esdmI_dataset_destroy(esdm_dataset_t *dset) {
   free(dset->id);
   free(dset->dims_dset_id);
   free(dset->actual_size);
+  free(dset->committedHeader);
+  free(dset->committedAccessPattern);
+  esdmI_fragmentPages_destroy(dset->fragmentPages);
   if(dset->chints) free(dset->chints);
+  esdmI_codec_destroy(dset->codec);
+  esdmI_accessPattern_destruct(&dset->accessPattern);
 
   free(dset);
   return ESDM_SUCCESS;
@@ -1601,6 +2314,44 @@ fail:
   return status;
 }
 
+esdm_status esdmI_dataspace_createFromReader(esdmI_jsonReader_t* reader, esdm_dataset_t* dataset, esdm_dataspace_t** out_dataspace) {
+  eassert(reader);
+  eassert(dataset);
+  eassert(out_dataspace);
+
+  esdm_status status = ESDM_INVALID_DATA_ERROR;
+  int64_t dims = dataset->dataspace->dims;
+  int64_t *size = NULL, *offset = NULL, *stride = NULL;
+  int64_t sizeCount = -1, offsetCount = -1, strideCount = -1;
+  *out_dataspace = NULL;
+
+  if(esdmI_jsonReader_next(reader) != ESDMI_JSON_OBJECT_START) goto done;
+  while(esdmI_jsonReader_nextKey(reader)) {
+    int64_t** array = esdmI_jsonReader_keyIs(reader, "size") ? &size : esdmI_jsonReader_keyIs(reader, "offset") ? &offset : esdmI_jsonReader_keyIs(reader, "stride") ? &stride : NULL;
+    int64_t* count = array == &size ? &sizeCount : array == &offset ? &offsetCount : &strideCount;
+    if(!array) {
+      esdmI_jsonReader_skipValue(reader, NULL, NULL);
+      continue;
+    }
+    if(*array) goto done;  //duplicate key
+    if(!esdmI_jsonReader_readIntArray(reader, array, count)) goto done;
+  }
+  if(!reader->ok) goto done;
+
+  //sanity check of the array lengths
+  if(sizeCount != dims || offsetCount != dims) goto done;
+  if(stride && strideCount != dims) goto done;
+
+  status = esdm_dataspace_create_full(dims, size, offset, dataset->dataspace->type, out_dataspace);
+  if(status == ESDM_SUCCESS && stride) status = esdm_dataspace_set_stride(*out_dataspace, stride);
+
+done:
+  free(size);
+  free(offset);
+  free(stride);
+  return status;
+}
+
 void esdm_dataspace_getEffectiveStride(esdm_dataspace_t* space, int64_t* out_stride) {
   if(space->stride) {
     memcpy(out_stride, space->stride, space->dims*sizeof(*space->stride));
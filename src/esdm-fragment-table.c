@@ -0,0 +1,862 @@
+/* This file is part of ESDM.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with ESDM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ * @brief A compact binary encoding for the fragment metadata of a dataset.
+ *
+ * Parsing fragment metadata from JSON creates a jansson object for every single field,
+ * which is prohibitively slow and memory hungry for datasets with hundreds of thousands of fragments.
+ * The binary table avoids this by storing each fragment as a short record of variable length integers.
+ *
+ * Layout of a table (integers are unsigned LEB128 varints unless noted otherwise, signed values are zigzag encoded):
+ *
+ *     magic          4 bytes "ESFT"
+ *     version        1 byte
+ *     length         8 bytes little endian, the size of the entire table including this header
+ *     dims
+ *     backendCount   followed by backendCount strings, the IDs of the backends the fragments are stored on
+ *     fragmentCount  followed by fragmentCount records
+ *
+ * Each record looks like this:
+ *
+ *     flags          1 byte, see the kFlag constants
+ *     backend        index into the backend table
+ *     id             string
+ *     actualBytes    signed
+ *     size           dims values
+ *     offset         dims signed values
+ *     stride         dims signed values, only present with kFlagStride
+ *     backendData    string, the JSON produced by the backend's fragment_metadata_create() callback, only present with kFlagBackendData
+ *
+ * Strings are stored as their length followed by the characters without a terminator.
+ * Two tables can be merged by concatenating their records, only the backend indices of the records need to be rewritten.
+ *
+ * The persistent snapshot of a dataset does not store a single table, but a paged table:
+ * The fragments are partitioned into spatially compact pages, each of which is a complete fragment table.
+ * A small index in front of the pages holds the bounding box of each page,
+ * so that a reader only needs to decode the pages that intersect the region it actually accesses.
+ *
+ *     magic          4 bytes "ESFP"
+ *     version        1 byte
+ *     length         8 bytes little endian, the size of the entire paged table including this header
+ *     dims
+ *     pageCount      followed by pageCount index entries
+ *
+ * Each index entry looks like this:
+ *
+ *     offset         dims signed values, the start of the bounding box of the fragments in the page
+ *     size           dims values, the size of that bounding box
+ *     position       the position of the page's fragment table, relative to the start of the paged table
+ *     pageSize       the size of the page's fragment table
+ *
+ * If the metadata backend can read byte ranges of a snapshot, a dataset is opened with only the header and the index of its paged table,
+ * see esdmI_fragmentPages_truncateToIndex(), and the pages are fetched from the snapshot when they are needed.
+ */
+
+#include <esdm-internal.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEBUG(fmt, ...) ESDM_DEBUG_COM_FMT("FRAGMENT TABLE", fmt, __VA_ARGS__)
+
+static const char kMagic[4] = {'E', 'S', 'F', 'T'};
+static const uint8_t kVersion = 1;
+static const int64_t kHeaderSize = sizeof(kMagic) + 1 + 8;
+
+enum {
+  kFlagStride = 1,
+  kFlagBackendData = 2
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Encoding ///////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+typedef struct tableWriter_t {
+  uint8_t* data;
+  int64_t size, allocatedSize;
+} tableWriter_t;
+
+static void writer_reserve(tableWriter_t* me, int64_t bytes) {
+  if(me->size + bytes <= me->allocatedSize) return;
+  while(me->size + bytes > me->allocatedSize) me->allocatedSize *= 2;
+  me->data = ea_checked_realloc(me->data, me->allocatedSize);
+}
+
+static void writer_putBytes(tableWriter_t* me, const void* bytes, int64_t count) {
+  writer_reserve(me, count);
+  memcpy(me->data + me->size, bytes, count);
+  me->size += count;
+}
+
+static void writer_putByte(tableWriter_t* me, uint8_t byte) {
+  writer_reserve(me, 1);
+  me->data[me->size++] = byte;
+}
+
+static void writer_putVarint(tableWriter_t* me, uint64_t value) {
+  writer_reserve(me, 10);
+  do {
+    uint8_t byte = value & 0x7f;
+    value >>= 7;
+    me->data[me->size++] = byte | (value ? 0x80 : 0);
+  } while(value);
+}
+
+static void writer_putSigned(tableWriter_t* me, int64_t value) {
+  writer_putVarint(me, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+static void writer_putString(tableWriter_t* me, const char* string, int64_t length) {
+  writer_putVarint(me, length);
+  writer_putBytes(me, string, length);
+}
+
+//returns the index of the backend in the table, adding it if necessary
+static int64_t internBackend(esdm_backend_t*** backends, int64_t* backendCount, esdm_backend_t* backend) {
+  for(int64_t i = 0; i < *backendCount; i++) {
+    if((*backends)[i] == backend) return i;
+  }
+  *backends = ea_checked_realloc(*backends, (*backendCount + 1)*sizeof**backends);
+  (*backends)[*backendCount] = backend;
+  return (*backendCount)++;
+}
+
+//Prepends the table header to the encoded records, and releases the records buffer.
+static char* assembleTable(int64_t dims, int64_t backendCount, const char* const* backendIds, const int64_t* backendIdLengths, int64_t count, tableWriter_t* records, int64_t* out_size) {
+  tableWriter_t table = { .data = ea_checked_malloc(records->size + 1024), .size = 0, .allocatedSize = records->size + 1024 };
+  writer_putBytes(&table, kMagic, sizeof(kMagic));
+  writer_putByte(&table, kVersion);
+  writer_putBytes(&table, (uint8_t[8]){0}, 8); //the length is filled in below
+  writer_putVarint(&table, dims);
+  writer_putVarint(&table, backendCount);
+  for(int64_t i = 0; i < backendCount; i++) writer_putString(&table, backendIds[i], backendIdLengths[i]);
+  writer_putVarint(&table, count);
+  writer_putBytes(&table, records->data, records->size);
+  for(int64_t i = 0; i < 8; i++) table.data[sizeof(kMagic) + 1 + i] = (uint64_t)table.size >> 8*i;
+
+  free(records->data);
+  *records = (tableWriter_t){0};
+  *out_size = table.size;
+  return (char*)table.data;
+}
+
+char* esdmI_fragmentTable_encode(int64_t dims, int64_t count, esdm_fragment_t** fragments, int64_t* out_size) {
+  eassert(count >= 0);
+  eassert(!count || fragments);
+  eassert(out_size);
+
+  timer myTimer;
+  ea_start_timer(&myTimer);
+
+  //The backend IDs are written before the records, but we only know which backends are used once we have seen all fragments.
+  //So we encode the records first, and assemble the table afterwards.
+  tableWriter_t records = { .data = ea_checked_malloc(1024), .size = 0, .allocatedSize = 1024 };
+  esdm_backend_t** backends = NULL;
+  int64_t backendCount = 0;
+  for(int64_t i = 0; i < count; i++) {
+    esdm_fragment_t* fragment = fragments[i];
+    esdm_dataspace_t* space = fragment->dataspace;
+    eassert(space->dims == dims);
+
+    char* backendData = NULL;
+    size_t backendDataSize = 0;
+    if(fragment->backend->callbacks.fragment_metadata_create) {
+      smd_string_stream_t* stream = smd_string_stream_create();
+      esdmI_backend_fragment_metadata_create(fragment->backend, fragment, stream);
+      backendData = smd_string_stream_close(stream, &backendDataSize);
+    }
+
+    writer_putByte(&records, (space->stride ? kFlagStride : 0) | (backendData ? kFlagBackendData : 0));
+    writer_putVarint(&records, internBackend(&backends, &backendCount, fragment->backend));
+    writer_putString(&records, fragment->id, strlen(fragment->id));
+    writer_putSigned(&records, fragment->actual_bytes);
+    for(int64_t d = 0; d < dims; d++) writer_putVarint(&records, space->size[d]);
+    for(int64_t d = 0; d < dims; d++) writer_putSigned(&records, space->offset[d]);
+    if(space->stride) {
+      for(int64_t d = 0; d < dims; d++) writer_putSigned(&records, space->stride[d]);
+    }
+    if(backendData) {
+      writer_putString(&records, backendData, backendDataSize);
+      free(backendData);
+    }
+  }
+
+  const char* backendIds[backendCount + 1];
+  int64_t backendIdLengths[backendCount + 1];
+  for(int64_t i = 0; i < backendCount; i++) {
+    backendIds[i] = backends[i]->config->id;
+    backendIdLengths[i] = strlen(backendIds[i]);
+  }
+  char* result = assembleTable(dims, backendCount, backendIds, backendIdLengths, count, &records, out_size);
+  free(backends);
+  DEBUG("encoded %"PRId64" fragments in %"PRId64" bytes (%g s)", count, *out_size, ea_stop_timer(myTimer));
+  return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Decoding ///////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+//All reading functions turn `ok` false on a buffer overrun, and return zeros from then on, so that errors only need to be checked once per record.
+typedef struct tableReader_t {
+  const uint8_t* pos, *end;
+  bool ok;
+} tableReader_t;
+
+static uint8_t reader_getByte(tableReader_t* me) {
+  if(!me->ok || me->pos >= me->end) return me->ok = false;
+  return *me->pos++;
+}
+
+static uint64_t reader_getVarint(tableReader_t* me) {
+  uint64_t result = 0;
+  for(int shift = 0; shift < 64; shift += 7) {
+    uint8_t byte = reader_getByte(me);
+    result |= (uint64_t)(byte & 0x7f) << shift;
+    if(!(byte & 0x80)) return me->ok ? result : 0;
+  }
+  return me->ok = false;  //too many continuation bytes
+}
+
+static int64_t reader_getSigned(tableReader_t* me) {
+  uint64_t value = reader_getVarint(me);
+  return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+//Copies a string of the table into a reusable heap buffer and terminates it.
+//The lengths come from the table, so they must not be used to size stack buffers.
+static char* terminateString(char** inout_buffer, int64_t* inout_capacity, const char* string, int64_t length) {
+  if(length + 1 > *inout_capacity) {
+    *inout_capacity = length + 1;
+    *inout_buffer = ea_checked_realloc(*inout_buffer, *inout_capacity);
+  }
+  memcpy(*inout_buffer, string, length);
+  (*inout_buffer)[length] = 0;
+  return *inout_buffer;
+}
+
+//returns a pointer into the table, the string is not terminated
+static const char* reader_getString(tableReader_t* me, int64_t* out_length) {
+  uint64_t length = reader_getVarint(me);
+  if(!me->ok || length > (uint64_t)(me->end - me->pos)) {
+    me->ok = false;
+    *out_length = 0;
+    return NULL;
+  }
+  const char* result = (const char*)me->pos;
+  me->pos += length;
+  *out_length = length;
+  return result;
+}
+
+bool esdmI_fragmentTable_isTable(const char* data, int64_t available) {
+  return available >= kHeaderSize && !memcmp(data, kMagic, sizeof(kMagic));
+}
+
+//Checks the header of a table and positions the reader behind it.
+//`out_tableSize` receives the size that is recorded in the header, or zero if the header is unusable.
+static esdm_status openTable(const char* data, int64_t available, tableReader_t* out_reader, uint64_t* out_tableSize) {
+  *out_tableSize = 0;
+  if(!esdmI_fragmentTable_isTable(data, available)) return ESDM_INVALID_DATA_ERROR;
+  if((uint8_t)data[sizeof(kMagic)] != kVersion) {
+    ESDM_WARN_FMT("unsupported fragment table version %d", (int)(uint8_t)data[sizeof(kMagic)]);
+    return ESDM_INVALID_DATA_ERROR;
+  }
+  uint64_t tableSize = 0;
+  for(int64_t i = 0; i < 8; i++) tableSize |= (uint64_t)(uint8_t)data[sizeof(kMagic) + 1 + i] << 8*i;
+  if(tableSize < kHeaderSize || tableSize > INT64_MAX) return ESDM_INVALID_DATA_ERROR;
+  *out_tableSize = tableSize;
+  if(tableSize > (uint64_t)available) return ESDM_INVALID_DATA_ERROR;
+
+  *out_reader = (tableReader_t){
+    .pos = (const uint8_t*)data + kHeaderSize,
+    .end = (const uint8_t*)data + tableSize,
+    .ok = true
+  };
+  return ESDM_SUCCESS;
+}
+
+//Decodes the records of a table into the dataset.
+//If `out_fragments` is not NULL, it receives the fragment of each record in table order:
+//either the fragment that was created for the record, or the fragment that the dataset already had for the record's shape.
+static esdm_status decodeTable(esdm_dataset_t* dataset, const char* data, int64_t available, int64_t* out_size, int64_t* out_count, esdm_fragment_t*** out_fragments) {
+  eassert(dataset);
+  eassert(data);
+
+  timer myTimer;
+  ea_start_timer(&myTimer);
+  if(out_size) *out_size = 0;
+  if(out_count) *out_count = 0;
+  if(out_fragments) *out_fragments = NULL;
+
+  tableReader_t reader;
+  uint64_t tableSize;
+  esdm_status ret = openTable(data, available, &reader, &tableSize);
+  if(out_size) *out_size = tableSize;  //also reported for truncated tables, so that the caller can detect the truncation
+  if(ret != ESDM_SUCCESS) return ret;
+  int64_t dims = reader_getVarint(&reader);
+  if(!reader.ok || dims != dataset->dataspace->dims) return ESDM_INVALID_DATA_ERROR;
+
+  //resolve the backend IDs once
+  int64_t backendCount = reader_getVarint(&reader);
+  if(!reader.ok || backendCount < 0 || backendCount > reader.end - reader.pos) return ESDM_INVALID_DATA_ERROR;  //each ID takes at least one byte
+  esdm_backend_t** backends = ea_checked_malloc((backendCount + 1)*sizeof*backends);
+  char* text = NULL;  //scratch buffer for the strings of the table
+  int64_t textCapacity = 0;
+  for(int64_t i = 0; i < backendCount && ret == ESDM_SUCCESS; i++) {
+    int64_t length;
+    const char* id = reader_getString(&reader, &length);
+    if(!reader.ok) {
+      ret = ESDM_INVALID_DATA_ERROR;
+      break;
+    }
+    backends[i] = esdmI_get_backend(terminateString(&text, &textCapacity, id, length));
+    if(!backends[i]) ret = ESDM_INVALID_DATA_ERROR;
+  }
+
+  //decode the records
+  int64_t fragmentCount = ret == ESDM_SUCCESS ? reader_getVarint(&reader) : 0;
+  if(ret == ESDM_SUCCESS && (!reader.ok || fragmentCount < 0 || fragmentCount > reader.end - reader.pos)) ret = ESDM_INVALID_DATA_ERROR;  //each record takes at least one byte
+  if(ret != ESDM_SUCCESS) {
+    free(backends);
+    free(text);
+    return ret;
+  }
+  esdm_fragment_t** fragments = out_fragments ? ea_checked_malloc((fragmentCount + 1)*sizeof*fragments) : NULL;
+  int64_t size[dims + 1], offset[dims + 1], stride[dims + 1];
+  for(int64_t i = 0; i < fragmentCount && ret == ESDM_SUCCESS; i++) {
+    uint8_t flags = reader_getByte(&reader);
+    uint64_t backendIndex = reader_getVarint(&reader);
+    int64_t idLength;
+    const char* id = reader_getString(&reader, &idLength);
+    int64_t actualBytes = reader_getSigned(&reader);
+    for(int64_t d = 0; d < dims; d++) size[d] = reader_getVarint(&reader);
+    for(int64_t d = 0; d < dims; d++) offset[d] = reader_getSigned(&reader);
+    if(flags & kFlagStride) {
+      for(int64_t d = 0; d < dims; d++) stride[d] = reader_getSigned(&reader);
+    }
+    int64_t backendDataLength = 0;
+    const char* backendData = flags & kFlagBackendData ? reader_getString(&reader, &backendDataLength) : NULL;
+    if(!reader.ok || backendIndex >= (uint64_t)backendCount) {
+      ret = ESDM_INVALID_DATA_ERROR;
+      break;
+    }
+
+    esdm_dataspace_t* space;
+    ret = esdm_dataspace_create_full(dims, size, offset, esdm_dataset_get_type(dataset), &space);
+    if(ret != ESDM_SUCCESS) break;
+    if(flags & kFlagStride) esdm_dataspace_set_stride(space, stride);
+    esdmI_hypercube_t* extends;
+    esdmI_dataspace_getExtends(space, &extends);
+    esdm_fragment_t* existing = esdmI_fragments_lookupForShape(&dataset->fragments, extends); //must not trigger the loading of further pages
+    esdmI_hypercube_destroy(extends);
+    if(existing) {
+      esdm_dataspace_destroy(space);  //we already have a fragment with this shape
+      if(fragments) fragments[i] = existing;
+      continue;
+    }
+
+    json_t* backendJson = backendData ? load_json(terminateString(&text, &textCapacity, backendData, backendDataLength)) : NULL;
+    esdm_fragment_t* fragment = esdmI_fragment_createLoaded(dataset, space, terminateString(&text, &textCapacity, id, idLength), backends[backendIndex], actualBytes, backendJson);
+    if(backendJson) json_decref(backendJson);
+    ret = esdmI_dataset_addLoadedFragment(dataset, fragment);
+    if(fragments) fragments[i] = fragment;
+  }
+  if(ret == ESDM_SUCCESS && !reader.ok) ret = ESDM_INVALID_DATA_ERROR;
+  free(backends);
+  free(text);
+
+  DEBUG("decoded %"PRId64" fragments from %"PRIu64" bytes (%g s)", fragmentCount, tableSize, ea_stop_timer(myTimer));
+  if(fragments && ret == ESDM_SUCCESS) {
+    *out_count = fragmentCount;
+    *out_fragments = fragments;
+  } else {
+    free(fragments);
+  }
+  return ret;
+}
+
+esdm_status esdmI_fragmentTable_decode(esdm_dataset_t* dataset, const char* data, int64_t available, int64_t* out_size) {
+  return decodeTable(dataset, data, available, out_size, NULL, NULL);
+}
+
+esdm_status esdmI_fragmentTable_decodeList(esdm_dataset_t* dataset, const char* data, int64_t available, int64_t* out_size, int64_t* out_count, esdm_fragment_t*** out_fragments) {
+  eassert(out_count);
+  eassert(out_fragments);
+  return decodeTable(dataset, data, available, out_size, out_count, out_fragments);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Merging ////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+typedef struct backendTable_t {
+  int64_t count;
+  const char** ids;
+  int64_t* lengths;
+} backendTable_t;
+
+//returns the index of the backend ID in the table, adding it if necessary
+static int64_t internBackendId(backendTable_t* me, const char* id, int64_t length) {
+  for(int64_t i = 0; i < me->count; i++) {
+    if(me->lengths[i] == length && !memcmp(me->ids[i], id, length)) return i;
+  }
+  me->ids = ea_checked_realloc(me->ids, (me->count + 1)*sizeof*me->ids);
+  me->lengths = ea_checked_realloc(me->lengths, (me->count + 1)*sizeof*me->lengths);
+  me->ids[me->count] = id;
+  me->lengths[me->count] = length;
+  return me->count++;
+}
+
+//Appends the records of a table to `records`, rewriting their backend indices to refer to `backends`.
+//The records are copied verbatim otherwise, so this does not need to know about datasets or backends.
+static bool appendRecords(const char* data, int64_t size, int64_t* inout_dims, backendTable_t* backends, tableWriter_t* records, int64_t* inout_count) {
+  tableReader_t reader;
+  uint64_t tableSize;
+  if(openTable(data, size, &reader, &tableSize) != ESDM_SUCCESS) return false;
+  int64_t dims = reader_getVarint(&reader);
+  if(!reader.ok || dims < 0 || dims > reader.end - reader.pos || (*inout_dims >= 0 && dims != *inout_dims)) return false;
+  *inout_dims = dims;
+
+  int64_t backendCount = reader_getVarint(&reader);
+  if(!reader.ok || backendCount < 0 || backendCount > reader.end - reader.pos) return false;  //each ID takes at least one byte
+  int64_t* backendMap = ea_checked_malloc((backendCount + 1)*sizeof*backendMap);
+  for(int64_t i = 0; i < backendCount && reader.ok; i++) {
+    int64_t length;
+    const char* id = reader_getString(&reader, &length);
+    if(reader.ok) backendMap[i] = internBackendId(backends, id, length);
+  }
+
+  int64_t fragmentCount = reader_getVarint(&reader);
+  if(fragmentCount < 0 || fragmentCount > reader.end - reader.pos) reader.ok = false;  //each record takes at least one byte
+  for(int64_t i = 0; i < fragmentCount && reader.ok; i++) {
+    uint8_t flags = reader_getByte(&reader);
+    uint64_t backendIndex = reader_getVarint(&reader);
+    const uint8_t* rest = reader.pos;
+    int64_t length;
+    reader_getString(&reader, &length);
+    reader_getSigned(&reader);
+    for(int64_t d = 0; d < dims; d++) reader_getVarint(&reader);
+    for(int64_t d = 0; d < dims; d++) reader_getSigned(&reader);
+    if(flags & kFlagStride) {
+      for(int64_t d = 0; d < dims; d++) reader_getSigned(&reader);
+    }
+    if(flags & kFlagBackendData) reader_getString(&reader, &length);
+    if(!reader.ok || backendIndex >= (uint64_t)backendCount) {
+      reader.ok = false;
+      break;
+    }
+
+    writer_putByte(records, flags);
+    writer_putVarint(records, backendMap[backendIndex]);
+    writer_putBytes(records, rest, reader.pos - rest);
+  }
+  free(backendMap);
+  *inout_count += fragmentCount;
+  return reader.ok;
+}
+
+char* esdmI_fragmentTable_merge(const char* a, int64_t aSize, const char* b, int64_t bSize, int64_t* out_size) {
+  eassert(a);
+  eassert(b);
+  eassert(out_size);
+
+  timer myTimer;
+  ea_start_timer(&myTimer);
+
+  tableWriter_t records = { .data = ea_checked_malloc(aSize + bSize + 1), .size = 0, .allocatedSize = aSize + bSize + 1 };
+  backendTable_t backends = {0};
+  int64_t dims = -1, count = 0;
+  char* result = NULL;
+  if(appendRecords(a, aSize, &dims, &backends, &records, &count) && appendRecords(b, bSize, &dims, &backends, &records, &count)) {
+    result = assembleTable(dims, backends.count, backends.ids, backends.lengths, count, &records, out_size); //the backend IDs still point into the input tables
+    DEBUG("merged %"PRId64" fragments into %"PRId64" bytes (%g s)", count, *out_size, ea_stop_timer(myTimer));
+  } else {
+    free(records.data);
+    *out_size = 0;
+  }
+  free(backends.ids);
+  free(backends.lengths);
+  return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Paged tables ///////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+static const char kPagedMagic[4] = {'E', 'S', 'F', 'P'};
+static const char kPagedIndexMagic[4] = {'E', 'S', 'F', 'I'};  //replaces kPagedMagic in a copy of the table that ends after the index
+static const uint8_t kPagedVersion = 1;
+static const int64_t kPageFragments = 256;  //pages are split until they hold at most this many fragments
+enum { kMaxLoadedRegions = 8 };  //the number of regions that are remembered by esdmI_fragmentPages_markRegionLoaded()
+
+struct esdmI_fragmentPages_t {
+  int64_t dims, pageCount, loadedCount;
+  char* data; //room for the entire paged table, the page positions point into this buffer
+  int64_t tableOffset, tableSize;  //the position and size of the paged table within the snapshot of the dataset
+  esdmI_hypercube_t** bounds;
+  int64_t* positions, *sizes;
+  bool* present;  //whether the page has been copied into `data`, the other pages are fetched from the snapshot on demand
+  bool* loaded;
+  esdmI_hypercube_t* loadedRegions[kMaxLoadedRegions];  //regions whose fragments have been loaded from the metadata backend's index, replaced round robin
+  int64_t nextLoadedRegion;
+};
+
+typedef struct keyedFragment_t {
+  int64_t key;
+  esdm_fragment_t* fragment;
+} keyedFragment_t;
+
+static int compareKeys(const void* aVoid, const void* bVoid) {
+  const keyedFragment_t* a = aVoid, *b = bVoid;
+  return a->key < b->key ? -1 : a->key > b->key ? 1 : 0;
+}
+
+//Recursive bisection: Sort the fragments along the dimension in which their centers are spread the widest, and split them at the median.
+//This yields pages with compact, mostly disjoint bounding boxes for any decomposition of the dataset into fragments.
+//The pages are contiguous ranges of the `fragments` array after the call, their boundaries are appended to `pageEnds`.
+static void partitionFragments(keyedFragment_t* fragments, int64_t count, int64_t dims, int64_t* pageEnds, int64_t* pageCount, int64_t base) {
+  if(count <= kPageFragments) {
+    pageEnds[(*pageCount)++] = base + count;
+    return;
+  }
+
+  int64_t splitDim = 0, widestSpread = -1;
+  for(int64_t d = 0; d < dims; d++) {
+    int64_t min = INT64_MAX, max = INT64_MIN;
+    for(int64_t i = 0; i < count; i++) {
+      esdm_dataspace_t* space = fragments[i].fragment->dataspace;
+      int64_t center = 2*space->offset[d] + space->size[d];  //twice the center, avoids rounding
+      if(center < min) min = center;
+      if(center > max) max = center;
+    }
+    if(max - min > widestSpread) {
+      widestSpread = max - min;
+      splitDim = d;
+    }
+  }
+  for(int64_t i = 0; i < count; i++) {
+    esdm_dataspace_t* space = fragments[i].fragment->dataspace;
+    fragments[i].key = 2*space->offset[splitDim] + space->size[splitDim];
+  }
+  qsort(fragments, count, sizeof(*fragments), compareKeys);
+
+  int64_t half = count/2;
+  partitionFragments(fragments, half, dims, pageEnds, pageCount, base);
+  partitionFragments(fragments + half, count - half, dims, pageEnds, pageCount, base + half);
+}
+
+char* esdmI_fragmentPages_encode(int64_t dims, int64_t count, esdm_fragment_t** fragments, int64_t* out_size) {
+  eassert(count >= 0);
+  eassert(!count || fragments);
+  eassert(out_size);
+
+  keyedFragment_t* keyed = ea_checked_malloc((count + 1)*sizeof(*keyed));
+  for(int64_t i = 0; i < count; i++) keyed[i] = (keyedFragment_t){ .key = 0, .fragment = fragments[i] };
+  int64_t* pageEnds = ea_checked_malloc((count/kPageFragments*2 + 2)*sizeof(*pageEnds));  //bisection never produces pages with less than kPageFragments/2 fragments
+  int64_t pageCount = 0;
+  if(count) partitionFragments(keyed, count, dims, pageEnds, &pageCount, 0);
+
+  //encode the pages
+  char* pages[pageCount + 1];
+  int64_t pageSizes[pageCount + 1];
+  int64_t* boundsStart = ea_checked_malloc((pageCount*dims + 1)*sizeof(*boundsStart));
+  int64_t* boundsEnd = ea_checked_malloc((pageCount*dims + 1)*sizeof(*boundsEnd));
+  esdm_fragment_t** pageFragments = ea_checked_malloc((count + 1)*sizeof(*pageFragments));
+  for(int64_t page = 0, start = 0; page < pageCount; start = pageEnds[page++]) {
+    int64_t pageFragmentCount = pageEnds[page] - start;
+    for(int64_t d = 0; d < dims; d++) {
+      boundsStart[page*dims + d] = INT64_MAX;
+      boundsEnd[page*dims + d] = INT64_MIN;
+    }
+    for(int64_t i = 0; i < pageFragmentCount; i++) {
+      esdm_dataspace_t* space = keyed[start + i].fragment->dataspace;
+      pageFragments[i] = keyed[start + i].fragment;
+      for(int64_t d = 0; d < dims; d++) {
+        if(space->offset[d] < boundsStart[page*dims + d]) boundsStart[page*dims + d] = space->offset[d];
+        if(space->offset[d] + space->size[d] > boundsEnd[page*dims + d]) boundsEnd[page*dims + d] = space->offset[d] + space->size[d];
+      }
+    }
+    pages[page] = esdmI_fragmentTable_encode(dims, pageFragmentCount, pageFragments, &pageSizes[page]);
+  }
+  free(pageFragments);
+  free(keyed);
+  free(pageEnds);
+
+  //The index entries contain the absolute page positions, which depend on the size of the index itself.
+  //Since the varints can only grow when the positions grow, we simply reencode the index until its size is stable.
+  tableWriter_t header = { .data = ea_checked_malloc(64), .size = 0, .allocatedSize = 64 };
+  writer_putBytes(&header, kPagedMagic, sizeof(kPagedMagic));
+  writer_putByte(&header, kPagedVersion);
+  writer_putBytes(&header, (uint8_t[8]){0}, 8); //the length is filled in below
+  writer_putVarint(&header, dims);
+  writer_putVarint(&header, pageCount);
+  tableWriter_t index = { .data = ea_checked_malloc(1024), .size = 0, .allocatedSize = 1024 };
+  int64_t indexSize = 0, position;
+  while(true) {
+    index.size = 0;
+    position = header.size + indexSize;
+    for(int64_t page = 0; page < pageCount; page++) {
+      for(int64_t d = 0; d < dims; d++) writer_putSigned(&index, boundsStart[page*dims + d]);
+      for(int64_t d = 0; d < dims; d++) writer_putVarint(&index, boundsEnd[page*dims + d] - boundsStart[page*dims + d]);
+      writer_putVarint(&index, position);
+      writer_putVarint(&index, pageSizes[page]);
+      position += pageSizes[page];
+    }
+    if(index.size == indexSize) break;
+    indexSize = index.size;
+  }
+  free(boundsStart);
+  free(boundsEnd);
+
+  tableWriter_t table = { .data = ea_checked_malloc(position + 1), .size = 0, .allocatedSize = position + 1 };
+  writer_putBytes(&table, header.data, header.size);
+  writer_putBytes(&table, index.data, index.size);
+  for(int64_t page = 0; page < pageCount; page++) {
+    writer_putBytes(&table, pages[page], pageSizes[page]);
+    free(pages[page]);
+  }
+  eassert(table.size == position);
+  for(int64_t i = 0; i < 8; i++) table.data[sizeof(kPagedMagic) + 1 + i] = (uint64_t)table.size >> 8*i;
+  free(index.data);
+  free(header.data);
+
+  DEBUG("encoded %"PRId64" fragments in %"PRId64" pages, %"PRId64" bytes", count, pageCount, table.size);
+  *out_size = table.size;
+  return (char*)table.data;
+}
+
+bool esdmI_fragmentPages_isPagedTable(const char* data, int64_t available) {
+  return available >= kHeaderSize && (!memcmp(data, kPagedMagic, sizeof(kPagedMagic)) || !memcmp(data, kPagedIndexMagic, sizeof(kPagedIndexMagic)));
+}
+
+static uint64_t pagedTableSize(const char* data) {
+  uint64_t result = 0;
+  for(int64_t i = 0; i < 8; i++) result |= (uint64_t)(uint8_t)data[sizeof(kPagedMagic) + 1 + i] << 8*i;
+  return result;
+}
+
+int64_t esdmI_fragmentPages_truncateToIndex(char* data, int64_t available) {
+  eassert(data);
+
+  if(available < kHeaderSize) return 0;
+  if(memcmp(data, kPagedMagic, sizeof(kPagedMagic))) return -1;
+  uint64_t tableSize = pagedTableSize(data);
+  tableReader_t reader = {
+    .pos = (const uint8_t*)data + kHeaderSize,
+    .end = (const uint8_t*)data + (tableSize < (uint64_t)available ? (int64_t)tableSize : available),
+    .ok = true
+  };
+  uint64_t dims = reader_getVarint(&reader);
+  uint64_t pageCount = reader_getVarint(&reader);
+  for(uint64_t page = 0; page < pageCount && reader.ok; page++) {
+    for(uint64_t i = 0; i < 2*dims + 2 && reader.ok; i++) reader_getVarint(&reader);  //offset, size, position and pageSize
+  }
+  if(!reader.ok) return tableSize > (uint64_t)available ? 0 : -1;
+
+  memcpy(data, kPagedIndexMagic, sizeof(kPagedIndexMagic));
+  return (const char*)reader.pos - data;
+}
+
+esdm_status esdmI_fragmentPages_open(const char* data, int64_t available, int64_t dims, int64_t tableOffset, int64_t* out_size, esdmI_fragmentPages_t** out_pages) {
+  eassert(data);
+  eassert(out_pages);
+
+  *out_pages = NULL;
+  if(out_size) *out_size = 0;
+  if(!esdmI_fragmentPages_isPagedTable(data, available)) return ESDM_INVALID_DATA_ERROR;
+  if((uint8_t)data[sizeof(kPagedMagic)] != kPagedVersion) {
+    ESDM_WARN_FMT("unsupported paged fragment table version %d", (int)(uint8_t)data[sizeof(kPagedMagic)]);
+    return ESDM_INVALID_DATA_ERROR;
+  }
+  bool indexOnly = !memcmp(data, kPagedIndexMagic, sizeof(kPagedIndexMagic));
+  uint64_t tableSize = pagedTableSize(data);
+  if(tableSize < kHeaderSize || tableSize > INT64_MAX || (!indexOnly && tableSize > (uint64_t)available)) return ESDM_INVALID_DATA_ERROR;
+
+  tableReader_t reader = {
+    .pos = (const uint8_t*)data + kHeaderSize,
+    .end = (const uint8_t*)data + (tableSize < (uint64_t)available ? (int64_t)tableSize : available),
+    .ok = true
+  };
+  if(reader_getVarint(&reader) != (uint64_t)dims || !reader.ok) return ESDM_INVALID_DATA_ERROR;
+  int64_t pageCount = reader_getVarint(&reader);
+  if(!reader.ok || pageCount < 0 || pageCount > reader.end - reader.pos) return ESDM_INVALID_DATA_ERROR;
+
+  esdmI_fragmentPages_t* result = ea_checked_malloc(sizeof(*result));
+  *result = (esdmI_fragmentPages_t){
+    .dims = dims,
+    .pageCount = 0,
+    .loadedCount = 0,
+    .data = NULL,
+    .tableOffset = tableOffset,
+    .tableSize = tableSize,
+    .bounds = ea_checked_malloc((pageCount + 1)*sizeof(*result->bounds)),
+    .positions = ea_checked_malloc((pageCount + 1)*sizeof(*result->positions)),
+    .sizes = ea_checked_malloc((pageCount + 1)*sizeof(*result->sizes)),
+    .present = ea_checked_malloc((pageCount + 1)*sizeof(*result->present)),
+    .loaded = ea_checked_malloc((pageCount + 1)*sizeof(*result->loaded))
+  };
+  int64_t offset[dims + 1], size[dims + 1];
+  for(int64_t page = 0; page < pageCount; page++) {
+    for(int64_t d = 0; d < dims; d++) offset[d] = reader_getSigned(&reader);
+    for(int64_t d = 0; d < dims; d++) size[d] = reader_getVarint(&reader);
+    uint64_t position = reader_getVarint(&reader);
+    uint64_t pageSize = reader_getVarint(&reader);
+    if(!reader.ok || position > tableSize || pageSize > tableSize - position) {
+      esdmI_fragmentPages_destroy(result);
+      return ESDM_INVALID_DATA_ERROR;
+    }
+    result->bounds[page] = esdmI_hypercube_make(dims, offset, size);
+    result->positions[page] = position;
+    result->sizes[page] = pageSize;
+    result->present[page] = !indexOnly;
+    result->loaded[page] = false;
+    result->pageCount++;
+  }
+  int64_t copySize = indexOnly ? (const char*)reader.pos - data : (int64_t)tableSize, dataSize = copySize;
+  for(int64_t page = 0; page < pageCount; page++) {
+    if(result->positions[page] + result->sizes[page] > dataSize) dataSize = result->positions[page] + result->sizes[page];
+  }
+  result->data = ea_checked_malloc(dataSize + 1);
+  memcpy(result->data, data, copySize);
+
+  DEBUG("opened paged fragment table with %"PRId64" pages%s", pageCount, indexOnly ? ", the pages are fetched on demand" : "");
+  if(out_size) *out_size = copySize;
+  *out_pages = result;
+  return ESDM_SUCCESS;
+}
+
+static bool needsFetch(const esdmI_fragmentPages_t* me, int64_t page, esdmI_hypercube_t* region) {
+  return !me->present[page] && !me->loaded[page] && (!region || esdmI_hypercube_doesIntersect(region, me->bounds[page]));
+}
+
+//Copies the pages that intersect the region into `data` if they are not there yet.
+//Adjacent pages are fetched with a single read from the metadata backend.
+static esdm_status fetchPages(esdmI_fragmentPages_t* me, esdm_dataset_t* dataset, esdmI_hypercube_t* region) {
+  for(int64_t page = 0; page < me->pageCount;) {
+    if(!needsFetch(me, page, region)) {
+      page++;
+      continue;
+    }
+    int64_t first = page++;
+    while(page < me->pageCount && needsFetch(me, page, region) && me->positions[page] == me->positions[page - 1] + me->sizes[page - 1]) page++;
+    int64_t start = me->positions[first], size = me->positions[page - 1] + me->sizes[page - 1] - start;
+    esdm_status ret = esdmI_dataset_retrieveSnapshot(dataset, me->tableOffset + start, size, me->data + start);
+    if(ret != ESDM_SUCCESS) return ret;
+    DEBUG("fetched %"PRId64" pages, %"PRId64" bytes", page - first, size);
+    for(int64_t i = first; i < page; i++) me->present[i] = true;
+  }
+  return ESDM_SUCCESS;
+}
+
+esdm_status esdmI_fragmentPages_load(esdmI_fragmentPages_t* me, esdm_dataset_t* dataset, esdmI_hypercube_t* region) {
+  eassert(me);
+  eassert(dataset);
+
+  esdm_status ret = fetchPages(me, dataset, region);
+  if(ret != ESDM_SUCCESS) return ret;
+  for(int64_t page = 0; page < me->pageCount; page++) {
+    if(me->loaded[page]) continue;
+    if(region && !esdmI_hypercube_doesIntersect(region, me->bounds[page])) continue;
+    ret = esdmI_fragmentTable_decode(dataset, me->data + me->positions[page], me->sizes[page], NULL);
+    if(ret != ESDM_SUCCESS) return ret;
+    me->loaded[page] = true;
+    me->loadedCount++;
+  }
+  return ESDM_SUCCESS;
+}
+
+bool esdmI_fragmentPages_isRegionLoaded(const esdmI_fragmentPages_t* me, esdmI_hypercube_t* region) {
+  eassert(me);
+  eassert(region);
+
+  for(int64_t i = 0; i < kMaxLoadedRegions; i++) {
+    esdmI_hypercube_t* loadedRegion = me->loadedRegions[i];
+    if(loadedRegion && esdmI_hypercube_overlap(loadedRegion, region) == esdmI_hypercube_size(region)) return true;
+  }
+  for(int64_t page = 0; page < me->pageCount; page++) {
+    if(!me->loaded[page] && esdmI_hypercube_doesIntersect(region, me->bounds[page])) return false;
+  }
+  return true;
+}
+
+void esdmI_fragmentPages_markRegionLoaded(esdmI_fragmentPages_t* me, esdmI_hypercube_t* region) {
+  eassert(me);
+  eassert(region);
+
+  //all fragments of a page that lies within the region intersect the region, so the page is complete
+  for(int64_t page = 0; page < me->pageCount; page++) {
+    if(me->loaded[page] || esdmI_hypercube_overlap(region, me->bounds[page]) != esdmI_hypercube_size(me->bounds[page])) continue;
+    me->loaded[page] = true;
+    me->loadedCount++;
+  }
+  esdmI_hypercube_destroy(me->loadedRegions[me->nextLoadedRegion]);
+  me->loadedRegions[me->nextLoadedRegion] = esdmI_hypercube_makeCopy(region);
+  me->nextLoadedRegion = (me->nextLoadedRegion + 1)%kMaxLoadedRegions;
+}
+
+bool esdmI_fragmentPages_isComplete(const esdmI_fragmentPages_t* me) {
+  eassert(me);
+  return me->loadedCount == me->pageCount;
+}
+
+int64_t esdmI_fragmentPages_loadedCount(const esdmI_fragmentPages_t* me) {
+  eassert(me);
+  return me->loadedCount;
+}
+
+int64_t esdmI_fragmentPages_pageCount(const esdmI_fragmentPages_t* me) {
+  eassert(me);
+  return me->pageCount;
+}
+
+int64_t esdmI_fragmentPages_fetchedCount(const esdmI_fragmentPages_t* me) {
+  eassert(me);
+  int64_t result = 0;
+  for(int64_t page = 0; page < me->pageCount; page++) result += me->present[page];
+  return result;
+}
+
+int64_t esdmI_fragmentPages_tableSize(const esdmI_fragmentPages_t* me) {
+  eassert(me);
+  return me->tableSize;
+}
+
+void esdmI_fragmentPages_getEnd(const esdmI_fragmentPages_t* me, int64_t* inout_end) {
+  eassert(me);
+  eassert(inout_end);
+  for(int64_t page = 0; page < me->pageCount; page++) {
+    for(int64_t d = 0; d < me->dims; d++) {
+      int64_t end = me->bounds[page]->ranges[d].end;
+      if(end > inout_end[d]) inout_end[d] = end;
+    }
+  }
+}
+
+void esdmI_fragmentPages_destroy(esdmI_fragmentPages_t* me) {
+  if(!me) return;
+  for(int64_t page = 0; page < me->pageCount; page++) esdmI_hypercube_destroy(me->bounds[page]);
+  for(int64_t i = 0; i < kMaxLoadedRegions; i++) esdmI_hypercube_destroy(me->loadedRegions[i]);
+  free(me->bounds);
+  free(me->positions);
+  free(me->sizes);
+  free(me->present);
+  free(me->loaded);
+  free(me->data);
+  free(me);
+}
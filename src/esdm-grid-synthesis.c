@@ -0,0 +1,290 @@
+/* This file is part of ESDM.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with ESDM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ * @brief Creates grids for datasets whose fragments form a rectilinear decomposition.
+ *
+ * Only applications that build their grids explicitly get the grid based fragment lookup, a plain `esdm_write()` user gets a scan of the fragment table on every read.
+ * When a read has to fall back to that scan, the shapes of the fragments are handed to a background thread,
+ * which checks whether the fragments tile their bounding box along one list of bounds per dimension.
+ * Regular decompositions are the special case of equidistant bounds, so they do not need separate treatment.
+ * If such bounds exist, the next read of the dataset creates a grid with these bounds, and puts the existing fragments into its cells.
+ * The background thread works on a copy of the fragment shapes, it never touches the dataset itself.
+ *
+ * A reopened dataset only fetches and decodes the fragment pages that its reads touch, see esdmI_dataset_loadFragments().
+ * As long as such a dataset has pages left, only the fragments that the read has used are analyzed, so the analysis never fetches a page.
+ * The resulting grid only covers the bounding box of these fragments.
+ * Before it is created, the pages that intersect the bounding box are decoded, and the grid is dropped if the box contains any fragment that was not analyzed.
+ */
+
+#include <glib.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <esdm-grid.h>
+#include <esdm-internal.h>
+
+#define DEBUG(fmt, ...) ESDM_DEBUG_COM_FMT("GRIDSYNTH", fmt, __VA_ARGS__)
+
+struct esdmI_gridSynthesis_t {
+  int64_t dims, fragmentCount;
+  int64_t* starts, *ends;  //the extends of the fragments, `dims` entries per fragment
+  bool done, cancelled;  //protected by gLock, whoever sees the other flag set is responsible to destroy the analysis
+  bool found;  //whether the fragments form a rectilinear decomposition, only valid once `done` is set
+  int64_t* intervals;  //`dims` entries, the number of cells along each axis
+  int64_t* bounds;  //the `intervals[dim] + 1` bounds of each axis, one axis after the other
+};
+
+static GMutex gLock;
+static GCond gIdle;
+static GThreadPool* gPool = NULL;
+static int64_t gPendingCount = 0;
+
+static void analysisDestroy(esdmI_gridSynthesis_t* me) {
+  free(me->starts);
+  free(me->ends);
+  free(me->intervals);
+  free(me->bounds);
+  free(me);
+}
+
+static int compareBounds(const void* a, const void* b) {
+  int64_t x = *(const int64_t*)a, y = *(const int64_t*)b;
+  return (x > y) - (x < y);
+}
+
+//Returns the interval of the axis that starts at the given bound, or -1 if there is no such interval.
+static int64_t findInterval(const int64_t* axisBounds, int64_t intervals, int64_t start) {
+  const int64_t* match = bsearch(&start, axisBounds, intervals, sizeof(*axisBounds), compareBounds);
+  return match ? match - axisBounds : -1;
+}
+
+//The fragments form a rectilinear decomposition if the distinct bounds along each axis cut their bounding box into exactly one cell per fragment.
+static bool findDecomposition(esdmI_gridSynthesis_t* me) {
+  const int64_t dims = me->dims, count = me->fragmentCount;
+  me->intervals = ea_checked_malloc(dims*sizeof(*me->intervals));
+  me->bounds = ea_checked_malloc(2*count*dims*sizeof(*me->bounds));
+
+  //collect the distinct bounds along each axis
+  int64_t cellCount = 1, boundCount = 0;
+  for(int64_t dim = 0; dim < dims; dim++) {
+    int64_t* axisBounds = me->bounds + boundCount;
+    for(int64_t i = 0; i < count; i++) {
+      axisBounds[2*i] = me->starts[i*dims + dim];
+      axisBounds[2*i + 1] = me->ends[i*dims + dim];
+    }
+    qsort(axisBounds, 2*count, sizeof(*axisBounds), compareBounds);
+    int64_t distinct = 1;
+    for(int64_t i = 1; i < 2*count; i++) {
+      if(axisBounds[i] != axisBounds[distinct - 1]) axisBounds[distinct++] = axisBounds[i];
+    }
+    me->intervals[dim] = distinct - 1;
+    boundCount += distinct;
+
+    //there cannot be a cell for each fragment if there are more cells than fragments
+    cellCount *= me->intervals[dim];
+    if(!cellCount || cellCount > count) return false;
+  }
+  if(cellCount != count) return false;
+
+  //each fragment must match a single cell, and no two fragments may match the same cell
+  //since there are as many cells as fragments, this implies that every cell is filled
+  bool* filled = ea_checked_calloc(cellCount, sizeof(*filled));
+  bool result = true;
+  for(int64_t i = 0; i < count && result; i++) {
+    int64_t linearIndex = 0;
+    const int64_t* axisBounds = me->bounds;
+    for(int64_t dim = 0; dim < dims; dim++) {
+      int64_t index = findInterval(axisBounds, me->intervals[dim], me->starts[i*dims + dim]);
+      if(index < 0 || axisBounds[index + 1] != me->ends[i*dims + dim]) {
+        result = false;
+        break;
+      }
+      linearIndex = linearIndex*me->intervals[dim] + index;
+      axisBounds += me->intervals[dim] + 1;
+    }
+    if(result && filled[linearIndex]) result = false;
+    if(result) filled[linearIndex] = true;
+  }
+  free(filled);
+  return result;
+}
+
+static void analysisThread(gpointer data, gpointer userData) {
+  esdmI_gridSynthesis_t* me = data;
+  bool found = findDecomposition(me);
+
+  g_mutex_lock(&gLock);
+  me->found = found;
+  me->done = true;
+  bool cancelled = me->cancelled;
+  if(!--gPendingCount) g_cond_broadcast(&gIdle);
+  g_mutex_unlock(&gLock);
+
+  if(cancelled) analysisDestroy(me);
+}
+
+void esdmI_gridSynthesis_schedule(esdm_dataset_t* dataset, int64_t fragmentCount, esdm_fragment_t** fragments) {
+  eassert(dataset);
+  eassert(fragments || !fragmentCount);
+
+  esdm_config_t* config = esdmI_getConfig();
+  int64_t minFragments = config ? config->gridSynthesisMinFragments : 0;
+  if(minFragments <= 0 || dataset->gridSynthesis) return;
+  if(!dataset->dataspace || !dataset->dataspace->dims) return;  //grids need at least one dimension
+
+  //the fragments in undecoded pages are unknown, fetching them all would defeat the lazy loading of the fragment metadata
+  esdm_fragment_t** allFragments = NULL;
+  if(!dataset->fragmentPages) fragments = allFragments = esdmI_fragments_list(&dataset->fragments, &fragmentCount);
+
+  //analyze each set of fragments only once
+  if(fragmentCount < minFragments || fragmentCount == dataset->gridSynthesisFragments) {
+    free(allFragments);
+    return;
+  }
+  dataset->gridSynthesisFragments = fragmentCount;
+
+  const int64_t dims = dataset->dataspace->dims;
+  esdmI_gridSynthesis_t* analysis = ea_checked_malloc(sizeof(*analysis));
+  *analysis = (esdmI_gridSynthesis_t){
+    .dims = dims,
+    .fragmentCount = fragmentCount,
+    .starts = ea_checked_malloc(fragmentCount*dims*sizeof(*analysis->starts)),
+    .ends = ea_checked_malloc(fragmentCount*dims*sizeof(*analysis->ends))
+  };
+  for(int64_t i = 0; i < fragmentCount; i++) {
+    esdm_dataspace_t* space = fragments[i]->dataspace;
+    eassert(space->dims == dims);
+    for(int64_t dim = 0; dim < dims; dim++) {
+      analysis->starts[i*dims + dim] = space->offset[dim];
+      analysis->ends[i*dims + dim] = space->offset[dim] + space->size[dim];
+    }
+  }
+  free(allFragments);
+
+  g_mutex_lock(&gLock);
+  if(!gPool) {
+    GError* error = NULL;
+    gPool = g_thread_pool_new(analysisThread, NULL, 1, FALSE, &error);
+    if(!gPool) {
+      ESDM_WARN_FMT("cannot start the grid synthesis thread: %s", error->message);
+      g_error_free(error);
+      g_mutex_unlock(&gLock);
+      analysisDestroy(analysis);
+      return;
+    }
+  }
+  gPendingCount++;
+  g_mutex_unlock(&gLock);
+
+  DEBUG("dataset \"%s\": analyzing the decomposition of %"PRId64" fragments", dataset->name, fragmentCount);
+  dataset->gridSynthesis = analysis;
+  g_thread_pool_push(gPool, analysis, NULL);
+}
+
+//Returns the bounding box of the grid that was found by the analysis.
+static esdmI_hypercube_t* gridExtends(esdmI_gridSynthesis_t* analysis) {
+  const int64_t dims = analysis->dims;
+  int64_t offset[dims], size[dims];
+  const int64_t* axisBounds = analysis->bounds;
+  for(int64_t dim = 0; dim < dims; dim++) {
+    offset[dim] = axisBounds[0];
+    size[dim] = axisBounds[analysis->intervals[dim]] - axisBounds[0];
+    axisBounds += analysis->intervals[dim] + 1;
+  }
+  return esdmI_hypercube_make(dims, offset, size);
+}
+
+//Creates the grid that was found by the analysis, and fills it with the given fragments.
+static void createGrid(esdm_dataset_t* dataset, esdmI_gridSynthesis_t* analysis, esdmI_hypercube_t* extends, int64_t fragmentCount, esdm_fragment_t** fragments) {
+  const int64_t dims = analysis->dims;
+  int64_t offset[dims], size[dims];
+  esdmI_hypercube_getOffsetAndSize(extends, offset, size);
+
+  esdm_grid_t* grid;
+  esdm_status ret = esdm_grid_create(dataset, dims, offset, size, &grid);
+  eassert(ret == ESDM_SUCCESS);
+  const int64_t* axisBounds = analysis->bounds;
+  for(int64_t dim = 0; dim < dims; dim++) {
+    ret = esdm_grid_subdivide(grid, dim, analysis->intervals[dim], (int64_t*)axisBounds);
+    eassert(ret == ESDM_SUCCESS);
+    axisBounds += analysis->intervals[dim] + 1;
+  }
+
+  for(int64_t i = 0; i < fragmentCount; i++) {
+    ret = esdmI_grid_addFragment(grid, fragments[i]);
+    eassert(ret == ESDM_SUCCESS && "the analyzed fragments must match the cells of the synthesized grid");
+  }
+  DEBUG("dataset \"%s\": synthesized a grid for %"PRId64" fragments", dataset->name, fragmentCount);
+
+  //persist the grid with the next commit if the dataset may be written
+  if(dataset->mode_flags & ESDM_MODE_FLAG_WRITE && dataset->status == ESDM_DATA_PERSISTENT) dataset->status = ESDM_DATA_DIRTY;
+}
+
+void esdmI_gridSynthesis_apply(esdm_dataset_t* dataset) {
+  eassert(dataset);
+  esdmI_gridSynthesis_t* analysis = dataset->gridSynthesis;
+  if(!analysis) return;
+
+  g_mutex_lock(&gLock);
+  bool done = analysis->done;
+  g_mutex_unlock(&gLock);
+  if(!done) return;
+
+  dataset->gridSynthesis = NULL;
+  if(analysis->found) {
+    //Fragments are only ever added to a loaded dataset, and the analyzed fragments lie within the box,
+    //so the same count means that the box contains exactly the fragments that were analyzed.
+    esdmI_hypercube_t* extends = gridExtends(analysis);
+    if(esdmI_dataset_loadFragments(dataset, extends) != ESDM_SUCCESS) {
+      ESDM_WARN_FMT("cannot decode the fragment metadata of dataset \"%s\"", dataset->name);
+    } else {
+      int64_t fragmentCount;
+      esdm_fragment_t** fragments = esdmI_fragments_makeSetCoveringRegion(&dataset->fragments, extends, &fragmentCount);
+      if(fragmentCount == analysis->fragmentCount) createGrid(dataset, analysis, extends, fragmentCount, fragments);
+      free(fragments);
+    }
+    esdmI_hypercube_destroy(extends);
+  }
+  analysisDestroy(analysis);
+}
+
+void esdmI_gridSynthesis_cancel(esdm_dataset_t* dataset) {
+  eassert(dataset);
+  esdmI_gridSynthesis_t* analysis = dataset->gridSynthesis;
+  dataset->gridSynthesis = NULL;
+  dataset->gridSynthesisFragments = 0;
+  if(!analysis) return;
+
+  g_mutex_lock(&gLock);
+  bool done = analysis->done;
+  analysis->cancelled = true;
+  g_mutex_unlock(&gLock);
+  if(done) analysisDestroy(analysis);
+}
+
+void esdmI_gridSynthesis_wait() {
+  g_mutex_lock(&gLock);
+  while(gPendingCount) g_cond_wait(&gIdle, &gLock);
+  g_mutex_unlock(&gLock);
+}
+
+void esdmI_gridSynthesis_finalize() {
+  esdmI_gridSynthesis_wait();
+  if(gPool) g_thread_pool_free(gPool, FALSE, TRUE);
+  gPool = NULL;
+}
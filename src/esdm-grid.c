@@ -15,6 +15,11 @@ typedef struct esdm_axis_t {
   int64_t* allBounds;	//array of intervals+1 entries, allBounds[0] == outerBounds[0] and allBounds[intervals] == outerBounds[1], as long as intervals == 1, this points to outerBounds[0]
 } esdm_axis_t;
 
+typedef struct esdmI_gridFragmentList_t {
+  int64_t count, slots;
+  esdm_fragment_t** fragments;
+} esdmI_gridFragmentList_t;
+
 struct esdm_grid_t {
   int64_t dimCount;
   esdm_dataset_t* dataset;
@@ -24,6 +29,10 @@ struct esdm_grid_t {
   int64_t emptyCells;	//will be set by esdm_grid_ensureGrid() when the grid is allocated
   esdm_gridEntry_t* grid;
 
+  //Top-level grids that are shared with other processes record the cells that this process fills, so that only these need to be shipped by an incremental encoding.
+  bool tracksWrites;
+  esdmI_gridFragmentList_t writtenFragments;
+
   esdm_axis_t axes[];	//dimCount elements
 };
 
@@ -254,6 +263,19 @@ static void esdmI_grid_registerCompletedCell(esdm_grid_t* grid) {
   }
 }
 
+static void esdmI_gridFragmentList_add(esdmI_gridFragmentList_t* list, esdm_fragment_t* fragment) {
+  if(list->count == list->slots) list->fragments = ea_checked_realloc(list->fragments, (list->slots = list->slots ? 2*list->slots : 16)*sizeof*list->fragments);
+  list->fragments[list->count++] = fragment;
+}
+
+//Like esdmI_grid_registerCompletedCell(), but for cells that have been filled by this process rather than by merging data from another process.
+static void esdmI_grid_registerWrittenCell(esdm_grid_t* grid, esdm_fragment_t* fragment) {
+  esdm_grid_t* root = grid;
+  while(root->parent) root = root->parent;
+  if(root->tracksWrites) esdmI_gridFragmentList_add(&root->writtenFragments, fragment);
+  esdmI_grid_registerCompletedCell(grid);
+}
+
 //Optimized binary search for the interval that contains the given location.
 //The result is either -1 if the location is out of bounds, or in the inclusive range [0, intervals-1].
 //The value `intervals` is never returned because `outerBounds[1]` only marks the end of the last interval but is not part of any interval itself.
@@ -372,7 +394,7 @@ esdm_status esdm_write_grid(esdm_grid_t* grid, esdm_dataspace_t* memspace, void*
   if(cell->fragment) return ESDM_SUCCESS; //we already have data for this grid cell -> nothing to be done
   cell->fragment = esdmI_dataset_lookupFragmentForShape(grid->dataset, memspace);
   if(cell->fragment) {
-    esdmI_grid_registerCompletedCell(grid);
+    esdmI_grid_registerWrittenCell(grid, cell->fragment);
     return ESDM_SUCCESS;  //we already have data for this grid cell -> nothing more to be done
   }
 
@@ -380,11 +402,26 @@ esdm_status esdm_write_grid(esdm_grid_t* grid, esdm_dataspace_t* memspace, void*
   bool isNewFragment;
   cell->fragment = esdmI_dataset_createFragment(grid->dataset, memspace, buffer, &isNewFragment);
   if(!cell->fragment) return ESDM_ERROR;
-  esdmI_grid_registerCompletedCell(grid);
+  esdmI_grid_registerWrittenCell(grid, cell->fragment);
   if(!isNewFragment) return ESDM_SUCCESS;
   return esdmI_scheduler_writeFragmentBlocking(esdmI_esdm(), cell->fragment, false);
 }
 
+esdm_status esdmI_grid_addFragment(esdm_grid_t* grid, esdm_fragment_t* fragment) {
+  eassert(grid);
+  eassert(fragment);
+
+  if(grid->dimCount != fragment->dataspace->dims) return ESDM_INVALID_ARGUMENT_ERROR;
+
+  esdm_gridEntry_t* cell;
+  esdm_status result = esdm_grid_findCellInHierarchy(&grid, fragment->dataspace, &cell);
+  if(result != ESDM_SUCCESS) return result;
+  if(cell->fragment) return ESDM_INVALID_STATE_ERROR;
+  cell->fragment = fragment;
+  esdmI_grid_registerWrittenCell(grid, fragment);
+  return ESDM_SUCCESS;
+}
+
 esdm_status esdm_read_grid(esdm_grid_t* grid, esdm_dataspace_t* memspace, void* buffer) {
   eassert(grid);
   eassert(memspace);
@@ -401,7 +438,7 @@ esdm_status esdm_read_grid(esdm_grid_t* grid, esdm_dataspace_t* memspace, void*
   //In case we don't have a fragment in this cell, check whether there's already one within the dataset.
   if(!cell->fragment) {
     cell->fragment = esdmI_dataset_lookupFragmentForShape(grid->dataset, memspace);
-    if(cell->fragment) esdmI_grid_registerCompletedCell(grid);
+    if(cell->fragment) esdmI_grid_registerWrittenCell(grid, cell->fragment);
   }
 
   //Do the actual reading.
@@ -414,13 +451,205 @@ esdm_status esdm_read_grid(esdm_grid_t* grid, esdm_dataspace_t* memspace, void*
     bool isNewFragment;
     cell->fragment = esdmI_dataset_createFragment(grid->dataset, memspace, buffer, &isNewFragment);
     if(!cell->fragment) return ESDM_ERROR;
-    esdmI_grid_registerCompletedCell(grid);
+    esdmI_grid_registerWrittenCell(grid, cell->fragment);
     if(!isNewFragment) return ESDM_SUCCESS; //should not happen, but we check it anyways
     (void)esdmI_scheduler_writeFragmentBlocking(esdmI_esdm(), cell->fragment, true);  //whether the write-back worked is not relevant for the success of the read
     return ESDM_SUCCESS;
   }
 }
 
+esdm_status esdm_write_grid_cells(esdm_grid_t* grid, int64_t count, esdm_dataspace_t** memspaces, void** buffers) {
+  eassert(grid);
+  eassert(count >= 0);
+  eassert(memspaces || !count);
+  eassert(buffers || !count);
+
+  //Find all the cells before writing anything, so that an invalid memspace does not leave a partial write behind.
+  esdm_grid_t** cellGrids = ea_checked_malloc(count*sizeof*cellGrids);
+  esdm_gridEntry_t** cells = ea_checked_malloc(count*sizeof*cells);
+  esdm_status result = ESDM_SUCCESS;
+  for(int64_t i = 0; i < count && result == ESDM_SUCCESS; i++) {
+    eassert(memspaces[i]);
+    eassert(buffers[i]);
+    if(grid->dimCount != memspaces[i]->dims) {
+      result = ESDM_INVALID_ARGUMENT_ERROR;
+      break;
+    }
+    cellGrids[i] = grid;
+    result = esdm_grid_findCellInHierarchy(&cellGrids[i], memspaces[i], &cells[i]);
+  }
+
+  //Create the fragments, and hand them to the scheduler all at once.
+  esdm_fragment_t** newFragments = ea_checked_malloc(count*sizeof*newFragments);
+  int64_t newCount = 0;
+  for(int64_t i = 0; i < count && result == ESDM_SUCCESS; i++) {
+    if(cells[i]->fragment) continue; //we already have data for this grid cell, possibly from an earlier entry of this batch
+    cells[i]->fragment = esdmI_dataset_lookupFragmentForShape(grid->dataset, memspaces[i]);
+    if(cells[i]->fragment) {
+      esdmI_grid_registerWrittenCell(cellGrids[i], cells[i]->fragment);
+      continue;
+    }
+
+    bool isNewFragment;
+    cells[i]->fragment = esdmI_dataset_createFragment(grid->dataset, memspaces[i], buffers[i], &isNewFragment);
+    if(!cells[i]->fragment) {
+      result = ESDM_ERROR;
+      break;
+    }
+    esdmI_grid_registerWrittenCell(cellGrids[i], cells[i]->fragment);
+    if(isNewFragment) newFragments[newCount++] = cells[i]->fragment;
+  }
+  esdm_status writeResult = esdmI_scheduler_writeFragmentsBlocking(esdmI_esdm(), newCount, newFragments, false);
+
+  free(newFragments);
+  free(cells);
+  free(cellGrids);
+  return result != ESDM_SUCCESS ? result : writeResult;
+}
+
+typedef struct esdmI_gridCellList_t {
+  int64_t count, slots;
+  struct esdmI_gridCellRef_t {
+    esdm_grid_t* grid;
+    int64_t linearIndex;
+  }* cells;
+} esdmI_gridCellList_t;
+
+//Append all cells of the grid hierarchy that intersect the region given by `start` and `end`, and which do not contain a subgrid.
+static void esdmI_grid_collectLeafCells(esdm_grid_t* grid, const int64_t* start, const int64_t* end, esdmI_gridCellList_t* list) {
+  int64_t dims = grid->dimCount;
+  int64_t first[dims], last[dims], index[dims];
+  for(int64_t dim = 0; dim < dims; dim++) {
+    esdm_axis_t* axis = &grid->axes[dim];
+    int64_t curStart = start[dim] > axis->outerBounds[0] ? start[dim] : axis->outerBounds[0];
+    int64_t curEnd = end[dim] < axis->outerBounds[1] ? end[dim] : axis->outerBounds[1];
+    if(curStart >= curEnd) return;
+    index[dim] = first[dim] = esdmI_axis_findInterval(axis, curStart);
+    last[dim] = esdmI_axis_findInterval(axis, curEnd - 1);
+  }
+
+  esdm_grid_ensureGrid(grid);
+  while(true) {
+    int64_t linearIndex = esdm_grid_linearIndex(grid, index);
+    eassert(linearIndex >= 0);
+    if(grid->grid[linearIndex].subgrid) {
+      esdmI_grid_collectLeafCells(grid->grid[linearIndex].subgrid, start, end, list);
+    } else {
+      if(list->count == list->slots) list->cells = ea_checked_realloc(list->cells, (list->slots = 2*list->slots + 8)*sizeof*list->cells);
+      list->cells[list->count++] = (struct esdmI_gridCellRef_t){ .grid = grid, .linearIndex = linearIndex };
+    }
+
+    //advance to the next cell, the last dimension is the fastest varying one
+    int64_t dim = dims - 1;
+    for(; dim >= 0; dim--) {
+      if(index[dim] < last[dim]) {
+        index[dim]++;
+        break;
+      }
+      index[dim] = first[dim];
+    }
+    if(dim < 0) break;
+  }
+}
+
+esdm_status esdm_read_grid_region(esdm_grid_t* grid, esdm_dataspace_t* memspace, void* buffer) {
+  eassert(grid);
+  eassert(memspace);
+  eassert(buffer);
+
+  if(grid->dimCount != memspace->dims) return ESDM_INVALID_ARGUMENT_ERROR;
+  int64_t dims = grid->dimCount, end[dims];
+  for(int64_t dim = 0; dim < dims; dim++) {
+    end[dim] = memspace->offset[dim] + memspace->size[dim];
+    if(memspace->offset[dim] < grid->axes[dim].outerBounds[0] || end[dim] > grid->axes[dim].outerBounds[1]) return ESDM_INVALID_ARGUMENT_ERROR;
+  }
+
+  esdmI_gridCellList_t list = {0};
+  esdmI_grid_collectLeafCells(grid, memspace->offset, end, &list);
+
+  //Sort the cells into those that have data, and those that must be read from other fragments of the dataset.
+  //The latter are read in their entirety, so that they can be written back to accelerate future reads on this grid.
+  esdm_fragment_t** fragments = ea_checked_malloc(list.count*sizeof*fragments);
+  void** missingBuffers = ea_checked_malloc((list.count + 1)*sizeof*missingBuffers);
+  esdm_dataspace_t** missingSpaces = ea_checked_malloc((list.count + 1)*sizeof*missingSpaces);
+  struct esdmI_gridCellRef_t* missingCells = ea_checked_malloc(list.count*sizeof*missingCells);
+  int64_t fragmentCount = 0, missingCount = 0;
+  esdm_type_t type = esdm_dataset_get_type(grid->dataset);
+  esdm_status result = ESDM_SUCCESS;
+  for(int64_t i = 0; i < list.count; i++) {
+    esdm_grid_t* cellGrid = list.cells[i].grid;
+    esdm_gridEntry_t* cell = &cellGrid->grid[list.cells[i].linearIndex];
+    if(!cell->fragment) {
+      int64_t index[dims], offset[dims], size[dims];
+      esdm_grid_indexCoordinates(cellGrid, list.cells[i].linearIndex, index);
+      result = esdm_grid_cellSize(cellGrid, index, offset, size);
+      eassert(result == ESDM_SUCCESS);
+      esdm_dataspace_t* cellSpace;
+      result = esdm_dataspace_create_full(dims, size, offset, type, &cellSpace);
+      if(result != ESDM_SUCCESS) break;
+
+      cell->fragment = esdmI_dataset_lookupFragmentForShape(grid->dataset, cellSpace);
+      if(cell->fragment) {
+        esdmI_grid_registerWrittenCell(cellGrid, cell->fragment);
+        esdm_dataspace_destroy(cellSpace);
+      } else {
+        missingCells[missingCount] = list.cells[i];
+        missingSpaces[missingCount + 1] = cellSpace;
+        missingBuffers[missingCount + 1] = ea_checked_malloc(esdm_dataspace_total_bytes(cellSpace));
+        missingCount++;
+        continue;
+      }
+    }
+    fragments[fragmentCount++] = cell->fragment;
+  }
+
+  //Do the actual reading.
+  esdm_instance_t* esdm = esdmI_esdm();
+  if(result != ESDM_SUCCESS) {
+    //nothing has been read yet
+  } else if(!missingCount) {
+    result = esdmI_scheduler_readFragmentsBlocking(esdm, grid->dataset, buffer, memspace, fragmentCount, fragments);
+  } else {
+    //the requested region and the missing cells are read together, so that each fragment is loaded only once
+    missingBuffers[0] = buffer;
+    missingSpaces[0] = memspace;
+    result = esdm_scheduler_read_multi_blocking(esdm, grid->dataset, missingCount + 1, missingBuffers, missingSpaces, false);
+
+    //write back the missing cells in parallel
+    if(result == ESDM_SUCCESS) {
+      esdm_fragment_t** newFragments = ea_checked_malloc(missingCount*sizeof*newFragments);
+      int64_t newCount = 0;
+      for(int64_t i = 0; i < missingCount; i++) {
+        esdm_grid_t* cellGrid = missingCells[i].grid;
+        esdm_gridEntry_t* cell = &cellGrid->grid[missingCells[i].linearIndex];
+        bool isNewFragment;
+        cell->fragment = esdmI_dataset_createFragment(grid->dataset, missingSpaces[i + 1], missingBuffers[i + 1], &isNewFragment);
+        if(!cell->fragment) continue;
+        esdmI_grid_registerWrittenCell(cellGrid, cell->fragment);
+        if(isNewFragment) {
+          //the fragment keeps the data until it is written, so the buffer remains valid even if the write-back fails
+          cell->fragment->ownsBuf = true;
+          missingBuffers[i + 1] = NULL;
+          newFragments[newCount++] = cell->fragment;
+        }
+      }
+      (void)esdmI_scheduler_writeFragmentsBlocking(esdm, newCount, newFragments, true);  //whether the write-back worked is not relevant for the success of the read
+      free(newFragments);
+    }
+  }
+
+  for(int64_t i = 1; i <= missingCount; i++) {
+    free(missingBuffers[i]);
+    esdm_dataspace_destroy(missingSpaces[i]);
+  }
+  free(missingCells);
+  free(missingSpaces);
+  free(missingBuffers);
+  free(fragments);
+  free(list.cells);
+  return result;
+}
+
 esdm_status esdm_dataset_grids(esdm_dataset_t* dataset, int64_t* out_count, esdm_grid_t*** out_grids) {
   eassert(dataset);
   eassert(out_count);
@@ -528,6 +757,245 @@ void esdmI_dataset_registerGridCompletion(esdm_dataset_t* dataset, esdm_grid_t*
   dataset->grids[index] = dataset->grids[dataset->gridCount];
   dataset->grids[dataset->gridCount] = temp;
   dataset->gridCount++, dataset->incompleteGridCount--;
+  esdmI_gridIndex_add(dataset, grid);
+}
+
+// esdmI_gridIndex_t ///////////////////////////////////////////////////////////////////////////////
+
+//The index over the complete grids of a dataset is an interval tree along a single key dimension:
+//A treap that is ordered by the start bounds of the grids, where each node caches the largest end bound within its subtree.
+//This allows finding all grids that overlap a range of the key dimension in O(log(n) + k), the other dimensions are checked for the k candidates only.
+//
+//The key dimension is the one in which the grids have the most distinct start bounds, which is the time dimension for the typical grid per timestep.
+//Since this depends on the grids that exist, the tree is rebuilt whenever the grid count has doubled, which keeps the amortized insertion cost logarithmic.
+typedef struct esdmI_gridIndexNode_t esdmI_gridIndexNode_t;
+struct esdmI_gridIndexNode_t {
+  esdm_grid_t* grid;
+  int64_t sequence; //the position of the grid in the order of completion, among equally good grids the later one wins
+  int64_t start, end, maxEnd; //the outer bounds of the grid along the key dimension, and the largest end bound within this subtree
+  uint64_t priority;
+  esdmI_gridIndexNode_t* children[2];
+};
+
+struct esdmI_gridIndex_t {
+  int64_t keyDim;
+  int64_t count, rebuildCount;  //the tree is rebuilt when `count` reaches `rebuildCount`
+  esdmI_gridIndexNode_t* root;
+};
+
+//A fixed mixing function instead of a random number generator, so that the tree shape is reproducible.
+static uint64_t esdmI_gridIndex_priority(int64_t sequence) {
+  uint64_t x = (uint64_t)sequence + 0x9e3779b97f4a7c15ull;
+  x = (x ^ (x >> 30))*0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27))*0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+
+static void esdmI_gridIndexNode_update(esdmI_gridIndexNode_t* node) {
+  node->maxEnd = node->end;
+  for(int i = 0; i < 2; i++) {
+    if(node->children[i]) node->maxEnd = max(node->maxEnd, node->children[i]->maxEnd);
+  }
+}
+
+static esdmI_gridIndexNode_t* esdmI_gridIndexNode_insert(esdmI_gridIndexNode_t* root, esdmI_gridIndexNode_t* node) {
+  if(!root) return node;
+
+  int side = node->start >= root->start;
+  root->children[side] = esdmI_gridIndexNode_insert(root->children[side], node);
+  esdmI_gridIndexNode_t* child = root->children[side];
+  if(child->priority > root->priority) {
+    //rotate the child up to restore the heap order of the priorities
+    root->children[side] = child->children[!side];
+    child->children[!side] = root;
+    esdmI_gridIndexNode_update(root);
+    esdmI_gridIndexNode_update(child);
+    return child;
+  }
+  esdmI_gridIndexNode_update(root);
+  return root;
+}
+
+static void esdmI_gridIndexNode_destroy(esdmI_gridIndexNode_t* node) {
+  if(!node) return;
+  esdmI_gridIndexNode_destroy(node->children[0]);
+  esdmI_gridIndexNode_destroy(node->children[1]);
+  free(node);
+}
+
+static int esdmI_gridIndex_compareBounds(const void* a, const void* b) {
+  int64_t x = *(const int64_t*)a, y = *(const int64_t*)b;
+  return (x > y) - (x < y);
+}
+
+//Find the dimension in which the complete grids of the dataset have the most distinct start bounds.
+static int64_t esdmI_gridIndex_selectKeyDim(esdm_dataset_t* dataset) {
+  int64_t count = dataset->gridCount, dims = dataset->grids[0]->dimCount;
+  int64_t* starts = ea_checked_malloc(count*sizeof*starts);
+  int64_t bestDim = 0, bestDistinct = 0;
+  for(int64_t dim = 0; dim < dims; dim++) {
+    for(int64_t i = 0; i < count; i++) starts[i] = dataset->grids[i]->axes[dim].outerBounds[0];
+    qsort(starts, count, sizeof*starts, esdmI_gridIndex_compareBounds);
+    int64_t distinct = 1;
+    for(int64_t i = 1; i < count; i++) distinct += starts[i] != starts[i - 1];
+    if(distinct > bestDistinct) bestDim = dim, bestDistinct = distinct;
+  }
+  free(starts);
+  return bestDim;
+}
+
+static void esdmI_gridIndex_insert(esdmI_gridIndex_t* index, esdm_grid_t* grid) {
+  esdmI_gridIndexNode_t* node = ea_checked_malloc(sizeof*node);
+  *node = (esdmI_gridIndexNode_t){
+    .grid = grid,
+    .sequence = index->count,
+    .start = grid->axes[index->keyDim].outerBounds[0],
+    .end = grid->axes[index->keyDim].outerBounds[1],
+    .maxEnd = grid->axes[index->keyDim].outerBounds[1],
+    .priority = esdmI_gridIndex_priority(index->count)
+  };
+  index->count++;
+  index->root = esdmI_gridIndexNode_insert(index->root, node);
+}
+
+void esdmI_gridIndex_add(esdm_dataset_t* dataset, esdm_grid_t* grid) {
+  esdmI_gridIndex_t* index = dataset->gridIndex;
+  if(!index) {
+    index = dataset->gridIndex = ea_checked_malloc(sizeof*index);
+    *index = (esdmI_gridIndex_t){ .keyDim = 0, .count = 0, .rebuildCount = 1, .root = NULL };
+  }
+  if(index->count + 1 < index->rebuildCount) {
+    esdmI_gridIndex_insert(index, grid);
+    return;
+  }
+
+  //rebuild the tree from all complete grids, this includes the new grid
+  eassert(dataset->gridCount == index->count + 1 && dataset->grids[index->count] == grid);
+  esdmI_gridIndexNode_destroy(index->root);
+  index->root = NULL;
+  index->count = 0;
+  index->keyDim = esdmI_gridIndex_selectKeyDim(dataset);
+  index->rebuildCount = 2*dataset->gridCount;
+  for(int64_t i = 0; i < dataset->gridCount; i++) esdmI_gridIndex_insert(index, dataset->grids[i]);
+}
+
+void esdmI_gridIndex_destroy(esdmI_gridIndex_t* index) {
+  if(!index) return;
+  esdmI_gridIndexNode_destroy(index->root);
+  free(index);
+}
+
+typedef struct esdmI_gridQuery_t {
+  esdmI_hypercube_t* region;
+  int64_t dims, keyDim, *start, *end;
+  //the best grid that contains the whole region
+  esdm_grid_t* bestGrid;
+  int64_t bestOverhead, bestSequence;
+  //all grids that overlap with the region, together with their overlap
+  int64_t overlapCount, overlapSlots;
+  struct esdmI_gridOverlap_t {
+    esdm_grid_t* grid;
+    int64_t overlap, sequence;
+  }* overlaps;
+} esdmI_gridQuery_t;
+
+//Visits all grids in the subtree that overlap the region.
+//The grids that contain the region compete for `bestGrid`, the others are collected in `overlaps` in case no grid contains the region.
+static void esdmI_gridQuery_visit(esdmI_gridQuery_t* query, esdmI_gridIndexNode_t* node) {
+  const int64_t keyDim = query->keyDim;
+  while(node && node->maxEnd > query->start[keyDim]) {
+    esdmI_gridQuery_visit(query, node->children[0]);
+    if(node->start >= query->end[keyDim]) return; //this node and the right subtree start behind the region
+    if(node->end > query->start[keyDim]) {
+      esdm_grid_t* grid = node->grid;
+      bool overlaps = true, contains = true;
+      for(int64_t dim = 0; dim < query->dims; dim++) {
+        const int64_t* bounds = grid->axes[dim].outerBounds;
+        overlaps = overlaps && bounds[0] < query->end[dim] && bounds[1] > query->start[dim];
+        contains = contains && bounds[0] <= query->start[dim] && bounds[1] >= query->end[dim];
+      }
+      if(contains) {
+        int64_t overhead = esdmI_grid_coverRegionOverhead(grid, query->region);
+        if(!query->bestGrid || overhead < query->bestOverhead || (overhead == query->bestOverhead && node->sequence > query->bestSequence)) {
+          query->bestGrid = grid;
+          query->bestOverhead = overhead;
+          query->bestSequence = node->sequence;
+        }
+      } else if(overlaps && !query->bestGrid) {
+        if(query->overlapCount == query->overlapSlots) query->overlaps = ea_checked_realloc(query->overlaps, (query->overlapSlots = 2*query->overlapSlots + 8)*sizeof*query->overlaps);
+        query->overlaps[query->overlapCount++] = (struct esdmI_gridOverlap_t){
+          .grid = grid,
+          .overlap = esdmI_grid_coverRegionSize(grid, query->region),
+          .sequence = node->sequence
+        };
+      }
+    }
+    node = node->children[1];
+  }
+}
+
+//Sort the overlapping grids by decreasing overlap, and by decreasing recency among grids with the same overlap.
+static int esdmI_gridQuery_compareOverlaps(const void* a, const void* b) {
+  const struct esdmI_gridOverlap_t* x = a, *y = b;
+  if(x->overlap != y->overlap) return x->overlap < y->overlap ? 1 : -1;
+  return (x->sequence < y->sequence) - (x->sequence > y->sequence);
+}
+
+esdm_grid_t** esdmI_dataset_gridsCoveringRegion(esdm_dataset_t* dataset, esdmI_hypercube_t* region, int64_t* out_gridCount) {
+  eassert(dataset);
+  eassert(region);
+  eassert(out_gridCount);
+
+  *out_gridCount = 0;
+  esdmI_gridIndex_t* index = dataset->gridIndex;
+  if(!index || !index->root) return NULL;
+
+  int64_t dims = esdmI_hypercube_dimensions(region), start[dims], size[dims], end[dims];
+  esdmI_hypercube_getOffsetAndSize(region, start, size);
+  for(int64_t dim = 0; dim < dims; dim++) end[dim] = start[dim] + size[dim];
+  esdmI_gridQuery_t query = {
+    .region = region,
+    .dims = dims,
+    .keyDim = index->keyDim,
+    .start = start,
+    .end = end
+  };
+  esdmI_gridQuery_visit(&query, index->root);
+
+  esdm_grid_t** result = NULL;
+  if(query.bestGrid) {
+    result = ea_checked_malloc(sizeof*result);
+    result[(*out_gridCount)++] = query.bestGrid;
+  } else if(query.overlapCount > 1) {
+    //Try to cover the region with several grids, taking the grids with the largest overlap first.
+    //A grid is only used if it covers some part of the region that is not covered by the grids before it.
+    qsort(query.overlaps, query.overlapCount, sizeof*query.overlaps, esdmI_gridQuery_compareOverlaps);
+    esdmI_hypercubeSet_t* uncovered = esdmI_hypercubeSet_make();
+    esdmI_hypercubeSet_add(uncovered, region);
+    result = ea_checked_malloc(query.overlapCount*sizeof*result);
+    for(int64_t i = 0; i < query.overlapCount && !esdmI_hypercubeSet_isEmpty(uncovered); i++) {
+      esdm_grid_t* grid = query.overlaps[i].grid;
+      int64_t gridStart[dims], gridSize[dims];
+      for(int64_t dim = 0; dim < dims; dim++) {
+        gridStart[dim] = grid->axes[dim].outerBounds[0];
+        gridSize[dim] = grid->axes[dim].outerBounds[1] - gridStart[dim];
+      }
+      esdmI_hypercube_t* extends = esdmI_hypercube_make(dims, gridStart, gridSize);
+      if(esdmI_hypercubeList_doesIntersect(esdmI_hypercubeSet_list(uncovered), extends)) {
+        result[(*out_gridCount)++] = grid;
+        esdmI_hypercubeSet_subtract(uncovered, extends);
+      }
+      esdmI_hypercube_destroy(extends);
+    }
+    if(!esdmI_hypercubeSet_isEmpty(uncovered)) {
+      free(result);
+      result = NULL;
+      *out_gridCount = 0;
+    }
+    esdmI_hypercubeSet_destroy(uncovered);
+  }
+  free(query.overlaps);
+  return result;
 }
 
 int64_t esdmI_grid_coverRegionSize(const esdm_grid_t* grid, const esdmI_hypercube_t* region) {
@@ -709,90 +1177,101 @@ void esdmI_grid_serialize(smd_string_stream_t* stream, esdm_grid_t* grid) {
   smd_string_stream_printf(stream, "]}");
 }
 
-esdm_status esdmI_grid_createFromJson(json_t* json, esdm_dataset_t* dataset, esdm_grid_t* parent, esdm_grid_t** out_grid) {
-  eassert(json);
+esdm_status esdmI_grid_createFromReader(esdmI_jsonReader_t* reader, esdm_dataset_t* dataset, esdm_grid_t* parent, esdm_grid_t** out_grid) {
+  eassert(reader);
   eassert(dataset);
+  eassert(out_grid);
 
   //state that's relevant for error cleanup
   esdm_status result = ESDM_ERROR;
   esdm_grid_t* grid = NULL;
-  int64_t constructedAxes = 0;
   int64_t constructedCells = 0;
+  char* id = NULL;
+  int64_t** bounds = NULL;  //the axes precede the cells in the serialized grid, but we can only allocate the grid object once we know the dimension count
+  int64_t* boundCounts = NULL;
+  int64_t axisCount = 0, axisSlots = 0;
+
+  if(esdmI_jsonReader_next(reader) != ESDMI_JSON_OBJECT_START) goto fail;
+  while(esdmI_jsonReader_nextKey(reader)) {
+    if(esdmI_jsonReader_keyIs(reader, "axes")) {
+      if(bounds || grid) goto fail;
+      if(esdmI_jsonReader_next(reader) != ESDMI_JSON_ARRAY_START) goto fail;
+      axisSlots = 4;
+      bounds = ea_checked_malloc(axisSlots*sizeof*bounds);
+      boundCounts = ea_checked_malloc(axisSlots*sizeof*boundCounts);
+      while(esdmI_jsonReader_nextElement(reader)) {
+        if(axisCount == axisSlots) {
+          bounds = ea_checked_realloc(bounds, (axisSlots *= 2)*sizeof*bounds);
+          boundCounts = ea_checked_realloc(boundCounts, axisSlots*sizeof*boundCounts);
+        }
+        if(!esdmI_jsonReader_readIntArray(reader, &bounds[axisCount], &boundCounts[axisCount])) goto fail;
+        if(boundCounts[axisCount++] < 2) goto fail;
+      }
+    } else if(esdmI_jsonReader_keyIs(reader, "id")) {
+      free(id);
+      id = esdmI_jsonReader_readString(reader);
+      if(!id) goto fail;
+    } else if(esdmI_jsonReader_keyIs(reader, "grid")) {
+      if(grid || !bounds) goto fail;
+
+      grid = ea_checked_malloc(sizeof*grid + axisCount*sizeof*grid->axes);
+      *grid = (esdm_grid_t){
+        .dimCount = axisCount,
+        .parent = parent,
+        .dataset = dataset,
+        .emptyCells = 0,
+        .id = NULL,
+        .grid = NULL
+      };
+      for(int64_t dim = 0; dim < axisCount; dim++) {
+        esdm_axis_t* axis = &grid->axes[dim];
+        axis->intervals = boundCounts[dim] - 1;
+        if(axis->intervals == 1) {
+          axis->allBounds = axis->outerBounds;
+          memcpy(axis->outerBounds, bounds[dim], sizeof(axis->outerBounds));
+        } else {
+          axis->allBounds = bounds[dim];
+          bounds[dim] = NULL;  //the axis has taken possession of the array
+        }
+        axis->outerBounds[0] = axis->allBounds[0];
+        axis->outerBounds[1] = axis->allBounds[axis->intervals];
+      }
 
-  //other state that must be forward declared due to the gotos
-  int64_t dimCount, cellCount;
-  const char* id;
-  json_t* axesArray, *cellArray, *idString;
-
-  if(!json_is_object(json)) goto fail;
-
-  axesArray = jansson_object_get(json, "axes");
-  if(!axesArray) goto fail;
-  if(!json_is_array(axesArray)) goto fail;
-  dimCount = json_array_size(axesArray);
-
-  cellArray = jansson_object_get(json, "grid");
-  if(!cellArray) goto fail;
-  if(!json_is_array(cellArray)) goto fail;
-  cellCount = json_array_size(cellArray);
-
-  idString = jansson_object_get(json, "id");
-  if(!idString) goto fail;
-  if(!json_is_string(idString)) goto fail;
-  id = json_string_value(idString);
-
-  grid = ea_checked_malloc(sizeof*grid + dimCount*sizeof*grid->axes);
-  *grid = (esdm_grid_t){
-    .dimCount = dimCount,
-    .parent = parent,
-    .dataset = dataset,
-    .emptyCells = 0,
-    .id = ea_checked_strdup(id),
-    .grid = ea_checked_calloc(cellCount, sizeof*grid->grid)
-  };
-  if(!grid->id) goto fail;
-
-  for(; constructedAxes < dimCount; constructedAxes++) {
-    esdm_axis_t* axis = &grid->axes[constructedAxes];
-    json_t* boundsArray = json_array_get(axesArray, constructedAxes);
-    if(!boundsArray) goto fail;
-    if(!json_is_array(boundsArray)) goto fail;
-    int64_t boundCount = json_array_size(boundsArray);
-    axis->intervals = boundCount - 1;
-    if(boundCount < 2) goto fail;
-    axis->allBounds = axis->intervals == 1 ? axis->outerBounds : ea_checked_malloc(boundCount*sizeof*axis->allBounds);
-    for(int64_t i = 0; i < boundCount; i++) {
-      json_t* bound = json_array_get(boundsArray, i);
-      if(!bound) goto fail;
-      if(!json_is_integer(bound)) goto fail;
-      axis->allBounds[i] = json_integer_value(bound);
-    }
-    axis->outerBounds[0] = axis->allBounds[0];
-    axis->outerBounds[1] = axis->allBounds[axis->intervals];
-  }
-  if(cellCount != esdmI_grid_cellCount(grid)) goto fail;
-
-  for(; constructedCells < cellCount; constructedCells++) {
-    esdm_gridEntry_t* cell = &grid->grid[constructedCells];
-    json_t* cellObject = json_array_get(cellArray, constructedCells);
-    if(!cellObject) goto fail;
-    if(!json_is_object(cellObject)) goto fail;
-
-    json_t* gridElement = jansson_object_get(cellObject, "grid");
-    json_t* fragmentElement = jansson_object_get(cellObject, "fragment");
-    if(gridElement && fragmentElement) {
-      goto fail;
-    } else if(gridElement) {
-      esdm_status ret = esdmI_grid_createFromJson(gridElement, dataset, grid, &cell->subgrid);
-      if(ret != ESDM_SUCCESS) goto fail;
-    } else if(fragmentElement) {
-      if(!json_is_object(fragmentElement)) goto fail;
-      esdm_status ret = esdmI_create_fragment_from_metadata(dataset, fragmentElement, &cell->fragment);
-      if(ret != ESDM_SUCCESS) goto fail;
+      int64_t cellCount = esdmI_grid_cellCount(grid);
+      grid->grid = ea_checked_calloc(cellCount, sizeof*grid->grid);
+      if(esdmI_jsonReader_next(reader) != ESDMI_JSON_ARRAY_START) goto fail;
+      while(esdmI_jsonReader_nextElement(reader)) {
+        if(constructedCells == cellCount) goto fail;
+        esdm_gridEntry_t* cell = &grid->grid[constructedCells++];
+        if(esdmI_jsonReader_next(reader) != ESDMI_JSON_OBJECT_START) goto fail;
+        while(esdmI_jsonReader_nextKey(reader)) {
+          if(esdmI_jsonReader_keyIs(reader, "grid") || esdmI_jsonReader_keyIs(reader, "fragment")) {
+            if(cell->subgrid || cell->fragment) goto fail;  //a cell contains either a subgrid or a fragment
+          }
+          if(esdmI_jsonReader_keyIs(reader, "grid")) {
+            esdm_status ret = esdmI_grid_createFromReader(reader, dataset, grid, &cell->subgrid);
+            if(ret != ESDM_SUCCESS) goto fail;
+          } else if(esdmI_jsonReader_keyIs(reader, "fragment")) {
+            esdm_status ret = esdmI_create_fragment_from_reader(dataset, reader, &cell->fragment);
+            if(ret != ESDM_SUCCESS) goto fail;
+            //the fragment may be stored in a page of the fragment table that has not been decoded yet, register it so that the page's copy is dropped when it is decoded
+            ret = esdmI_dataset_addLoadedFragment(dataset, cell->fragment);
+            if(ret != ESDM_SUCCESS) goto fail;
+          } else {
+            if(!esdmI_jsonReader_skipValue(reader, NULL, NULL)) goto fail;
+          }
+        }
+        if(!reader->ok) goto fail;
+        if(!cell->subgrid && !cell->fragment) grid->emptyCells++;
+      }
+      if(!reader->ok || constructedCells != cellCount) goto fail;
     } else {
-      grid->emptyCells++;
+      if(!esdmI_jsonReader_skipValue(reader, NULL, NULL)) goto fail;
     }
   }
+  if(!reader->ok || !grid || !id) goto fail;
+  grid->id = id;
+  id = NULL;
 
   //construction of the grid object was successful, register the grid with the dataset
   if(!parent) {
@@ -804,34 +1283,33 @@ esdm_status esdmI_grid_createFromJson(json_t* json, esdm_dataset_t* dataset, esd
   goto done;
 
 fail:
-  while(constructedCells--) {
-    esdm_gridEntry_t* cell = &grid->grid[constructedCells];
-    if(cell->subgrid) esdmI_grid_destroy(cell->subgrid);
-  }
-
-  while(constructedAxes--) {
-    esdm_axis_t* axis = &grid->axes[constructedAxes];
-    if(axis->intervals != 1) free(axis->allBounds);
-  }
-
   if(grid) {
-    free(grid->id);
+    while(constructedCells--) {
+      esdm_gridEntry_t* cell = &grid->grid[constructedCells];
+      if(cell->subgrid) esdmI_grid_destroy(cell->subgrid);
+    }
+    for(int64_t dim = 0; dim < grid->dimCount; dim++) {
+      esdm_axis_t* axis = &grid->axes[dim];
+      if(axis->intervals != 1) free(axis->allBounds);
+    }
     free(grid->grid);
     free(grid);
   }
   grid = NULL;
 
 done:
+  for(int64_t dim = 0; dim < axisCount; dim++) free(bounds[dim]);
+  free(bounds);
+  free(boundCounts);
+  free(id);
   *out_grid = grid;
   return result;
 }
 
 esdm_status esdmI_grid_createFromString(const char* serializedGrid, esdm_dataset_t* dataset, esdm_grid_t** out_grid) {
-  json_t* json = load_json(serializedGrid);
-  if(!json) return ESDM_ERROR;
-  esdm_status result = esdmI_grid_createFromJson(json, dataset, NULL, out_grid);
-  json_decref(json);
-  return result;
+  esdmI_jsonReader_t reader;
+  esdmI_jsonReader_init(&reader, serializedGrid, strlen(serializedGrid));
+  return esdmI_grid_createFromReader(&reader, dataset, NULL, out_grid);
 }
 
 esdm_status esdmI_grid_mergeWithJson(esdm_grid_t* grid, json_t* json) {
@@ -890,6 +1368,374 @@ esdm_status esdmI_grid_mergeWithString(esdm_grid_t* grid, const char* serialized
   return result;
 }
 
+// Binary grid encoding ////////////////////////////////////////////////////////////////////////////
+
+//The JSON serialization is used for the persistent metadata, but exchanging grids between processes in JSON is prohibitively slow for grids with millions of cells.
+//The binary encoding stores the structure of a grid as arrays of axis bounds, and the fragments of its cells as a binary fragment table.
+//Each fragment identifies its cell by its shape, so empty cells do not take any space in the encoding.
+//
+//Layout (all integers are 8 bytes little endian):
+//
+//    magic          4 bytes "ESGR"
+//    version        1 byte
+//    length         the size of the entire encoding including this header
+//    idLength       followed by idLength characters, the ID of the grid
+//    structureSize  followed by the structure of the grid, zero for incremental encodings which do not contain the structure
+//    table          the fragment table that fills the rest of the encoding, see esdm-fragment-table.c
+//
+//The structure of a grid looks like this, it is repeated recursively for its subgrids:
+//
+//    idLength       followed by idLength characters, the ID of the (sub)grid
+//    axes           for each dimension: the interval count, followed by intervals+1 bounds
+//    subgridCount   followed by subgridCount pairs of a linear cell index and the structure of the subgrid in that cell, in ascending cell order
+static const char kGridMagic[4] = {'E', 'S', 'G', 'R'};
+static const uint8_t kGridVersion = 1;
+static const int64_t kGridHeaderSize = sizeof(kGridMagic) + 1 + 8;
+
+typedef struct esdmI_gridEncoder_t {
+  char* data;
+  int64_t size, allocatedSize;
+} esdmI_gridEncoder_t;
+
+static void esdmI_gridEncoder_put(esdmI_gridEncoder_t* me, const void* bytes, int64_t count) {
+  if(me->size + count > me->allocatedSize) {
+    while(me->size + count > me->allocatedSize) me->allocatedSize *= 2;
+    me->data = ea_checked_realloc(me->data, me->allocatedSize);
+  }
+  memcpy(me->data + me->size, bytes, count);
+  me->size += count;
+}
+
+static void esdmI_gridEncoder_setInt(esdmI_gridEncoder_t* me, int64_t position, int64_t value) {
+  eassert(position + 8 <= me->size);
+  for(int64_t i = 0; i < 8; i++) me->data[position + i] = (uint64_t)value >> 8*i;
+}
+
+static void esdmI_gridEncoder_putInt(esdmI_gridEncoder_t* me, int64_t value) {
+  esdmI_gridEncoder_put(me, (uint8_t[8]){0}, 8);
+  esdmI_gridEncoder_setInt(me, me->size - 8, value);
+}
+
+static void esdmI_gridEncoder_putString(esdmI_gridEncoder_t* me, const char* string) {
+  int64_t length = strlen(string);
+  esdmI_gridEncoder_putInt(me, length);
+  esdmI_gridEncoder_put(me, string, length);
+}
+
+//All reading functions turn `ok` false on a buffer overrun, and return zeros/NULL from then on, so that errors only need to be checked once in a while.
+typedef struct esdmI_gridDecoder_t {
+  const char* pos, *end;
+  bool ok;
+} esdmI_gridDecoder_t;
+
+static const char* esdmI_gridDecoder_get(esdmI_gridDecoder_t* me, int64_t count) {
+  if(!me->ok || count < 0 || count > me->end - me->pos) {
+    me->ok = false;
+    return NULL;
+  }
+  const char* result = me->pos;
+  me->pos += count;
+  return result;
+}
+
+static int64_t esdmI_gridDecoder_getInt(esdmI_gridDecoder_t* me) {
+  const char* bytes = esdmI_gridDecoder_get(me, 8);
+  if(!bytes) return 0;
+  uint64_t result = 0;
+  for(int64_t i = 0; i < 8; i++) result |= (uint64_t)(uint8_t)bytes[i] << 8*i;
+  return result;
+}
+
+//returns a newly allocated string, or NULL on error
+static char* esdmI_gridDecoder_getString(esdmI_gridDecoder_t* me) {
+  int64_t length = esdmI_gridDecoder_getInt(me);
+  const char* characters = esdmI_gridDecoder_get(me, length);
+  if(!characters) return NULL;
+  char* result = ea_checked_malloc(length + 1);
+  memcpy(result, characters, length);
+  result[length] = 0;
+  return result;
+}
+
+//The parts of an encoding, all pointers point into the encoding itself.
+typedef struct esdmI_gridEncoding_t {
+  const char* id;
+  int64_t idLength;
+  const char* structure;
+  int64_t structureSize;
+  const char* table;
+  int64_t tableSize;
+} esdmI_gridEncoding_t;
+
+static esdm_status esdmI_gridEncoding_open(const char* data, int64_t size, esdmI_gridEncoding_t* out_encoding) {
+  if(size < kGridHeaderSize || memcmp(data, kGridMagic, sizeof(kGridMagic))) return ESDM_INVALID_DATA_ERROR;
+  if((uint8_t)data[sizeof(kGridMagic)] != kGridVersion) {
+    ESDM_WARN_FMT("unsupported grid encoding version %d", (int)(uint8_t)data[sizeof(kGridMagic)]);
+    return ESDM_INVALID_DATA_ERROR;
+  }
+  esdmI_gridDecoder_t decoder = { .pos = data + sizeof(kGridMagic) + 1, .end = data + size, .ok = true };
+  int64_t length = esdmI_gridDecoder_getInt(&decoder);
+  if(length < kGridHeaderSize || length > size) return ESDM_INVALID_DATA_ERROR;
+  decoder.end = data + length;
+
+  out_encoding->idLength = esdmI_gridDecoder_getInt(&decoder);
+  out_encoding->id = esdmI_gridDecoder_get(&decoder, out_encoding->idLength);
+  out_encoding->structureSize = esdmI_gridDecoder_getInt(&decoder);
+  out_encoding->structure = esdmI_gridDecoder_get(&decoder, out_encoding->structureSize);
+  if(!decoder.ok) return ESDM_INVALID_DATA_ERROR;
+  out_encoding->table = decoder.pos;
+  out_encoding->tableSize = decoder.end - decoder.pos;
+  return ESDM_SUCCESS;
+}
+
+static bool esdmI_gridEncoding_matchesId(const esdmI_gridEncoding_t* encoding, const char* id) {
+  return id && (int64_t)strlen(id) == encoding->idLength && !memcmp(id, encoding->id, encoding->idLength);
+}
+
+//Puts the grid into fixed structure state, and encodes its structure.
+static void esdmI_grid_encodeStructure(esdmI_gridEncoder_t* encoder, esdm_grid_t* grid) {
+  esdm_grid_ensureGrid(grid);
+  if(!grid->id) grid->id = ea_make_id(23);
+
+  esdmI_gridEncoder_putString(encoder, grid->id);
+  for(int64_t dim = 0; dim < grid->dimCount; dim++) {
+    const esdm_axis_t* axis = &grid->axes[dim];
+    esdmI_gridEncoder_putInt(encoder, axis->intervals);
+    for(int64_t i = 0; i <= axis->intervals; i++) esdmI_gridEncoder_putInt(encoder, axis->allBounds[i]);
+  }
+
+  int64_t countPosition = encoder->size, subgridCount = 0;
+  esdmI_gridEncoder_putInt(encoder, 0);  //the count is filled in below
+  for(int64_t i = 0, cellCount = esdmI_grid_cellCount(grid); i < cellCount; i++) {
+    if(!grid->grid[i].subgrid) continue;
+    esdmI_gridEncoder_putInt(encoder, i);
+    esdmI_grid_encodeStructure(encoder, grid->grid[i].subgrid);
+    subgridCount++;
+  }
+  esdmI_gridEncoder_setInt(encoder, countPosition, subgridCount);
+}
+
+//Creates a grid from its encoded structure, the grid does not contain any fragments yet.
+static esdm_status esdmI_grid_decodeStructure(esdmI_gridDecoder_t* decoder, esdm_dataset_t* dataset, esdm_grid_t* parent, esdm_grid_t** out_grid) {
+  const int64_t dims = dataset->dataspace->dims;
+  *out_grid = NULL;
+
+  //allocate a grid with a single cell, which is always safe to destroy
+  esdm_grid_t* grid = ea_checked_malloc(sizeof*grid + dims*sizeof*grid->axes);
+  *grid = (esdm_grid_t){
+    .dimCount = dims,
+    .dataset = dataset,
+    .parent = parent,
+    .id = esdmI_gridDecoder_getString(decoder),
+    .emptyCells = 0,
+    .grid = NULL
+  };
+  for(int64_t dim = 0; dim < dims; dim++) {
+    grid->axes[dim] = (esdm_axis_t){ .intervals = 1, .allBounds = grid->axes[dim].outerBounds };
+  }
+
+  //read the axes
+  int64_t cellCount = 1;
+  for(int64_t dim = 0; dim < dims && decoder->ok; dim++) {
+    esdm_axis_t* axis = &grid->axes[dim];
+    int64_t intervals = esdmI_gridDecoder_getInt(decoder);
+    if(intervals < 1 || intervals > (decoder->end - decoder->pos)/8 || cellCount > INT64_MAX/intervals) goto fail;
+    cellCount *= intervals;
+    if(intervals > 1) axis->allBounds = ea_checked_malloc((intervals + 1)*sizeof*axis->allBounds);
+    axis->intervals = intervals;
+    for(int64_t i = 0; i <= intervals; i++) {
+      axis->allBounds[i] = esdmI_gridDecoder_getInt(decoder);
+      if(i && axis->allBounds[i] <= axis->allBounds[i - 1]) goto fail;
+    }
+    axis->outerBounds[0] = axis->allBounds[0];
+    axis->outerBounds[1] = axis->allBounds[intervals];
+  }
+  if(!decoder->ok || !grid->id) goto fail;
+  esdm_grid_ensureGrid(grid);
+
+  //read the subgrids, which must match the extends of their cells
+  int64_t subgridCount = esdmI_gridDecoder_getInt(decoder);
+  if(subgridCount < 0 || subgridCount > cellCount) goto fail;
+  for(int64_t i = 0, lastIndex = -1; i < subgridCount; i++) {
+    int64_t linearIndex = esdmI_gridDecoder_getInt(decoder);
+    if(!decoder->ok || linearIndex <= lastIndex || linearIndex >= cellCount) goto fail;
+    lastIndex = linearIndex;
+    esdm_status ret = esdmI_grid_decodeStructure(decoder, dataset, grid, &grid->grid[linearIndex].subgrid);
+    if(ret != ESDM_SUCCESS) goto fail;
+
+    int64_t index[dims], offset[dims], size[dims];
+    esdm_grid_indexCoordinates(grid, linearIndex, index);
+    ret = esdm_grid_cellSize(grid, index, offset, size);
+    eassert(ret == ESDM_SUCCESS);
+    const esdm_grid_t* subgrid = grid->grid[linearIndex].subgrid;
+    for(int64_t dim = 0; dim < dims; dim++) {
+      if(subgrid->axes[dim].outerBounds[0] != offset[dim] || subgrid->axes[dim].outerBounds[1] != offset[dim] + size[dim]) goto fail;
+    }
+  }
+  if(!decoder->ok) goto fail;
+
+  *out_grid = grid;
+  return ESDM_SUCCESS;
+
+fail:
+  esdmI_grid_destroy(grid);
+  return ESDM_INVALID_DATA_ERROR;
+}
+
+static void esdmI_grid_collectFragments(esdm_grid_t* grid, esdmI_gridFragmentList_t* list) {
+  if(!grid->grid) return;
+  for(int64_t i = 0, cellCount = esdmI_grid_cellCount(grid); i < cellCount; i++) {
+    const esdm_gridEntry_t* cell = &grid->grid[i];
+    if(cell->subgrid) esdmI_grid_collectFragments(cell->subgrid, list);
+    if(cell->fragment) esdmI_gridFragmentList_add(list, cell->fragment);
+  }
+}
+
+char* esdmI_grid_encode(esdm_grid_t* grid, bool incremental, int64_t* out_size) {
+  eassert(grid);
+  eassert(!grid->parent && "only top-level grids can be encoded");
+  eassert(out_size);
+
+  esdmI_gridEncoder_t encoder = { .data = ea_checked_malloc(1024), .size = 0, .allocatedSize = 1024 };
+  esdmI_gridEncoder_put(&encoder, kGridMagic, sizeof(kGridMagic));
+  esdmI_gridEncoder_put(&encoder, &kGridVersion, 1);
+  esdmI_gridEncoder_putInt(&encoder, 0);  //the length is filled in below
+
+  if(!grid->id) grid->id = ea_make_id(23);
+  esdmI_gridEncoder_putString(&encoder, grid->id);
+
+  //the structure is only needed by processes that do not have a copy of the grid yet
+  int64_t structurePosition = encoder.size;
+  esdmI_gridEncoder_putInt(&encoder, 0);  //the size is filled in below
+  if(!incremental) {
+    esdmI_grid_encodeStructure(&encoder, grid);
+    esdmI_gridEncoder_setInt(&encoder, structurePosition, encoder.size - structurePosition - 8);
+  }
+
+  //an incremental encoding only contains the cells that this process has filled since the last incremental encoding
+  esdmI_gridFragmentList_t fragments = {0};
+  if(incremental && grid->tracksWrites) {
+    fragments = grid->writtenFragments;
+  } else {
+    esdmI_grid_collectFragments(grid, &fragments);
+  }
+  if(incremental) {
+    grid->writtenFragments = (esdmI_gridFragmentList_t){0};
+    grid->tracksWrites = true;
+  }
+  int64_t tableSize;
+  char* table = esdmI_fragmentTable_encode(grid->dimCount, fragments.count, fragments.fragments, &tableSize);
+  esdmI_gridEncoder_put(&encoder, table, tableSize);
+  free(table);
+  free(fragments.fragments);
+
+  esdmI_gridEncoder_setInt(&encoder, sizeof(kGridMagic) + 1, encoder.size);
+  *out_size = encoder.size;
+  return encoder.data;
+}
+
+//Puts the fragments of the table into the cells that they match.
+//Fragments for cells that already have data are ignored, fragments that do not match any cell are an error.
+static esdm_status esdmI_grid_fillCellsFromTable(esdm_grid_t* grid, const char* table, int64_t tableSize) {
+  int64_t fragmentCount;
+  esdm_fragment_t** fragments;
+  esdm_status result = esdmI_fragmentTable_decodeList(grid->dataset, table, tableSize, NULL, &fragmentCount, &fragments);
+  if(result != ESDM_SUCCESS) return result;
+
+  int64_t filledCount = 0;
+  for(int64_t i = 0; i < fragmentCount; i++) {
+    esdm_grid_t* cellGrid = grid;
+    esdm_gridEntry_t* cell;
+    if(esdm_grid_findCellInHierarchy(&cellGrid, fragments[i]->dataspace, &cell) != ESDM_SUCCESS) {
+      result = ESDM_INVALID_DATA_ERROR;
+      break;
+    }
+    if(cell->fragment) continue;
+    cell->fragment = fragments[i];
+    esdmI_grid_registerCompletedCell(cellGrid);
+    filledCount++;
+  }
+  free(fragments);
+
+  //the grid must be persisted with the next commit, even if this process did not write anything itself
+  if(filledCount) grid->dataset->status = ESDM_DATA_DIRTY;
+  return result;
+}
+
+esdm_status esdmI_grid_createFromBinary(const char* data, int64_t size, esdm_dataset_t* dataset, esdm_grid_t** out_grid) {
+  eassert(data);
+  eassert(dataset);
+  eassert(out_grid);
+  *out_grid = NULL;
+
+  esdmI_gridEncoding_t encoding;
+  esdm_status result = esdmI_gridEncoding_open(data, size, &encoding);
+  if(result != ESDM_SUCCESS) return result;
+  if(!encoding.structureSize) return ESDM_INVALID_DATA_ERROR; //an incremental encoding cannot be used to create a grid
+
+  esdmI_gridDecoder_t decoder = { .pos = encoding.structure, .end = encoding.structure + encoding.structureSize, .ok = true };
+  esdm_grid_t* grid;
+  result = esdmI_grid_decodeStructure(&decoder, dataset, NULL, &grid);
+  if(result != ESDM_SUCCESS) return result;
+  if(decoder.pos != decoder.end || !esdmI_gridEncoding_matchesId(&encoding, grid->id)) {
+    esdmI_grid_destroy(grid);
+    return ESDM_INVALID_DATA_ERROR;
+  }
+
+  //the grid must be registered before its cells are filled, so that its completion can be registered as well
+  esdmI_dataset_registerGrid(dataset, grid);
+  grid->tracksWrites = true;
+  result = esdmI_grid_fillCellsFromTable(grid, encoding.table, encoding.tableSize);
+  if(result == ESDM_SUCCESS) *out_grid = grid;
+  return result;
+}
+
+esdm_status esdmI_grid_mergeWithBinary(esdm_grid_t* grid, const char* data, int64_t size) {
+  eassert(grid);
+  eassert(!grid->parent);
+  eassert(data);
+
+  esdmI_gridEncoding_t encoding;
+  esdm_status result = esdmI_gridEncoding_open(data, size, &encoding);
+  if(result != ESDM_SUCCESS) return result;
+  if(!esdmI_gridEncoding_matchesId(&encoding, grid->id)) return ESDM_INVALID_STATE_ERROR;
+  return esdmI_grid_fillCellsFromTable(grid, encoding.table, encoding.tableSize);
+}
+
+esdm_status esdmI_grid_mergeEncodings(const char* a, int64_t aSize, const char* b, int64_t bSize, char** out_data, int64_t* out_size) {
+  eassert(a);
+  eassert(b);
+  eassert(out_data);
+  eassert(out_size);
+  *out_data = NULL;
+  *out_size = 0;
+
+  esdmI_gridEncoding_t aEncoding, bEncoding;
+  if(esdmI_gridEncoding_open(a, aSize, &aEncoding) != ESDM_SUCCESS) return ESDM_INVALID_DATA_ERROR;
+  if(esdmI_gridEncoding_open(b, bSize, &bEncoding) != ESDM_SUCCESS) return ESDM_INVALID_DATA_ERROR;
+  if(aEncoding.idLength != bEncoding.idLength || memcmp(aEncoding.id, bEncoding.id, aEncoding.idLength)) return ESDM_INVALID_STATE_ERROR;
+
+  int64_t tableSize;
+  char* table = esdmI_fragmentTable_merge(aEncoding.table, aEncoding.tableSize, bEncoding.table, bEncoding.tableSize, &tableSize);
+  if(!table) return ESDM_INVALID_DATA_ERROR;
+
+  //the result is an incremental encoding, whoever merges it has the structure already
+  esdmI_gridEncoder_t encoder = { .data = ea_checked_malloc(kGridHeaderSize + 16 + aEncoding.idLength + tableSize), .size = 0, .allocatedSize = kGridHeaderSize + 16 + aEncoding.idLength + tableSize };
+  esdmI_gridEncoder_put(&encoder, kGridMagic, sizeof(kGridMagic));
+  esdmI_gridEncoder_put(&encoder, &kGridVersion, 1);
+  esdmI_gridEncoder_putInt(&encoder, 0);
+  esdmI_gridEncoder_putInt(&encoder, aEncoding.idLength);
+  esdmI_gridEncoder_put(&encoder, aEncoding.id, aEncoding.idLength);
+  esdmI_gridEncoder_putInt(&encoder, 0);
+  esdmI_gridEncoder_put(&encoder, table, tableSize);
+  esdmI_gridEncoder_setInt(&encoder, sizeof(kGridMagic) + 1, encoder.size);
+  free(table);
+
+  *out_data = encoder.data;
+  *out_size = encoder.size;
+  return ESDM_SUCCESS;
+}
+
 const char* esdmI_grid_id(esdm_grid_t* grid) {
   return grid->id;
 }
@@ -909,5 +1755,7 @@ void esdmI_grid_destroy(esdm_grid_t* grid) {
   for(int64_t dim = grid->dimCount; dim--; ) {
     if(grid->axes[dim].intervals != 1) free(grid->axes[dim].allBounds);
   }
+  free(grid->writtenFragments.fragments);
+  free(grid->id);
   free(grid);
 }
@@ -0,0 +1,338 @@
+/* This file is part of ESDM.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with ESDM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ * @brief A streaming pull parser for the JSON metadata of ESDM.
+ *
+ * The reader tokenizes the metadata in place, keys, strings and numbers are returned as pointers into the input buffer.
+ * This allows the metadata parsers to create the ESDM objects directly from the token stream,
+ * without building a complete jansson object tree first, which needs several times the memory of the text itself.
+ *
+ * The reader is lenient with the separators: commas and colons are only used to delimit tokens and to recognize keys,
+ * misplaced separators are not reported as errors. Its purpose is to read the metadata that ESDM produces, not to validate JSON.
+ */
+
+#include <esdm-internal.h>
+#include <stdlib.h>
+#include <string.h>
+
+void esdmI_jsonReader_init(esdmI_jsonReader_t* me, const char* data, int64_t size) {
+  eassert(me);
+  eassert(data || !size);
+  *me = (esdmI_jsonReader_t){
+    .pos = data,
+    .end = data + size,
+    .token = ESDMI_JSON_END,
+    .text = NULL,
+    .length = 0,
+    .ok = true
+  };
+}
+
+static esdmI_jsonToken_t fail(esdmI_jsonReader_t* me) {
+  me->ok = false;
+  me->text = NULL;
+  me->length = 0;
+  return me->token = ESDMI_JSON_INVALID;
+}
+
+//same as fail(), for the functions that return a success flag
+static bool reject(esdmI_jsonReader_t* me) {
+  fail(me);
+  return false;
+}
+
+static void skipSpace(esdmI_jsonReader_t* me) {
+  while(me->pos < me->end) {
+    switch(*me->pos) {
+      case ' ': case '\t': case '\n': case '\r': case ',':
+        me->pos++;
+        break;
+      default:
+        return;
+    }
+  }
+}
+
+static bool isNumberChar(char c) {
+  return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+static esdmI_jsonToken_t literal(esdmI_jsonReader_t* me, const char* word, esdmI_jsonToken_t token) {
+  int64_t length = strlen(word);
+  if(me->end - me->pos < length || memcmp(me->pos, word, length)) return fail(me);
+  me->text = me->pos;
+  me->length = length;
+  me->pos += length;
+  return me->token = token;
+}
+
+esdmI_jsonToken_t esdmI_jsonReader_next(esdmI_jsonReader_t* me) {
+  eassert(me);
+  if(!me->ok) return ESDMI_JSON_INVALID;
+
+  skipSpace(me);
+  me->text = NULL;
+  me->length = 0;
+  if(me->pos >= me->end || !*me->pos) return me->token = ESDMI_JSON_END;  //a null byte terminates the JSON text
+
+  switch(*me->pos) {
+    case '{': me->pos++; return me->token = ESDMI_JSON_OBJECT_START;
+    case '}': me->pos++; return me->token = ESDMI_JSON_OBJECT_END;
+    case '[': me->pos++; return me->token = ESDMI_JSON_ARRAY_START;
+    case ']': me->pos++; return me->token = ESDMI_JSON_ARRAY_END;
+    case 't': return literal(me, "true", ESDMI_JSON_TRUE);
+    case 'f': return literal(me, "false", ESDMI_JSON_FALSE);
+    case 'n': return literal(me, "null", ESDMI_JSON_NULL);
+    case '"': {
+      const char* start = ++me->pos;
+      while(me->pos < me->end && *me->pos != '"') {
+        if(*me->pos == '\\') me->pos++;  //the escaped character cannot terminate the string
+        me->pos++;
+      }
+      if(me->pos >= me->end) return fail(me);
+      me->text = start;
+      me->length = me->pos++ - start;
+
+      //a string that is followed by a colon is a key
+      const char* afterString = me->pos;
+      while(afterString < me->end && (*afterString == ' ' || *afterString == '\t' || *afterString == '\n' || *afterString == '\r')) afterString++;
+      if(afterString < me->end && *afterString == ':') {
+        me->pos = afterString + 1;
+        return me->token = ESDMI_JSON_KEY;
+      }
+      return me->token = ESDMI_JSON_STRING;
+    }
+    default: {
+      if(!isNumberChar(*me->pos)) return fail(me);
+      me->text = me->pos;
+      while(me->pos < me->end && isNumberChar(*me->pos)) me->pos++;
+      me->length = me->pos - me->text;
+      return me->token = ESDMI_JSON_NUMBER;
+    }
+  }
+}
+
+esdmI_jsonToken_t esdmI_jsonReader_peek(esdmI_jsonReader_t* me) {
+  eassert(me);
+  esdmI_jsonReader_t copy = *me;
+  return esdmI_jsonReader_next(&copy);
+}
+
+bool esdmI_jsonReader_nextKey(esdmI_jsonReader_t* me) {
+  switch(esdmI_jsonReader_next(me)) {
+    case ESDMI_JSON_KEY: return true;
+    case ESDMI_JSON_OBJECT_END: return false;
+    default:
+      return reject(me);
+  }
+}
+
+bool esdmI_jsonReader_nextElement(esdmI_jsonReader_t* me) {
+  switch(esdmI_jsonReader_peek(me)) {
+    case ESDMI_JSON_ARRAY_END:
+      esdmI_jsonReader_next(me);
+      return false;
+    case ESDMI_JSON_INVALID: case ESDMI_JSON_END: case ESDMI_JSON_KEY: case ESDMI_JSON_OBJECT_END:
+      return reject(me);
+    default:
+      return true;
+  }
+}
+
+bool esdmI_jsonReader_keyIs(const esdmI_jsonReader_t* me, const char* key) {
+  eassert(me);
+  eassert(key);
+  return me->token == ESDMI_JSON_KEY && (int64_t)strlen(key) == me->length && !memcmp(me->text, key, me->length);
+}
+
+bool esdmI_jsonReader_readInt(esdmI_jsonReader_t* me, int64_t* out_value) {
+  eassert(out_value);
+  if(esdmI_jsonReader_next(me) != ESDMI_JSON_NUMBER) return reject(me);
+
+  const char* c = me->text, *end = me->text + me->length;
+  bool negative = c < end && *c == '-';
+  if(negative) c++;
+  if(c == end) return reject(me);
+  uint64_t value = 0;
+  for(; c < end; c++) {
+    if(*c < '0' || *c > '9') return reject(me); //not an integer
+    if(value > (UINT64_MAX - 9)/10) return reject(me); //overflow
+    value = 10*value + (*c - '0');
+  }
+  if(value > (uint64_t)INT64_MAX + negative) return reject(me);
+  *out_value = negative ? (int64_t)(0 - value) : (int64_t)value;
+  return true;
+}
+
+bool esdmI_jsonReader_readDouble(esdmI_jsonReader_t* me, double* out_value) {
+  eassert(out_value);
+  if(esdmI_jsonReader_next(me) != ESDMI_JSON_NUMBER) return reject(me);
+  char buffer[64];  //the input is not terminated after the number, so we need a copy for strtod()
+  if(me->length >= (int64_t)sizeof(buffer)) return reject(me);
+  memcpy(buffer, me->text, me->length);
+  buffer[me->length] = 0;
+  char* numberEnd;
+  *out_value = strtod(buffer, &numberEnd);
+  if(*numberEnd) return reject(me);
+  return true;
+}
+
+bool esdmI_jsonReader_readIntArray(esdmI_jsonReader_t* me, int64_t** out_values, int64_t* out_count) {
+  eassert(out_values);
+  eassert(out_count);
+  *out_values = NULL;
+  *out_count = 0;
+  if(esdmI_jsonReader_next(me) != ESDMI_JSON_ARRAY_START) return reject(me);
+
+  int64_t count = 0, slots = 8;
+  int64_t* values = ea_checked_malloc(slots*sizeof(*values));
+  while(esdmI_jsonReader_nextElement(me)) {
+    if(count == slots) values = ea_checked_realloc(values, (slots *= 2)*sizeof(*values));
+    if(!esdmI_jsonReader_readInt(me, &values[count++])) break;
+  }
+  if(!me->ok) {
+    free(values);
+    return false;
+  }
+  *out_values = values;
+  *out_count = count;
+  return true;
+}
+
+static int hexValue(char c) {
+  if(c >= '0' && c <= '9') return c - '0';
+  if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+static bool readHex4(const char* c, const char* end, uint32_t* out_value) {
+  if(end - c < 4) return false;
+  *out_value = 0;
+  for(int i = 0; i < 4; i++) {
+    int digit = hexValue(c[i]);
+    if(digit < 0) return false;
+    *out_value = *out_value << 4 | digit;
+  }
+  return true;
+}
+
+//encodes the code point as UTF-8, returns the number of bytes written
+static int putUtf8(char* out, uint32_t codePoint) {
+  if(codePoint < 0x80) {
+    out[0] = codePoint;
+    return 1;
+  } else if(codePoint < 0x800) {
+    out[0] = 0xc0 | codePoint >> 6;
+    out[1] = 0x80 | (codePoint & 0x3f);
+    return 2;
+  } else if(codePoint < 0x10000) {
+    out[0] = 0xe0 | codePoint >> 12;
+    out[1] = 0x80 | (codePoint >> 6 & 0x3f);
+    out[2] = 0x80 | (codePoint & 0x3f);
+    return 3;
+  }
+  out[0] = 0xf0 | codePoint >> 18;
+  out[1] = 0x80 | (codePoint >> 12 & 0x3f);
+  out[2] = 0x80 | (codePoint >> 6 & 0x3f);
+  out[3] = 0x80 | (codePoint & 0x3f);
+  return 4;
+}
+
+char* esdmI_jsonReader_copyString(esdmI_jsonReader_t* me) {
+  eassert(me);
+  if(me->token != ESDMI_JSON_STRING && me->token != ESDMI_JSON_KEY) return NULL;
+
+  //the unescaped string is never longer than the escaped one
+  char* result = ea_checked_malloc(me->length + 1);
+  char* out = result;
+  const char* c = me->text, *end = me->text + me->length;
+  while(c < end) {
+    if(*c != '\\') {
+      *out++ = *c++;
+      continue;
+    }
+    if(++c == end) goto fail;
+    switch(*c++) {
+      case '"': *out++ = '"'; break;
+      case '\\': *out++ = '\\'; break;
+      case '/': *out++ = '/'; break;
+      case 'b': *out++ = '\b'; break;
+      case 'f': *out++ = '\f'; break;
+      case 'n': *out++ = '\n'; break;
+      case 'r': *out++ = '\r'; break;
+      case 't': *out++ = '\t'; break;
+      case 'u': {
+        uint32_t codePoint;
+        if(!readHex4(c, end, &codePoint)) goto fail;
+        c += 4;
+        if(codePoint >= 0xd800 && codePoint < 0xdc00) {
+          //high surrogate, must be followed by an escaped low surrogate
+          uint32_t low;
+          if(end - c < 6 || c[0] != '\\' || c[1] != 'u' || !readHex4(c + 2, end, &low) || low < 0xdc00 || low >= 0xe000) goto fail;
+          c += 6;
+          codePoint = 0x10000 + ((codePoint - 0xd800) << 10) + (low - 0xdc00);
+        }
+        out += putUtf8(out, codePoint); //at most four bytes from at least six input characters
+        break;
+      }
+      default: goto fail;
+    }
+  }
+  *out = 0;
+  return result;
+
+fail:
+  free(result);
+  fail(me);
+  return NULL;
+}
+
+char* esdmI_jsonReader_readString(esdmI_jsonReader_t* me) {
+  if(esdmI_jsonReader_next(me) != ESDMI_JSON_STRING) {
+    fail(me);
+    return NULL;
+  }
+  return esdmI_jsonReader_copyString(me);
+}
+
+bool esdmI_jsonReader_skipValue(esdmI_jsonReader_t* me, const char** out_start, int64_t* out_size) {
+  eassert(me);
+
+  int64_t depth = 0;
+  const char* start = NULL;
+  do {
+    esdmI_jsonToken_t token = esdmI_jsonReader_next(me);
+    if(!start) {
+      //the text of a string token starts behind the opening quote, punctuation tokens have no text
+      start = token == ESDMI_JSON_STRING ? me->text - 1 : me->text ? me->text : me->pos - 1;
+    }
+    switch(token) {
+      case ESDMI_JSON_OBJECT_START: case ESDMI_JSON_ARRAY_START: depth++; break;
+      case ESDMI_JSON_OBJECT_END: case ESDMI_JSON_ARRAY_END: depth--; break;
+      case ESDMI_JSON_INVALID: case ESDMI_JSON_END: return reject(me);
+      case ESDMI_JSON_KEY: if(!depth) return reject(me); break;  //keys are only valid within objects
+      default: break;
+    }
+    if(depth < 0) return reject(me);
+  } while(depth);
+
+  if(out_start) *out_start = start;
+  if(out_size) *out_size = me->pos - start;
+  return true;
+}
@@ -0,0 +1,267 @@
+/* This file is part of ESDM.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with ESDM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ * @brief A process wide cache of parsed container and dataset metadata.
+ *
+ * The cache owns the containers that it holds, nobody else has a reference to them.
+ * Datasets are different: They are always owned by their container, the cache only keeps them loaded after they have been closed.
+ * Either way, an object is removed from the cache when it is reused, so an object is never in use and in the cache at the same time.
+ */
+
+#include <glib.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <esdm-internal.h>
+
+#define DEBUG(fmt, ...) ESDM_DEBUG_COM_FMT("MDCACHE", fmt, __VA_ARGS__)
+
+typedef struct cacheEntry_t {
+  bool isContainer;
+  void* object;  //either an esdm_container_t* or an esdm_dataset_t*
+  int64_t bytes;
+} cacheEntry_t;
+
+//Recursive, because evicting a container destroys its datasets, which removes them from the cache.
+static GRecMutex gLock;
+static GQueue gLru = G_QUEUE_INIT;  //the cache entries, least recently closed first
+static GHashTable* gLinks = NULL;  //maps the cached objects to their links within gLru
+static GHashTable* gContainers = NULL;  //maps container names to the cached containers
+static int64_t gBytes = 0;
+static int64_t gHits = 0, gMisses = 0, gInvalidations = 0, gEvictions = 0;
+
+static int64_t budget() {
+  esdm_config_t* config = esdmI_getConfig();
+  return config ? config->metadataCacheBytes : 0;
+}
+
+static void ensureTables() {
+  if(gLinks) return;
+  gLinks = g_hash_table_new(g_direct_hash, g_direct_equal);
+  gContainers = g_hash_table_new(g_str_hash, g_str_equal);
+}
+
+//Removes the object from the bookkeeping, returns whether it was cached.
+//Must be called with the lock held.
+static bool removeObject(void* object) {
+  if(!gLinks) return false;
+  GList* link = g_hash_table_lookup(gLinks, object);
+  if(!link) return false;
+
+  cacheEntry_t* entry = link->data;
+  g_queue_delete_link(&gLru, link);
+  g_hash_table_remove(gLinks, object);
+  if(entry->isContainer) {
+    esdm_container_t* c = object;
+    if(g_hash_table_lookup(gContainers, c->name) == c) g_hash_table_remove(gContainers, c->name);
+  }
+  gBytes -= entry->bytes;
+  free(entry);
+  return true;
+}
+
+//Must be called with the lock held.
+static void addObject(bool isContainer, void* object, int64_t bytes) {
+  ensureTables();
+  cacheEntry_t* entry = ea_checked_malloc(sizeof(*entry));
+  *entry = (cacheEntry_t){
+    .isContainer = isContainer,
+    .object = object,
+    .bytes = bytes
+  };
+  g_queue_push_tail(&gLru, entry);
+  g_hash_table_insert(gLinks, object, g_queue_peek_tail_link(&gLru));
+  if(isContainer) g_hash_table_insert(gContainers, ((esdm_container_t*)object)->name, object);
+  gBytes += bytes;
+}
+
+//Must be called with the lock held.
+static void evictObject(void* object, bool isContainer) {
+  if(!removeObject(object)) return;
+  if(isContainer) {
+    esdm_container_t* c = object;
+    DEBUG("evicting container \"%s\"", c->name);
+    if(esdmI_container_destroy(c) != ESDM_SUCCESS) ESDM_WARN_FMT("failed to destroy the cached container \"%s\"", c->name);
+  } else {
+    esdm_dataset_t* d = object;
+    DEBUG("evicting dataset \"%s\"", d->name);
+    esdmI_dataset_unload(d);
+  }
+}
+
+//Evicts the least recently closed objects until the cache fits its budget.
+//Must be called with the lock held.
+static void trim() {
+  int64_t limit = budget();
+  while(gBytes > limit && !g_queue_is_empty(&gLru)) {
+    cacheEntry_t* entry = g_queue_peek_head(&gLru);
+    evictObject(entry->object, entry->isContainer);
+    gEvictions++;
+  }
+}
+
+static bool sameStamp(const esdm_md_stamp_t* a, const esdm_md_stamp_t* b) {
+  return !memcmp(a, b, sizeof(*a));
+}
+
+static bool currentContainerStamp(esdm_container_t* c, esdm_md_stamp_t* out_stamp) {
+  esdm_md_backend_t* backend = esdm_get_modules()->metadata_backend;
+  if(!backend->callbacks.container_stamp) return false;
+  *out_stamp = (esdm_md_stamp_t){0};
+  return backend->callbacks.container_stamp(backend, c, out_stamp) == ESDM_SUCCESS;
+}
+
+static bool currentDatasetStamp(esdm_dataset_t* d, esdm_md_stamp_t* out_stamp) {
+  esdm_md_backend_t* backend = esdm_get_modules()->metadata_backend;
+  if(!backend->callbacks.dataset_stamp || !d->id) return false;
+  *out_stamp = (esdm_md_stamp_t){0};
+  return backend->callbacks.dataset_stamp(backend, d, out_stamp) == ESDM_SUCCESS;
+}
+
+void esdmI_mdCache_stampContainer(esdm_container_t* c) {
+  eassert(c);
+  c->mdStamped = budget() > 0 && currentContainerStamp(c, &c->mdStamp);
+}
+
+void esdmI_mdCache_stampDataset(esdm_dataset_t* d) {
+  eassert(d);
+  d->mdStamped = budget() > 0 && currentDatasetStamp(d, &d->mdStamp);
+}
+
+bool esdmI_mdCache_parkContainer(esdm_container_t* c) {
+  eassert(c);
+  if(!c->mdStamped || c->status != ESDM_DATA_PERSISTENT || budget() <= 0) return false;
+  for(int i = 0; i < c->dsets.count; i++) {
+    esdm_dataset_t* d = c->dsets.dset[i];
+    if(d->refcount || (d->status != ESDM_DATA_NOT_LOADED && d->status != ESDM_DATA_PERSISTENT)) return false;
+  }
+
+  g_rec_mutex_lock(&gLock);
+  //there is at most one cached container per name, the one that was closed last is the more useful one
+  if(gContainers) {
+    esdm_container_t* old = g_hash_table_lookup(gContainers, c->name);
+    if(old) evictObject(old, true);
+  }
+  addObject(true, c, c->mdBytes);
+  trim();
+  g_rec_mutex_unlock(&gLock);
+  return true;
+}
+
+esdm_container_t* esdmI_mdCache_takeContainer(const char* name) {
+  eassert(name);
+  if(budget() <= 0) return NULL;
+
+  g_rec_mutex_lock(&gLock);
+  esdm_container_t* c = gContainers ? g_hash_table_lookup(gContainers, name) : NULL;
+  if(c) removeObject(c);
+  else gMisses++;
+  g_rec_mutex_unlock(&gLock);
+  if(!c) return NULL;
+
+  //the container is ours now, so we can check the stamp without holding the lock
+  esdm_md_stamp_t stamp;
+  bool valid = currentContainerStamp(c, &stamp) && sameStamp(&stamp, &c->mdStamp);
+  g_rec_mutex_lock(&gLock);
+  if(valid) {
+    gHits++;
+  } else {
+    gInvalidations++;
+    gMisses++;
+  }
+  g_rec_mutex_unlock(&gLock);
+
+  if(!valid) {
+    DEBUG("container \"%s\" has changed", name);
+    esdmI_container_destroy(c);
+    return NULL;
+  }
+  c->refcount = 1;
+  c->status = ESDM_DATA_PERSISTENT;
+  return c;
+}
+
+bool esdmI_mdCache_parkDataset(esdm_dataset_t* d) {
+  eassert(d);
+  if(!d->mdStamped || d->status != ESDM_DATA_PERSISTENT || d->refcount || budget() <= 0) return false;
+
+  g_rec_mutex_lock(&gLock);
+  removeObject(d);
+  addObject(false, d, d->snapshotBytes + d->journalBytes);
+  trim();  //may unload the dataset right away, which is just what the caller would have done
+  g_rec_mutex_unlock(&gLock);
+  return true;
+}
+
+void esdmI_mdCache_takeDataset(esdm_dataset_t* d) {
+  eassert(d);
+
+  g_rec_mutex_lock(&gLock);
+  bool cached = removeObject(d);
+  if(!cached && d->status == ESDM_DATA_NOT_LOADED && budget() > 0) gMisses++;
+  g_rec_mutex_unlock(&gLock);
+  if(!cached) return;
+
+  esdm_md_stamp_t stamp;
+  bool valid = currentDatasetStamp(d, &stamp) && sameStamp(&stamp, &d->mdStamp);
+  g_rec_mutex_lock(&gLock);
+  if(valid) {
+    gHits++;
+  } else {
+    gInvalidations++;
+    gMisses++;
+  }
+  g_rec_mutex_unlock(&gLock);
+
+  if(!valid) {
+    DEBUG("dataset \"%s\" has changed", d->name);
+    esdmI_dataset_unload(d);
+  }
+}
+
+bool esdmI_mdCache_forgetDataset(esdm_dataset_t* d) {
+  eassert(d);
+  g_rec_mutex_lock(&gLock);
+  bool result = removeObject(d);
+  g_rec_mutex_unlock(&gLock);
+  return result;
+}
+
+void esdmI_mdCache_clear() {
+  g_rec_mutex_lock(&gLock);
+  while(!g_queue_is_empty(&gLru)) {
+    cacheEntry_t* entry = g_queue_peek_head(&gLru);
+    evictObject(entry->object, entry->isContainer);
+  }
+  if(gLinks) {
+    g_hash_table_destroy(gLinks);
+    g_hash_table_destroy(gContainers);
+    gLinks = gContainers = NULL;
+  }
+  g_rec_mutex_unlock(&gLock);
+}
+
+void esdmI_mdCache_getStats(int64_t* out_hits, int64_t* out_misses, int64_t* out_invalidations, int64_t* out_evictions, int64_t* out_bytes) {
+  g_rec_mutex_lock(&gLock);
+  if(out_hits) *out_hits = gHits;
+  if(out_misses) *out_misses = gMisses;
+  if(out_invalidations) *out_invalidations = gInvalidations;
+  if(out_evictions) *out_evictions = gEvictions;
+  if(out_bytes) *out_bytes = gBytes;
+  g_rec_mutex_unlock(&gLock);
+}
@@ -43,6 +43,11 @@
 #  pragma message("Building ESDM with MongoDB support.")
 #endif
 
+#ifdef ESDM_HAS_SQLITE
+#  include "backends-metadata/sqlite/md-sqlite.h"
+#  pragma message("Building ESDM with SQLite metadata support.")
+#endif
+
 esdm_modules_t *esdm_modules_init(esdm_instance_t *esdm) {
   ESDM_DEBUG(__func__);
 
@@ -66,6 +71,11 @@ esdm_modules_t *esdm_modules_init(esdm_instance_t *esdm) {
   else if (strncmp(metadata_coordinator->type, "mongodb", 7) == 0) {
     modules->metadata_backend = mongodb_backend_init(metadata_coordinator);
   }
+#endif
+#ifdef ESDM_HAS_SQLITE
+  else if (strncmp(metadata_coordinator->type, "sqlite", 6) == 0) {
+    modules->metadata_backend = sqlite_backend_init(metadata_coordinator);
+  }
 #endif
   else {
     ESDM_ERROR("Unknown metadata backend type. Please check your ESDM configuration.");
@@ -120,18 +130,97 @@ esdm_status esdm_modules_finalize(esdm_instance_t *esdm) {
   return ESDM_SUCCESS;
 }
 
-esdm_backend_t** esdm_modules_makeBackendRecommendation(esdm_modules_t* modules, esdm_dataspace_t* space, int64_t* out_backendCount, int64_t* out_maxFragmentSize) {
+//The cost model that is used to place data on the backends.
+//The time a backend needs to finish `x` additional bytes is modeled as `fixedTime + x/rate`.
+typedef struct backendCost_t {
+  esdm_backend_t* backend;
+  double rate;  //effective bytes per second for new data, including the per-fragment latency overhead
+  double fixedTime; //seconds until the already queued work has drained, plus the latency of the first request
+} backendCost_t;
+
+static void estimateBackendCost(esdm_backend_t* backend, backendCost_t* out_cost) {
+  double latency, throughput;
+  esdmI_performance_backendModel(backend, &latency, &throughput);
+
+  double parallelism = backend->threads > 0 ? backend->threads : 1;
+  double fragmentSize = esdmI_backend_fragmentSize(backend);
+  if(!(fragmentSize > 0)) fragmentSize = 10*1024*1024;
+  int64_t queuedBytes = atomic_load(&backend->queuedBytes);
+  int queuedOps = atomic_load(&backend->queuedOps);
+  if(queuedBytes < 0) queuedBytes = 0;
+  if(queuedOps < 0) queuedOps = 0;
+
+  *out_cost = (backendCost_t){
+    .backend = backend,
+    .rate = 1/(1/throughput + latency/(fragmentSize*parallelism)),  //the data is split into fragments of about fragmentSize bytes, each of which pays the latency on one of the threads
+    .fixedTime = queuedBytes/throughput + queuedOps*latency/parallelism + latency
+  };
+}
+
+//Node-local backends can only be used if all processes that may read the data share the node.
+//If there is more than one node, restrict ourselves to the global backends unless there are none.
+static bool backendIsAccessible(esdm_backend_t* backend, bool globalOnly) {
+  return !globalOnly || backend->config->data_accessibility == ESDM_ACCESSIBILITY_GLOBAL;
+}
+
+static bool requireGlobalBackends(esdm_modules_t* modules) {
+  esdm_instance_t* esdm = esdmI_esdm();
+  if(!esdm || esdm->total_procs <= esdm->procs_per_node) return false;
+  for(int64_t i = 0; i < modules->data_backend_count; i++) {
+    if(modules->data_backends[i]->config->data_accessibility == ESDM_ACCESSIBILITY_GLOBAL) return true;
+  }
+  return false;
+}
+
+static int compareFixedTime(const void* aVoid, const void* bVoid) {
+  const backendCost_t* a = aVoid, *b = bVoid;
+  return a->fixedTime < b->fixedTime ? -1 : a->fixedTime > b->fixedTime ? 1 : 0;
+}
+
+esdm_backend_t** esdm_modules_makeBackendRecommendation(esdm_modules_t* modules, esdm_dataspace_t* space, int64_t* out_backendCount, int64_t* out_maxFragmentSize, double** out_shares) {
+  eassert(modules);
+  eassert(modules->data_backend_count > 0);
   eassert(out_backendCount);
 
-  //TODO: actually select a subset of backends
-  *out_backendCount = modules->data_backend_count;
-  esdm_backend_t** result = ea_memdup(modules->data_backends, *out_backendCount*sizeof(*result));
+  //estimate the costs for all accessible backends
+  bool globalOnly = requireGlobalBackends(modules);
+  backendCost_t costs[modules->data_backend_count];
+  int64_t candidateCount = 0;
+  for(int64_t i = 0; i < modules->data_backend_count; i++) {
+    if(backendIsAccessible(modules->data_backends[i], globalOnly)) estimateBackendCost(modules->data_backends[i], &costs[candidateCount++]);
+  }
+  eassert(candidateCount > 0);
+  qsort(costs, candidateCount, sizeof(*costs), compareFixedTime);
+
+  //Select the backends by water filling: All used backends should finish at the same time T.
+  //With `sum_i rate_i*(T - fixedTime_i) = bytes`, T is minimal when we use exactly those backends with `fixedTime_i < T`.
+  //Since the backends are sorted by their fixed time, we simply add backends until the next one would not finish its queue before T.
+  double bytes = space ? esdm_dataspace_total_bytes(space) : 0;
+  double rateSum = 0, weightedTimeSum = 0, finishTime = 0;
+  int64_t selectedCount = 0;
+  while(selectedCount < candidateCount) {
+    if(selectedCount && costs[selectedCount].fixedTime >= finishTime) break;
+    rateSum += costs[selectedCount].rate;
+    weightedTimeSum += costs[selectedCount].rate*costs[selectedCount].fixedTime;
+    finishTime = (bytes + weightedTimeSum)/rateSum;
+    selectedCount++;
+  }
+  DEBUG("Placing %.0f bytes on %"PRId64" of %"PRId64" backends, estimated completion in %g s", bytes, selectedCount, candidateCount, finishTime);
+
+  *out_backendCount = selectedCount;
+  esdm_backend_t** result = ea_checked_malloc(selectedCount*sizeof(*result));
+  if(out_shares) *out_shares = ea_checked_malloc(selectedCount*sizeof(**out_shares));
+  for(int64_t i = 0; i < selectedCount; i++) {
+    result[i] = costs[i].backend;
+    if(out_shares) (*out_shares)[i] = bytes > 0 ? costs[i].rate*(finishTime - costs[i].fixedTime)/bytes : costs[i].rate/rateSum;
+  }
 
   if(out_maxFragmentSize) {
-    //determine the minimal max_fragment_size of a data backend that we return
+    //determine the minimal fragment size of a data backend that we return
     *out_maxFragmentSize = INT64_MAX;
     for(int64_t i = 0; i < *out_backendCount; i++) {
-      if(*out_maxFragmentSize > result[i]->config->max_fragment_size) *out_maxFragmentSize = result[i]->config->max_fragment_size;
+      int64_t curSize = esdmI_backend_fragmentSize(result[i]);
+      if(*out_maxFragmentSize > curSize) *out_maxFragmentSize = curSize;
     }
   }
 
@@ -139,17 +228,31 @@ esdm_backend_t** esdm_modules_makeBackendRecommendation(esdm_modules_t* modules,
 }
 
 esdm_backend_t* esdm_modules_randomWeightedBackend(esdm_modules_t* modules) {
-  //esdm_backend_t* bestBackend = NULL;
-  // for now just randomly assign the backend
-  //float bestThroughput = 0;
-  //for(int64_t i = 0; i < modules->data_backend_count; i++) {
-  //  float curThroughput = esdmI_backend_estimate_throughput(modules->data_backends[i]);
-  //  if(curThroughput >= bestThroughput) {
-  //    bestThroughput = curThroughput;
-  //    bestBackend = modules->data_backends[i];
-  //  }
-  //}
-  return modules->data_backends[rand() % modules->data_backend_count];
+  eassert(modules->data_backend_count > 0);
+
+  //weight each backend with the inverse of the time it is expected to need for a full size fragment, considering the work that is already queued on it
+  bool globalOnly = requireGlobalBackends(modules);
+  double weights[modules->data_backend_count];
+  double totalWeight = 0;
+  for(int64_t i = 0; i < modules->data_backend_count; i++) {
+    esdm_backend_t* backend = modules->data_backends[i];
+    weights[i] = 0;
+    if(!backendIsAccessible(backend, globalOnly)) continue;
+    backendCost_t cost;
+    estimateBackendCost(backend, &cost);
+    double fragmentSize = esdmI_backend_fragmentSize(backend);
+    totalWeight += weights[i] = 1/(cost.fixedTime + fragmentSize/cost.rate);
+  }
+
+  double choice = totalWeight*rand()/((double)RAND_MAX + 1);
+  for(int64_t i = 0; i < modules->data_backend_count; i++) {
+    if(weights[i] > 0 && (choice -= weights[i]) < 0) return modules->data_backends[i];
+  }
+  //only reachable due to rounding errors, return the last accessible backend
+  for(int64_t i = modules->data_backend_count; i--; ) {
+    if(weights[i] > 0) return modules->data_backends[i];
+  }
+  return modules->data_backends[0];
 }
 
 esdm_backend_t* esdm_modules_fastestBackend(esdm_modules_t* modules) {
@@ -30,6 +30,7 @@
 
 #include <esdm-internal.h>
 #include <esdm.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -81,3 +82,170 @@ esdm_status esdm_backend_t_estimate_performance(esdm_backend_t *backend, int req
 
   return ESDM_SUCCESS;
 }
+
+// Auto tuning of the fragment size ///////////////////////////////////////////
+
+enum {
+  IO_MODEL_MIN_SAMPLES = 8,  //number of samples that we need before we trust the fit
+  AUTO_FRAGMENT_SIZE_MIN = 64*1024,
+  AUTO_FRAGMENT_SIZE_MAX = 1024*1024*1024
+};
+static const double kIoModelDecay = 1 - 1.0/64; //weight of the old samples when a new sample is added
+
+//Latency and throughput as predicted by the configured performance model of the backend.
+static void backendModelPrediction(esdm_backend_t* backend, double* out_latency, double* out_throughput) {
+  *out_throughput = backend->callbacks.estimate_throughput ? esdmI_backend_estimate_throughput(backend) : 0;
+  if(!(*out_throughput > 0)) *out_throughput = 100.0*1024*1024; //same default as the generic performance model
+
+  *out_latency = 0;
+  if(backend->callbacks.performance_estimate) {
+    esdm_fragment_t probe = {.bytes = 0};
+    float probeTime;
+    if(!esdmI_backend_performance_estimate(backend, &probe, &probeTime) && probeTime > 0) *out_latency = probeTime;
+  }
+}
+
+//The smallest fragment size that reaches the given fraction of the streaming bandwidth:
+//bytes/throughput >= efficiency*(latency + bytes/throughput)  <=>  bytes >= efficiency/(1 - efficiency)*latency*throughput
+static int64_t fragmentSizeForEfficiency(double latency, double throughput, double efficiency, int64_t fallback) {
+  if(!(latency > 0) || !(throughput > 0)) return fallback; //no latency means that all fragment sizes are equally efficient
+  double size = efficiency/(1 - efficiency)*latency*throughput;
+  if(size < AUTO_FRAGMENT_SIZE_MIN) return AUTO_FRAGMENT_SIZE_MIN;
+  if(size > AUTO_FRAGMENT_SIZE_MAX) return AUTO_FRAGMENT_SIZE_MAX;
+  return (int64_t)ceil(size);
+}
+
+//Must be called with the mutex held.
+static void ioModel_fit(esdmI_ioModel_t* model, esdm_backend_t* backend) {
+  if(model->samples < IO_MODEL_MIN_SAMPLES) return;
+
+  double meanBytes = model->sumBytes/model->samples;
+  double meanTime = model->sumTime/model->samples;
+  double varBytes = model->sumBytesSquared/model->samples - meanBytes*meanBytes;
+  double covariance = model->sumBytesTime/model->samples - meanBytes*meanTime;
+  double latency, throughput;
+  if(varBytes > 1e-4*meanBytes*meanBytes && covariance > 0) {
+    //the samples span a range of sizes, so we can fit both parameters
+    throughput = varBytes/covariance;
+    latency = meanTime - meanBytes/throughput;
+    if(latency < 0) latency = 0;
+  } else {
+    //all samples have about the same size, keep the latency of the performance model and fit only the throughput
+    double modelThroughput;
+    backendModelPrediction(backend, &latency, &modelThroughput);
+    if(latency > meanTime) latency = 0;
+    throughput = meanTime - latency > 0 ? meanBytes/(meanTime - latency) : modelThroughput;
+  }
+  model->latency = latency;
+  model->throughput = throughput;
+  if(backend->config->fragment_size_efficiency > 0) {
+    int64_t size = fragmentSizeForEfficiency(latency, throughput, backend->config->fragment_size_efficiency, backend->config->max_fragment_size);
+    if(size != model->fragmentSize) DEBUG("Backend %s: latency = %g s, throughput = %g MiB/s, fragment size = %"PRId64, backend->config->id, latency, throughput/1024/1024, size);
+    model->fragmentSize = size;
+  }
+}
+
+void esdmI_performance_recordBackendIo(esdm_backend_t* backend, int64_t bytes, double seconds) {
+  eassert(backend);
+  if(bytes <= 0 || !(seconds > 0)) return;
+
+  esdmI_ioModel_t* model = &backend->ioModel;
+  g_mutex_lock(&model->mutex);
+  model->samples = kIoModelDecay*model->samples + 1;
+  model->sumBytes = kIoModelDecay*model->sumBytes + bytes;
+  model->sumTime = kIoModelDecay*model->sumTime + seconds;
+  model->sumBytesSquared = kIoModelDecay*model->sumBytesSquared + (double)bytes*bytes;
+  model->sumBytesTime = kIoModelDecay*model->sumBytesTime + bytes*seconds;
+  model->updated = true;
+  ioModel_fit(model, backend);
+  g_mutex_unlock(&model->mutex);
+}
+
+//The decayed sums are stored instead of the fit, so that the next process continues to refine the same fit.
+void esdmI_performance_storeBackendModel(esdm_md_backend_t* md, esdm_backend_t* backend) {
+  if(!md->callbacks.performance_model_commit) return;
+
+  esdmI_ioModel_t* model = &backend->ioModel;
+  char json[512];
+  g_mutex_lock(&model->mutex);
+  bool store = model->updated && model->samples >= IO_MODEL_MIN_SAMPLES;
+  int size = snprintf(json, sizeof(json), "{\"samples\":%.17g,\"sumBytes\":%.17g,\"sumTime\":%.17g,\"sumBytesSquared\":%.17g,\"sumBytesTime\":%.17g,\"latency\":%.17g,\"throughput\":%.17g}",
+                      model->samples, model->sumBytes, model->sumTime, model->sumBytesSquared, model->sumBytesTime, model->latency, model->throughput);
+  model->updated = false;
+  g_mutex_unlock(&model->mutex);
+  if(!store) return;
+
+  eassert(size < (int)sizeof(json));
+  if(md->callbacks.performance_model_commit(md, backend->config->id, json, size)) {
+    ESDM_WARN_FMT("cannot store the I/O model of backend %s", backend->config->id);
+  }
+}
+
+void esdmI_performance_loadBackendModel(esdm_md_backend_t* md, esdm_backend_t* backend) {
+  if(!md->callbacks.performance_model_retrieve) return;
+
+  char* text;
+  int size;
+  if(md->callbacks.performance_model_retrieve(md, backend->config->id, &text, &size)) return; //no model stored yet
+  json_t* root = load_json(text);
+  free(text);
+  if(!root) {
+    ESDM_WARN_FMT("ignoring the unreadable I/O model of backend %s", backend->config->id);
+    return;
+  }
+
+  double values[5];
+  const char* keys[5] = {"samples", "sumBytes", "sumTime", "sumBytesSquared", "sumBytesTime"};
+  bool valid = true;
+  for(int i = 0; i < 5; i++) {
+    json_t* elem = jansson_object_get(root, keys[i]);
+    valid = valid && elem && json_is_number(elem);
+    values[i] = valid ? json_number_value(elem) : 0;
+  }
+  json_decref(root);
+  if(!valid || !(values[0] > 0)) {
+    ESDM_WARN_FMT("ignoring the unreadable I/O model of backend %s", backend->config->id);
+    return;
+  }
+
+  esdmI_ioModel_t* model = &backend->ioModel;
+  g_mutex_lock(&model->mutex);
+  model->samples = values[0];
+  model->sumBytes = values[1];
+  model->sumTime = values[2];
+  model->sumBytesSquared = values[3];
+  model->sumBytesTime = values[4];
+  ioModel_fit(model, backend);
+  g_mutex_unlock(&model->mutex);
+}
+
+bool esdmI_performance_backendModel(esdm_backend_t* backend, double* out_latency, double* out_throughput) {
+  eassert(backend);
+  eassert(out_latency);
+  eassert(out_throughput);
+
+  esdmI_ioModel_t* model = &backend->ioModel;
+  g_mutex_lock(&model->mutex);
+  *out_latency = model->latency;
+  *out_throughput = model->throughput;
+  g_mutex_unlock(&model->mutex);
+  if(*out_throughput > 0) return true;
+  backendModelPrediction(backend, out_latency, out_throughput);
+  return false;
+}
+
+int64_t esdmI_backend_fragmentSize(esdm_backend_t* backend) {
+  eassert(backend);
+  if(!(backend->config->fragment_size_efficiency > 0)) return backend->config->max_fragment_size;
+
+  esdmI_ioModel_t* model = &backend->ioModel;
+  g_mutex_lock(&model->mutex);
+  int64_t result = model->fragmentSize;
+  g_mutex_unlock(&model->mutex);
+  if(result > 0) return result;
+
+  //nothing measured yet, use the configured performance model
+  double latency, throughput;
+  backendModelPrediction(backend, &latency, &throughput);
+  return fragmentSizeForEfficiency(latency, throughput, backend->config->fragment_size_efficiency, backend->config->max_fragment_size);
+}
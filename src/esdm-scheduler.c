@@ -36,6 +36,7 @@
 #define DEBUG(fmt, ...) ESDM_DEBUG_COM_FMT("SCHEDULER", fmt, __VA_ARGS__)
 
 static void backend_thread(io_work_t *data_p, esdm_backend_t *backend_id);
+static esdm_status readBlock(io_work_t *work, esdm_backend_t *backend);
 
 static esdm_readTimes_t gReadTimes = {0};
 static esdm_writeTimes_t gWriteTimes = {0};
@@ -63,6 +64,10 @@ esdm_scheduler_t *esdm_scheduler_init(esdm_instance_t *esdm) {
       b->threads = max_local;
     }
     DEBUG("Using %d threads for backend %s", b->threads, b->config->id);
+    atomic_init(&b->queuedBytes, 0);
+    atomic_init(&b->queuedOps, 0);
+    g_mutex_init(&b->ioModel.mutex);
+    esdmI_performance_loadBackendModel(esdm->modules->metadata_backend, b);
 
     if (b->threads == 0) {
       b->threadPool = NULL;
@@ -84,6 +89,8 @@ esdm_status esdm_scheduler_finalize(esdm_instance_t *esdm) {
       if (b->threadPool) {
         g_thread_pool_free(b->threadPool, 0, 1);
       }
+      esdmI_performance_storeBackendModel(esdm->modules->metadata_backend, b); //after the thread pool has finished all I/O
+      g_mutex_clear(&b->ioModel.mutex);
     }
   }
 
@@ -97,6 +104,24 @@ esdm_status esdm_scheduler_finalize(esdm_instance_t *esdm) {
 
 static double gOutputTime = 0, gInputTime = 0;
 
+//Hand a task to the thread pool of its backend (or execute it synchronously if the backend has no threads),
+//keeping track of the amount of work that is queued on the backend.
+static void pushTask(io_work_t* task, esdm_backend_t* backend) {
+  switch(task->op) {
+    case ESDM_OP_WRITE_STREAM: task->queuedBytes = task->data.streamChunkSize; break;
+    case ESDM_OP_READ_BLOCK: task->queuedBytes = task->data.blockBytes; break;
+    default: task->queuedBytes = task->fragment->bytes;
+  }
+  atomic_fetch_add(&backend->queuedBytes, task->queuedBytes);
+  atomic_fetch_add(&backend->queuedOps, 1);
+  if (backend->threads == 0) {
+    backend_thread(task, backend);
+  } else {
+    GError *error;
+    g_thread_pool_push(backend->threadPool, task, &error);
+  }
+}
+
 static void backend_thread(io_work_t *work, esdm_backend_t *backend) {
   io_request_status_t *status = work->parent;
 
@@ -106,19 +131,43 @@ static void backend_thread(io_work_t *work, esdm_backend_t *backend) {
 
   eassert(backend == work->fragment->backend);
 
+  //only operations that actually touch the storage are relevant for the performance model
+  bool isBackendIo;
+  switch (work->op) {
+    case (ESDM_OP_READ): isBackendIo = work->fragment->status == ESDM_DATA_NOT_LOADED; break;
+    case (ESDM_OP_WRITE): isBackendIo = work->fragment->status == ESDM_DATA_DIRTY; break;
+    case (ESDM_OP_WRITE_STREAM): isBackendIo = true; break;
+    case (ESDM_OP_READ_BLOCK): isBackendIo = work->data.block >= 0; break;  //the block table is too small to tell anything about the throughput
+    default: isBackendIo = false;
+  }
   esdm_status ret;
   switch (work->op) {
     case (ESDM_OP_READ): {
-      ret = esdm_fragment_load(work->fragment);
+      if(work->fragment->status == ESDM_DATA_DIRTY) {
+        ret = ESDM_SUCCESS; //same as esdm_fragment_load(), the data is already in memory
+      } else {
+        bool cacheHit;
+        ret = esdmI_fragment_retrieve(work->fragment, &cacheHit);
+        if(cacheHit) isBackendIo = false;
+      }
       break;
     }
     case (ESDM_OP_WRITE): {
       ret = esdm_fragment_commit(work->fragment);
       break;
     }
+    case (ESDM_OP_WRITE_STREAM): {
+      ret = esdmI_backend_fragment_write_stream_blocksize(backend, work->data.streamState, work->data.mem_buf, work->data.streamChunkOffset, work->data.streamChunkSize);
+      break;
+    }
+    case (ESDM_OP_READ_BLOCK): {
+      ret = readBlock(work, backend);
+      break;
+    }
     default:
       ret = ESDM_ERROR;
   }
+  if (ret == ESDM_SUCCESS && isBackendIo) esdmI_performance_recordBackendIo(backend, work->queuedBytes, ea_stop_timer(myTimer));
 
   work->return_code = ret;
 
@@ -128,6 +177,9 @@ static void backend_thread(io_work_t *work, esdm_backend_t *backend) {
 
   double localTime = ea_stop_timer(myTimer);
 
+  atomic_fetch_sub(&backend->queuedBytes, work->queuedBytes);
+  atomic_fetch_sub(&backend->queuedOps, 1);
+
   g_mutex_lock(&status->mutex);
   // Please note the return value from atomic_fetch_sub() is the original
   // value stored in atomic object. Here, it's the value before subtraction.
@@ -141,8 +193,10 @@ static void backend_thread(io_work_t *work, esdm_backend_t *backend) {
   }
 
   switch (work->op) {
-    case (ESDM_OP_READ): gInputTime += localTime; break;
-    case (ESDM_OP_WRITE): gOutputTime += localTime; break;
+    case (ESDM_OP_READ):
+    case (ESDM_OP_READ_BLOCK): gInputTime += localTime; break;
+    case (ESDM_OP_WRITE):
+    case (ESDM_OP_WRITE_STREAM): gOutputTime += localTime; break;
   }
   g_mutex_unlock(&status->mutex);
   //esdm_dataspace_destroy(work->fragment->dataspace);
@@ -366,6 +420,31 @@ static void read_copy_callback(io_work_t *work) {
   esdm_dataspace_copy_data(work->fragment->dataspace, work->fragment->buf, work->data.buf_space, work->data.mem_buf);
 }
 
+static void read_fanout_callback(io_work_t *work) {
+  if (work->return_code != ESDM_SUCCESS) {
+    DEBUG("Error reading from fragment ", work->fragment);
+  } else {
+    for(int64_t i = 0; i < work->data.destCount; i++) {
+      esdm_dataspace_copy_data(work->fragment->dataspace, work->fragment->buf, work->data.buf_spaces[i], work->data.mem_bufs[i]);
+    }
+  }
+  free(work->data.mem_bufs);
+  free(work->data.buf_spaces);
+}
+
+static void read_gather_callback(io_work_t *work) {
+  if (work->return_code != ESDM_SUCCESS) {
+    DEBUG("Error reading from fragment ", work->fragment);
+    return;
+  }
+  int64_t elementSize = esdm_sizeof(work->fragment->dataspace->type);
+  const char* source = work->fragment->buf;
+  char* dest = work->data.mem_buf;
+  for(int64_t i = 0; i < work->data.pointCount; i++) {
+    memcpy(dest + work->data.pointOffsets[2*i + 1], source + work->data.pointOffsets[2*i], elementSize);
+  }
+}
+
 static void buffer_cleanup_callback(io_work_t *work) {
   if (work->return_code != ESDM_SUCCESS) {
     DEBUG("Error reading from fragment ", work->fragment);
@@ -374,6 +453,157 @@ static void buffer_cleanup_callback(io_work_t *work) {
   work->return_code = esdm_fragment_unload(work->fragment); //get rid of the reference to user supplied data to avoid UB
 }
 
+// Block reads ////////////////////////////////////////////////////////////////
+
+//Protects the `blocks` and `notBlocked` members of all fragments.
+static GMutex gBlockTableMutex;
+
+//Whether a read that copies the fragment's data to `space` should only fetch the blocks it needs.
+//That is the case if the fragment is stored compressed by a backend that can read parts of it, and only a part of its data is needed.
+static bool readBlockwise(esdm_fragment_t *f, esdm_dataspace_t *space) {
+  if(f->status != ESDM_DATA_NOT_LOADED || f->actual_bytes == (size_t)-1 || !f->backend->callbacks.fragment_retrieve_range) return false;
+  g_mutex_lock(&gBlockTableMutex);
+  bool notBlocked = f->notBlocked;
+  g_mutex_unlock(&gBlockTableMutex);
+  if(notBlocked) return false;
+
+  eassert(f->dataspace->dims == space->dims);
+  int64_t neededElements = 1;
+  for(int64_t i = 0; i < space->dims; i++) {
+    int64_t start = f->dataspace->offset[i] > space->offset[i] ? f->dataspace->offset[i] : space->offset[i];
+    int64_t end = min_int64(f->dataspace->offset[i] + f->dataspace->size[i], space->offset[i] + space->size[i]);
+    if(end <= start) return false;
+    neededElements *= end - start;
+  }
+  return neededElements < (int64_t)f->elements;
+}
+
+//Returns the block table of a compressed fragment, reading it from the backend if necessary.
+//`*out_blocks` is set to NULL if the fragment's data cannot be read blockwise.
+static esdm_status fragment_blockTable(esdm_fragment_t *f, esdmI_codecBlocks_t **out_blocks) {
+  g_mutex_lock(&gBlockTableMutex);
+  esdmI_codecBlocks_t *blocks = f->blocks;
+  bool notBlocked = f->notBlocked;
+  g_mutex_unlock(&gBlockTableMutex);
+  if(blocks || notBlocked) {
+    *out_blocks = blocks;
+    return ESDM_SUCCESS;
+  }
+
+  //read the fixed part of the header first, it tells us the size of the block table
+  int64_t storedBytes = f->actual_bytes;
+  int64_t headerBytes = min_int64(esdmI_codec_blockPrefixBytes, storedBytes);
+  char *header = ea_checked_malloc(headerBytes ? headerBytes : 1);
+  esdm_status ret = esdmI_backend_fragment_retrieve_range(f->backend, f, 0, headerBytes, header);
+  int64_t tableBytes = ret == ESDM_SUCCESS ? esdmI_codec_blockHeaderSize(header, headerBytes) : -1;
+  if(tableBytes > headerBytes && tableBytes <= storedBytes) {
+    header = ea_checked_realloc(header, tableBytes);
+    ret = esdmI_backend_fragment_retrieve_range(f->backend, f, headerBytes, tableBytes - headerBytes, header + headerBytes);
+    headerBytes = tableBytes;
+  }
+  if(ret == ESDM_SUCCESS && tableBytes >= 0) {
+    ret = esdmI_codec_parseBlocks(header, headerBytes, storedBytes, f->dataspace->dims, f->dataspace->size, &blocks);
+    //the blocks are only hypercubes if all dimensions before the split dimension have size one
+    for(int64_t i = 0; ret == ESDM_SUCCESS && blocks && i < blocks->splitDim; i++) {
+      if(f->dataspace->size[i] != 1) {
+        free(blocks);
+        blocks = NULL;
+      }
+    }
+  }
+  free(header);
+  if(ret != ESDM_SUCCESS) return ret;
+
+  g_mutex_lock(&gBlockTableMutex);
+  if(f->blocks) {
+    //another read was faster
+    free(blocks);
+    blocks = f->blocks;
+  } else {
+    f->blocks = blocks;
+    f->notBlocked = !blocks;
+  }
+  g_mutex_unlock(&gBlockTableMutex);
+  *out_blocks = blocks;
+  return ESDM_SUCCESS;
+}
+
+static int64_t blockRows(esdm_fragment_t *f, esdmI_codecBlocks_t *blocks, int64_t block) {
+  return min_int64(blocks->rowsPerBlock, f->dataspace->size[blocks->splitDim] - block*blocks->rowsPerBlock);
+}
+
+//Pushes one ESDM_OP_READ_BLOCK task for each block of the fragment that intersects `buf_space`.
+static void pushBlockReads(io_request_status_t *status, esdm_fragment_t *f, esdmI_codecBlocks_t *blocks, void *buf, esdm_dataspace_t *buf_space) {
+  int64_t dim = blocks->splitDim;
+  int64_t fragmentStart = f->dataspace->offset[dim];
+  int64_t start = buf_space->offset[dim] > fragmentStart ? buf_space->offset[dim] : fragmentStart;
+  int64_t end = min_int64(fragmentStart + f->dataspace->size[dim], buf_space->offset[dim] + buf_space->size[dim]);
+  if(end <= start) return;
+  int64_t firstBlock = (start - fragmentStart)/blocks->rowsPerBlock, lastBlock = (end - 1 - fragmentStart)/blocks->rowsPerBlock;
+  int64_t rowBytes = f->bytes/f->dataspace->size[dim];
+
+  //account for all tasks before the first one can complete
+  atomic_fetch_add(&status->pending_ops, lastBlock - firstBlock + 1);
+  for(int64_t block = firstBlock; block <= lastBlock; block++) {
+    io_work_t *task = ea_checked_calloc(1, sizeof(*task));
+    task->parent = status;
+    task->op = ESDM_OP_READ_BLOCK;
+    task->fragment = f;
+    task->data.mem_buf = buf;
+    task->data.buf_space = buf_space;
+    task->data.block = block;
+    task->data.blockBytes = blockRows(f, blocks, block)*rowBytes;
+    pushTask(task, f->backend);
+  }
+}
+
+//Executes an ESDM_OP_READ_BLOCK task.
+//For block -1, this reads the block table and pushes the tasks for the needed blocks,
+//or reads the entire fragment if its data is not block compressed.
+static esdm_status readBlock(io_work_t *work, esdm_backend_t *backend) {
+  esdm_fragment_t *f = work->fragment;
+  if(work->data.block < 0) {
+    esdmI_codecBlocks_t *blocks;
+    esdm_status ret = fragment_blockTable(f, &blocks);
+    if(ret != ESDM_SUCCESS) return ret;
+    if(blocks) {
+      pushBlockReads(work->parent, f, blocks, work->data.mem_buf, work->data.buf_space);
+    } else {
+      ret = esdmI_fragment_retrieve(f, NULL);
+      if(ret == ESDM_SUCCESS) esdm_dataspace_copy_data(f->dataspace, f->buf, work->data.buf_space, work->data.mem_buf);
+    }
+    return ret;
+  }
+
+  esdmI_codecBlocks_t *blocks = f->blocks;  //set before this task was pushed
+  int64_t block = work->data.block;
+  int64_t storedBytes = blocks->offsets[block + 1] - blocks->offsets[block];
+  char *stored = ea_checked_malloc(storedBytes ? storedBytes : 1);
+  esdm_status ret = esdmI_backend_fragment_retrieve_range(backend, f, blocks->offsets[block], storedBytes, stored);
+  char *raw = stored;
+  if(ret == ESDM_SUCCESS && storedBytes != work->data.blockBytes) {
+    raw = ea_checked_malloc(work->data.blockBytes ? work->data.blockBytes : 1);
+    ret = esdmI_codec_decodeBlock(stored, storedBytes, raw, work->data.blockBytes);
+  }
+  if(ret == ESDM_SUCCESS) {
+    int64_t dims = f->dataspace->dims, dim = blocks->splitDim;
+    int64_t size[dims], offset[dims];
+    memcpy(size, f->dataspace->size, sizeof(size));
+    memcpy(offset, f->dataspace->offset, sizeof(offset));
+    offset[dim] += block*blocks->rowsPerBlock;
+    size[dim] = blockRows(f, blocks, block);
+    esdm_dataspace_t *blockSpace;
+    ret = esdm_dataspace_subspace(f->dataspace, dims, size, offset, &blockSpace);
+    if(ret == ESDM_SUCCESS) {
+      ret = esdm_dataspace_copy_data(blockSpace, raw, work->data.buf_space, work->data.mem_buf);
+      esdm_dataspace_destroy(blockSpace);
+    }
+  }
+  if(raw != stored) free(raw);
+  free(stored);
+  return ret;
+}
+
 bool esdmI_scheduler_try_direct_io(esdm_fragment_t *f, void * buf, esdm_dataspace_t * da){
   if(f->dataspace->type != da->type){
     return FALSE;
@@ -398,8 +628,6 @@ bool esdmI_scheduler_try_direct_io(esdm_fragment_t *f, void * buf, esdm_dataspac
 }
 
 esdm_status esdm_scheduler_enqueue_read(esdm_instance_t *esdm, io_request_status_t *status, int frag_count, esdm_fragment_t **read_frag, void *buf, esdm_dataspace_t *buf_space) {
-  GError *error;
-
   atomic_fetch_add(&status->pending_ops, frag_count);
 
   for (int i = 0; i < frag_count; i++) {
@@ -410,7 +638,15 @@ esdm_status esdm_scheduler_enqueue_read(esdm_instance_t *esdm, io_request_status
     task->parent = status;
     task->op = ESDM_OP_READ;
     task->fragment = f;
-    if (esdmI_scheduler_try_direct_io(f, buf, buf_space)) {
+    if (readBlockwise(f, buf_space)) {
+      //only fetch and decompress the blocks that are needed, each on its own backend thread
+      task->op = ESDM_OP_READ_BLOCK;
+      task->callback = NULL;
+      task->data.mem_buf = buf;
+      task->data.buf_space = buf_space;
+      task->data.block = -1;
+      task->data.blockBytes = 0;
+    } else if (esdmI_scheduler_try_direct_io(f, buf, buf_space)) {
       task->callback = buffer_cleanup_callback;
     } else {
       //We cannot instruct the fragment to read the data directly into `buf` as we may only need a part of the fragment's data, and the overshoot may cause UB.
@@ -418,11 +654,7 @@ esdm_status esdm_scheduler_enqueue_read(esdm_instance_t *esdm, io_request_status
       task->data.mem_buf = buf;
       task->data.buf_space = buf_space;
     }
-    if (backend_to_use->threads == 0) {
-      backend_thread(task, backend_to_use);
-    } else {
-      g_thread_pool_push(backend_to_use->threadPool, task, &error);
-    }
+    pushTask(task, backend_to_use);
   }
 
   return ESDM_SUCCESS;
@@ -445,6 +677,10 @@ static void updateRequestStats(esdm_statistics_t* stats, uint64_t requestCount,
 }
 
 esdm_status esdmI_scheduler_readSingleFragmentBlocking(esdm_instance_t* esdm, esdm_dataset_t* dataset, void* buffer, esdm_dataspace_t* memspace, esdm_fragment_t* fragment) {
+  return esdmI_scheduler_readFragmentsBlocking(esdm, dataset, buffer, memspace, 1, &fragment);
+}
+
+esdm_status esdmI_scheduler_readFragmentsBlocking(esdm_instance_t* esdm, esdm_dataset_t* dataset, void* buffer, esdm_dataspace_t* memspace, int64_t count, esdm_fragment_t** fragments) {
   timer myTimer;
   ea_start_timer(&myTimer);
   esdm_readTimes_t myTimes = {0};
@@ -454,7 +690,7 @@ esdm_status esdmI_scheduler_readSingleFragmentBlocking(esdm_instance_t* esdm, es
   esdm_status ret = esdm_scheduler_status_init(&status);
   if(ret != ESDM_SUCCESS) return ret;
 
-  ret = esdm_scheduler_enqueue_read(esdm, &status, 1, &fragment, buffer, memspace);
+  ret = esdm_scheduler_enqueue_read(esdm, &status, count, fragments, buffer, memspace);
   eassert(ret == ESDM_SUCCESS);
   myTimes.enqueue = ea_stop_timer(myTimer) - startTime;
 
@@ -469,8 +705,9 @@ esdm_status esdmI_scheduler_readSingleFragmentBlocking(esdm_instance_t* esdm, es
   ret = status.return_code;
 
   //update the statistics
-  int64_t requestBytes = esdm_dataspace_total_bytes(memspace);
-  updateIoStats(&esdm->readStats, 1, requestBytes);
+  int64_t requestBytes = esdm_dataspace_total_bytes(memspace), ioBytes = 0;
+  for(int64_t i = 0; i < count; i++) ioBytes += esdm_dataspace_total_bytes(fragments[i]->dataspace);
+  updateIoStats(&esdm->readStats, count, ioBytes);
   updateRequestStats(&esdm->readStats, 1, requestBytes, false);
 
   gReadTimes.enqueue += myTimes.enqueue;
@@ -480,6 +717,23 @@ esdm_status esdmI_scheduler_readSingleFragmentBlocking(esdm_instance_t* esdm, es
   return ret;
 }
 
+//Create a dataspace with stride zero (all logical elements are mapped to the one and only element in memory),
+//which allows to use a single fill value as the source of a copy operation.
+//Use esdmI_dataspace_setExtends() to select the region that is to be filled.
+static esdm_dataspace_t* makeFillSourceSpace(int64_t dimensions, esdm_type_t type) {
+  esdm_dataspace_t* sourceSpace;
+  int64_t size[dimensions], stride[dimensions];
+  for(int64_t i = 0; i < dimensions; i++) {
+    size[i] = INT64_MAX;
+    stride[i] = 0;
+  }
+  esdm_status ret = esdm_dataspace_create(dimensions, size, type, &sourceSpace);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_dataspace_set_stride(sourceSpace, stride);
+  eassert(ret == ESDM_SUCCESS);
+  return sourceSpace;
+}
+
 static esdm_status esdm_scheduler_enqueue_fill(esdm_instance_t* esdm, io_request_status_t* status, void* fillValue, void* buf, esdm_dataspace_t* bufSpace, esdmI_hypercubeList_t* fillRegion) {
   //I would really love to make the fill operation asynchronous.
   //However, it does not make any sense to use one of our backend threads, because the backends are concerned with storage, not with pure in-memory operations.
@@ -491,19 +745,7 @@ static esdm_status esdm_scheduler_enqueue_fill(esdm_instance_t* esdm, io_request
 
   esdm_status ret;
   int64_t dimensions = esdm_dataspace_get_dims(bufSpace);
-  esdm_type_t type = esdm_dataspace_get_type(bufSpace);
-
-  //create a dataspace with stride zero (all logical elements are mapped to the one and only element in memory) which we use as a source in the subsequent copy operations
-  esdm_dataspace_t* sourceSpace;
-  int64_t size[dimensions], stride[dimensions];
-  for(int64_t i = 0; i < dimensions; i++) {
-    size[i] = INT64_MAX;
-    stride[i] = 0;
-  }
-  ret = esdm_dataspace_create(dimensions, size, type, &sourceSpace);
-  eassert(ret == ESDM_SUCCESS);
-  ret = esdm_dataspace_set_stride(sourceSpace, stride);
-  eassert(ret == ESDM_SUCCESS);
+  esdm_dataspace_t* sourceSpace = makeFillSourceSpace(dimensions, esdm_dataspace_get_type(bufSpace));
 
   //for each hypercube in the set, copy the fill value to the corresponding bufSpace area
   for(int64_t i = 0; i < fillRegion->count; i++) {
@@ -524,12 +766,39 @@ static esdm_status esdm_scheduler_enqueue_fill(esdm_instance_t* esdm, io_request
   return ESDM_SUCCESS;
 }
 
+//Split the dataspace into a regular grid of hypercubes with `splitFactors[i]` cells along dimension `i`.
+static esdmI_hypercubeSet_t* splitSpace(esdm_dataspace_t* space, int64_t* splitFactors) {
+  esdmI_hypercubeSet_t* result = esdmI_hypercubeSet_make();
+  int64_t splitCoords[space->dims];
+  memset(splitCoords, 0, sizeof(splitCoords));
+  esdmI_hypercube_t* curCube = esdmI_hypercube_makeDefault(space->dims);
+  while(true) {
+    //set the current ranges
+    for(int64_t i = 0; i < space->dims; i++) {
+      curCube->ranges[i] = (esdmI_range_t){
+        .start = space->offset[i] + splitCoords[i]*space->size[i]/splitFactors[i],
+        .end = space->offset[i] + (splitCoords[i] + 1)*space->size[i]/splitFactors[i]
+      };
+    }
+
+    esdmI_hypercubeSet_add(result, curCube);
+
+    //update the split coords
+    int64_t updateDim;
+    for(updateDim = space->dims; updateDim--; ) {
+      if(++(splitCoords[updateDim]) < splitFactors[updateDim]) break;
+      splitCoords[updateDim] = 0;
+    }
+    if(updateDim < 0) break;
+  }
+  esdmI_hypercube_destroy(curCube);
+  return result;
+}
+
 //Implementation of `esdm_scheduler_makeSplitRecommendation()` that tries to produce fragments that are about as wide as high/long/deep/... .
 static esdmI_hypercubeSet_t* makeSplitRecommendation_balancedDims(esdm_dataspace_t* space, int64_t maxFragmentSize) {
   eassert(space);
 
-  esdmI_hypercubeSet_t* result = esdmI_hypercubeSet_make();
-
   //determine the count of splitable dimensions (length > 1)
   uint64_t splitDims = 0;
   for(int64_t i = 0; i < space->dims; i++) {
@@ -537,6 +806,7 @@ static esdmI_hypercubeSet_t* makeSplitRecommendation_balancedDims(esdm_dataspace
   }
   if(!splitDims) {
     //only a single element, use a trivial recommendation
+    esdmI_hypercubeSet_t* result = esdmI_hypercubeSet_make();
     esdmI_hypercube_t* cube;
     esdmI_dataspace_getExtends(space, &cube);
     esdmI_hypercubeSet_add(result, cube);
@@ -554,31 +824,20 @@ static esdmI_hypercubeSet_t* makeSplitRecommendation_balancedDims(esdm_dataspace
     eassert(splitFactors[i] <= space->size[i]);
   }
 
-  //create the split hypercubes
-  int64_t splitCoords[space->dims];
-  memset(splitCoords, 0, sizeof(splitCoords));
-  esdmI_hypercube_t* curCube = esdmI_hypercube_makeDefault(space->dims);
-  while(true) {
-    //set the current ranges
-    for(int64_t i = 0; i < space->dims; i++) {
-      curCube->ranges[i] = (esdmI_range_t){
-        .start = space->offset[i] + splitCoords[i]*space->size[i]/splitFactors[i],
-        .end = space->offset[i] + (splitCoords[i] + 1)*space->size[i]/splitFactors[i]
-      };
-    }
+  return splitSpace(space, splitFactors);
+}
 
-    esdmI_hypercubeSet_add(result, curCube);
+//Implementation of `esdm_scheduler_makeSplitRecommendation()` that produces fragments of the given shape (or slightly smaller ones).
+static esdmI_hypercubeSet_t* makeSplitRecommendation_fixedShape(esdm_dataspace_t* space, int64_t* edges) {
+  eassert(space);
+  eassert(edges);
 
-    //update the split coords
-    int64_t updateDim;
-    for(updateDim = space->dims; updateDim--; ) {
-      if(++(splitCoords[updateDim]) < splitFactors[updateDim]) break;
-      splitCoords[updateDim] = 0;
-    }
-    if(updateDim < 0) break;
+  int64_t splitFactors[space->dims];
+  for(int64_t i = 0; i < space->dims; i++) {
+    eassert(edges[i] >= 1);
+    splitFactors[i] = space->size[i] ? (space->size[i] + edges[i] - 1)/edges[i] : 1;
   }
-  esdmI_hypercube_destroy(curCube);
-  return result;
+  return splitSpace(space, splitFactors);
 }
 
 struct dimInfo_t {
@@ -669,33 +928,36 @@ static esdmI_hypercubeSet_t* makeSplitRecommendation_contiguousFragments(esdm_da
 
 //Decide how the given dataset should be split into fragments to get sensible fragment sizes.
 //Returns a hypercube set with one hypercube for each fragment that should be generated.
-esdmI_hypercubeSet_t* esdm_scheduler_makeSplitRecommendation(esdm_dataspace_t* space, esdm_backend_t* backend) {
+//If enough reads have been recorded for the dataset, the fragment shape is chosen to minimize the expected read amplification,
+//otherwise the fragmentation method of the backend is used.
+esdmI_hypercubeSet_t* esdm_scheduler_makeSplitRecommendation(esdm_dataset_t* dataset, esdm_dataspace_t* space, esdm_backend_t* backend) {
+  int64_t fragmentSize = esdmI_backend_fragmentSize(backend);
+  if(dataset) {
+    int64_t edges[space->dims];
+    if(esdmI_accessPattern_fragmentShape(&dataset->accessPattern, space, fragmentSize, edges)) return makeSplitRecommendation_fixedShape(space, edges);
+  }
+
   switch(backend->config->fragmentation_method) {
     case ESDMI_FRAGMENTATION_METHOD_EQUALIZED:
-      return makeSplitRecommendation_balancedDims(space, backend->config->max_fragment_size);
+      return makeSplitRecommendation_balancedDims(space, fragmentSize);
     case ESDMI_FRAGMENTATION_METHOD_CONTIGUOUS:
-      return makeSplitRecommendation_contiguousFragments(space, backend->config->max_fragment_size);
+      return makeSplitRecommendation_contiguousFragments(space, fragmentSize);
   }
   fprintf(stderr, "fatal error: memory corruption detected: backend->config->fragmentation contains broken data\n");
   abort();
 }
 
-// Split the given dataspace into sub-hypercubes, one for each given backend, matching the size of the sub-hypercubes to the estimated throughput of the respective backend.
+// Split the given dataspace into sub-hypercubes, one for each given backend, matching the size of the sub-hypercubes to the share of the data that is recommended for the respective backend.
 //
 // `out_backendExtends` is a pointer to an uninitialized array of hypercube pointers on entry,
 // this function will either create a hypercube for each entry or set it to NULL to signal that the respective backend should not be used.
-static void splitToBackends(esdm_dataspace_t* space, int64_t backendCount, esdm_backend_t** backends, esdmI_hypercube_t** out_backendExtends) {
+static void splitToBackends(esdm_dataspace_t* space, int64_t backendCount, double* shares, esdmI_hypercube_t** out_backendExtends) {
   eassert(space);
   eassert(backendCount > 0);
-  eassert(backends);
+  eassert(shares);
   eassert(out_backendExtends);
 
-  //get some input data
-  float* weights = ea_checked_malloc(backendCount*sizeof(*weights));
-  for (int64_t i = 0; i < backendCount; i++) {
-    if (backends[i]->callbacks.estimate_throughput != NULL)
-      weights[i] = esdmI_backend_estimate_throughput(backends[i]);
-  }
+  double* weights = ea_memdup(shares, backendCount*sizeof(*weights));
 
   int64_t dims = esdm_dataspace_get_dims(space);
   int64_t stride[dims];
@@ -721,18 +983,18 @@ static void splitToBackends(esdm_dataspace_t* space, int64_t backendCount, esdm_
 
     //determine the ranges for the different backends
     for(int64_t i = 1; i < backendCount; i++) weights[i] += weights[i-1]; //make weights cumulative
-    float totalWeight = weights[backendCount-1];
+    double totalWeight = weights[backendCount-1];
     int64_t* bounds = ea_checked_malloc((backendCount + 1)*sizeof(*bounds));
     bounds[0] = totalExtends->ranges[bestDim].start;
     bounds[backendCount] = totalExtends->ranges[bestDim].end;
     int64_t size = esdmI_range_size(totalExtends->ranges[bestDim]);
-    for(int64_t i = 1; i < backendCount; i++) bounds[i] = (int64_t)roundf(weights[i-1]*size/totalWeight) + bounds[0];
+    for(int64_t i = 1; i < backendCount; i++) bounds[i] = (int64_t)round(weights[i-1]*size/totalWeight) + bounds[0];
 
     //create the respective hypercubes
     for(int64_t i = 0; i < backendCount; i++) {
       eassert(bounds[i] <= bounds[i+1]);
       if(bounds[i] == bounds[i+1]) {
-        out_backendExtends = NULL;
+        out_backendExtends[i] = NULL;
       } else {
         esdmI_hypercube_t* curCube = esdmI_hypercube_makeCopy(totalExtends);
         curCube->ranges[bestDim] = (esdmI_range_t){
@@ -746,9 +1008,9 @@ static void splitToBackends(esdm_dataspace_t* space, int64_t backendCount, esdm_
     //cleanup
     free(bounds);
   } else {
-    //no suitable split dim found, assign the entire dataspace to the fastest backend
+    //no suitable split dim found, assign the entire dataspace to the backend with the largest share
     int64_t bestBackend = -1;
-    float bestWeight = 0;
+    double bestWeight = 0;
     for(int64_t i = 0; i < backendCount; i++) {
       if(bestWeight <= weights[i]) {
         bestWeight = weights[i];
@@ -777,10 +1039,12 @@ esdm_status esdm_scheduler_enqueue_write(esdm_instance_t *esdm, io_request_statu
   //esdm_performance_recommendation(esdm, NULL, NULL);    // e.g., split, merge, replication?
   //esdm_layout_recommendation(esdm, NULL, NULL);		  // e.g., merge, split, transform?
   int64_t backendCount;
-  esdm_backend_t** backends = esdm_modules_makeBackendRecommendation(esdm->modules, space, &backendCount, NULL);
+  double* shares;
+  esdm_backend_t** backends = esdm_modules_makeBackendRecommendation(esdm->modules, space, &backendCount, NULL, &shares);
   eassert(backends);
   esdmI_hypercube_t** backendExtends = ea_checked_malloc(backendCount*sizeof(*backendExtends));
-  splitToBackends(space, backendCount, backends, backendExtends);
+  splitToBackends(space, backendCount, shares, backendExtends);
+  free(shares);
   gWriteTimes.backendDistribution += startTime = ea_stop_timer(myTimer);
   for(int64_t backendIndex = 0; backendIndex < backendCount; backendIndex++) {
     esdmI_hypercube_t* curExtends = backendExtends[backendIndex];
@@ -795,7 +1059,7 @@ esdm_status esdm_scheduler_enqueue_write(esdm_instance_t *esdm, io_request_statu
     eassert(ret == ESDM_SUCCESS);
     ret = esdm_dataspace_copyDatalayout(backendSpace, space);
     eassert(ret == ESDM_SUCCESS);
-    esdmI_hypercubeSet_t* cubes = esdm_scheduler_makeSplitRecommendation(backendSpace, curBackend);
+    esdmI_hypercubeSet_t* cubes = esdm_scheduler_makeSplitRecommendation(dataset, backendSpace, curBackend);
     esdmI_hypercubeList_t* cubeList = esdmI_hypercubeSet_list(cubes);
     esdm_dataspace_destroy(backendSpace);
 
@@ -846,12 +1110,7 @@ void esdmI_scheduler_writeFragmentNonblocking(esdm_instance_t* esdm, esdm_fragme
   };
 
   atomic_fetch_add(&status->pending_ops, 1);
-  if (backend->threads == 0) {
-    backend_thread(task, backend);
-  } else {
-    GError *error;
-    g_thread_pool_push(backend->threadPool, task, &error);
-  }
+  pushTask(task, backend);
 
   int64_t byteCount = esdm_dataspace_total_bytes(fragment->dataspace);
   updateIoStats(&esdm->writeStats, 1, byteCount);
@@ -862,14 +1121,43 @@ void esdmI_scheduler_writeFragmentNonblocking(esdm_instance_t* esdm, esdm_fragme
   gWriteTimes.total += endTime;
 }
 
+void esdmI_scheduler_writeStreamChunkNonblocking(esdm_instance_t* esdm, esdm_backend_t* backend, estream_write_t* state, void* buffer, int64_t offset, int64_t size, void (*callback)(io_work_t* work), void* owner, io_request_status_t* status) {
+  eassert(state && state->fragment);
+  eassert(state->fragment->backend == backend);
+
+  io_work_t* task = ea_checked_malloc(sizeof(*task));
+  *task = (io_work_t){
+    .fragment = state->fragment,
+    .op = ESDM_OP_WRITE_STREAM,
+    .return_code = ESDM_SUCCESS,
+    .parent = status,
+    .callback = callback,
+    .data = {
+      .mem_buf = buffer,
+      .streamState = state,
+      .streamChunkOffset = offset,
+      .streamChunkSize = size,
+      .streamOwner = owner
+    }
+  };
+  atomic_fetch_add(&status->pending_ops, 1);
+  updateIoStats(&esdm->writeStats, offset == 0, size);  //count each fragment with its first chunk
+  pushTask(task, backend);
+}
+
 esdm_status esdmI_scheduler_writeFragmentBlocking(esdm_instance_t* esdm, esdm_fragment_t* fragment, bool requestIsInternal) {
+  return esdmI_scheduler_writeFragmentsBlocking(esdm, 1, &fragment, requestIsInternal);
+}
+
+esdm_status esdmI_scheduler_writeFragmentsBlocking(esdm_instance_t* esdm, int64_t count, esdm_fragment_t** fragments, bool requestIsInternal) {
   ESDM_DEBUG(__func__);
 
   io_request_status_t status;
   esdm_status ret = esdm_scheduler_status_init(&status);
   eassert(ret == ESDM_SUCCESS);
 
-  esdmI_scheduler_writeFragmentNonblocking(esdm, fragment, requestIsInternal, &status);
+  //all fragments share the same request status, so that they are written in parallel and we only need to wait once
+  for(int64_t i = 0; i < count; i++) esdmI_scheduler_writeFragmentNonblocking(esdm, fragments[i], requestIsInternal, &status);
 
   //esdmI_scheduler_writeFragmentNonblocking() has its own internal time measurement which already adds to the total write time, so it must must be excluded from our time measurement
   timer myTimer;
@@ -940,6 +1228,728 @@ esdm_status esdm_scheduler_write_blocking(esdm_instance_t *esdm, esdm_dataset_t
 }
 
 
+esdm_status esdm_scheduler_write_multi_blocking(esdm_instance_t *esdm, esdm_dataset_t *dataset, int64_t count, void **bufs, esdm_dataspace_t **subspaces, bool requestIsInternal) {
+  ESDM_DEBUG(__func__);
+
+  timer myTimer;
+  ea_start_timer(&myTimer);
+
+  io_request_status_t status;
+  esdm_status ret = esdm_scheduler_status_init(&status);
+  eassert(ret == ESDM_SUCCESS);
+
+  //all regions share the same request status, so that we only need to wait once
+  for(int64_t i = 0; i < count; i++) {
+    ret = esdm_scheduler_enqueue_write(esdm, &status, dataset, bufs[i], subspaces[i], requestIsInternal); //This function does its own internal time measurements.
+    if(ret != ESDM_SUCCESS) break;
+  }
+  double syncStartTime = ea_stop_timer(myTimer);
+
+  //we must wait for the already enqueued writes even if enqueuing failed for some region
+  esdm_status waitRet = esdm_scheduler_wait(&status);
+  eassert(waitRet == ESDM_SUCCESS);
+  waitRet = esdm_scheduler_status_finalize(&status);
+  eassert(waitRet == ESDM_SUCCESS);
+  double endTime = ea_stop_timer(myTimer);
+
+  gWriteTimes.completion += endTime - syncStartTime;
+  gWriteTimes.total += endTime;
+
+  return ret != ESDM_SUCCESS ? ret : status.return_code;
+}
+
+//The destinations that need the data of a single fragment during a multi-region read.
+typedef struct readDestinations_t {
+  int64_t count, allocatedCount;
+  void **bufs;
+  esdm_dataspace_t **spaces;
+} readDestinations_t;
+
+static void readDestinations_destroy(gpointer data) {
+  readDestinations_t* destinations = data;
+  free(destinations->bufs);
+  free(destinations->spaces);
+  free(destinations);
+}
+
+static void readDestinations_add(readDestinations_t* destinations, void* buf, esdm_dataspace_t* space) {
+  if(destinations->count == destinations->allocatedCount) {
+    destinations->allocatedCount = destinations->allocatedCount ? 2*destinations->allocatedCount : 4;
+    destinations->bufs = ea_checked_realloc(destinations->bufs, destinations->allocatedCount*sizeof(*destinations->bufs));
+    destinations->spaces = ea_checked_realloc(destinations->spaces, destinations->allocatedCount*sizeof(*destinations->spaces));
+  }
+  destinations->bufs[destinations->count] = buf;
+  destinations->spaces[destinations->count] = space;
+  destinations->count++;
+}
+
+esdm_status esdm_scheduler_read_multi_blocking(esdm_instance_t *esdm, esdm_dataset_t *dataset, int64_t count, void **bufs, esdm_dataspace_t **subspaces, bool requestIsInternal) {
+  ESDM_DEBUG(__func__);
+
+  timer myTimer;
+  ea_start_timer(&myTimer);
+  esdm_readTimes_t myTimes = {0};
+  double startTime; //reused for the different individual measurements
+
+  if(!count) return ESDM_SUCCESS;
+
+  io_request_status_t status;
+  esdm_status ret = esdm_scheduler_status_init(&status);
+  eassert(ret == ESDM_SUCCESS);
+
+  //Collect the fragments of all regions, remembering for each fragment which regions need its data.
+  //The fragments are also kept in a separate array to get a deterministic order of the I/O tasks.
+  startTime = ea_stop_timer(myTimer);
+  GHashTable* fragmentDestinations = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, readDestinations_destroy);
+  int64_t uniqueCount = 0, uniqueAllocatedCount = 16;
+  esdm_fragment_t** uniqueFragments = ea_checked_malloc(uniqueAllocatedCount*sizeof(*uniqueFragments));
+  int64_t requestBytes = 0, ioBytes = 0, incompleteRegions = 0;
+  esdmI_hypercubeSet_t** uncovered = ea_checked_malloc(count*sizeof(*uncovered));
+  for(int64_t i = 0; i < count; i++) {
+    int64_t fragmentCount;
+    esdm_fragment_t** fragments;
+    bool dataIsComplete;
+    esdmI_hypercube_t* readExtends;
+    esdmI_dataspace_getExtends(subspaces[i], &readExtends);
+    esdmI_dataset_fragmentsCoveringRegion(dataset, readExtends, &fragmentCount, &fragments, &uncovered[i], &dataIsComplete);
+    if(!requestIsInternal) esdmI_accessPattern_recordRead(&dataset->accessPattern, readExtends);
+    esdmI_hypercube_destroy(readExtends);
+    if(!dataIsComplete) incompleteRegions++;
+
+    for(int64_t j = 0; j < fragmentCount; j++) {
+      readDestinations_t* destinations = g_hash_table_lookup(fragmentDestinations, fragments[j]);
+      if(!destinations) {
+        destinations = ea_checked_malloc(sizeof(*destinations));
+        *destinations = (readDestinations_t){0};
+        g_hash_table_insert(fragmentDestinations, fragments[j], destinations);
+        if(uniqueCount == uniqueAllocatedCount) uniqueFragments = ea_checked_realloc(uniqueFragments, (uniqueAllocatedCount *= 2)*sizeof(*uniqueFragments));
+        uniqueFragments[uniqueCount++] = fragments[j];
+        ioBytes += esdm_dataspace_total_bytes(fragments[j]->dataspace);
+      }
+      readDestinations_add(destinations, bufs[i], subspaces[i]);
+    }
+    free(fragments);
+    requestBytes += esdm_dataspace_total_bytes(subspaces[i]);
+  }
+  DEBUG("%"PRId64" regions need %"PRId64" distinct fragments", count, uniqueCount);
+  myTimes.makeSet = ea_stop_timer(myTimer) - startTime;
+
+  //fill the data holes, if possible
+  startTime = ea_stop_timer(myTimer);
+  if(incompleteRegions) {
+    esdm_type_t type = esdm_dataset_get_type(dataset);
+    char fillValue[esdm_sizeof(type)];
+    ret = esdm_dataset_get_fill_value(dataset, fillValue);
+    if(ret == ESDM_SUCCESS) {
+      for(int64_t i = 0; i < count && ret == ESDM_SUCCESS; i++) {
+        eassert(esdm_dataspace_get_type(subspaces[i]) == type);  //TODO handle the case that the two types don't match
+        if(!esdmI_hypercubeSet_isEmpty(uncovered[i])) ret = esdm_scheduler_enqueue_fill(esdm, &status, fillValue, bufs[i], subspaces[i], esdmI_hypercubeSet_list(uncovered[i]));
+      }
+    } else {
+      ret = ESDM_INCOMPLETE_DATA; //no fill value set, so we error out
+    }
+  }
+  myTimes.coverageCheck = ea_stop_timer(myTimer) - startTime;
+
+  if(ret == ESDM_SUCCESS) {
+    //load each fragment once, and copy its data to all the regions that need it
+    startTime = ea_stop_timer(myTimer);
+    atomic_fetch_add(&status.pending_ops, uniqueCount);
+    for(int64_t i = 0; i < uniqueCount; i++) {
+      esdm_fragment_t* fragment = uniqueFragments[i];
+      readDestinations_t* destinations = g_hash_table_lookup(fragmentDestinations, fragment);
+
+      io_work_t* task = ea_checked_malloc(sizeof(*task));
+      *task = (io_work_t){
+        .fragment = fragment,
+        .op = ESDM_OP_READ,
+        .return_code = ESDM_SUCCESS,
+        .parent = &status,
+        .callback = read_fanout_callback
+      };
+      if(destinations->count == 1 && esdmI_scheduler_try_direct_io(fragment, destinations->bufs[0], destinations->spaces[0])) {
+        task->callback = buffer_cleanup_callback;
+      } else {
+        //pass the destination arrays on to the callback
+        task->data.destCount = destinations->count;
+        task->data.mem_bufs = destinations->bufs;
+        task->data.buf_spaces = destinations->spaces;
+        destinations->bufs = NULL;
+        destinations->spaces = NULL;
+      }
+      pushTask(task, fragment->backend);
+    }
+    myTimes.enqueue = ea_stop_timer(myTimer) - startTime;
+
+    startTime = ea_stop_timer(myTimer);
+    ret = esdm_scheduler_wait(&status);
+    eassert(ret == ESDM_SUCCESS);
+    myTimes.completion = ea_stop_timer(myTimer) - startTime;
+
+    ret = status.return_code;
+
+    //update the statistics
+    updateIoStats(&esdm->readStats, uniqueCount, ioBytes);
+    updateRequestStats(&esdm->readStats, count, requestBytes, requestIsInternal);
+  }
+  esdm_status finalizeRet = esdm_scheduler_status_finalize(&status);
+  eassert(finalizeRet == ESDM_SUCCESS);
+
+  //cleanup
+  for(int64_t i = 0; i < count; i++) esdmI_hypercubeSet_destroy(uncovered[i]);
+  free(uncovered);
+  free(uniqueFragments);
+  g_hash_table_destroy(fragmentDestinations);
+  myTimes.total = ea_stop_timer(myTimer);
+
+  gReadTimes.makeSet += myTimes.makeSet;
+  gReadTimes.coverageCheck += myTimes.coverageCheck;
+  gReadTimes.enqueue += myTimes.enqueue;
+  gReadTimes.completion += myTimes.completion;
+  gReadTimes.total += myTimes.total;
+
+  return ret;
+}
+
+//Index to find a fragment that contains a given point.
+//The fragments are sorted by their start in the first dimension, so that we only need to check those fragments that start less than maxEdge elements before the point.
+//Consecutive points are usually close to each other, so we first check the fragment that contained the last point.
+typedef struct pointIndex_t {
+  int64_t dims, count, maxEdge, lastHit;
+  esdm_fragment_t** fragments;
+} pointIndex_t;
+
+static int compareFragmentStart(const void* aVoid, const void* bVoid) {
+  esdm_fragment_t* a = *(esdm_fragment_t* const*)aVoid, *b = *(esdm_fragment_t* const*)bVoid;
+  return a->dataspace->offset[0] < b->dataspace->offset[0] ? -1 : a->dataspace->offset[0] > b->dataspace->offset[0] ? 1 : 0;
+}
+
+static bool fragmentContainsPoint(esdm_fragment_t* fragment, const int64_t* point) {
+  esdm_dataspace_t* space = fragment->dataspace;
+  for(int64_t d = 0; d < space->dims; d++) {
+    if(point[d] < space->offset[d] || point[d] >= space->offset[d] + space->size[d]) return false;
+  }
+  return true;
+}
+
+//takes possession of the fragments array
+static void pointIndex_init(pointIndex_t* me, int64_t dims, int64_t count, esdm_fragment_t** fragments) {
+  *me = (pointIndex_t){
+    .dims = dims,
+    .count = count,
+    .maxEdge = 0,
+    .lastHit = -1,
+    .fragments = fragments
+  };
+  if(!dims) return;
+  qsort(fragments, count, sizeof(*fragments), compareFragmentStart);
+  for(int64_t i = 0; i < count; i++) {
+    if(fragments[i]->dataspace->size[0] > me->maxEdge) me->maxEdge = fragments[i]->dataspace->size[0];
+  }
+}
+
+//returns the index of a fragment that contains the point, or -1 if there is none
+static int64_t pointIndex_find(pointIndex_t* me, const int64_t* point) {
+  if(me->lastHit >= 0 && fragmentContainsPoint(me->fragments[me->lastHit], point)) return me->lastHit;
+  if(!me->dims) return me->lastHit = me->count ? 0 : -1;
+
+  //binary search for the first fragment that starts behind the point, then walk backwards
+  int64_t low = 0, high = me->count;
+  while(low < high) {
+    int64_t middle = low + (high - low)/2;
+    if(me->fragments[middle]->dataspace->offset[0] <= point[0]) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  for(int64_t i = low; i--; ) {
+    if(me->fragments[i]->dataspace->offset[0] + me->maxEdge <= point[0]) break;
+    if(fragmentContainsPoint(me->fragments[i], point)) return me->lastHit = i;
+  }
+  return -1;
+}
+
+esdm_status esdm_scheduler_read_points_blocking(esdm_instance_t *esdm, esdm_dataset_t *dataset, int64_t count, const int64_t *coords, void *buf, bool requestIsInternal) {
+  ESDM_DEBUG(__func__);
+
+  timer myTimer;
+  ea_start_timer(&myTimer);
+  esdm_readTimes_t myTimes = {0};
+  double startTime; //reused for the different individual measurements
+
+  if(!count) return ESDM_SUCCESS;
+  int64_t dims = esdm_dataspace_get_dims(dataset->dataspace);
+  int64_t elementSize = esdm_sizeof(esdm_dataset_get_type(dataset));
+
+  //fetch the fragments that cover the bounding box of the points
+  startTime = ea_stop_timer(myTimer);
+  esdmI_hypercube_t* boundingBox = esdmI_hypercube_makeDefault(dims);
+  for(int64_t d = 0; d < dims; d++) {
+    esdmI_range_t* range = &boundingBox->ranges[d];
+    *range = (esdmI_range_t){ .start = coords[d], .end = coords[d] + 1 };
+    for(int64_t i = 1; i < count; i++) {
+      int64_t coord = coords[i*dims + d];
+      if(coord < range->start) range->start = coord;
+      if(coord >= range->end) range->end = coord + 1;
+    }
+  }
+  int64_t fragmentCount;
+  esdm_fragment_t** fragments;
+  esdmI_hypercubeSet_t* uncovered;
+  bool dataIsComplete;
+  esdmI_dataset_fragmentsCoveringRegion(dataset, boundingBox, &fragmentCount, &fragments, &uncovered, &dataIsComplete);
+  esdmI_hypercube_destroy(boundingBox);
+  esdmI_hypercubeSet_destroy(uncovered);  //the holes in the bounding box do not tell us which points are missing, that is checked per point below
+
+  //Assign each point to a fragment that contains it, and sort the points by fragment with a counting sort.
+  //For each point, we store the byte offset of its element within the fragment's data, and the byte offset of its value within `buf`.
+  pointIndex_t index;
+  pointIndex_init(&index, dims, fragmentCount, fragments);
+  int64_t* pointFragments = ea_checked_malloc(count*sizeof(*pointFragments));
+  int64_t* pointStart = ea_checked_malloc((fragmentCount + 1)*sizeof(*pointStart)); //the points of fragment i are found at [pointStart[i], pointStart[i+1])
+  for(int64_t i = 0; i <= fragmentCount; i++) pointStart[i] = 0;
+  int64_t missingCount = 0;
+  for(int64_t i = 0; i < count; i++) {
+    pointFragments[i] = pointIndex_find(&index, &coords[i*dims]);
+    if(pointFragments[i] < 0) {
+      missingCount++;
+    } else {
+      pointStart[pointFragments[i] + 1]++;
+    }
+  }
+  for(int64_t i = 0; i < fragmentCount; i++) pointStart[i + 1] += pointStart[i];
+  int64_t* cursor = ea_memdup(pointStart, fragmentCount*sizeof(*cursor) + 1);  //+ 1 avoids a zero size allocation
+  int64_t* pointOffsets = ea_checked_malloc(2*(count - missingCount)*sizeof(*pointOffsets) + 1);
+  for(int64_t i = 0; i < count; i++) {
+    if(pointFragments[i] < 0) continue;
+    int64_t slot = cursor[pointFragments[i]]++;
+    pointOffsets[2*slot] = esdm_dataspace_elementOffset(fragments[pointFragments[i]]->dataspace, (int64_t*)&coords[i*dims]);
+    pointOffsets[2*slot + 1] = i*elementSize;
+  }
+  free(cursor);
+  myTimes.makeSet = ea_stop_timer(myTimer) - startTime;
+
+  //fill the missing points, if possible
+  startTime = ea_stop_timer(myTimer);
+  esdm_status ret = ESDM_SUCCESS;
+  if(missingCount) {
+    DEBUG("%"PRId64" of %"PRId64" points are not covered by any fragment", missingCount, count);
+    char fillValue[elementSize];
+    ret = esdm_dataset_get_fill_value(dataset, fillValue);
+    if(ret == ESDM_SUCCESS) {
+      for(int64_t i = 0; i < count; i++) {
+        if(pointFragments[i] < 0) memcpy((char*)buf + i*elementSize, fillValue, elementSize);
+      }
+    } else {
+      ret = ESDM_INCOMPLETE_DATA; //no fill value set, so we error out
+    }
+  }
+  myTimes.coverageCheck = ea_stop_timer(myTimer) - startTime;
+
+  if(ret == ESDM_SUCCESS) {
+    io_request_status_t status;
+    ret = esdm_scheduler_status_init(&status);
+    eassert(ret == ESDM_SUCCESS);
+
+    //load each fragment that contains points once, and gather the values
+    startTime = ea_stop_timer(myTimer);
+    int64_t usedCount = 0, ioBytes = 0;
+    for(int64_t i = 0; i < fragmentCount; i++) {
+      if(pointStart[i + 1] > pointStart[i]) usedCount++;
+    }
+    DEBUG("%"PRId64" points need %"PRId64" fragments", count, usedCount);
+    atomic_fetch_add(&status.pending_ops, usedCount);
+    for(int64_t i = 0; i < fragmentCount; i++) {
+      if(pointStart[i + 1] == pointStart[i]) continue;
+      io_work_t* task = ea_checked_malloc(sizeof(*task));
+      *task = (io_work_t){
+        .fragment = fragments[i],
+        .op = ESDM_OP_READ,
+        .return_code = ESDM_SUCCESS,
+        .parent = &status,
+        .callback = read_gather_callback,
+        .data = {
+          .mem_buf = buf,
+          .pointCount = pointStart[i + 1] - pointStart[i],
+          .pointOffsets = &pointOffsets[2*pointStart[i]]
+        }
+      };
+      ioBytes += esdm_dataspace_total_bytes(fragments[i]->dataspace);
+      pushTask(task, fragments[i]->backend);
+    }
+    myTimes.enqueue = ea_stop_timer(myTimer) - startTime;
+
+    startTime = ea_stop_timer(myTimer);
+    ret = esdm_scheduler_wait(&status);
+    eassert(ret == ESDM_SUCCESS);
+
+    ret = esdm_scheduler_status_finalize(&status);
+    eassert(ret == ESDM_SUCCESS);
+    myTimes.completion = ea_stop_timer(myTimer) - startTime;
+
+    ret = status.return_code;
+
+    //update the statistics
+    updateIoStats(&esdm->readStats, usedCount, ioBytes);
+    updateRequestStats(&esdm->readStats, 1, count*elementSize, requestIsInternal);
+  }
+
+  //cleanup
+  free(pointOffsets);
+  free(pointStart);
+  free(pointFragments);
+  free(fragments);
+  myTimes.total = ea_stop_timer(myTimer);
+
+  gReadTimes.makeSet += myTimes.makeSet;
+  gReadTimes.coverageCheck += myTimes.coverageCheck;
+  gReadTimes.enqueue += myTimes.enqueue;
+  gReadTimes.completion += myTimes.completion;
+  gReadTimes.total += myTimes.total;
+
+  return ret;
+}
+
+//State of a streaming read, shared between the calling thread and the backend threads.
+typedef struct streamResult_t {
+  esdm_dataspace_t* space;
+  void* result;
+} streamResult_t;
+
+typedef struct readStream_t {
+  esdm_dataspace_t* space;  //the requested region
+  esdm_type_t type;
+  void* userPtr;
+  esdm_stream_func_t streamFunc;
+  esdm_combine_func_t combineFunc;
+  esdm_reduce_func_t reduceFunc;
+  void* fillValue;  //the smd attribute that is passed on to streamFunc
+
+  GMutex mutex;
+  GCond cond;  //signaled whenever a task completes or a result is queued
+  int64_t pendingTasks, windowBytes;
+  GQueue results;  //streamResult_t objects that are waiting for reduceFunc, only used without combineFunc
+  void* partial;  //an intermediate result that is waiting for a combine partner, only used with combineFunc
+  bool havePartial;
+  esdm_status ret;
+} readStream_t;
+
+//Hand the output of streamFunc on, either to the combine tree or to the queue of the calling thread.
+//Takes possession of the dataspace.
+static void readStream_pushResult(readStream_t* stream, esdm_dataspace_t* space, void* result) {
+  if(!stream->reduceFunc) {
+    esdm_dataspace_destroy(space);
+    return;
+  }
+  if(stream->combineFunc) {
+    esdm_dataspace_destroy(space);
+    g_mutex_lock(&stream->mutex);
+    while(stream->havePartial) {
+      void* other = stream->partial;
+      stream->havePartial = false;
+      g_mutex_unlock(&stream->mutex);
+      result = stream->combineFunc(stream->space, stream->userPtr, other, result);
+      g_mutex_lock(&stream->mutex);
+    }
+    stream->partial = result;
+    stream->havePartial = true;
+    g_mutex_unlock(&stream->mutex);
+  } else {
+    streamResult_t* item = ea_checked_malloc(sizeof(*item));
+    *item = (streamResult_t){ .space = space, .result = result };
+    g_mutex_lock(&stream->mutex);
+    g_queue_push_tail(&stream->results, item);
+    g_cond_signal(&stream->cond);
+    g_mutex_unlock(&stream->mutex);
+  }
+}
+
+//Copy the data of `cube` from the source into a contiguous buffer of the requested type and run streamFunc on it.
+//If `sourceIsDisposable` is set and the cube covers the entire contiguous source in the requested type, the source buffer is passed on directly.
+static void readStream_processBlock(readStream_t* stream, esdmI_hypercube_t* cube, esdm_dataspace_t* sourceSpace, void* sourceBuf, bool sourceIsDisposable) {
+  esdm_dataspace_t* blockSpace;
+  esdm_status ret = esdmI_dataspace_createFromHypercube(cube, stream->type, &blockSpace);
+  eassert(ret == ESDM_SUCCESS);
+  int64_t bytes = esdm_dataspace_total_bytes(blockSpace);
+
+  void* blockBuf = sourceBuf;
+  bool copy = !sourceIsDisposable || sourceSpace->stride || sourceSpace->type != stream->type || bytes != esdm_dataspace_total_bytes(sourceSpace);
+  if(copy) {
+    blockBuf = ea_checked_malloc(bytes);
+    esdm_dataspace_copy_data(sourceSpace, sourceBuf, blockSpace, blockBuf);
+  }
+  void* result = stream->streamFunc(blockSpace, blockBuf, stream->userPtr, stream->fillValue);
+  if(copy) free(blockBuf);
+  readStream_pushResult(stream, blockSpace, result);
+}
+
+//Pass the queued results to reduceFunc, must be called on the calling thread with the mutex held.
+static void readStream_drain(readStream_t* stream) {
+  while(!g_queue_is_empty(&stream->results)) {
+    streamResult_t* item = g_queue_pop_head(&stream->results);
+    g_mutex_unlock(&stream->mutex);
+    stream->reduceFunc(item->space, stream->userPtr, item->result);
+    esdm_dataspace_destroy(item->space);
+    free(item);
+    g_mutex_lock(&stream->mutex);
+  }
+}
+
+static void read_stream_callback(io_work_t *work) {
+  readStream_t* stream = work->data.stream;
+  esdm_fragment_t* fragment = work->fragment;
+  esdm_status ret = work->return_code;
+  if(ret != ESDM_SUCCESS) {
+    DEBUG("Error reading from fragment ", work->fragment);
+  } else {
+    esdmI_hypercubeList_t* blocks = esdmI_hypercubeSet_list(work->data.streamRegion);
+    for(int64_t i = 0; i < blocks->count; i++) {
+      readStream_processBlock(stream, blocks->cubes[i], fragment->dataspace, fragment->buf, work->data.unloadFragment);
+    }
+    if(work->data.unloadFragment) ret = esdm_fragment_unload(fragment);
+  }
+  esdmI_hypercubeSet_destroy(work->data.streamRegion);
+
+  g_mutex_lock(&stream->mutex);
+  stream->windowBytes -= work->data.streamBytes;
+  stream->pendingTasks--;
+  if(ret != ESDM_SUCCESS) stream->ret = ret;
+  g_cond_signal(&stream->cond);
+  g_mutex_unlock(&stream->mutex);
+}
+
+//Stream the fill value for a data hole, splitting it into blocks of at most `maxBytes`.
+static void readStream_fill(readStream_t* stream, esdmI_hypercube_t* cube, int64_t maxBytes, esdm_dataspace_t* fillSpace, void* fillValue) {
+  int64_t dims = esdmI_hypercube_dimensions(cube);
+  int64_t bytes = esdmI_hypercube_size(cube)*esdm_sizeof(stream->type);
+  int64_t offset[dims], size[dims];
+  esdmI_hypercube_getOffsetAndSize(cube, offset, size);
+  int64_t dim = 0;
+  while(dim < dims && size[dim] == 1) dim++;
+  if(bytes <= maxBytes || dim == dims) {
+    esdm_status ret = esdmI_dataspace_setExtends(fillSpace, cube);
+    eassert(ret == ESDM_SUCCESS);
+    readStream_processBlock(stream, cube, fillSpace, fillValue, false);
+    return;
+  }
+
+  //split along the first dimension that allows it, oversized slices are split further recursively
+  int64_t start = offset[dim], end = offset[dim] + size[dim];
+  int64_t step = maxBytes/(bytes/size[dim]);
+  if(step < 1) step = 1;
+  for(int64_t cur = start; cur < end; cur += step) {
+    offset[dim] = cur;
+    size[dim] = min_int64(step, end - cur);
+    esdmI_hypercube_t* slice = esdmI_hypercube_make(dims, offset, size);
+    readStream_fill(stream, slice, maxBytes, fillSpace, fillValue);
+    esdmI_hypercube_destroy(slice);
+  }
+}
+
+//The part of a streaming read that only uses the given fragments, it neither looks up nor changes anything in the dataset.
+//The I/O is added to `stats`, and the time measurements to `times`.
+static esdm_status readStream(esdm_instance_t *esdm, esdm_dataset_t *dataset, int64_t fragmentCount, esdm_fragment_t** fragments, esdm_dataspace_t *subspace, void *user_ptr, esdm_stream_func_t stream_func, esdm_combine_func_t combine_func, esdm_reduce_func_t reduce_func, esdm_statistics_t* stats, esdm_readTimes_t* times) {
+  eassert(stream_func);
+
+  timer myTimer;
+  ea_start_timer(&myTimer);
+  esdm_readTimes_t myTimes = {0};
+  double startTime; //reused for the different individual measurements
+
+  //the blocks are converted to the requested type as they are copied out of the fragments
+  esdm_type_t type = esdm_dataspace_get_type(subspace);
+  esdm_type_t datasetType = esdm_dataset_get_type(dataset);
+  if(!ea_converter_for_types(type, datasetType)) {
+    ESDM_WARN("unable to convert the dataset's datatype to the requested one");
+    return ESDM_INVALID_ARGUMENT_ERROR;
+  }
+  int64_t windowLimit = esdm->config->readStreamWindowBytes;
+
+  //Determine which part of the region each fragment provides.
+  //Fragments may overlap, so each fragment only gets the part that is not yet provided by an earlier one,
+  //which ensures that every element is passed to the stream function exactly once.
+  startTime = ea_stop_timer(myTimer);
+  esdmI_hypercube_t* readExtends;
+  esdmI_dataspace_getExtends(subspace, &readExtends);
+  esdmI_hypercubeSet_t* remaining = esdmI_hypercubeSet_make();
+  esdmI_hypercubeSet_add(remaining, readExtends);
+  esdmI_hypercubeSet_t** regions = ea_checked_malloc(fragmentCount*sizeof(*regions));
+  for(int64_t i = 0; i < fragmentCount; i++) {
+    esdmI_hypercube_t* fragmentExtends;
+    esdmI_dataspace_getExtends(fragments[i]->dataspace, &fragmentExtends);
+    regions[i] = esdmI_hypercubeSet_make();
+    esdmI_hypercubeList_t* list = esdmI_hypercubeSet_list(remaining);
+    for(int64_t j = 0; j < list->count; j++) {
+      esdmI_hypercube_t* block = esdmI_hypercube_makeIntersection(list->cubes[j], fragmentExtends);
+      if(block) {
+        if(!esdmI_hypercube_isEmpty(block)) esdmI_hypercubeSet_add(regions[i], block);
+        esdmI_hypercube_destroy(block);
+      }
+    }
+    esdmI_hypercubeSet_subtract(remaining, fragmentExtends);
+    esdmI_hypercube_destroy(fragmentExtends);
+  }
+  esdmI_hypercube_destroy(readExtends);
+  myTimes.makeSet = ea_stop_timer(myTimer) - startTime;
+
+  //check whether we have all the requested data
+  startTime = ea_stop_timer(myTimer);
+  esdm_status ret = ESDM_SUCCESS;
+  char fillValue[esdm_sizeof(datasetType)];  //converted along with the data
+  if(!esdmI_hypercubeSet_isEmpty(remaining)) ret = esdm_dataset_get_fill_value(dataset, fillValue) == ESDM_SUCCESS ? ESDM_SUCCESS : ESDM_INCOMPLETE_DATA;
+  myTimes.coverageCheck = ea_stop_timer(myTimer) - startTime;
+
+  readStream_t stream = {
+    .space = subspace,
+    .type = type,
+    .userPtr = user_ptr,
+    .streamFunc = stream_func,
+    .combineFunc = combine_func,
+    .reduceFunc = reduce_func,
+    .fillValue = dataset->fill_value,
+    .ret = ESDM_SUCCESS
+  };
+  g_mutex_init(&stream.mutex);
+  g_cond_init(&stream.cond);
+  g_queue_init(&stream.results);
+
+  io_request_status_t status;
+  esdm_status statusRet = esdm_scheduler_status_init(&status);
+  eassert(statusRet == ESDM_SUCCESS);
+
+  int64_t loadCount = 0, ioBytes = 0;
+  if(ret == ESDM_SUCCESS) {
+    startTime = ea_stop_timer(myTimer);
+    for(int64_t i = 0; i < fragmentCount; i++) {
+      esdm_fragment_t* fragment = fragments[i];
+      if(esdmI_hypercubeSet_isEmpty(regions[i])) {  //the fragment is hidden by other fragments
+        esdmI_hypercubeSet_destroy(regions[i]);
+        continue;
+      }
+
+      //the fragment's data and the copy of its blocks must fit into the window, but a single task is always allowed to run
+      int64_t fragmentBytes = esdm_dataspace_total_bytes(fragment->dataspace);
+      int64_t blockBytes = 0;
+      esdmI_hypercubeList_t* blocks = esdmI_hypercubeSet_list(regions[i]);
+      for(int64_t j = 0; j < blocks->count; j++) blockBytes += esdmI_hypercube_size(blocks->cubes[j])*esdm_sizeof(type);
+      int64_t taskBytes = fragmentBytes + blockBytes;
+
+      g_mutex_lock(&stream.mutex);
+      readStream_drain(&stream);
+      while(stream.pendingTasks && stream.windowBytes + taskBytes > windowLimit) {
+        g_cond_wait(&stream.cond, &stream.mutex);
+        readStream_drain(&stream);
+      }
+      stream.windowBytes += taskBytes;
+      stream.pendingTasks++;
+      g_mutex_unlock(&stream.mutex);
+
+      io_work_t* task = ea_checked_malloc(sizeof(*task));
+      *task = (io_work_t){
+        .fragment = fragment,
+        .op = ESDM_OP_READ,
+        .return_code = ESDM_SUCCESS,
+        .parent = &status,
+        .callback = read_stream_callback,
+        .data = {
+          .stream = &stream,
+          .streamRegion = regions[i],
+          .streamBytes = taskBytes,
+          .unloadFragment = fragment->status == ESDM_DATA_NOT_LOADED
+        }
+      };
+      atomic_fetch_add(&status.pending_ops, 1);
+      pushTask(task, fragment->backend);
+      loadCount++;
+      ioBytes += fragmentBytes;
+    }
+    myTimes.enqueue = ea_stop_timer(myTimer) - startTime;
+
+    //the data holes are streamed by the calling thread while the backends are busy
+    startTime = ea_stop_timer(myTimer);
+    if(!esdmI_hypercubeSet_isEmpty(remaining)) {
+      esdm_dataspace_t* fillSpace = makeFillSourceSpace(esdm_dataspace_get_dims(subspace), datasetType);
+      esdmI_hypercubeList_t* holes = esdmI_hypercubeSet_list(remaining);
+      for(int64_t i = 0; i < holes->count; i++) readStream_fill(&stream, holes->cubes[i], windowLimit/2, fillSpace, fillValue);
+      esdm_dataspace_destroy(fillSpace);
+    }
+
+    g_mutex_lock(&stream.mutex);
+    readStream_drain(&stream);
+    while(stream.pendingTasks) {
+      g_cond_wait(&stream.cond, &stream.mutex);
+      readStream_drain(&stream);
+    }
+    g_mutex_unlock(&stream.mutex);
+
+    statusRet = esdm_scheduler_wait(&status);  //the backend threads may still hold references to `status`
+    eassert(statusRet == ESDM_SUCCESS);
+    myTimes.completion = ea_stop_timer(myTimer) - startTime;
+
+    ret = stream.ret;
+    if(stream.havePartial) reduce_func(subspace, user_ptr, stream.partial);
+
+    updateIoStats(stats, loadCount, ioBytes);
+  } else {
+    for(int64_t i = 0; i < fragmentCount; i++) esdmI_hypercubeSet_destroy(regions[i]);
+  }
+  statusRet = esdm_scheduler_status_finalize(&status);
+  eassert(statusRet == ESDM_SUCCESS);
+
+  //cleanup
+  g_mutex_clear(&stream.mutex);
+  g_cond_clear(&stream.cond);
+  esdmI_hypercubeSet_destroy(remaining);
+  free(regions);
+  myTimes.total = ea_stop_timer(myTimer);
+
+  times->makeSet += myTimes.makeSet;
+  times->coverageCheck += myTimes.coverageCheck;
+  times->enqueue += myTimes.enqueue;
+  times->completion += myTimes.completion;
+  times->total += myTimes.total;
+
+  return ret;
+}
+
+esdm_status esdm_scheduler_read_stream_blocking(esdm_instance_t *esdm, esdm_dataset_t *dataset, esdm_dataspace_t *subspace, void *user_ptr, esdm_stream_func_t stream_func, esdm_combine_func_t combine_func, esdm_reduce_func_t reduce_func) {
+  ESDM_DEBUG(__func__);
+
+  timer myTimer;
+  ea_start_timer(&myTimer);
+  int64_t fragmentCount;
+  esdm_fragment_t** fragments;
+  esdmI_hypercubeSet_t* uncovered;
+  bool dataIsComplete;
+  esdmI_hypercube_t* readExtends;
+  esdmI_dataspace_getExtends(subspace, &readExtends);
+  esdmI_dataset_fragmentsCoveringRegion(dataset, readExtends, &fragmentCount, &fragments, &uncovered, &dataIsComplete);
+  esdmI_accessPattern_recordRead(&dataset->accessPattern, readExtends);
+  esdmI_hypercubeSet_destroy(uncovered);
+  esdmI_hypercube_destroy(readExtends);
+  gReadTimes.makeSet += ea_stop_timer(myTimer);
+
+  esdm_status ret = readStream(esdm, dataset, fragmentCount, fragments, subspace, user_ptr, stream_func, combine_func, reduce_func, &esdm->readStats, &gReadTimes);
+  if(ret != ESDM_INCOMPLETE_DATA) updateRequestStats(&esdm->readStats, 1, esdm_dataspace_total_bytes(subspace), false);
+  free(fragments);
+  return ret;
+}
+
+esdm_status esdmI_scheduler_readStreamFragments(esdm_instance_t *esdm, esdm_dataset_t *dataset, int64_t fragmentCount, esdm_fragment_t** fragments, esdm_dataspace_t *memspace, void *user_ptr, esdm_stream_func_t stream_func, esdm_combine_func_t combine_func, esdm_reduce_func_t reduce_func, esdm_statistics_t* inout_stats) {
+  esdm_readTimes_t times = {0};
+  return readStream(esdm, dataset, fragmentCount, fragments, memspace, user_ptr, stream_func, combine_func, reduce_func, inout_stats, &times);
+}
+
+void esdmI_scheduler_addReadStats(esdm_instance_t* esdm, const esdm_statistics_t* stats) {
+  esdm->readStats.bytesUser += stats->bytesUser;
+  esdm->readStats.bytesInternal += stats->bytesInternal;
+  esdm->readStats.bytesIo += stats->bytesIo;
+  esdm->readStats.requests += stats->requests;
+  esdm->readStats.internalRequests += stats->internalRequests;
+  esdm->readStats.fragments += stats->fragments;
+}
+
 esdm_status esdm_scheduler_read_blocking(esdm_instance_t *esdm, esdm_dataset_t *dataset, void *buf, esdm_dataspace_t *subspace, esdmI_hypercubeSet_t** out_fillRegion, bool allowWriteback, bool requestIsInternal) {
   ESDM_DEBUG(__func__);
 
@@ -961,6 +1971,7 @@ esdm_status esdm_scheduler_read_blocking(esdm_instance_t *esdm, esdm_dataset_t *
     esdmI_hypercube_t* readExtends;
     esdmI_dataspace_getExtends(subspace, &readExtends);
     esdmI_dataset_fragmentsCoveringRegion(dataset, readExtends, &frag_count, &read_frag, &uncovered, &dataIsComplete);
+    if(!requestIsInternal) esdmI_accessPattern_recordRead(&dataset->accessPattern, readExtends);
     esdmI_hypercube_destroy(readExtends);
     DEBUG("fragments to read: %d", frag_count);
   }
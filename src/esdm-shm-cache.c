@@ -0,0 +1,395 @@
+/* This file is part of ESDM.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with ESDM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ * @brief A cache for fragment data in POSIX shared memory, which is shared by the processes on a node.
+ *
+ * The segment consists of a header, a hash table of slots, and a data area.
+ * The data area is used as a ring buffer: New entries are appended at the head, and the oldest entries are evicted from the tail.
+ * Each block in the data area starts with a small header that names the slot it belongs to, so that the tail can be advanced.
+ *
+ * Lookups are lock-free: Each slot has a single atomic word that combines its state and a reference count.
+ * A reader first acquires a reference on a READY slot, and only then checks the key, so the slot cannot be evicted or reused while it is being checked or copied.
+ * Insertions and evictions are serialized by a spin lock in the header, the data itself is copied into the cache outside of the lock.
+ * An entry can only be evicted while nobody holds a reference to it, if the oldest entry is in use, the new data is simply not cached.
+ *
+ * Slots are found by linear probing over at most kMaxProbes slots.
+ * When the slot table fills up before the data area (many small fragments), an insertion drops the oldest entry within its probe window to free a slot.
+ * The block of a dropped entry stays in the ring buffer until the tail passes it, its slot may be reused immediately.
+ * Evicted slots are tombstones that keep probe chains intact, they are turned back into empty slots as soon as they are at the end of a chain.
+ */
+
+#include <esdm-internal.h>
+
+#include <fcntl.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define DEBUG(fmt, ...) ESDM_DEBUG_COM_FMT("SHM CACHE", fmt, __VA_ARGS__)
+
+static const char kMagic[8] = {'E', 'S', 'D', 'M', 'S', 'H', 'M', '1'};
+static const int64_t kAlignment = 16;
+static const int64_t kAverageEntrySize = 64*1024; //used to size the slot table
+static const int64_t kMaxProbes = 64;
+#define KEY_LENGTH 128
+
+enum {
+  kSlotEmpty = 0,
+  kSlotWriting = 1,
+  kSlotReady = 2,
+  kSlotEvicted = 3
+};
+
+//the slot state is stored in the upper 32 bits of the slot word, the reference count in the lower 32 bits
+#define SLOT_WORD(state, refs) ((uint64_t)(state) << 32 | (uint64_t)(refs))
+#define SLOT_STATE(word) ((int)((word) >> 32))
+
+typedef struct shmSlot_t {
+  _Atomic uint64_t word;
+  _Atomic uint64_t hash;
+  int64_t position, size; //the position of the block in the data area, -1 once the entry has been evicted, and the size of the cached data
+  char key[KEY_LENGTH];
+} shmSlot_t;
+
+typedef struct shmBlockHeader_t {
+  int64_t slot; //-1 for padding at the end of the data area
+  int64_t size; //the size of the entire block, including this header
+} shmBlockHeader_t;
+
+typedef struct shmHeader_t {
+  char magic[8];
+  int64_t segmentSize, slotCount, dataSize;
+  atomic_flag writerLock;
+  int64_t head, tail, used; //the state of the ring buffer, protected by the writer lock
+  atomic_int_fast64_t hits, misses, stores, evictions;
+} shmHeader_t;
+
+//one cache per process
+static struct {
+  shmHeader_t* header;
+  shmSlot_t* slots;
+  char* data;
+} gCache;
+
+static int64_t alignUp(int64_t value) {
+  return (value + kAlignment - 1)/kAlignment*kAlignment;
+}
+
+static int64_t slotTableOffset() {
+  return alignUp(sizeof(shmHeader_t));
+}
+
+static int64_t dataOffset(int64_t slotCount) {
+  return alignUp(slotTableOffset() + slotCount*sizeof(shmSlot_t));
+}
+
+static void mapSegment(void* segment) {
+  gCache.header = segment;
+  gCache.slots = (shmSlot_t*)((char*)segment + slotTableOffset());
+  gCache.data = (char*)segment + dataOffset(gCache.header->slotCount);
+}
+
+esdm_status esdmI_shmCache_create(const char* name, int64_t bytes) {
+  eassert(name);
+  eassert(!gCache.header && "only one shared memory cache can be attached at a time");
+
+  int64_t slotCount = bytes/kAverageEntrySize;
+  if(slotCount < 1024) slotCount = 1024;
+  int64_t dataSize = alignUp(bytes);
+  int64_t segmentSize = dataOffset(slotCount) + dataSize;
+
+  int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+  if(fd < 0) {
+    ESDM_WARN_FMT("cannot create the shared memory segment \"%s\"", name);
+    return ESDM_ERROR;
+  }
+  void* segment = MAP_FAILED;
+  if(!ftruncate(fd, segmentSize)) segment = mmap(NULL, segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(segment == MAP_FAILED) {
+    shm_unlink(name);
+    ESDM_WARN_FMT("cannot map the shared memory segment \"%s\" of %"PRId64" bytes", name, segmentSize);
+    return ESDM_ERROR;
+  }
+
+  //the segment is zero filled, which is the empty state of all slots
+  shmHeader_t* header = segment;
+  header->segmentSize = segmentSize;
+  header->slotCount = slotCount;
+  header->dataSize = dataSize;
+  atomic_flag_clear(&header->writerLock);
+  header->head = header->tail = header->used = 0;
+  atomic_store(&header->hits, 0);
+  atomic_store(&header->misses, 0);
+  atomic_store(&header->stores, 0);
+  atomic_store(&header->evictions, 0);
+  atomic_thread_fence(memory_order_release);
+  memcpy(header->magic, kMagic, sizeof(kMagic));  //written last, so that attaching processes can detect a complete header
+  mapSegment(segment);
+  DEBUG("created \"%s\" with %"PRId64" slots and %"PRId64" data bytes", name, slotCount, dataSize);
+  return ESDM_SUCCESS;
+}
+
+esdm_status esdmI_shmCache_attach(const char* name) {
+  eassert(name);
+  eassert(!gCache.header && "only one shared memory cache can be attached at a time");
+
+  int fd = shm_open(name, O_RDWR, 0600);
+  if(fd < 0) return ESDM_ERROR;
+  struct stat info;
+  void* segment = MAP_FAILED;
+  if(!fstat(fd, &info) && info.st_size >= (off_t)sizeof(shmHeader_t)) segment = mmap(NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(segment == MAP_FAILED) return ESDM_ERROR;
+
+  shmHeader_t* header = segment;
+  atomic_thread_fence(memory_order_acquire);
+  if(memcmp(header->magic, kMagic, sizeof(kMagic)) || header->segmentSize != info.st_size) {
+    munmap(segment, info.st_size);
+    return ESDM_INVALID_DATA_ERROR;
+  }
+  mapSegment(segment);
+  return ESDM_SUCCESS;
+}
+
+void esdmI_shmCache_unlink(const char* name) {
+  shm_unlink(name);
+}
+
+void esdmI_shmCache_detach() {
+  if(!gCache.header) return;
+  munmap(gCache.header, gCache.header->segmentSize);
+  gCache.header = NULL;
+  gCache.slots = NULL;
+  gCache.data = NULL;
+}
+
+bool esdmI_shmCache_isAttached() {
+  return gCache.header;
+}
+
+void esdmI_shmCache_getStats(int64_t* out_hits, int64_t* out_misses, int64_t* out_stores, int64_t* out_evictions) {
+  shmHeader_t* header = gCache.header;
+  if(out_hits) *out_hits = header ? atomic_load(&header->hits) : 0;
+  if(out_misses) *out_misses = header ? atomic_load(&header->misses) : 0;
+  if(out_stores) *out_stores = header ? atomic_load(&header->stores) : 0;
+  if(out_evictions) *out_evictions = header ? atomic_load(&header->evictions) : 0;
+}
+
+//The key must identify the data globally, so it combines the backend and the fragment ID.
+//Returns false if the key does not fit into a slot.
+static bool makeKey(esdm_fragment_t* fragment, char (*out_key)[KEY_LENGTH], uint64_t* out_hash) {
+  int length = snprintf(*out_key, KEY_LENGTH, "%s/%s", fragment->backend->config->id, fragment->id);
+  if(length < 0 || length >= KEY_LENGTH) return false;
+  //FNV-1a
+  uint64_t hash = 0xcbf29ce484222325u;
+  for(int i = 0; i < length; i++) hash = (hash ^ (uint8_t)(*out_key)[i])*0x100000001b3u;
+  *out_hash = hash;
+  return true;
+}
+
+//Tries to acquire a reference on the slot, which must be READY.
+static bool acquireSlot(shmSlot_t* slot) {
+  uint64_t word = atomic_load_explicit(&slot->word, memory_order_acquire);
+  while(SLOT_STATE(word) == kSlotReady) {
+    if(atomic_compare_exchange_weak_explicit(&slot->word, &word, word + 1, memory_order_acquire, memory_order_acquire)) return true;
+  }
+  return false;
+}
+
+static void releaseSlot(shmSlot_t* slot) {
+  atomic_fetch_sub_explicit(&slot->word, 1, memory_order_release);
+}
+
+static int64_t probeCount(shmHeader_t* header) {
+  return header->slotCount < kMaxProbes ? header->slotCount : kMaxProbes;
+}
+
+bool esdmI_shmCache_load(esdm_fragment_t* fragment) {
+  eassert(fragment);
+  eassert(fragment->buf);
+  shmHeader_t* header = gCache.header;
+  if(!header) return false;
+
+  char key[KEY_LENGTH];
+  uint64_t hash;
+  if(!makeKey(fragment, &key, &hash)) return false;
+  int64_t bytes = esdm_dataspace_total_bytes(fragment->dataspace);
+
+  for(int64_t i = 0; i < probeCount(header); i++) {
+    shmSlot_t* slot = &gCache.slots[(hash + i)%header->slotCount];
+    uint64_t word = atomic_load_explicit(&slot->word, memory_order_acquire);
+    if(SLOT_STATE(word) == kSlotEmpty) break;
+    if(SLOT_STATE(word) != kSlotReady || atomic_load_explicit(&slot->hash, memory_order_relaxed) != hash) continue;
+    if(!acquireSlot(slot)) continue;
+    bool match = atomic_load_explicit(&slot->hash, memory_order_relaxed) == hash && !strcmp(slot->key, key) && slot->size == bytes;
+    if(match) memcpy(fragment->buf, gCache.data + slot->position + sizeof(shmBlockHeader_t), bytes);
+    releaseSlot(slot);
+    if(match) {
+      atomic_fetch_add(&header->hits, 1);
+      return true;
+    }
+  }
+  atomic_fetch_add(&header->misses, 1);
+  return false;
+}
+
+static void lockWriter(shmHeader_t* header) {
+  while(atomic_flag_test_and_set_explicit(&header->writerLock, memory_order_acquire)) sched_yield();
+}
+
+static void unlockWriter(shmHeader_t* header) {
+  atomic_flag_clear_explicit(&header->writerLock, memory_order_release);
+}
+
+//Turns the tombstones that precede an empty slot into empty slots, must be called with the writer lock held.
+//No probe chain can extend beyond an empty slot, so no chain needs these tombstones anymore.
+static void clearTombstones(shmHeader_t* header, int64_t slotIndex) {
+  int64_t next = (slotIndex + 1)%header->slotCount;
+  if(SLOT_STATE(atomic_load(&gCache.slots[next].word)) != kSlotEmpty) return;
+  for(int64_t i = 0; i < header->slotCount; i++) {
+    shmSlot_t* slot = &gCache.slots[(slotIndex - i + header->slotCount)%header->slotCount];
+    if(SLOT_STATE(atomic_load(&slot->word)) != kSlotEvicted) break;
+    atomic_store(&slot->word, SLOT_WORD(kSlotEmpty, 0));
+  }
+}
+
+//Drops the entry of a READY slot, must be called with the writer lock held.
+//Returns false if the entry is still being read.
+static bool evictSlot(shmHeader_t* header, shmSlot_t* slot) {
+  uint64_t expected = SLOT_WORD(kSlotReady, 0);
+  if(!atomic_compare_exchange_strong(&slot->word, &expected, SLOT_WORD(kSlotEvicted, 0))) return false;
+  slot->position = -1;
+  atomic_fetch_add(&header->evictions, 1);
+  return true;
+}
+
+//Removes the oldest block from the ring buffer, must be called with the writer lock held.
+//Returns false if the oldest entry cannot be evicted because it is still being read or written.
+static bool evictOldest(shmHeader_t* header) {
+  eassert(header->used > 0);
+  shmBlockHeader_t* block = (shmBlockHeader_t*)(gCache.data + header->tail);
+  //the slot may have been dropped and reused already, then the block is just dead space
+  if(block->slot >= 0 && gCache.slots[block->slot].position == header->tail) {
+    if(!evictSlot(header, &gCache.slots[block->slot])) return false;
+    clearTombstones(header, block->slot);
+  }
+  header->used -= block->size;
+  header->tail += block->size;
+  if(header->tail == header->dataSize) header->tail = 0;
+  return true;
+}
+
+//Reserves a block of the given size in the ring buffer, must be called with the writer lock held.
+//Returns the position of the block, or -1 if the space cannot be made available.
+static int64_t allocateBlock(shmHeader_t* header, int64_t blockSize) {
+  if(blockSize > header->dataSize) return -1;
+  while(true) {
+    if(!header->used) header->head = header->tail = 0;
+    if(!header->used || header->head > header->tail) {
+      //the free space is the end of the data area, followed by its start up to the tail
+      int64_t remaining = header->dataSize - header->head;
+      if(remaining >= blockSize) break;
+      *(shmBlockHeader_t*)(gCache.data + header->head) = (shmBlockHeader_t){ .slot = -1, .size = remaining };
+      header->used += remaining;
+      header->head = 0;
+    } else {
+      if(header->tail - header->head >= blockSize) break;
+      if(!evictOldest(header)) return -1;
+    }
+  }
+  int64_t position = header->head;
+  header->used += blockSize;
+  header->head += blockSize;
+  if(header->head == header->dataSize) header->head = 0;
+  return position;
+}
+
+void esdmI_shmCache_store(esdm_fragment_t* fragment) {
+  eassert(fragment);
+  eassert(fragment->buf);
+  shmHeader_t* header = gCache.header;
+  if(!header) return;
+
+  char key[KEY_LENGTH];
+  uint64_t hash;
+  if(!makeKey(fragment, &key, &hash)) return;
+  int64_t bytes = esdm_dataspace_total_bytes(fragment->dataspace);
+  int64_t blockSize = alignUp(sizeof(shmBlockHeader_t) + bytes);
+
+  lockWriter(header);
+  //The space is reserved first, because making room may evict entries and clear tombstones in the probe window.
+  //A reservation that is not used is handed back, which is always possible since it is the newest block.
+  int64_t position = allocateBlock(header, blockSize);
+  shmSlot_t* target = NULL;
+  if(position >= 0) {
+    //only writers modify slots that are not READY, so we can inspect them safely while we hold the lock
+    shmSlot_t* oldest = NULL;  //the unreferenced entry in the probe window whose block is closest to the tail
+    int64_t oldestAge = -1;
+    bool duplicate = false;
+    for(int64_t i = 0; i < probeCount(header); i++) {
+      shmSlot_t* slot = &gCache.slots[(hash + i)%header->slotCount];
+      uint64_t word = atomic_load(&slot->word);
+      int state = SLOT_STATE(word);
+      if(state == kSlotEmpty) {
+        if(!target) target = slot;
+        break;
+      }
+      if(state == kSlotEvicted) {
+        if(!target) target = slot;
+        continue;
+      }
+      if(atomic_load_explicit(&slot->hash, memory_order_relaxed) == hash && !strcmp(slot->key, key)) {
+        duplicate = true;  //someone else has already cached this fragment
+        break;
+      }
+      int64_t age = (header->head - slot->position + header->dataSize)%header->dataSize;
+      if(word == SLOT_WORD(kSlotReady, 0) && age > oldestAge) {
+        oldest = slot;
+        oldestAge = age;
+      }
+    }
+    if(duplicate) target = NULL;
+    if(!target && !duplicate && oldest && evictSlot(header, oldest)) target = oldest;  //the slot table is full, drop the oldest entry in the window
+    if(!target) {
+      header->head = position;
+      header->used -= blockSize;
+      position = -1;
+    }
+  }
+  if(position >= 0) {
+    atomic_store(&target->word, SLOT_WORD(kSlotWriting, 0));
+    atomic_store_explicit(&target->hash, hash, memory_order_relaxed);
+    memcpy(target->key, key, sizeof(key));
+    target->position = position;
+    target->size = bytes;
+    *(shmBlockHeader_t*)(gCache.data + position) = (shmBlockHeader_t){ .slot = target - gCache.slots, .size = blockSize };
+  }
+  unlockWriter(header);
+  if(position < 0) return;
+
+  //the slot is WRITING, so neither readers nor evictions touch the block while we fill it
+  memcpy(gCache.data + position + sizeof(shmBlockHeader_t), fragment->buf, bytes);
+  atomic_store_explicit(&target->word, SLOT_WORD(kSlotReady, 0), memory_order_release);
+  atomic_fetch_add(&header->stores, 1);
+}
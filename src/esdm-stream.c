@@ -1,16 +1,34 @@
 #include <esdm-stream.h>
 
+#include <math.h>
+
 #include <esdm.h>
 #include <esdm-datatypes-internal.h>
 #include <esdm-debug.h>
+#include <esdm-grid.h>
 #include <esdm-internal.h>
 
+//One of the backends that a write stream distributes its fragments to.
+//The chunks that are written to a backend form a queue, so the chunks of each fragment reach the backend in order,
+//while the queues of different backends are flushed in parallel.
+typedef struct wstreamTarget_t {
+  esdm_backend_t* backend;
+  double share;  //the fraction of the stream's data that this backend is supposed to receive
+  int64_t assignedBytes;
+  GQueue pendingChunks;  //wstreamChunk_t objects that wait for the chunk before them to be written
+  bool flushing;  //whether a chunk is currently in flight on this backend
+} wstreamTarget_t;
+
 struct esdm_wstream_metadata_t {
   //data description
   esdm_dataset_t* dataset;
   esdm_dataspace_t* dataspace;
-  esdm_backend_t* backend;
-  estream_write_t backendState;
+  esdm_grid_t* grid;  //records the fragment decomposition, NULL for scalar streams
+  int64_t targetCount;
+  wstreamTarget_t* targets;
+  wstreamTarget_t* curTarget;  //the target of the current fragment
+  int64_t assignedBytes;  //sum of the `assignedBytes` of all targets
+  estream_write_t* backendState;  //one per fragment, freed once the last chunk of the fragment has been written
 
   //fragmentation/chunking parameters
   int64_t fragmentationDim;
@@ -26,10 +44,62 @@ struct esdm_wstream_metadata_t {
   int64_t fragCapacityRemaining;
   int64_t curFragment, nextChunk;
   int64_t chunkOffset;
+
+  //asynchronous flushing: the filled chunks are written on the backends' thread pools while the producer fills the next buffer
+  GMutex mutex;
+  GCond cond;  //signaled whenever a chunk has been written
+  int64_t bufferCount;
+  void** buffers;  //`bufferCount` buffers of `esdm_wstream_metadata_max_chunk_size()` elements each
+  GQueue freeBuffers;
+  esdm_status ret;
+  io_request_status_t status;
 };
 
-static const int64_t kMaxChunkSize = 16*1024;  //TODO: This should come from configuration.
+typedef struct wstreamChunk_t {
+  esdm_wstream_metadata_t* metadata;
+  wstreamTarget_t* target;
+  estream_write_t* state;
+  void* buffer;
+  int64_t offset, size;
+  bool isLast;  //the last chunk of its fragment
+} wstreamChunk_t;
+
+static const int64_t kMinChunkSize = 64*1024, kMaxChunkSize = 16*1024*1024;
+
+//Use the configured "write-stream-blocksize" of the backend.
+//Without that, use the amount of data that the backend writes during one latency period, so that the per-chunk latency does not dominate.
+static int64_t chunkSizeForBackend(esdm_backend_t* backend) {
+  int64_t result = backend->config->write_stream_blocksize;
+  if(result <= 0) {
+    double latency, throughput;
+    esdmI_performance_backendModel(backend, &latency, &throughput);
+    double productSize = latency*throughput;
+    result = productSize > kMaxChunkSize ? kMaxChunkSize : productSize;  //careful, the product may be NaN or infinite
+    if(!(result >= kMinChunkSize)) result = kMinChunkSize;
+  }
+  int64_t fragmentSize = esdmI_backend_fragmentSize(backend);
+  if(fragmentSize > 0 && result > fragmentSize) result = fragmentSize;
+  return result;
+}
 
+//Pick the target that lags the most behind its share of the data written so far, including the new fragment.
+//This is deterministic, so that all fragments of a stream are placed according to the throughput estimates of the backends.
+static wstreamTarget_t* selectTarget(esdm_wstream_metadata_t* metadata, int64_t fragmentBytes) {
+  int64_t totalBytes = metadata->assignedBytes + fragmentBytes;
+  wstreamTarget_t* result = &metadata->targets[0];
+  double bestDeficit = -INFINITY;
+  for(int64_t i = 0; i < metadata->targetCount; i++) {
+    wstreamTarget_t* target = &metadata->targets[i];
+    double deficit = target->share*totalBytes - target->assignedBytes;
+    if(deficit > bestDeficit) {
+      bestDeficit = deficit;
+      result = target;
+    }
+  }
+  result->assignedBytes += fragmentBytes;
+  metadata->assignedBytes = totalBytes;
+  return result;
+}
 static esdmI_range_t getBounds(esdm_dataspace_t* dataspace, int64_t dim, int64_t* cumulativeCounts, int64_t objectIndex);
 
 //returns the max. object width
@@ -56,6 +126,7 @@ static void initCounts(int64_t dimCount, int64_t elementSize, int64_t maxObjectS
 }
 
 
+
 static void wstream_create_newFragment(esdm_wstream_metadata_t* metadata){
   int64_t dimCount = metadata->dataspace->dims;
   metadata->curFragment++;
@@ -72,6 +143,7 @@ static void wstream_create_newFragment(esdm_wstream_metadata_t* metadata){
   //printf("Fragment capacity: %"PRIu64"\n", fragCapacityRemaining);
   metadata->fragCapacityRemaining = fragCapacityRemaining;
   metadata->chunkOffset = 0;
+  metadata->curTarget = selectTarget(metadata, fragCapacityRemaining);
 
   esdm_dataspace_t* memspace;
   esdm_status ret = esdm_dataspace_create_full(dimCount, size, offset, metadata->dataspace->type, &memspace);
@@ -80,24 +152,76 @@ static void wstream_create_newFragment(esdm_wstream_metadata_t* metadata){
     abort();
   }
   bool isNewFragment;
-  metadata->backendState.fragment = esdmI_dataset_createFragment(metadata->dataset, memspace, NULL, &isNewFragment);
+  metadata->backendState = ea_checked_malloc(sizeof(*metadata->backendState));
+  *metadata->backendState = (estream_write_t){0};
+  metadata->backendState->fragment = esdmI_dataset_createFragment(metadata->dataset, memspace, NULL, &isNewFragment);
   eassert(isNewFragment);
   //if(isNewFragment) {
-  metadata->backendState.fragment->backend = metadata->backend;
+  metadata->backendState->fragment->backend = metadata->curTarget->backend;
   //} else {
-  //  metadata->backendState.fragment = NULL;  //no need to stream anything into an already existing fragment
+  //  metadata->backendState->fragment = NULL;  //no need to stream anything into an already existing fragment
   //}
+  if(metadata->grid) {
+    ret = esdmI_grid_addFragment(metadata->grid, metadata->backendState->fragment);
+    eassert(ret == ESDM_SUCCESS && "the fragments of a stream must match the cells of its grid");
+  }
   esdm_dataspace_destroy(memspace);
 }
 
+static void wstream_chunkWritten(io_work_t* work);
+
+static void wstream_writeChunk(wstreamChunk_t* chunk) {
+  esdm_wstream_metadata_t* metadata = chunk->metadata;
+  esdmI_scheduler_writeStreamChunkNonblocking(esdmI_esdm(), chunk->target->backend, chunk->state, chunk->buffer, chunk->offset, chunk->size, wstream_chunkWritten, chunk, &metadata->status);
+}
+
+//Called on the backend thread, recycles the buffer and starts writing the next chunk for the same backend, if one is waiting.
+static void wstream_chunkWritten(io_work_t* work) {
+  wstreamChunk_t* chunk = work->data.streamOwner;
+  esdm_wstream_metadata_t* metadata = chunk->metadata;
+  wstreamTarget_t* target = chunk->target;
+  if(chunk->isLast) free(chunk->state);
+
+  g_mutex_lock(&metadata->mutex);
+  if(work->return_code != ESDM_SUCCESS) metadata->ret = work->return_code;
+  g_queue_push_tail(&metadata->freeBuffers, chunk->buffer);
+  wstreamChunk_t* next = g_queue_pop_head(&target->pendingChunks);
+  if(!next) target->flushing = false;
+  g_cond_broadcast(&metadata->cond);
+  g_mutex_unlock(&metadata->mutex);
+
+  free(chunk);
+  if(next) wstream_writeChunk(next);
+}
+
+//Creates a grid with one cell per fragment of the stream, so that reads of the streamed region can use the grid to find the fragments.
+static void wstream_createGrid(esdm_wstream_metadata_t* metadata) {
+  esdm_dataspace_t* space = metadata->dataspace;
+  if(!space->dims) return;  //grids need at least one dimension
+  for(int64_t dim = 0; dim < space->dims; dim++) {
+    if(space->size[dim] <= 0) return;
+  }
+
+  esdm_status ret = esdm_grid_create(metadata->dataset, space->dims, space->offset, space->size, &metadata->grid);
+  eassert(ret == ESDM_SUCCESS);
+  for(int64_t dim = 0; dim < space->dims; dim++) {
+    if(metadata->fragmentCounts[dim] == 1) continue;
+    //`getBounds()` splits the axis in the same way as `esdm_grid_subdivideFlexible()` does
+    ret = esdm_grid_subdivideFlexible(metadata->grid, dim, metadata->fragmentCounts[dim]);
+    eassert(ret == ESDM_SUCCESS);
+  }
+}
+
 esdm_wstream_metadata_t* esdm_wstream_metadata_create(esdm_dataset_t* dataset, int64_t dimCount, int64_t* offset, int64_t* size, esdm_type_t type) {
   eassert(dataset->dataspace->dims == dimCount);
 
   esdm_wstream_metadata_t* result = ea_checked_malloc(sizeof*result);
   *result = (esdm_wstream_metadata_t){
     .dataset = dataset,
-    .backend = esdm_modules_randomWeightedBackend(esdm_get_modules()),
-    .backendState = {0},
+    .grid = NULL,
+    .curTarget = NULL,
+    .assignedBytes = 0,
+    .backendState = NULL,
 
     //these are the defaults for the case that the entire stream region fits into a single fragment/chunk
     .fragmentationDim = 0,
@@ -110,9 +234,9 @@ esdm_wstream_metadata_t* esdm_wstream_metadata_create(esdm_dataset_t* dataset, i
     .fragCapacityRemaining = 0,
     .curFragment = -1,
     .nextChunk = 0,
-    .chunkOffset = 0
+    .chunkOffset = 0,
+    .ret = ESDM_SUCCESS
   };
-  eassert(result->backend);
   esdm_status ret = esdm_dataspace_create_full(dimCount, size, offset, type, &result->dataspace);
   if(ret != ESDM_SUCCESS) {
     ESDM_WARN("could not create dataspace");
@@ -120,9 +244,46 @@ esdm_wstream_metadata_t* esdm_wstream_metadata_create(esdm_dataset_t* dataset, i
     return NULL;
   }
 
+  //Distribute the stream across the backends in the same way as esdm_write() does, according to the estimated throughput of the backends.
+  int64_t maxFragmentSize;
+  double* shares;
+  esdm_backend_t** backends = esdm_modules_makeBackendRecommendation(esdm_get_modules(), result->dataspace, &result->targetCount, &maxFragmentSize, &shares);
+  eassert(backends && result->targetCount > 0);
+  result->targets = ea_checked_malloc(result->targetCount*sizeof*result->targets);
+  int64_t maxChunkSize = INT64_MAX;
+  for(int64_t i = 0; i < result->targetCount; i++) {
+    result->targets[i] = (wstreamTarget_t){
+      .backend = backends[i],
+      .share = shares[i],
+      .assignedBytes = 0,
+      .flushing = false
+    };
+    g_queue_init(&result->targets[i].pendingChunks);
+    int64_t chunkSize = chunkSizeForBackend(backends[i]);
+    if(chunkSize < maxChunkSize) maxChunkSize = chunkSize;
+  }
+  free(backends);
+  free(shares);
+
   //Find the parameters for splitting the dataspace into fragments, and splitting fragments into chunks.
-  initCounts(dimCount, esdm_sizeof(type), kMaxChunkSize, size, &result->chunkingDim, &result->maxChunkWidth, result->chunkCounts, result->cumulativeChunkCounts);
-  initCounts(dimCount, esdm_sizeof(type), result->backend->config->max_fragment_size, size, &result->fragmentationDim, NULL, result->fragmentCounts, result->cumulativeFragmentCounts);
+  //Both are limited by the most restrictive backend, so that every fragment and chunk fits any of the selected backends.
+  initCounts(dimCount, esdm_sizeof(type), maxChunkSize, size, &result->chunkingDim, &result->maxChunkWidth, result->chunkCounts, result->cumulativeChunkCounts);
+  initCounts(dimCount, esdm_sizeof(type), maxFragmentSize, size, &result->fragmentationDim, NULL, result->fragmentCounts, result->cumulativeFragmentCounts);
+  wstream_createGrid(result);
+
+  g_mutex_init(&result->mutex);
+  g_cond_init(&result->cond);
+  g_queue_init(&result->freeBuffers);
+  ret = esdm_scheduler_status_init(&result->status);
+  eassert(ret == ESDM_SUCCESS);
+  //one buffer is filled while each backend may write another one
+  result->bufferCount = result->targetCount + 1;
+  result->buffers = ea_checked_malloc(result->bufferCount*sizeof*result->buffers);
+  int64_t bufferSize = esdm_wstream_metadata_max_chunk_size(result)*esdm_sizeof(type);
+  for(int64_t i = 0; i < result->bufferCount; i++) {
+    result->buffers[i] = ea_checked_malloc(bufferSize);
+    g_queue_push_tail(&result->freeBuffers, result->buffers[i]);
+  }
 
   wstream_create_newFragment(result);
   return result;
@@ -173,21 +334,61 @@ int64_t esdm_wstream_metadata_next_chunk_size(esdm_wstream_metadata_t* metadata)
 }
 
 
-//TODO: Rewrite this to create a grid that will contain the fragments.
-void esdm_wstream_flush(esdm_wstream_metadata_t* metadata, void* buffer, void* bufferEnd) {
+//Takes a free buffer from the ring, waiting for a chunk write to finish if necessary.
+static void* wstream_acquireBuffer(esdm_wstream_metadata_t* metadata) {
+  g_mutex_lock(&metadata->mutex);
+  while(g_queue_is_empty(&metadata->freeBuffers)) g_cond_wait(&metadata->cond, &metadata->mutex);
+  void* result = g_queue_pop_head(&metadata->freeBuffers);
+  esdm_status ret = metadata->ret;
+  g_mutex_unlock(&metadata->mutex);
+
+  if(ret != ESDM_SUCCESS) {
+    //TODO: Handle this error condition
+    fprintf(stderr, "backend returned an error while flushing data from a write stream\naborting...\n");
+    abort();
+  }
+  return result;
+}
+
+void* esdm_wstream_metadata_first_buffer(esdm_wstream_metadata_t* metadata) {
+  return wstream_acquireBuffer(metadata);
+}
+
+void* esdm_wstream_flush(esdm_wstream_metadata_t* metadata, void* buffer, void* bufferEnd) {
   //printf("esdm_wstream_flush\n");
   eassert(!isFinished(metadata));
   int64_t curChunkSize = (char*)bufferEnd - (char*)buffer;
 
   eassert(metadata->fragCapacityRemaining >= curChunkSize);
 
-  if(metadata->backendState.fragment){ //don't stream any data that's already on disk
-    int ret = esdmI_backend_fragment_write_stream_blocksize(metadata->backend, &metadata->backendState, buffer, metadata->chunkOffset, curChunkSize);
-    if(ret != ESDM_SUCCESS) {
-      //TODO: Handle this error condition
-      fprintf(stderr, "backend returned an error while flushing data from a write stream\naborting...\n");
-      abort();
+  if(metadata->backendState->fragment){ //don't stream any data that's already on disk
+    wstreamTarget_t* target = metadata->curTarget;
+    wstreamChunk_t* chunk = ea_checked_malloc(sizeof(*chunk));
+    *chunk = (wstreamChunk_t){
+      .metadata = metadata,
+      .target = target,
+      .state = metadata->backendState,
+      .buffer = buffer,
+      .offset = metadata->chunkOffset,
+      .size = curChunkSize,
+      .isLast = metadata->fragCapacityRemaining == curChunkSize
+    };
+
+    //the chunks of a fragment must reach the backend in order, so only one chunk is in flight per backend
+    g_mutex_lock(&metadata->mutex);
+    bool startNow = !target->flushing;
+    if(startNow) {
+      target->flushing = true;
+    } else {
+      g_queue_push_tail(&target->pendingChunks, chunk);
     }
+    g_mutex_unlock(&metadata->mutex);
+    if(startNow) wstream_writeChunk(chunk);
+  } else {
+    if(metadata->fragCapacityRemaining == curChunkSize) free(metadata->backendState);
+    g_mutex_lock(&metadata->mutex);
+    g_queue_push_tail(&metadata->freeBuffers, buffer);
+    g_mutex_unlock(&metadata->mutex);
   }
   //advance the iterator status to the next chunk
   metadata->chunkOffset += curChunkSize;
@@ -198,11 +399,31 @@ void esdm_wstream_flush(esdm_wstream_metadata_t* metadata, void* buffer, void* b
   if(metadata->fragCapacityRemaining == 0 && ! isFinished(metadata)){
     wstream_create_newFragment(metadata);
   }
+
+  return wstream_acquireBuffer(metadata);
 }
 
 void esdm_wstream_metadata_destroy(esdm_wstream_metadata_t* metadata) {
   eassert(isFinished(metadata));
 
+  //wait for the background writes to finish
+  esdm_status ret = esdm_scheduler_wait(&metadata->status);
+  eassert(ret == ESDM_SUCCESS);
+  if(metadata->ret != ESDM_SUCCESS || metadata->status.return_code != ESDM_SUCCESS) {
+    //TODO: Handle this error condition
+    fprintf(stderr, "backend returned an error while flushing data from a write stream\naborting...\n");
+    abort();
+  }
+  ret = esdm_scheduler_status_finalize(&metadata->status);
+  eassert(ret == ESDM_SUCCESS);
+
+  for(int64_t i = 0; i < metadata->targetCount; i++) eassert(g_queue_is_empty(&metadata->targets[i].pendingChunks));
+  free(metadata->targets);
+  g_queue_clear(&metadata->freeBuffers);
+  g_mutex_clear(&metadata->mutex);
+  g_cond_clear(&metadata->cond);
+  for(int64_t i = 0; i < metadata->bufferCount; i++) free(metadata->buffers[i]);
+  free(metadata->buffers);
   esdm_dataspace_destroy(metadata->dataspace);
   free(metadata->fragmentCounts);
   free(metadata->chunkCounts);
@@ -210,3 +431,202 @@ void esdm_wstream_metadata_destroy(esdm_wstream_metadata_t* metadata) {
   free(metadata->cumulativeChunkCounts);
   free(metadata);
 }
+
+struct esdm_rstream_metadata_t {
+  //data description
+  esdm_dataset_t* dataset;
+  esdm_dataspace_t* dataspace;
+
+  //the fragments that cover the stream region, resolved on the creating thread so that the background thread never touches the dataset's fragment list
+  int64_t fragmentCount;
+  esdm_fragment_t** fragments;
+  esdm_statistics_t stats;  //the I/O of the background thread, added to the global statistics when the stream is destroyed
+
+  //chunking parameters, see esdm_wstream_metadata_t
+  int64_t chunkingDim, maxChunkWidth;
+  int64_t* chunkCounts, *cumulativeChunkCounts;
+  int64_t chunkCount, maxChunkElements;
+
+  //prefetching: chunk `i` is read into `buffers[i % kRstreamBufferCount]` by a background thread
+  GThread* thread;
+  GMutex mutex;
+  GCond cond;
+  void* buffers[3];  //kRstreamBufferCount buffers
+  int64_t readyChunks;  //the number of chunks that the background thread has finished reading
+  int64_t handedOutChunks;  //the number of chunks that have been passed to the user
+  int64_t releasedChunks;  //the number of chunks whose buffers the user has given back
+  bool cancel;
+  esdm_status ret;  //the first error of the background thread, no further chunks are handed out after an error
+};
+
+//The destination of a chunk read, passed through the scheduler to rstream_copyBlock().
+typedef struct rstreamChunkTarget_t {
+  esdm_dataspace_t* space;
+  void* buffer;
+} rstreamChunkTarget_t;
+
+static const int64_t kRstreamBufferCount = 3;  //one chunk is consumed while the next two are prefetched
+
+static void rstream_chunkBounds(esdm_rstream_metadata_t* metadata, int64_t chunk, int64_t* out_offset, int64_t* out_size) {
+  for(int64_t dim = metadata->dataspace->dims; dim--; ) {
+    esdmI_range_t range = getBounds(metadata->dataspace, dim, metadata->cumulativeChunkCounts, chunk);
+    out_offset[dim] = range.start;
+    out_size[dim] = range.end - range.start;
+  }
+}
+
+//Copies each block that the scheduler streams in into the chunk buffer.
+static void* rstream_copyBlock(esdm_dataspace_t* space, void* buffer, void* chunk, void* fillValue) {
+  rstreamChunkTarget_t* target = chunk;
+  esdm_dataspace_copy_data(space, buffer, target->space, target->buffer);
+  return NULL;
+}
+
+static gpointer rstream_prefetchThread(gpointer data) {
+  esdm_rstream_metadata_t* metadata = data;
+  int64_t dimCount = metadata->dataspace->dims;
+
+  for(int64_t chunk = 0; chunk < metadata->chunkCount; chunk++) {
+    g_mutex_lock(&metadata->mutex);
+    while(!metadata->cancel && chunk - metadata->releasedChunks >= kRstreamBufferCount) g_cond_wait(&metadata->cond, &metadata->mutex);
+    bool cancel = metadata->cancel;
+    g_mutex_unlock(&metadata->mutex);
+    if(cancel) break;
+
+    int64_t offset[dimCount], size[dimCount];
+    rstream_chunkBounds(metadata, chunk, offset, size);
+    esdm_dataspace_t* chunkSpace;
+    esdm_status ret = esdm_dataspace_create_full(dimCount, size, offset, metadata->dataspace->type, &chunkSpace);
+    if(ret == ESDM_SUCCESS) {
+      rstreamChunkTarget_t target = { .space = chunkSpace, .buffer = metadata->buffers[chunk % kRstreamBufferCount] };
+      ret = esdmI_scheduler_readStreamFragments(esdmI_esdm(), metadata->dataset, metadata->fragmentCount, metadata->fragments, chunkSpace, &target, rstream_copyBlock, NULL, NULL, &metadata->stats);
+      esdm_dataspace_destroy(chunkSpace);
+    }
+
+    g_mutex_lock(&metadata->mutex);
+    if(ret == ESDM_SUCCESS) {
+      metadata->readyChunks = chunk + 1;
+    } else {
+      metadata->ret = ret;
+    }
+    g_cond_broadcast(&metadata->cond);
+    g_mutex_unlock(&metadata->mutex);
+    if(ret != ESDM_SUCCESS) break;
+  }
+  return NULL;
+}
+
+esdm_rstream_metadata_t* esdm_rstream_metadata_create(esdm_dataset_t* dataset, int64_t dimCount, int64_t* offset, int64_t* size, esdm_type_t type) {
+  eassert(dataset->dataspace->dims == dimCount);
+
+  esdm_rstream_metadata_t* result = ea_checked_malloc(sizeof*result);
+  *result = (esdm_rstream_metadata_t){
+    .dataset = dataset,
+
+    //these are the defaults for the case that the entire stream region fits into a single chunk
+    .chunkingDim = 0,
+    .maxChunkWidth = dimCount ? size[0] : 1,
+    .chunkCounts = ea_checked_malloc(dimCount*sizeof*result->chunkCounts),
+    .cumulativeChunkCounts = ea_checked_malloc((dimCount + 1)*sizeof*result->cumulativeChunkCounts),
+    .ret = ESDM_SUCCESS
+  };
+  esdm_status ret = esdm_dataspace_create_full(dimCount, size, offset, type, &result->dataspace);
+  if(ret != ESDM_SUCCESS) {
+    ESDM_WARN("could not create dataspace");
+    free(result->chunkCounts);
+    free(result->cumulativeChunkCounts);
+    free(result);
+    return NULL;
+  }
+
+  //Read in chunks of about the size of the fragments that a write stream would produce, so that the chunks tend to match the fragments on disk.
+  esdm_modules_t* modules = esdm_get_modules();
+  int64_t chunkSize = 0;
+  for(int i = 0; i < modules->data_backend_count; i++) {
+    int64_t fragmentSize = esdmI_backend_fragmentSize(modules->data_backends[i]);
+    if(fragmentSize > chunkSize) chunkSize = fragmentSize;
+  }
+  if(chunkSize <= 0) chunkSize = 10*1024*1024;
+  initCounts(dimCount, esdm_sizeof(type), chunkSize, size, &result->chunkingDim, &result->maxChunkWidth, result->chunkCounts, result->cumulativeChunkCounts);
+  result->chunkCount = result->cumulativeChunkCounts[0];
+  result->maxChunkElements = result->maxChunkWidth;
+  for(int64_t dim = result->chunkingDim + 1; dim < dimCount; dim++) result->maxChunkElements *= size[dim];
+
+  //Look up the fragments once for the whole stream region.
+  //This is also where the read is recorded in the access pattern, the chunk reads of the background thread are not user requests.
+  esdmI_hypercube_t* extends;
+  esdmI_dataspace_getExtends(result->dataspace, &extends);
+  esdmI_hypercubeSet_t* uncovered;
+  bool dataIsComplete;
+  esdmI_dataset_fragmentsCoveringRegion(dataset, extends, &result->fragmentCount, &result->fragments, &uncovered, &dataIsComplete);
+  esdmI_accessPattern_recordRead(&dataset->accessPattern, extends);
+  esdmI_hypercubeSet_destroy(uncovered);
+  esdmI_hypercube_destroy(extends);
+  result->stats.requests = 1;
+  result->stats.bytesUser = esdm_dataspace_total_bytes(result->dataspace);
+
+  for(int64_t i = 0; i < kRstreamBufferCount; i++) result->buffers[i] = ea_checked_malloc(result->maxChunkElements*esdm_sizeof(type));
+  g_mutex_init(&result->mutex);
+  g_cond_init(&result->cond);
+  result->thread = g_thread_new("esdm-rstream", rstream_prefetchThread, result);
+  return result;
+}
+
+void* esdm_rstream_metadata_next_chunk(esdm_rstream_metadata_t* metadata, void* previousBuffer, int64_t* out_elementCount) {
+  eassert(metadata);
+  eassert(out_elementCount);
+
+  g_mutex_lock(&metadata->mutex);
+  if(previousBuffer) {
+    metadata->releasedChunks++;
+    g_cond_broadcast(&metadata->cond);
+  }
+  while(metadata->handedOutChunks < metadata->chunkCount && metadata->readyChunks <= metadata->handedOutChunks && metadata->ret == ESDM_SUCCESS) g_cond_wait(&metadata->cond, &metadata->mutex);
+  if(metadata->handedOutChunks == metadata->chunkCount || metadata->readyChunks <= metadata->handedOutChunks) {
+    //either all chunks have been delivered, or the background thread failed to read the next one, which ends the stream early
+    if(metadata->ret != ESDM_SUCCESS) ESDM_WARN_FMT("error %d while reading data for a read stream, ending the stream", metadata->ret);
+    metadata->handedOutChunks = metadata->chunkCount;  //don't warn again on subsequent calls
+    g_mutex_unlock(&metadata->mutex);
+    *out_elementCount = 0;
+    return NULL;
+  }
+  int64_t chunk = metadata->handedOutChunks++;
+  g_mutex_unlock(&metadata->mutex);
+
+  int64_t dimCount = metadata->dataspace->dims;
+  int64_t offset[dimCount], size[dimCount];
+  rstream_chunkBounds(metadata, chunk, offset, size);
+  int64_t elementCount = 1;
+  for(int64_t dim = 0; dim < dimCount; dim++) elementCount *= size[dim];
+  *out_elementCount = elementCount;
+  return metadata->buffers[chunk % kRstreamBufferCount];
+}
+
+esdm_status esdm_rstream_metadata_status(esdm_rstream_metadata_t* metadata) {
+  eassert(metadata);
+
+  g_mutex_lock(&metadata->mutex);
+  esdm_status result = metadata->ret;
+  g_mutex_unlock(&metadata->mutex);
+  return result;
+}
+
+void esdm_rstream_metadata_destroy(esdm_rstream_metadata_t* metadata) {
+  eassert(metadata);
+
+  g_mutex_lock(&metadata->mutex);
+  metadata->cancel = true;
+  g_cond_broadcast(&metadata->cond);
+  g_mutex_unlock(&metadata->mutex);
+  g_thread_join(metadata->thread);  //waits for a chunk read that may be in progress
+  esdmI_scheduler_addReadStats(esdmI_esdm(), &metadata->stats);
+
+  g_mutex_clear(&metadata->mutex);
+  g_cond_clear(&metadata->cond);
+  for(int64_t i = 0; i < kRstreamBufferCount; i++) free(metadata->buffers[i]);
+  esdm_dataspace_destroy(metadata->dataspace);
+  free(metadata->fragments);
+  free(metadata->chunkCounts);
+  free(metadata->cumulativeChunkCounts);
+  free(metadata);
+}
@@ -138,6 +138,7 @@ esdm_status esdm_mkfs(int format_flags, data_accessibility_t target) {
   int ret;
   int ret_final = ESDM_SUCCESS;
   esdm_modules_t* modules = esdmI_esdm()->modules;
+  esdmI_mdCache_clear();  // the cached objects are gone once the metadata is formatted
   if (modules->metadata_backend->config->data_accessibility == target) {
     ret = modules->metadata_backend->callbacks.mkfs(modules->metadata_backend, format_flags);
     if (ret != ESDM_SUCCESS) {
@@ -164,11 +165,14 @@ esdm_status esdm_finalize() {
 
   esdm_instance_t* esdm = esdmI_esdm();
 
+  esdmI_mdCache_clear();
+  esdmI_gridSynthesis_finalize();
   esdm_scheduler_finalize(esdm);
   esdm_performance_finalize(esdm);
   esdm_layout_finalize(esdm);
   esdm_modules_finalize(esdm);
   esdm_config_finalize(esdm);
+  esdmI_shmCache_detach();
 
   esdm_log_on_exit(0);
 
@@ -200,6 +204,33 @@ esdm_status esdm_read(esdm_dataset_t *dataset, void *buf, esdm_dataspace_t *spac
   return esdmI_readWithFillRegion(dataset, buf, space, NULL);
 }
 
+esdm_status esdm_write_multi(esdm_dataset_t *dataset, int64_t count, void **bufs, esdm_dataspace_t **spaces) {
+  ESDM_DEBUG(__func__);
+  eassert(dataset);
+  eassert(count >= 0);
+  eassert(!count || (bufs && spaces));
+
+  return esdm_scheduler_write_multi_blocking(esdmI_esdm(), dataset, count, bufs, spaces, false);
+}
+
+esdm_status esdm_read_multi(esdm_dataset_t *dataset, int64_t count, void **bufs, esdm_dataspace_t **spaces) {
+  ESDM_DEBUG(__func__);
+  eassert(dataset);
+  eassert(count >= 0);
+  eassert(!count || (bufs && spaces));
+
+  return esdm_scheduler_read_multi_blocking(esdmI_esdm(), dataset, count, bufs, spaces, false);
+}
+
+esdm_status esdm_read_points(esdm_dataset_t *dataset, int64_t count, const int64_t *coords, void *buf) {
+  ESDM_DEBUG(__func__);
+  eassert(dataset);
+  eassert(count >= 0);
+  eassert(!count || (coords && buf));
+
+  return esdm_scheduler_read_points_blocking(esdmI_esdm(), dataset, count, coords, buf, false);
+}
+
 esdm_status esdm_sync() {
   ESDM_DEBUG(__func__);
   return ESDM_SUCCESS;
@@ -245,19 +276,23 @@ esdm_status esdm_dataset_change_name(esdm_dataset_t *d, char const * new_name){
   return ESDM_SUCCESS;
 }
 
-esdm_status esdm_read_stream(esdm_dataset_t *d, esdm_dataspace_t *space, void * user_ptr, esdm_stream_func_t stream_func, esdm_reduce_func_t reduce_func)
-{
-  // TODO emulation function for now.
-  uint64_t size = esdm_dataspace_total_bytes(space);
-  void * buf = ea_checked_malloc(size);
-  esdm_status ret = esdmI_readWithFillRegion(d, buf, space, NULL);
-  void * intermediate = stream_func(space, buf, user_ptr, d->fill_value);
-  if(reduce_func){
-    reduce_func(space, user_ptr, intermediate);
-  }
-  free(buf);
+esdm_status esdm_read_stream(esdm_dataset_t *d, esdm_dataspace_t *space, void * user_ptr, esdm_stream_func_t stream_func, esdm_reduce_func_t reduce_func) {
+  ESDM_DEBUG(__func__);
+  eassert(d);
+  eassert(space);
+  eassert(stream_func);
 
-  return ESDM_SUCCESS;
+  return esdm_scheduler_read_stream_blocking(esdmI_esdm(), d, space, user_ptr, stream_func, NULL, reduce_func);
+}
+
+esdm_status esdm_read_stream_combine(esdm_dataset_t *d, esdm_dataspace_t *space, void * user_ptr, esdm_stream_func_t stream_func, esdm_combine_func_t combine_func, esdm_reduce_func_t reduce_func) {
+  ESDM_DEBUG(__func__);
+  eassert(d);
+  eassert(space);
+  eassert(stream_func);
+  eassert(combine_func);
+
+  return esdm_scheduler_read_stream_blocking(esdmI_esdm(), d, space, user_ptr, stream_func, combine_func, reduce_func);
 }
 
 esdm_statistics_t esdm_read_stats() { return esdmI_esdm()->readStats; }
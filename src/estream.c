@@ -64,7 +64,25 @@ bool estream_mem_unpack_fragment_param(esdm_fragment_t *f, void ** out_buf, size
 }
 
 int estream_mem_unpack_fragment(esdm_fragment_t *f, void * rbuff, size_t size){
-  if(f->actual_bytes != -1){
+  bool blocked = f->actual_bytes != -1 && esdmI_codec_isBlocked(rbuff, size);
+  if(blocked || (f->actual_bytes != -1 && esdmI_codec_isEncoded(rbuff, size))){
+    // compressed by the built-in pipeline, decompress directly into the fragment if possible
+    void * out = f->dataspace->stride ? ea_checked_malloc(f->bytes) : f->buf;
+    int ret;
+    if(blocked){
+      ret = esdmI_codec_decodeBlocks(rbuff, size, out, f->dataspace->dims, f->dataspace->size, f->bytes);
+    }else{
+      ret = esdmI_codec_decode(rbuff, size, out, f->bytes);
+    }
+    free(rbuff);
+    if(ret != ESDM_SUCCESS){
+      WARN("failed to decompress fragment %s", f->id);
+      if(out != f->buf) free(out);
+      return ret;
+    }
+    if(! f->dataspace->stride) return ESDM_SUCCESS;
+    rbuff = out;
+  }else if(f->actual_bytes != -1){
     // need to decompress
 #ifdef HAVE_SCIL
     SCIL_Datatype_t scil_t = ea_esdm_datatype_to_scil(f->dataspace->type->type);
@@ -108,6 +126,29 @@ int estream_mem_unpack_fragment(esdm_fragment_t *f, void * rbuff, size_t size){
 }
 
 
+// Determines how a fragment is split into independently compressed blocks, returns false if it is compressed as a whole.
+// The blocks are consecutive slices along the first dimension that is larger than one, so that each block is contiguous.
+static bool codec_block_layout(esdm_fragment_t *f, int64_t * out_splitDim, int64_t * out_rowCount, int64_t * out_rowBytes, int64_t * out_rowsPerBlock){
+  esdm_config_t * config = esdmI_getConfig();
+  int64_t blockBytes = config ? config->codecBlockBytes : 1024*1024;
+  if((int64_t) f->bytes <= blockBytes || f->dataspace->dims <= 0) return false;
+
+  int64_t splitDim = 0;
+  while(splitDim < f->dataspace->dims - 1 && f->dataspace->size[splitDim] == 1) splitDim++;
+  int64_t rowCount = f->dataspace->size[splitDim];
+  if(rowCount <= 1 || splitDim > 255) return false;
+  int64_t rowBytes = f->bytes / rowCount;
+  int64_t rowsPerBlock = blockBytes / rowBytes;
+  if(rowsPerBlock < 1) rowsPerBlock = 1;
+  if(rowsPerBlock >= rowCount) return false;
+
+  *out_splitDim = splitDim;
+  *out_rowCount = rowCount;
+  *out_rowBytes = rowBytes;
+  *out_rowsPerBlock = rowsPerBlock;
+  return true;
+}
+
 int estream_mem_pack_fragment(esdm_fragment_t *f, void ** in_out_buff, size_t * out_size){
   int last_phase = 0;
 
@@ -115,8 +156,11 @@ int estream_mem_pack_fragment(esdm_fragment_t *f, void ** in_out_buff, size_t *
     last_phase = 1;
   }
 
+  if(f->dataset->codec){
+    last_phase = 2;
+  }
 #ifdef HAVE_SCIL
-  if(f->dataset->chints && f->dataspace->dims <= 5){
+  else if(f->dataset->chints && f->dataspace->dims <= 5){
     last_phase = 2;
   }
 #endif
@@ -156,7 +200,44 @@ int estream_mem_pack_fragment(esdm_fragment_t *f, void ** in_out_buff, size_t *
   }
 
   // phase 2: compression
-  if(f->dataset->chints && f->dataspace->dims <= 5){
+  if(f->dataset->codec){
+    void * encoded;
+    int64_t encoded_size;
+    int64_t elementSize = esdm_sizeof(f->dataspace->type);
+    int64_t splitDim, rowCount, rowBytes, rowsPerBlock;
+    int ret;
+    // the block table of the previous content is stale now
+    free(f->blocks);
+    f->blocks = NULL;
+    f->notBlocked = false;
+    if(codec_block_layout(f, & splitDim, & rowCount, & rowBytes, & rowsPerBlock)){
+      ret = esdmI_codec_encodeBlocks(f->dataset->codec, elementSize, inBuff, splitDim, rowCount, rowBytes, rowsPerBlock, & encoded, & encoded_size);
+    }else{
+      ret = esdmI_codec_encode(f->dataset->codec, elementSize, inBuff, bytes, & encoded, & encoded_size);
+    }
+    if(ret != ESDM_SUCCESS){
+      free(allocBuff);
+      return ret;
+    }
+    DEBUG("codec compressed: %ld => %ld\n", (long) bytes, (long) encoded_size);
+    if(encoded_size < (int64_t) bytes){
+      f->actual_bytes = encoded_size;
+      bytes = encoded_size;
+      free(allocBuff);
+      allocBuff = encoded;
+      inBuff = encoded;
+    }else{
+      // incompressible data is stored as it is
+      f->actual_bytes = -1;
+      free(encoded);
+    }
+    if(*in_out_buff != NULL && inBuff != *in_out_buff){
+      memcpy(*in_out_buff, inBuff, bytes);
+      inBuff = *in_out_buff;
+      free(allocBuff);
+      allocBuff = NULL;
+    }
+  }else if(f->dataset->chints && f->dataspace->dims <= 5){
 #ifdef HAVE_SCIL
     scil_context_t *ctx;
     // TODO handle special values...  int special_values_count, scil_value_t *special_values
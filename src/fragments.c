@@ -32,6 +32,8 @@ static void esdmI_fragments_deallocateValue(gpointer valueArg) {
 
 void esdmI_fragments_construct(esdm_fragments_t* me) {
   me->table = g_hash_table_new_full(esdmI_fragments_hashKey, esdmI_fragments_equalKeys, esdmI_fragments_deallocateKey, esdmI_fragments_deallocateValue);
+  me->uncommitted = NULL;
+  me->uncommittedCount = me->uncommittedSlots = 0;
 }
 
 esdm_status esdmI_fragments_add(esdm_fragments_t* me, esdm_fragment_t* fragment) {
@@ -49,6 +51,11 @@ esdm_status esdmI_fragments_add(esdm_fragments_t* me, esdm_fragment_t* fragment)
     result = ESDM_INVALID_STATE_ERROR;
   } else {
     g_hash_table_insert(me->table, key, fragment);
+    if(me->uncommittedCount == me->uncommittedSlots) {
+      me->uncommittedSlots = me->uncommittedSlots ? 2*me->uncommittedSlots : 16;
+      me->uncommitted = ea_checked_realloc(me->uncommitted, me->uncommittedSlots*sizeof*me->uncommitted);
+    }
+    me->uncommitted[me->uncommittedCount++] = fragment;
   }
 
   gStats.fragmentAddCalls++;
@@ -85,6 +92,7 @@ static gboolean esdmI_fragments_deleteFragmentsFromBackend(gpointer keyArg, gpoi
 
 esdm_status esdmI_fragments_deleteAll(esdm_fragments_t* me) {
   deleteFragmentsFromBackendState state = { .result = ESDM_SUCCESS };
+  me->uncommittedCount = 0;
   g_hash_table_foreach_remove(me->table, esdmI_fragments_deleteFragmentsFromBackend, &state);
   return state.result;
 }
@@ -175,11 +183,45 @@ void esdmI_fragments_metadata_create(esdm_fragments_t* me, smd_string_stream_t*
   gStats.metadataCreation += ea_stop_timer(myTimer);;
 }
 
+void esdmI_fragments_uncommitted_metadata_create(esdm_fragments_t* me, smd_string_stream_t* stream) {
+  timer myTimer;
+  ea_start_timer(&myTimer);
+
+  smd_string_stream_printf(stream, "[");
+  for(int64_t i = 0; i < me->uncommittedCount; i++) {
+    if(i) smd_string_stream_printf(stream, ",");
+    esdm_fragment_metadata_create(me->uncommitted[i], stream);
+  }
+  smd_string_stream_printf(stream, "]");
+
+  gStats.metadataCreationCalls++;
+  gStats.metadataCreation += ea_stop_timer(myTimer);
+}
+
+esdm_fragment_t** esdmI_fragments_list(esdm_fragments_t* me, int64_t* out_count) {
+  *out_count = g_hash_table_size(me->table);
+  esdm_fragment_t** result = ea_checked_malloc((*out_count + 1)*sizeof*result);
+  GHashTableIter iter;
+  gpointer key, value;
+  int64_t i = 0;
+  g_hash_table_iter_init(&iter, me->table);
+  while(g_hash_table_iter_next(&iter, &key, &value)) result[i++] = value;
+  return result;
+}
+
+void esdmI_fragments_markCommitted(esdm_fragments_t* me) {
+  me->uncommittedCount = 0;
+}
+
 void esdmI_fragments_purge(esdm_fragments_t* me) {
+  me->uncommittedCount = 0;
   g_hash_table_remove_all(me->table);
 }
 
 esdm_status esdmI_fragments_destruct(esdm_fragments_t* me) {
+  free(me->uncommitted);
+  me->uncommitted = NULL;
+  me->uncommittedCount = me->uncommittedSlots = 0;
   g_hash_table_destroy(me->table);
   return ESDM_SUCCESS;
 }
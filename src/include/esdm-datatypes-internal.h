@@ -32,6 +32,12 @@ enum esdm_data_status_e {
 
 typedef enum esdm_data_status_e esdm_data_status_e;
 
+//An opaque token that changes whenever the persistent metadata of a container or dataset changes.
+//The metadata backends derive it from file modification times and sizes, or from version counters, see the `*_stamp` callbacks.
+typedef struct esdm_md_stamp_t {
+  int64_t words[4];
+} esdm_md_stamp_t;
+
 struct esdm_datasets_t {
   esdm_dataset_t ** dset;
   int count;
@@ -46,16 +52,74 @@ struct esdm_container_t {
   int refcount;
   esdm_data_status_e status;
   int mode_flags; // set via esdm_mode_flags_e
+  esdm_md_stamp_t mdStamp; //the stamp of the persistent metadata that this container was loaded from, only valid if `mdStamped` is set
+  bool mdStamped;
+  int64_t mdBytes; //the size of the persistent metadata, used as the cost of keeping the container in the metadata cache
 };
 
 typedef struct esdmI_hypercubeNeighbourManager_t esdmI_hypercubeNeighbourManager_t;
 
 struct esdm_fragments_t {
   GHashTable* table;
+  esdm_fragment_t** uncommitted; //the fragments that were added since the last metadata commit, in the order of their addition
+  int64_t uncommittedCount, uncommittedSlots;
 };
 
 typedef struct esdm_fragments_t esdm_fragments_t;
 
+//A pipeline of the built-in compression stages, see esdm-codec.c.
+typedef struct esdmI_codec_t {
+  int64_t stageCount;
+  esdm_codec_stage_t stages[];
+} esdmI_codec_t;
+
+//The block table of a fragment that has been compressed in independent blocks, see esdm-codec.c.
+typedef struct esdmI_codecBlocks_t {
+  int64_t splitDim;  //the dimension along which the fragment is sliced into blocks
+  int64_t rowsPerBlock;  //the number of slices per block, the last block may hold fewer
+  int64_t blockCount;
+  int64_t offsets[];  //`blockCount + 1` byte offsets of the blocks within the stored data, the last one is the size of the stored data
+} esdmI_codecBlocks_t;
+typedef struct esdmI_fragmentPages_t esdmI_fragmentPages_t;  //the index of a paged fragment table, defined in esdm-fragment-table.c
+typedef struct esdmI_gridIndex_t esdmI_gridIndex_t;  //a search tree over the extends of the complete grids of a dataset, defined in esdm-grid.c
+typedef struct esdmI_gridSynthesis_t esdmI_gridSynthesis_t;  //a background analysis of the fragment decomposition, defined in esdm-grid-synthesis.c
+typedef struct esdmI_hypercube_t esdmI_hypercube_t;  //defined below, used by the metadata backend callbacks
+
+enum { ESDMI_ACCESS_PATTERN_SHAPES = 8 };  //number of distinct read shapes that are tracked per dataset
+
+//Summary of the shapes of the regions that have been read from a dataset.
+//Each tracked shape has a weight that decays exponentially with the number of later reads, so that the summary follows changes of the access pattern.
+typedef struct esdmI_accessPattern_t {
+  int64_t dims;
+  int64_t shapeCount;
+  double weights[ESDMI_ACCESS_PATTERN_SHAPES];
+  int64_t* sizes; //shapeCount*dims entries, NULL if no shape has been recorded yet
+} esdmI_accessPattern_t;
+
+typedef enum esdmI_jsonToken_t {
+  ESDMI_JSON_INVALID, //a syntax error was found, the reader stays in this state
+  ESDMI_JSON_END, //the end of the input or a null byte was reached
+  ESDMI_JSON_OBJECT_START,
+  ESDMI_JSON_OBJECT_END,
+  ESDMI_JSON_ARRAY_START,
+  ESDMI_JSON_ARRAY_END,
+  ESDMI_JSON_KEY, //a string that is followed by a colon
+  ESDMI_JSON_STRING,
+  ESDMI_JSON_NUMBER,
+  ESDMI_JSON_TRUE,
+  ESDMI_JSON_FALSE,
+  ESDMI_JSON_NULL
+} esdmI_jsonToken_t;
+
+//A streaming JSON tokenizer that works directly on the metadata text, see esdm-json-reader.c.
+typedef struct esdmI_jsonReader_t {
+  const char* pos, *end;
+  esdmI_jsonToken_t token; //the last token that was read
+  const char* text; //the text of the last key, string, number or literal within the input, without the quotes and with the escapes still in place, NULL for punctuation
+  int64_t length;
+  bool ok;  //turns false on the first error
+} esdmI_jsonReader_t;
+
 struct esdm_dataset_t {
   char *name;
   char *id;
@@ -66,13 +130,25 @@ struct esdm_dataset_t {
   smd_attr_t *attr;
   int64_t *actual_size; // used for unlimited dimensions
   esdm_fragments_t fragments;
+  esdmI_fragmentPages_t* fragmentPages; //the persistent fragments that are decoded on demand, NULL once all fragments are in `fragments`
   int64_t gridCount, incompleteGridCount, gridSlotCount;
   esdm_grid_t** grids; //This array first contains the complete grids, then the grids that still lack some subgrids/fragments, and finally some pointers that are allocated but not used.
                       //When a grid is completed, it is swapped with the first incomplete grid and the grid counts are adjusted accordingly. This should be more efficient than managing two separate arrays.
+  esdmI_gridIndex_t* gridIndex; //indexes the complete grids for esdmI_dataset_gridsCoveringRegion(), NULL as long as there are none
+  esdmI_gridSynthesis_t* gridSynthesis; //the pending analysis of the fragment decomposition, NULL if there is none
+  int64_t gridSynthesisFragments; //the fragment count at the last analysis, each set of fragments is analyzed only once
   int refcount;
   esdm_data_status_e status;
   int mode_flags; // set via esdm_mode_flags_e
   scil_user_hints_t * chints; // compression hints from SCIL, NULL if none available
+  esdmI_codec_t * codec; // the built-in compression pipeline, NULL if none is set, takes precedence over `chints`
+  esdmI_accessPattern_t accessPattern;
+  char* committedHeader; //the metadata without the fragments and the access pattern, and with only the first `committedGridCount` grids, as it was last committed; NULL if there is no committed snapshot
+  int64_t committedGridCount; //the complete grids that are persistent, the grids that are completed later are appended to the journal
+  char* committedAccessPattern; //the serialized access pattern as it was last committed, NULL if it was empty
+  int64_t snapshotBytes, journalBytes; //the current size of the persistent metadata snapshot and of the journal that is appended to it
+  esdm_md_stamp_t mdStamp; //the stamp of the persistent metadata that the fragments were loaded from, only valid if `mdStamped` is set
+  bool mdStamped;
 };
 
 struct esdm_fragment_t {
@@ -88,6 +164,10 @@ struct esdm_fragment_t {
   //int direct_io;
   esdm_data_status_e status;
   bool ownsBuf; //If true, the fragment is responsible to free the buffer when it's destructed or unloaded. Otherwise, `buf` is just a reference for zero copy writing.
+  //The block table of the stored data, NULL if it has not been read yet (or if the data is not block compressed).
+  //Set by the first partial read of a compressed fragment, see esdm_scheduler_enqueue_read().
+  esdmI_codecBlocks_t* blocks;
+  bool notBlocked;  //a partial read has found that the stored data is not block compressed
 };
 
 // MODULES ////////////////////////////////////////////////////////////////////
@@ -156,6 +236,20 @@ struct esdm_backend_t_callbacks_t {
    */
   //TODO: I find the semantics of `cur_buf` and `cur_offset` surprising. Imho, we should redesign this call, possibly splitting it into two or three functions.
   int (*fragment_write_stream_blocksize)(esdm_backend_t * b, estream_write_t * state, void * cur_buf, size_t cur_offset, uint64_t cur_size);
+
+  /**
+   * Read a part of the stored data of a fragment as it is, without unpacking it.
+   *
+   * @param[in] backend the backend object
+   * @param[in] fragment the fragment, its `actual_bytes` tell the size of the stored data
+   * @param[in] offset the byte offset of the first byte to read within the stored data
+   * @param[in] size count of bytes to read
+   * @param[out] buf the buffer that receives the data
+   *
+   * This is used to read only the needed blocks of a block compressed fragment (see esdm-codec.c).
+   * Optional: Backends without this callback always read entire fragments.
+   */
+  int (*fragment_retrieve_range)(esdm_backend_t * b, esdm_fragment_t *fragment, int64_t offset, int64_t size, void * buf);
 };
 
 struct esdm_md_backend_callbacks_t {
@@ -177,6 +271,27 @@ struct esdm_md_backend_callbacks_t {
   int (*dataset_update)(esdm_md_backend_t *, esdm_dataset_t *dataset);
   int (*dataset_destroy)(esdm_md_backend_t *, esdm_dataset_t *dataset);
   int (*dataset_remove)(esdm_md_backend_t *, esdm_dataset_t *dataset);
+  //Optional support for incremental commits: dataset_append() adds a record to the dataset's metadata journal,
+  //dataset_retrieve_journal() fetches all records that were appended since the last dataset_commit(), which empties the journal.
+  //out_json is set to NULL if the journal is empty.
+  int (*dataset_append)(esdm_md_backend_t *, esdm_dataset_t *dataset, char * json, int md_size);
+  int (*dataset_retrieve_journal)(esdm_md_backend_t *, esdm_dataset_t *dataset, char ** out_json, int * out_size);
+  //Optional support for the metadata cache: return a stamp that changes whenever the persistent metadata of the object changes.
+  //These should be much cheaper than retrieving the metadata, the cache is disabled for backends that do not provide them.
+  int (*container_stamp)(esdm_md_backend_t *, esdm_container_t *container, esdm_md_stamp_t * out_stamp);
+  int (*dataset_stamp)(esdm_md_backend_t *, esdm_dataset_t *dataset, esdm_md_stamp_t * out_stamp);
+  //Optional support for region queries: return the committed fragments of the dataset that intersect the region as a sequence of binary fragment tables (see esdm-fragment-table.c).
+  //This allows a reader to decode only the fragments it needs instead of entire pages of the snapshot.
+  int (*dataset_fragments_in_region)(esdm_md_backend_t *, esdm_dataset_t *dataset, esdmI_hypercube_t *region, char ** out_tables, int64_t * out_size);
+  //Optional support for partial reads of a snapshot: copy up to `size` bytes of the snapshot, starting at `offset`, into `out_data`.
+  //`out_size` receives the number of bytes copied, which is less than `size` only at the end of the snapshot.
+  //With this, opening a dataset only reads the JSON part and the page index of the snapshot, the pages of the fragment table are read when they are needed.
+  int (*dataset_retrieve_range)(esdm_md_backend_t *, esdm_dataset_t *dataset, int64_t offset, int64_t size, char * out_data, int64_t * out_size);
+  //Optional storage for the fitted I/O models of the data backends (see esdmI_ioModel_t), keyed by the id of the data backend.
+  //This lets a new process start from the fit of the previous runs, and esdm-stat report it.
+  //performance_model_retrieve() returns an error if nothing has been stored for the backend yet.
+  int (*performance_model_commit)(esdm_md_backend_t *, const char *backendId, char * json, int size);
+  int (*performance_model_retrieve)(esdm_md_backend_t *, const char *backendId, char ** out_json, int * out_size);
 
   int (*mkfs)(esdm_md_backend_t *, int format_flags);
   int (*fsck)(esdm_md_backend_t*);
@@ -194,6 +309,16 @@ typedef enum esdmI_fragmentation_method_t {
  * Each backend provides
  *
  */
+//Online fit of the latency/throughput curve of a backend from the I/O operations it has actually performed.
+//The sums decay exponentially so that the model follows changes in the backend performance.
+typedef struct esdmI_ioModel_t {
+  GMutex mutex;
+  double samples, sumBytes, sumTime, sumBytesSquared, sumBytesTime;
+  double latency, throughput; //the current fit, zero if there are not enough samples yet
+  int64_t fragmentSize; //the auto tuned fragment size, zero if it has not been determined yet
+  bool updated; //new samples have been recorded since the model was loaded from the metadata backend
+} esdmI_ioModel_t;
+
 struct esdm_backend_t {
   esdm_config_backend_t *config;
   char *name;
@@ -204,6 +329,10 @@ struct esdm_backend_t {
   esdm_backend_t_callbacks_t callbacks;
   int threads;
   GThreadPool *threadPool;
+  //work that has been handed to the backend but has not completed yet, used to make load aware placement decisions
+  atomic_int_least64_t queuedBytes;
+  atomic_int queuedOps;
+  esdmI_ioModel_t ioModel;
 };
 
 struct esdm_md_backend_t {
@@ -216,7 +345,9 @@ struct esdm_md_backend_t {
 
 typedef enum io_operation_t {
   ESDM_OP_WRITE = 0,
-  ESDM_OP_READ
+  ESDM_OP_READ,
+  ESDM_OP_WRITE_STREAM,  //write one chunk of a write stream, see esdmI_scheduler_writeStreamChunkNonblocking()
+  ESDM_OP_READ_BLOCK  //read one block of a block compressed fragment, see esdm_scheduler_enqueue_read()
 } io_operation_t;
 
 typedef struct io_request_status_t {
@@ -229,6 +360,25 @@ typedef struct io_request_status_t {
 typedef struct {
   void *mem_buf;
   esdm_dataspace_t *buf_space;
+  //used when the data of a fragment is needed by several destinations, the callback takes possession of the arrays
+  int64_t destCount;
+  void **mem_bufs;
+  esdm_dataspace_t **buf_spaces;
+  //used for point reads: pointCount pairs of byte offsets into the fragment's data and into mem_buf, the array is owned by the caller
+  int64_t pointCount;
+  int64_t *pointOffsets;
+  //used for streaming reads: the part of the fragment that is passed to the stream function, owned by the callback
+  struct readStream_t *stream;
+  struct esdmI_hypercubeSet_t *streamRegion;
+  int64_t streamBytes;  //the amount of memory that this task counts against the stream's window
+  bool unloadFragment;  //the fragment was loaded only for the stream, so it is unloaded once it has been processed
+  //used for write streams: `mem_buf` contains `streamChunkSize` bytes that are written at `streamChunkOffset` within the fragment of `streamState`
+  estream_write_t *streamState;
+  int64_t streamChunkOffset, streamChunkSize;
+  void *streamOwner;  //opaque pointer for the callback
+  //used for block reads: the block of a block compressed fragment that is copied to `mem_buf`, -1 if the block table must be read first
+  int64_t block;
+  int64_t blockBytes;  //the uncompressed size of the block
 } io_work_callback_data_t;
 
 typedef struct io_work_t io_work_t;
@@ -240,6 +390,7 @@ struct io_work_t {
   io_request_status_t *parent;
   void (*callback)(io_work_t *work);
   io_work_callback_data_t data;
+  int64_t queuedBytes;  //the amount of bytes this task added to the queue of its backend
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -257,6 +408,7 @@ struct esdm_config_backend_t {
   int max_threads_per_node;
   int max_global_threads;
   uint64_t max_fragment_size; //this is a soft limit that may be exceeded anytime
+  double fragment_size_efficiency; //if positive, the fragment size is auto tuned so that this fraction of the streaming bandwidth is reached, `max_fragment_size` is only used until the backend performance is known
   esdmI_fragmentation_method_t fragmentation_method;
   data_accessibility_t data_accessibility;
   uint32_t write_stream_blocksize; /* size in bytes for enabling write streaming, 0 if disabled */
@@ -297,6 +449,10 @@ enum {
 typedef struct esdm_config_t {
   void *json;
   uint8_t boundListImplementation;  //one of the BOUND_LIST_IMPLEMENTATION_* constants
+  int64_t metadataCacheBytes;  //the budget of the metadata cache, zero disables it
+  int64_t readStreamWindowBytes;  //the maximum amount of fragment data that esdm_read_stream() keeps in memory at any time
+  int64_t codecBlockBytes;  //the uncompressed size of the independently compressed blocks of a fragment that is written with a codec hint
+  int64_t gridSynthesisMinFragments;  //the minimum fragment count of a dataset to look for a grid in its fragments, zero disables the grid synthesis
 } esdm_config_t;
 
 typedef struct esdm_modules_t {
@@ -350,7 +506,6 @@ struct esdmI_range_t {
   int64_t start, end; //start is inclusive, end is exclusive, i.e. the range includes all `x` with `start <= x < end`
 };
 
-typedef struct esdmI_hypercube_t esdmI_hypercube_t;
 struct esdmI_hypercube_t {
   int64_t dims;
   esdmI_range_t ranges[];
@@ -494,6 +649,7 @@ struct esdm_backendTimes_t {
   double mkfs;
   double fsck;
   double fragment_write_stream_blocksize;
+  double fragment_retrieve_range;
 };
 
 //statistics for the handling of fragments
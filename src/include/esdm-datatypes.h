@@ -47,6 +47,17 @@ typedef enum esdm_status {
   ESDM_DELETED_DATA_ERROR   //attempt to access data that has been deleted from disk
 } esdm_status;
 
+/**
+ * The stages of the built-in lossless compression pipeline, see `esdm_dataset_set_codec_hint()`.
+ */
+typedef enum esdm_codec_stage_t {
+  ESDM_CODEC_BYTE_SHUFFLE = 1, //group the n-th bytes of all elements together
+  ESDM_CODEC_BIT_SHUFFLE, //group the n-th bits of all elements together
+  ESDM_CODEC_DELTA, //replace each element by its integer difference to the previous element, suited for integer data
+  ESDM_CODEC_XOR, //replace each element by its bitwise XOR with the previous element, suited for floating point data
+  ESDM_CODEC_LZ //fast LZ77 style compression of the resulting byte stream
+} esdm_codec_stage_t;
+
 /**
  * ESDM provides logging helpers, the available loglevels are defined here.
  */
@@ -230,6 +230,44 @@ esdm_status esdm_write_grid(esdm_grid_t* grid, esdm_dataspace_t* memspace, void*
  */
 esdm_status esdm_read_grid(esdm_grid_t* grid, esdm_dataspace_t* memspace, void* buffer);
 
+/**
+ * esdm_write_grid_cells()
+ *
+ * Provide the data for several grid cells at once.
+ *
+ * @param[in] grid defines the dataset as well as the legal shapes of cells that may be written to
+ * @param[in] count the number of cells to write
+ * @param[in] memspaces array of `count` dataspaces, each of which defines a cell that is to be written as well as the data layout within the respective buffer
+ * @param[in] buffers array of `count` pointers to the first data element of the respective cell
+ *
+ * This is equivalent to calling `esdm_write_grid()` for each cell,
+ * except that all the cells are handed to the backends at once, and written in parallel with a single wait.
+ * All memspaces are checked before anything is written, so an invalid memspace does not leave a partial write behind.
+ *
+ * @return `ESDM_SUCCESS` on success, `ESDM_INVALID_ARGUMENT_ERROR` if any `memspace` does not correspond to a single cell exactly, `ESDM_INVALID_STATE_ERROR` if a grid cell contains a subgrid
+ */
+esdm_status esdm_write_grid_cells(esdm_grid_t* grid, int64_t count, esdm_dataspace_t** memspaces, void** buffers);
+
+/**
+ * esdm_read_grid_region()
+ *
+ * Read an arbitrary region within the domain of a grid into memory.
+ *
+ * @param[in] grid the grid whose cells are used to read the data
+ * @param[in] memspace defines which region is to be read as well as the data layout within the buffer
+ * @param[out] buffer pointer to the first data element that is to be read
+ *
+ * The region does not need to be aligned with the cells, it may span any number of cells and subgrid cells.
+ * The fragments of all affected cells are read in parallel with a single wait.
+ *
+ * Like with `esdm_read_grid()`, cells that do not contain data themselves are read from the other fragments of the dataset,
+ * and written back as a whole to accelerate future reads on the same grid.
+ * These write-backs are performed in parallel as well.
+ *
+ * @return `ESDM_SUCCESS` on success, `ESDM_INVALID_ARGUMENT_ERROR` if the `memspace` is not within the domain of the grid
+ */
+esdm_status esdm_read_grid_region(esdm_grid_t* grid, esdm_dataspace_t* memspace, void* buffer);
+
 /**
  * esdm_dataset_grids()
  *
@@ -318,6 +356,14 @@ void esdm_gridIterator_destroy(esdm_gridIterator_t* iterator);
 void esdmI_dataset_registerGrid(esdm_dataset_t* dataset, esdm_grid_t* grid);
 void esdmI_dataset_registerGridCompletion(esdm_dataset_t* dataset, esdm_grid_t* grid);
 
+//Select the complete grids that serve a read of the region.
+//This is either the single grid that contains the region with the smallest overhead, or, if there is no such grid, a set of grids that jointly cover the region.
+//Returns NULL if the complete grids do not cover the region, the caller is responsible to free the returned array.
+esdm_grid_t** esdmI_dataset_gridsCoveringRegion(esdm_dataset_t* dataset, esdmI_hypercube_t* region, int64_t* out_gridCount);
+
+void esdmI_gridIndex_add(esdm_dataset_t* dataset, esdm_grid_t* grid);  //called by esdmI_dataset_registerGridCompletion()
+void esdmI_gridIndex_destroy(esdmI_gridIndex_t* index);  //must be called whenever the dataset forgets its grids, NULL is a noop
+
 //Compute the total size of the grid cells that intersect the region.
 //This assumes that the grid is complete, i.e. it does not waste time checking presence of fragments and subgrids.
 int64_t esdmI_grid_coverRegionSize(const esdm_grid_t* grid, const esdmI_hypercube_t* region);
@@ -326,6 +372,10 @@ int64_t esdmI_grid_coverRegionSize(const esdm_grid_t* grid, const esdmI_hypercub
 //TODO: Make this recurs into subgrids to get a precise result, currently this may overestimate the overhead.
 int64_t esdmI_grid_coverRegionOverhead(esdm_grid_t* grid, esdmI_hypercube_t* region);
 
+//Put an existing fragment into the grid cell that matches its dataspace exactly.
+//Fails if there is no such cell, or if the cell already has a fragment.
+esdm_status esdmI_grid_addFragment(esdm_grid_t* grid, esdm_fragment_t* fragment);
+
 //Recursively list all fragments in the grid that intersect with the given region.
 //There must be no empty cells within the provided region, and there must be an overlap with the region.
 esdm_status esdmI_grid_fragmentsInRegion(esdm_grid_t* grid, esdmI_hypercube_t* region, int64_t* out_fragmentCount, esdm_fragment_t*** out_fragments);
@@ -333,12 +383,37 @@ esdm_status esdmI_grid_fragmentsInRegion(esdm_grid_t* grid, esdmI_hypercube_t* r
 //For use by esdm_mpi and storing as metadata.
 //This puts the grid into fixed structure state.
 void esdmI_grid_serialize(smd_string_stream_t* stream, esdm_grid_t* grid);  //the resulting stream is in JSON format
-esdm_status esdmI_grid_createFromJson(json_t* json, esdm_dataset_t* dataset, esdm_grid_t* parent, esdm_grid_t** out_grid);
+esdm_status esdmI_grid_createFromReader(esdmI_jsonReader_t* reader, esdm_dataset_t* dataset, esdm_grid_t* parent, esdm_grid_t** out_grid);  //reads the next value from the reader, which must be a serialized grid
 esdm_status esdmI_grid_createFromString(const char* serializedGrid, esdm_dataset_t* dataset, esdm_grid_t** out_grid);
 //These two functions must be called with a string/json that was created from a copy of the grid, i.e. the grid IDs must match.
 esdm_status esdmI_grid_mergeWithJson(esdm_grid_t* grid, json_t* json);
 esdm_status esdmI_grid_mergeWithString(esdm_grid_t* grid, const char* serializedGrid);
 
+/**
+ * Encode a top-level grid in the compact binary format that is used to exchange grids between processes.
+ *
+ * @param [in] grid the grid to encode, a full encoding puts it into fixed structure state
+ * @param [in] incremental if false, the encoding contains the structure of the grid and the fragments of all its cells;
+ *                         if true, it contains only the fragments of the cells that this process has filled since the grid was created from a binary encoding or last encoded incrementally,
+ *                         or the fragments of all cells if neither has happened yet
+ * @param [out] out_size the size of the returned encoding in bytes
+ *
+ * @return a newly allocated buffer containing the encoding, the caller is responsible to free() it
+ */
+char* esdmI_grid_encode(esdm_grid_t* grid, bool incremental, int64_t* out_size);
+
+//Creates a new top-level grid from a full binary encoding, and adds its fragments to the dataset.
+//If the fragments cannot be put into the cells of the grid, an error is returned, but the grid remains registered with the dataset.
+esdm_status esdmI_grid_createFromBinary(const char* data, int64_t size, esdm_dataset_t* dataset, esdm_grid_t** out_grid);
+
+//Fills the empty cells of the grid with the fragments of a binary encoding of a copy of the grid, returns ESDM_INVALID_STATE_ERROR if the grid IDs do not match.
+esdm_status esdmI_grid_mergeWithBinary(esdm_grid_t* grid, const char* data, int64_t size);
+
+//Combines two binary encodings of copies of the same grid into an incremental encoding that contains the fragments of both, without decoding any fragments.
+//This is used to combine the encodings of many processes along a reduction tree.
+//Returns ESDM_INVALID_STATE_ERROR if the grid IDs do not match, and ESDM_INVALID_DATA_ERROR if one of the encodings is corrupt.
+esdm_status esdmI_grid_mergeEncodings(const char* a, int64_t aSize, const char* b, int64_t bSize, char** out_data, int64_t* out_size);
+
 //Access the ID of a grid.
 //Returns NULL if the grid is not in fixed structure state yet (i.e. if it has not been (de-)serialized yet).
 //The returned pointer is owned by the grid, do not modify or deallocate it.
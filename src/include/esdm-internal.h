@@ -73,7 +73,8 @@ esdm_modules_t *esdm_modules_init(esdm_instance_t *esdm);
 esdm_backend_t* esdm_modules_fastestBackend(esdm_modules_t* modules);
 
 /*
- * Randomly assign a backend based on their performance
+ * Randomly assign a backend based on their performance.
+ * The probability of a backend is proportional to the inverse of the time it is expected to need for a fragment, including the work already queued on it.
  */
 esdm_backend_t* esdm_modules_randomWeightedBackend(esdm_modules_t* modules);
 
@@ -86,9 +87,14 @@ esdm_status esdm_modules_finalize();
  * @param [in] space the dataspace for which the recommendation is to be made
  * @param [out] out_moduleCount returns the number of recommended backends
  * @param [out] out_maxFragmentSize a max fragment size that is suitable for use with all the recommended backends (optional, may be NULL)
+ * @param [out] out_shares returns a freshly allocated array of *out_moduleCount fractions of the data that should go to the respective backend, these sum up to one (optional, may be NULL)
  * @return a freshly allocated array of *out_moduleCount backend pointers, must be free'd by the caller
+ *
+ * The backends are selected based on their performance model, the work that is already queued on them, and their data accessibility.
+ * The shares are chosen so that all recommended backends are expected to finish at the same time,
+ * backends that would not even have drained their queue by that time are not recommended.
  */
-esdm_backend_t** esdm_modules_makeBackendRecommendation(esdm_modules_t* modules, esdm_dataspace_t* space, int64_t* out_moduleCount, int64_t* out_maxFragmentSize);
+esdm_backend_t** esdm_modules_makeBackendRecommendation(esdm_modules_t* modules, esdm_dataspace_t* space, int64_t* out_moduleCount, int64_t* out_maxFragmentSize, double** out_shares);
 
 esdm_status esdm_modules_register();
 
@@ -120,10 +126,57 @@ esdm_status esdm_scheduler_read_blocking(esdm_instance_t *esdm, esdm_dataset_t *
 
 esdm_status esdm_scheduler_write_blocking(esdm_instance_t *esdm, esdm_dataset_t *dataset, void *buf, esdm_dataspace_t *memspace, bool requestIsInternal);
 
+/**
+ * Read several regions of a dataset with a single wait.
+ * Each fragment that is needed by any of the regions is loaded only once, and its data is copied to all regions that overlap it.
+ * Data holes are filled with the fill value, if one is set, otherwise ESDM_INCOMPLETE_DATA is returned without reading anything.
+ */
+esdm_status esdm_scheduler_read_multi_blocking(esdm_instance_t *esdm, esdm_dataset_t *dataset, int64_t count, void **bufs, esdm_dataspace_t **memspaces, bool requestIsInternal);
+
+/**
+ * Read individual elements of a dataset with a single wait.
+ * `coords` contains `count` points with one coordinate per dimension of the dataset, the values are stored consecutively in `buf` using the dataset's type.
+ * Each fragment that contains any of the points is loaded only once.
+ * Points that are not covered by any fragment receive the fill value, if one is set, otherwise ESDM_INCOMPLETE_DATA is returned without reading anything.
+ */
+esdm_status esdm_scheduler_read_points_blocking(esdm_instance_t *esdm, esdm_dataset_t *dataset, int64_t count, const int64_t *coords, void *buf, bool requestIsInternal);
+
+/**
+ * Stream a region of a dataset through a user function, see esdm_read_stream() and esdm_read_stream_combine().
+ * Each fragment is loaded at most once, and only while its data is processed; fragments that are completely hidden by other fragments are not loaded at all.
+ * The fragment loads are throttled so that the loaded data never exceeds the configured window.
+ * If `combine_func` is NULL, the stream outputs are passed to `reduce_func` one by one on the calling thread.
+ */
+esdm_status esdm_scheduler_read_stream_blocking(esdm_instance_t *esdm, esdm_dataset_t *dataset, esdm_dataspace_t *memspace, void *user_ptr, esdm_stream_func_t stream_func, esdm_combine_func_t combine_func, esdm_reduce_func_t reduce_func);
+
+/**
+ * Like esdm_scheduler_read_stream_blocking(), but read from the given fragment list instead of looking the fragments up.
+ * This neither loads fragments into the dataset, nor records the read, nor touches the global statistics,
+ * so it may run on a background thread as long as the fragments stay alive; the I/O is added to `inout_stats`.
+ */
+esdm_status esdmI_scheduler_readStreamFragments(esdm_instance_t *esdm, esdm_dataset_t *dataset, int64_t fragmentCount, esdm_fragment_t** fragments, esdm_dataspace_t *memspace, void *user_ptr, esdm_stream_func_t stream_func, esdm_combine_func_t combine_func, esdm_reduce_func_t reduce_func, esdm_statistics_t* inout_stats);
+
+void esdmI_scheduler_addReadStats(esdm_instance_t* esdm, const esdm_statistics_t* stats); //adds statistics that were collected with esdmI_scheduler_readStreamFragments()
+
+/**
+ * Write several regions of a dataset with a single wait.
+ */
+esdm_status esdm_scheduler_write_multi_blocking(esdm_instance_t *esdm, esdm_dataset_t *dataset, int64_t count, void **bufs, esdm_dataspace_t **memspaces, bool requestIsInternal);
+
+/**
+ * Hand one chunk of a write stream to the thread pool of the stream's backend.
+ * The chunk is written with the backend's `fragment_write_stream_blocksize()` callback, `callback` is called once that is done.
+ * The caller must ensure that the chunks of a fragment are passed in order, and that only one chunk per fragment is in flight at any time.
+ * The buffer must remain valid until the callback has been called.
+ */
+void esdmI_scheduler_writeStreamChunkNonblocking(esdm_instance_t* esdm, esdm_backend_t* backend, estream_write_t* state, void* buffer, int64_t offset, int64_t size, void (*callback)(io_work_t* work), void* owner, io_request_status_t* status);
+
 esdm_status esdmI_scheduler_writeFragmentBlocking(esdm_instance_t* esdm, esdm_fragment_t* fragment, bool requestIsInternal);
+esdm_status esdmI_scheduler_writeFragmentsBlocking(esdm_instance_t* esdm, int64_t count, esdm_fragment_t** fragments, bool requestIsInternal); //writes all fragments in parallel with a single wait
 void esdmI_scheduler_writeFragmentNonblocking(esdm_instance_t* esdm, esdm_fragment_t* fragment, bool requestIsInternal, io_request_status_t* status);
 
 esdm_status esdmI_scheduler_readSingleFragmentBlocking(esdm_instance_t* esdm, esdm_dataset_t* dataset, void* buffer, esdm_dataspace_t* memspace, esdm_fragment_t* fragment);
+esdm_status esdmI_scheduler_readFragmentsBlocking(esdm_instance_t* esdm, esdm_dataset_t* dataset, void* buffer, esdm_dataspace_t* memspace, int64_t count, esdm_fragment_t** fragments); //reads the given (distinct) fragments in parallel with a single wait, copying the parts that overlap `memspace` to `buffer`
 
 esdm_status esdm_scheduler_enqueue(esdm_instance_t *esdm, io_request_status_t *status, io_operation_t type, esdm_dataset_t *dataset, void *buf, esdm_dataspace_t *memspace);
 
@@ -162,6 +215,40 @@ esdm_status esdm_performance_recommendation(esdm_instance_t *esdm, esdm_fragment
 
 esdm_status esdm_performance_finalize();
 
+/**
+ * Feed the measured duration of a backend I/O operation into the online latency/throughput fit of the backend.
+ */
+void esdmI_performance_recordBackendIo(esdm_backend_t* backend, int64_t bytes, double seconds);
+
+/**
+ * Get the latency (in seconds) and throughput (in bytes per second) of a backend.
+ * These are fitted to the measured I/O operations if enough of them are available, otherwise the configured performance model is used.
+ * The fit is stored in the metadata backend when ESDM is finalized, and a new process continues with it.
+ *
+ * @return true if the values are fitted to measurements of this or a previous run, false if they are the static prediction of the configured performance model
+ */
+bool esdmI_performance_backendModel(esdm_backend_t* backend, double* out_latency, double* out_throughput);
+
+/**
+ * Load the I/O model that a previous run has stored for the data backend, if the metadata backend supports this.
+ * Must be called before the backend performs any I/O.
+ */
+void esdmI_performance_loadBackendModel(esdm_md_backend_t* md, esdm_backend_t* backend);
+
+/**
+ * Store the I/O model of the data backend in the metadata backend if new measurements have been made since it was loaded.
+ */
+void esdmI_performance_storeBackendModel(esdm_md_backend_t* md, esdm_backend_t* backend);
+
+/**
+ * Get the fragment size that should be used for the given backend.
+ *
+ * This is the configured `max-fragment-size` unless that is set to "auto".
+ * In that case, the fragment size is derived from the latency/throughput curve of the backend,
+ * so that the fraction "fragment-size-efficiency" (default 0.9) of the streaming bandwidth is reached.
+ */
+int64_t esdmI_backend_fragmentSize(esdm_backend_t* backend);
+
 esdm_readTimes_t esdmI_performance_read();
 esdm_readTimes_t esdmI_performance_read_add(const esdm_readTimes_t* a, const esdm_readTimes_t* b);
 esdm_readTimes_t esdmI_performance_read_sub(const esdm_readTimes_t* minuend, const esdm_readTimes_t* subtrahend);
@@ -201,6 +288,7 @@ int esdmI_backend_fragment_metadata_free (esdm_backend_t * b, void * options);
 int esdmI_backend_mkfs(esdm_backend_t * b, int format_flags);
 int esdmI_backend_fsck(esdm_backend_t * b);
 int esdmI_backend_fragment_write_stream_blocksize(esdm_backend_t * b, estream_write_t * state, void * cur_buf, size_t cur_offset, uint32_t cur_size);
+int esdmI_backend_fragment_retrieve_range(esdm_backend_t * b, esdm_fragment_t *fragment, int64_t offset, int64_t size, void * buf);
 
 double esdmI_backendOutputTime();
 double esdmI_backendInputTime();
@@ -233,8 +321,10 @@ esdm_status esdmI_container_destroy(esdm_container_t *container);
 
 void esdm_dataset_init(esdm_container_t *container, const char *name, esdm_dataspace_t *dataspace, esdm_dataset_t **out_dataset);
 
-esdm_status esdm_dataset_open_md_load(esdm_dataset_t *dset, char ** out_md, int * out_size);
+esdm_status esdm_dataset_open_md_load(esdm_dataset_t *dset, char ** out_md, int * out_size);  //reads only the header and the page index of a paged fragment table if the metadata backend supports it, the pages are fetched when they are needed
+esdm_status esdmI_dataset_open_md_loadComplete(esdm_dataset_t *dset, char ** out_md, int * out_size);  //always reads the entire snapshot, used when the metadata is shared with other processes that must not fetch pages on their own
 esdm_status esdm_dataset_open_md_parse(esdm_dataset_t *d, char * md, int size);
+void esdmI_dataset_metadata_create(esdm_dataset_t *d, smd_string_stream_t *s);  //serializes the complete metadata as JSON, including the fragments, for human inspection
 
 esdm_status esdmI_dataset_fragmentsCoveringRegion(esdm_dataset_t* dataset, esdmI_hypercube_t* region, int64_t* out_count, esdm_fragment_t*** out_fragments, esdmI_hypercubeSet_t** out_uncovered, bool* out_fullyCovered);
 
@@ -256,6 +346,9 @@ esdm_fragment_t* esdmI_dataset_lookupFragmentForShape(esdm_dataset_t* dataset, e
  */
 esdm_status esdmI_dataset_destroy(esdm_dataset_t *dataset);
 
+//Drops the attributes and fragments of a dataset that is not referenced any more, leaving only the reference that the container holds.
+void esdmI_dataset_unload(esdm_dataset_t *dataset);
+
 
 ///////////////////////////////////////////////////////////////////////////////
 // Dataspace //////////////////////////////////////////////////////////////////
@@ -282,6 +375,9 @@ esdm_status esdmI_dataspace_createFromHypercube(esdmI_hypercube_t* extends, esdm
  */
 esdm_status esdmI_dataspace_createFromJson(json_t* json, esdm_dataset_t* dataset, esdm_dataspace_t** out_dataspace);
 
+//Same as esdmI_dataspace_createFromJson(), but reads the next value from a JSON reader.
+esdm_status esdmI_dataspace_createFromReader(esdmI_jsonReader_t* reader, esdm_dataset_t* dataset, esdm_dataspace_t** out_dataspace);
+
 /**
  * Get the logical extends covered by a dataspace in the form of an `esdmI_hypercube_t`.
  *
@@ -303,6 +399,28 @@ esdm_status esdmI_dataspace_getExtends(esdm_dataspace_t* space, esdmI_hypercube_
 esdm_status esdmI_dataspace_setExtends(esdm_dataspace_t* space, esdmI_hypercube_t* extends);
 
 
+///////////////////////////////////////////////////////////////////////////////
+// Access pattern /////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+void esdmI_accessPattern_construct(esdmI_accessPattern_t* me);
+void esdmI_accessPattern_recordRead(esdmI_accessPattern_t* me, esdmI_hypercube_t* region);
+void esdmI_accessPattern_serialize(smd_string_stream_t* stream, const esdmI_accessPattern_t* me);  //the resulting stream is in JSON format
+esdm_status esdmI_accessPattern_loadJson(esdmI_accessPattern_t* me, json_t* json);
+void esdmI_accessPattern_destruct(esdmI_accessPattern_t* me);
+
+/**
+ * Determine the fragment shape that minimizes the expected read amplification for the recorded access pattern.
+ *
+ * @param [in] me the access pattern of the dataset
+ * @param [in] space the dataspace that is to be split into fragments
+ * @param [in] maxFragmentSize the size in bytes that the fragments should not exceed
+ * @param [out] out_edges array of `space->dims` edge lengths of the recommended fragments
+ *
+ * @return true if a recommendation was made, false if not enough reads have been recorded to justify one
+ */
+bool esdmI_accessPattern_fragmentShape(const esdmI_accessPattern_t* me, esdm_dataspace_t* space, int64_t maxFragmentSize, int64_t* out_edges);
+
 ///////////////////////////////////////////////////////////////////////////////
 // Fragment ///////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
@@ -313,11 +431,273 @@ esdm_fragment_t* esdmI_fragments_lookupForShape(esdm_fragments_t* me, esdmI_hype
 esdm_status esdmI_fragments_deleteAll(esdm_fragments_t* me);  //calls `esdmI_backend_fragment_delete()` and `esdmI_fragment_destroy()` on all fragments, leaving the fragment list empty on success
 esdm_fragment_t** esdmI_fragments_makeSetCoveringRegion(esdm_fragments_t* me, esdmI_hypercube_t* region, int64_t* out_fragmentCount);  //caller is responsible to free the returned array
 void esdmI_fragments_metadata_create(esdm_fragments_t* me, smd_string_stream_t* s);
+void esdmI_fragments_uncommitted_metadata_create(esdm_fragments_t* me, smd_string_stream_t* s); //serializes only the fragments that were added since the last call to `esdmI_fragments_markCommitted()`
+void esdmI_fragments_markCommitted(esdm_fragments_t* me);  //forgets which fragments were added, call this after their metadata has been persisted
+esdm_fragment_t** esdmI_fragments_list(esdm_fragments_t* me, int64_t* out_count);  //caller is responsible to free the returned array
 void esdmI_fragments_purge(esdm_fragments_t* me); //this will `esdm_fragment_destroy()` all currently stored fragments
 esdm_status esdmI_fragments_destruct(esdm_fragments_t* me);  //calls `esdm_fragment_destroy()` on its members, but does not invoke the `fragment_delete()` callback of the backend
 
 void esdm_fragment_metadata_create(esdm_fragment_t *f, smd_string_stream_t * stream);
 esdm_status esdmI_create_fragment_from_metadata(esdm_dataset_t *dset, json_t * json, esdm_fragment_t ** out);
+esdm_status esdmI_create_fragment_from_reader(esdm_dataset_t *dset, esdmI_jsonReader_t * reader, esdm_fragment_t ** out); //reads the next value from the reader, returns the dataset's existing fragment if it has one of the same shape
+esdm_fragment_t* esdmI_fragment_createLoaded(esdm_dataset_t *dset, esdm_dataspace_t *space, const char *id, esdm_backend_t *backend, int64_t actualBytes, json_t *backendMetadata); //creates the object for a fragment that is described by persistent metadata, takes possession of the dataspace
+esdm_status esdmI_dataset_addLoadedFragment(esdm_dataset_t *d, esdm_fragment_t *frag); //adds a fragment that was decoded from metadata, it is dropped if the dataset already has a fragment of the same shape
+esdm_status esdmI_fragment_retrieve(esdm_fragment_t *fragment, bool *out_cacheHit);  //like `esdm_fragment_retrieve()`, `*out_cacheHit` tells whether the data came from the shared memory cache instead of the backend, may be NULL
+
+///////////////////////////////////////////////////////////////////////////////
+// Metadata cache /////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+//A process wide cache that keeps containers and datasets parsed after they have been closed,
+//so that reopening them does not need to retrieve and parse their metadata again.
+//Before an object is reused, its stamp is compared to the current stamp that the metadata backend reports,
+//so changes by other processes are detected. When the cached objects exceed the budget, the least recently closed ones are evicted.
+//Only clean objects that were loaded via the backend are cached, everything else is handled as if there was no cache.
+
+void esdmI_mdCache_stampContainer(esdm_container_t* container);  //records the current stamp of the container's metadata, call this before loading it and after committing it
+void esdmI_mdCache_stampDataset(esdm_dataset_t* dataset);  //same as stampContainer() for a dataset
+
+bool esdmI_mdCache_parkContainer(esdm_container_t* container);  //hands a closed container to the cache, returns false if the cache does not take it, in which case the caller must destroy it
+esdm_container_t* esdmI_mdCache_takeContainer(const char* name);  //returns a cached container with an unchanged stamp and removes it from the cache, or NULL
+
+bool esdmI_mdCache_parkDataset(esdm_dataset_t* dataset);  //keeps a closed dataset loaded, returns false if the cache does not take it, in which case the caller must unload it
+void esdmI_mdCache_takeDataset(esdm_dataset_t* dataset);  //removes the dataset from the cache if it is cached, and unloads it if its stamp has changed
+bool esdmI_mdCache_forgetDataset(esdm_dataset_t* dataset);  //removes the dataset from the cache without any checks, returns whether it was cached
+
+void esdmI_mdCache_clear();  //evicts all cached objects
+void esdmI_mdCache_getStats(int64_t* out_hits, int64_t* out_misses, int64_t* out_invalidations, int64_t* out_evictions, int64_t* out_bytes); //all pointers may be NULL
+
+///////////////////////////////////////////////////////////////////////////////
+// Grid synthesis /////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+//Looks for a rectilinear decomposition in the fragments of datasets that are read without a grid, and creates a grid for it, see esdm-grid-synthesis.c.
+//The analysis runs on a background thread, its result is applied by the next read of the dataset.
+//Writable datasets are marked dirty when they get a grid, so that the grid is stored with their next commit.
+
+//Starts an analysis of the dataset's fragments if they have not been analyzed yet.
+//If the dataset still has undecoded pages, only the given fragments are analyzed, which are the ones a read has just used, so that no pages need to be fetched for the analysis.
+void esdmI_gridSynthesis_schedule(esdm_dataset_t* dataset, int64_t fragmentCount, esdm_fragment_t** fragments);
+void esdmI_gridSynthesis_apply(esdm_dataset_t* dataset);  //creates the grid if a finished analysis has found one, a noop if there is no finished analysis
+void esdmI_gridSynthesis_cancel(esdm_dataset_t* dataset);  //drops the pending analysis, call this before the fragments of the dataset are purged
+void esdmI_gridSynthesis_wait();  //blocks until all pending analyses have finished
+void esdmI_gridSynthesis_finalize();  //waits for the pending analyses and stops the background thread
+
+///////////////////////////////////////////////////////////////////////////////
+// Codec //////////////////////////////////////////////////////////////////////
+
+esdm_status esdmI_codec_create(int64_t stageCount, const esdm_codec_stage_t* stages, esdmI_codec_t** out_codec);
+void esdmI_codec_destroy(esdmI_codec_t* codec);
+
+//Compress `size` bytes of data that consists of elements of `elementSize` bytes.
+//The result is a `malloc()`'ed buffer that starts with a header describing the pipeline, so that it can be decoded without the codec.
+//The result may be larger than the input if the data is not compressible.
+esdm_status esdmI_codec_encode(const esdmI_codec_t* codec, int64_t elementSize, const void* data, int64_t size, void** out_buffer, int64_t* out_size);
+
+//Check whether the buffer starts with the header of an encoded buffer.
+bool esdmI_codec_isEncoded(const void* buffer, int64_t size);
+
+//Decompress the output of `esdmI_codec_encode()`, `dataSize` must match the size of the original data.
+//Returns `ESDM_INVALID_DATA_ERROR` if the buffer is corrupted.
+esdm_status esdmI_codec_decode(const void* buffer, int64_t size, void* out_data, int64_t dataSize);
+
+//Compress `rowCount` slices of `rowBytes` bytes each in independent blocks of `rowsPerBlock` slices, see esdm-codec.c for the container format.
+//`splitDim` is the dimension along which the data was sliced, it is only recorded for the reader.
+esdm_status esdmI_codec_encodeBlocks(const esdmI_codec_t* codec, int64_t elementSize, const void* data, int64_t splitDim, int64_t rowCount, int64_t rowBytes, int64_t rowsPerBlock, void** out_buffer, int64_t* out_size);
+
+//Check whether the buffer starts with the header of a block container.
+bool esdmI_codec_isBlocked(const void* buffer, int64_t size);
+
+//The amount of bytes at the start of a block container that are needed to determine the size of its header with `esdmI_codec_blockHeaderSize()`.
+extern const int64_t esdmI_codec_blockPrefixBytes;
+
+//Returns the size of the header of a block container including its block table, or -1 if the buffer does not start with a block container.
+int64_t esdmI_codec_blockHeaderSize(const void* buffer, int64_t size);
+
+//Parse the block table from the first `size` bytes of a block container of `totalSize` bytes.
+//`dims` and `sizes` describe the shape of the data, the number of slices is the size of the split dimension.
+//The result is a `malloc()`'ed object, returns `ESDM_INVALID_DATA_ERROR` if the header is incomplete or inconsistent.
+esdm_status esdmI_codec_parseBlocks(const void* buffer, int64_t size, int64_t totalSize, int64_t dims, const int64_t* sizes, esdmI_codecBlocks_t** out_blocks);
+
+//Decompress a single block of a block container, `dataSize` must be the size of the slices that it holds.
+esdm_status esdmI_codec_decodeBlock(const void* block, int64_t size, void* out_data, int64_t dataSize);
+
+//Decompress an entire block container that holds `dataSize` bytes of data of the given shape.
+esdm_status esdmI_codec_decodeBlocks(const void* buffer, int64_t size, void* out_data, int64_t dims, const int64_t* sizes, int64_t dataSize);
+
+// Shared memory fragment cache ///////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+//A cache for fragment data in POSIX shared memory, which allows the processes on a node to share the fragments they load.
+//The cache is optional, while no cache is attached, loading and storing are noops.
+//The MPI interface sets it up with `esdm_mpi_shm_cache_init()`.
+
+esdm_status esdmI_shmCache_create(const char* name, int64_t bytes);  //creates a shared memory segment with a data budget of `bytes` and attaches it to this process
+esdm_status esdmI_shmCache_attach(const char* name);  //attaches to a segment that another process has created
+void esdmI_shmCache_unlink(const char* name);  //removes the name of the segment, attached processes can continue to use it
+void esdmI_shmCache_detach();
+bool esdmI_shmCache_isAttached();
+void esdmI_shmCache_getStats(int64_t* out_hits, int64_t* out_misses, int64_t* out_stores, int64_t* out_evictions); //the counters are shared by all processes that use the segment, all pointers may be NULL
+
+bool esdmI_shmCache_load(esdm_fragment_t* fragment);  //copies the fragment's data into `fragment->buf` if it is cached, returns whether it was
+void esdmI_shmCache_store(esdm_fragment_t* fragment); //adds the data in `fragment->buf` to the cache, evicting the oldest entries as necessary, silently does nothing if there is no room
+
+///////////////////////////////////////////////////////////////////////////////
+// JSON reader ////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+//The reader does not copy the input, the buffer must remain valid as long as the reader is used.
+void esdmI_jsonReader_init(esdmI_jsonReader_t* me, const char* data, int64_t size);
+esdmI_jsonToken_t esdmI_jsonReader_next(esdmI_jsonReader_t* me);
+esdmI_jsonToken_t esdmI_jsonReader_peek(esdmI_jsonReader_t* me);  //returns the next token without consuming it
+
+//Iteration helpers: Call these repeatedly after consuming the opening brace/bracket.
+//nextKey() returns true when it has read the next key, nextElement() returns true when another value follows that the caller must consume.
+//Both consume the closing brace/bracket and return false at the end of the object/array, and on errors.
+bool esdmI_jsonReader_nextKey(esdmI_jsonReader_t* me);
+bool esdmI_jsonReader_nextElement(esdmI_jsonReader_t* me);
+bool esdmI_jsonReader_keyIs(const esdmI_jsonReader_t* me, const char* key);  //checks whether the last token is the given key
+
+//These read the next value, they return false and put the reader into the error state if the value has a different type.
+bool esdmI_jsonReader_readInt(esdmI_jsonReader_t* me, int64_t* out_value);
+bool esdmI_jsonReader_readDouble(esdmI_jsonReader_t* me, double* out_value);
+bool esdmI_jsonReader_readIntArray(esdmI_jsonReader_t* me, int64_t** out_values, int64_t* out_count);  //the caller is responsible to free() the array
+char* esdmI_jsonReader_readString(esdmI_jsonReader_t* me);  //returns a malloc()'ed copy with the escapes resolved, or NULL
+char* esdmI_jsonReader_copyString(esdmI_jsonReader_t* me);  //same as readString() for the last key or string that was read
+
+//Skips the next value including all its children, and optionally returns the location of its text within the input.
+bool esdmI_jsonReader_skipValue(esdmI_jsonReader_t* me, const char** out_start, int64_t* out_size);
+
+///////////////////////////////////////////////////////////////////////////////
+// Binary fragment table //////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Encode fragment metadata in the compact binary format that is used for persistent dataset metadata and for exchanging fragments between processes.
+ *
+ * @param [in] dims the dimension count of the dataset, all fragments must have this many dimensions
+ * @param [in] count the number of fragments to encode
+ * @param [in] fragments the fragments to encode
+ * @param [out] out_size the size of the returned table in bytes
+ *
+ * @return a newly allocated buffer containing the table, the caller is responsible to free() it
+ */
+char* esdmI_fragmentTable_encode(int64_t dims, int64_t count, esdm_fragment_t** fragments, int64_t* out_size);
+
+/**
+ * Decode a binary fragment table and add its fragments to the dataset.
+ * Fragments with a shape that the dataset already has are dropped.
+ *
+ * @param [in] dataset the dataset to add the fragments to
+ * @param [in] data the start of the table
+ * @param [in] available the number of bytes that may be read from `data`
+ * @param [out] out_size the size of the table in bytes, may be NULL
+ *
+ * @return ESDM_SUCCESS, or ESDM_INVALID_DATA_ERROR if the table is corrupt, truncated, or has an unknown version
+ */
+esdm_status esdmI_fragmentTable_decode(esdm_dataset_t* dataset, const char* data, int64_t available, int64_t* out_size);
+
+/**
+ * Decode a binary fragment table like esdmI_fragmentTable_decode(), and return the fragment of each record.
+ *
+ * @param [in] dataset the dataset to add the fragments to
+ * @param [in] data the start of the table
+ * @param [in] available the number of bytes that may be read from `data`
+ * @param [out] out_size the size of the table in bytes, may be NULL
+ * @param [out] out_count the number of records in the table
+ * @param [out] out_fragments a newly allocated array with one fragment per record in table order, records with a shape that the dataset already had yield the existing fragment, the caller is responsible to free() the array
+ *
+ * @return ESDM_SUCCESS, or ESDM_INVALID_DATA_ERROR if the table is corrupt, truncated, or has an unknown version
+ */
+esdm_status esdmI_fragmentTable_decodeList(esdm_dataset_t* dataset, const char* data, int64_t available, int64_t* out_size, int64_t* out_count, esdm_fragment_t*** out_fragments);
+
+//Checks whether `data` starts with the magic bytes of a fragment table.
+bool esdmI_fragmentTable_isTable(const char* data, int64_t available);
+
+/**
+ * Merge two binary fragment tables into one without decoding their fragments.
+ * This is used to combine the tables of many processes along a reduction tree.
+ * Fragments that appear in both tables are kept twice, the decoder drops the duplicates.
+ *
+ * @param [in] a the first table
+ * @param [in] aSize the number of bytes that may be read from `a`
+ * @param [in] b the second table, must have the same dimension count as `a`
+ * @param [in] bSize the number of bytes that may be read from `b`
+ * @param [out] out_size the size of the returned table in bytes
+ *
+ * @return a newly allocated table that contains the records of both tables, or NULL if one of them is corrupt, the caller is responsible to free() it
+ */
+char* esdmI_fragmentTable_merge(const char* a, int64_t aSize, const char* b, int64_t bSize, int64_t* out_size);
+
+/**
+ * Encode fragment metadata as a paged table.
+ * The fragments are partitioned into spatially compact pages, which are indexed by their bounding boxes,
+ * so that readers only need to decode the pages that intersect the regions they access.
+ *
+ * @param [in] dims the dimension count of the dataset, all fragments must have this many dimensions
+ * @param [in] count the number of fragments to encode
+ * @param [in] fragments the fragments to encode
+ * @param [out] out_size the size of the returned table in bytes
+ *
+ * @return a newly allocated buffer containing the paged table, the caller is responsible to free() it
+ */
+char* esdmI_fragmentPages_encode(int64_t dims, int64_t count, esdm_fragment_t** fragments, int64_t* out_size);
+
+/**
+ * Read the index of a paged table without decoding any fragments.
+ *
+ * @param [in] data the start of the paged table, the returned object keeps a copy of the table
+ * @param [in] available the number of bytes that may be read from `data`
+ * @param [in] dims the dimension count of the dataset
+ * @param [in] tableOffset the position of the paged table within the snapshot, used to fetch the pages of a table that was truncated with esdmI_fragmentPages_truncateToIndex()
+ * @param [out] out_size the number of bytes of the paged table that are present at `data`, may be NULL
+ * @param [out] out_pages the new page index, must be destroyed with esdmI_fragmentPages_destroy()
+ *
+ * @return ESDM_SUCCESS, or ESDM_INVALID_DATA_ERROR if the index is corrupt, truncated, or has an unknown version
+ */
+esdm_status esdmI_fragmentPages_open(const char* data, int64_t available, int64_t dims, int64_t tableOffset, int64_t* out_size, esdmI_fragmentPages_t** out_pages);
+
+/**
+ * Check whether the start of a paged table contains its complete index, and mark it as a table without pages if so.
+ * esdmI_fragmentPages_load() fetches the pages of such a table from the snapshot when they are needed.
+ *
+ * @param [inout] data the start of the paged table
+ * @param [in] available the number of bytes that may be read from `data`
+ *
+ * @return the size of the header and the index, which is the number of bytes that need to be kept;
+ *         0 if more bytes are needed to find the end of the index; -1 if `data` is not a paged table
+ */
+int64_t esdmI_fragmentPages_truncateToIndex(char* data, int64_t available);
+
+//Fetches and decodes all pages that intersect the region and have not been decoded yet, and adds their fragments to the dataset.
+//Passing NULL as the region decodes all remaining pages.
+esdm_status esdmI_fragmentPages_load(esdmI_fragmentPages_t* me, esdm_dataset_t* dataset, esdmI_hypercube_t* region);
+bool esdmI_fragmentPages_isComplete(const esdmI_fragmentPages_t* me);  //true once all pages have been decoded
+//For fragments that are loaded from the index of the metadata backend instead of the pages:
+//Checks whether all fragments that intersect the region have been loaded, either with their pages or by an earlier index query for an enclosing region.
+bool esdmI_fragmentPages_isRegionLoaded(const esdmI_fragmentPages_t* me, esdmI_hypercube_t* region);
+//Records that the caller has loaded all fragments that intersect the region, the pages that lie within the region need not be decoded anymore.
+void esdmI_fragmentPages_markRegionLoaded(esdmI_fragmentPages_t* me, esdmI_hypercube_t* region);
+int64_t esdmI_fragmentPages_loadedCount(const esdmI_fragmentPages_t* me);
+int64_t esdmI_fragmentPages_pageCount(const esdmI_fragmentPages_t* me);
+int64_t esdmI_fragmentPages_fetchedCount(const esdmI_fragmentPages_t* me);  //the number of pages that have been read from the snapshot
+int64_t esdmI_fragmentPages_tableSize(const esdmI_fragmentPages_t* me);  //the size of the entire paged table, including the pages that have not been fetched
+void esdmI_fragmentPages_getEnd(const esdmI_fragmentPages_t* me, int64_t* inout_end);  //raises the entries of `inout_end` to the end coordinates of all pages, used to restore the actual size of unlimited dimensions
+bool esdmI_fragmentPages_isPagedTable(const char* data, int64_t available);
+void esdmI_fragmentPages_destroy(esdmI_fragmentPages_t* me);
+
+/**
+ * Make sure that all fragments that may intersect the given region have been decoded from the persistent metadata.
+ *
+ * @param [in] dataset the dataset to load the fragments of
+ * @param [in] region the region of interest, or NULL to load all fragments
+ *
+ * @return status
+ */
+esdm_status esdmI_dataset_loadFragments(esdm_dataset_t* dataset, esdmI_hypercube_t* region);
+
+//Reads exactly `size` bytes at `offset` of the persistent snapshot of the dataset into `out_data`, fails if the metadata backend cannot read byte ranges.
+esdm_status esdmI_dataset_retrieveSnapshot(esdm_dataset_t* dataset, int64_t offset, int64_t size, char* out_data);
 
 /**
  * Create a new fragment.
@@ -19,6 +19,21 @@ esdm_status esdm_mpi_init_manual();
 
 void esdm_mpi_finalize();
 
+/**
+ * esdm_mpi_shm_cache_init()
+ *
+ * Set up a fragment cache in POSIX shared memory that is shared by the processes on each node.
+ * When a process loads a fragment from a backend, it adds the data to the cache,
+ * so that other processes on the same node can load it from memory instead of the storage.
+ * The cache is detached in `esdm_finalize()`.
+ *
+ * @param com the MPI communicator, all processes must call this function after `esdm_init()`
+ * @param bytes the memory budget of the cache on each node, the oldest fragments are evicted to stay within this budget
+ *
+ * @return the worst status of all processes, no cache is used if this is not ESDM_SUCCESS
+ */
+esdm_status esdm_mpi_shm_cache_init(MPI_Comm com, int64_t bytes);
+
 //TODO: Allow use of a different root than rank 0.
 
 esdm_status esdm_mpi_container_create(MPI_Comm com, const char *name, int allow_overwrite, esdm_container_t **out_container);
@@ -31,9 +46,57 @@ esdm_status esdm_mpi_container_commit(MPI_Comm com, esdm_container_t *container)
 /* for a dataset, metadata can be added only at rank 0 */
 esdm_status esdm_mpi_dataset_create(MPI_Comm com, esdm_container_t *container, const char *name, esdm_dataspace_t *dataspace, esdm_dataset_t **out_dataset);
 esdm_status esdm_mpi_dataset_open(MPI_Comm com, esdm_container_t *container, const char *name, esdm_dataset_t **out_dataset);
+
+/**
+ * esdm_mpi_dataset_open_collective()
+ *
+ * Open a dataset on all processes of the communicator.
+ * Only rank 0 reads the metadata including the binary fragment tables, which is then broadcasted to the other processes.
+ * `esdm_mpi_dataset_open()` is equivalent.
+ *
+ * @param com the MPI communicator, all processes must call this function with the same arguments
+ * @param container the container, must have been opened with the same communicator
+ * @param name the name of the dataset
+ * @param out_dataset returns the opened dataset
+ */
+esdm_status esdm_mpi_dataset_open_collective(MPI_Comm com, esdm_container_t *container, const char *name, esdm_dataset_t **out_dataset);
 esdm_status esdm_mpi_dataset_ref(MPI_Comm com, esdm_dataset_t * d);
 esdm_status esdm_mpi_dataset_commit(MPI_Comm com, esdm_dataset_t *dataset);
 
+/**
+ * esdm_mpi_write_collective()
+ *
+ * Collectively write data from all processes of the communicator.
+ * The processes that share a node send their data to one aggregator process on that node,
+ * which writes the combined region of the node with a single `esdm_write()` if the regions tile a hyperslab.
+ * This reduces the number of fragments by the number of processes per node and allows the backends to receive large fragments.
+ *
+ * @param com the MPI communicator, all processes must call this function
+ * @param dataset the dataset to write to, must have been created or opened with the same communicator
+ * @param buf the local data, may be NULL if `memspace` is empty
+ * @param memspace the region that this process writes and the layout of `buf`, may be empty (a size of zero in any dimension)
+ *
+ * @return the worst status of all processes
+ */
+esdm_status esdm_mpi_write_collective(MPI_Comm com, esdm_dataset_t *dataset, void *buf, esdm_dataspace_t *memspace);
+
+/**
+ * esdm_mpi_read_collective()
+ *
+ * Collectively read data on all processes of the communicator.
+ * Each fragment that is needed by any process is read from storage only once, by one of the processes that need it,
+ * and the pieces are redistributed with `MPI_Alltoallv()`.
+ * This avoids multiplying the load on the storage by the number of processes when many processes read overlapping regions.
+ *
+ * @param com the MPI communicator, all processes must call this function
+ * @param dataset the dataset to read from, must have been opened with the same communicator
+ * @param buf the local buffer to read into, may be NULL if `memspace` is empty
+ * @param memspace the region that this process reads and the layout of `buf`, may be empty (a size of zero in any dimension)
+ *
+ * @return the worst status of all processes
+ */
+esdm_status esdm_mpi_read_collective(MPI_Comm com, esdm_dataset_t *dataset, void *buf, esdm_dataspace_t *memspace);
+
 /**
  * esdm_mpi_grid_bcast()
  *
@@ -52,6 +115,8 @@ esdm_status esdm_mpi_grid_bcast(MPI_Comm comm, esdm_dataset_t* dataset, esdm_gri
  * esdm_mpi_grid_commit()
  *
  * Merge the information about all fragments that have been added to the grid copies after an `esdm_mpi_grid_bcast()`.
+ * Each process only sends the cells that it has filled since its last `esdm_mpi_grid_commit()`, so committing a grid repeatedly while it is being written is cheap.
+ * The merged grid is available at rank 0.
  *
  * @param comm the MPI communicator that defines the process set, must be the same as the one used in the preceding `esdm_mpi_grid_bcast()` call
  * @param grid the local copy of a grid that was previously broadcasted with `esdm_mpi_grid_bcast()`
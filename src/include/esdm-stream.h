@@ -9,21 +9,32 @@ extern "C" {
 #endif
 
 typedef struct esdm_wstream_metadata_t esdm_wstream_metadata_t;
+typedef struct esdm_rstream_metadata_t esdm_rstream_metadata_t;
 
-#define defineStreamType(streamType, elementType) typedef struct streamType { \
-  esdm_wstream_metadata_t* metadata; /*contains opaque implementation details of the stream API*/ \
+#define defineStreamType(streamType, metadataType, elementType) typedef struct streamType { \
+  metadataType* metadata; /*contains opaque implementation details of the stream API*/ \
   elementType *buffer, *iter, *iterEnd, *bufferEnd; \
 } streamType
-defineStreamType(esdm_wstream_uint8_t, uint8_t);
-defineStreamType(esdm_wstream_uint16_t, uint16_t);
-defineStreamType(esdm_wstream_uint32_t, uint32_t);
-defineStreamType(esdm_wstream_uint64_t, uint64_t);
-defineStreamType(esdm_wstream_int8_t, int8_t);
-defineStreamType(esdm_wstream_int16_t, int16_t);
-defineStreamType(esdm_wstream_int32_t, int32_t);
-defineStreamType(esdm_wstream_int64_t, int64_t);
-defineStreamType(esdm_wstream_float_t, float);
-defineStreamType(esdm_wstream_double_t, double);
+defineStreamType(esdm_wstream_uint8_t, esdm_wstream_metadata_t, uint8_t);
+defineStreamType(esdm_wstream_uint16_t, esdm_wstream_metadata_t, uint16_t);
+defineStreamType(esdm_wstream_uint32_t, esdm_wstream_metadata_t, uint32_t);
+defineStreamType(esdm_wstream_uint64_t, esdm_wstream_metadata_t, uint64_t);
+defineStreamType(esdm_wstream_int8_t, esdm_wstream_metadata_t, int8_t);
+defineStreamType(esdm_wstream_int16_t, esdm_wstream_metadata_t, int16_t);
+defineStreamType(esdm_wstream_int32_t, esdm_wstream_metadata_t, int32_t);
+defineStreamType(esdm_wstream_int64_t, esdm_wstream_metadata_t, int64_t);
+defineStreamType(esdm_wstream_float_t, esdm_wstream_metadata_t, float);
+defineStreamType(esdm_wstream_double_t, esdm_wstream_metadata_t, double);
+defineStreamType(esdm_rstream_uint8_t, esdm_rstream_metadata_t, uint8_t);
+defineStreamType(esdm_rstream_uint16_t, esdm_rstream_metadata_t, uint16_t);
+defineStreamType(esdm_rstream_uint32_t, esdm_rstream_metadata_t, uint32_t);
+defineStreamType(esdm_rstream_uint64_t, esdm_rstream_metadata_t, uint64_t);
+defineStreamType(esdm_rstream_int8_t, esdm_rstream_metadata_t, int8_t);
+defineStreamType(esdm_rstream_int16_t, esdm_rstream_metadata_t, int16_t);
+defineStreamType(esdm_rstream_int32_t, esdm_rstream_metadata_t, int32_t);
+defineStreamType(esdm_rstream_int64_t, esdm_rstream_metadata_t, int64_t);
+defineStreamType(esdm_rstream_float_t, esdm_rstream_metadata_t, float);
+defineStreamType(esdm_rstream_double_t, esdm_rstream_metadata_t, double);
 #undef defineStreamType
 
 /**
@@ -35,6 +46,10 @@ defineStreamType(esdm_wstream_double_t, double);
  * @param [in] offset array of `dimCount` elements that provides the logical coordinates of the first value that will be streamed
  * @param [in] size array of `dimCount` elements that provides the extends of the hypercube that is to be streamed
  *
+ * The streamed region is split into fragments that are distributed across the data backends according to their estimated throughput,
+ * the fragments on different backends are written in parallel.
+ * The decomposition is recorded as a grid on the dataset (see `esdm_dataset_grids()`), which allows later reads to locate the fragments directly.
+ *
  * Typical usage:
  *
  *     esdm_wstream_double_t stream;
@@ -54,7 +69,7 @@ defineStreamType(esdm_wstream_double_t, double);
   typeof(*stream)* const esdm_internal_stream_ptr = (stream); /*avoid multiple evaluation*/ \
   esdm_wstream_metadata_t* esdm_internal_stream_metadata = esdm_wstream_metadata_create(dataset, dimCount, offset, size, smd_c_to_smd_type(*esdm_internal_stream_ptr->buffer)); \
   int64_t esdm_internal_element_count = esdm_wstream_metadata_max_chunk_size(esdm_internal_stream_metadata); \
-  typeof(*stream.buffer) esdm_internal_buffer = (typeof(*stream.buffer)) malloc(esdm_internal_element_count*sizeof(*esdm_internal_stream_ptr->buffer)); \
+  typeof(*stream.buffer) esdm_internal_buffer = (typeof(*stream.buffer)) esdm_wstream_metadata_first_buffer(esdm_internal_stream_metadata); \
   *esdm_internal_stream_ptr = (typeof(*stream)){ \
     .metadata = esdm_internal_stream_metadata, \
     .buffer = esdm_internal_buffer, \
@@ -82,7 +97,8 @@ defineStreamType(esdm_wstream_double_t, double);
   } \
   *esdm_internal_stream_ptr->iter++ = (value); \
   if(esdm_internal_stream_ptr->iter == esdm_internal_stream_ptr->iterEnd) { \
-    esdm_wstream_flush(esdm_internal_stream_ptr->metadata, esdm_internal_stream_ptr->buffer, esdm_internal_stream_ptr->iter); \
+    esdm_internal_stream_ptr->buffer = esdm_wstream_flush(esdm_internal_stream_ptr->metadata, esdm_internal_stream_ptr->buffer, esdm_internal_stream_ptr->iter); \
+    esdm_internal_stream_ptr->bufferEnd = esdm_internal_stream_ptr->buffer + esdm_wstream_metadata_max_chunk_size(esdm_internal_stream_ptr->metadata); \
     esdm_internal_stream_ptr->iter = esdm_internal_stream_ptr->buffer; \
     esdm_internal_stream_ptr->iterEnd = esdm_internal_stream_ptr->iter + esdm_wstream_metadata_next_chunk_size(esdm_internal_stream_ptr->metadata); \
   } \
@@ -95,6 +111,7 @@ defineStreamType(esdm_wstream_double_t, double);
  *
  * @param[in] stream the stream to commit, close, and destroy
  *
+ * The filled chunks are written in the background while the stream is packed, this waits until all of them have reached the backend.
  * It is an error to call this macro before the stream has been fully packed with data.
  * See `esdm_wstream_start()` for a usage example.
  */
@@ -104,9 +121,118 @@ defineStreamType(esdm_wstream_double_t, double);
     fprintf(stderr, "wstream: preliminary commit of a stream: too few calls to esdm_wstream_pack()\n"); \
     abort(); \
   } \
-  /*since `esdm_wstream_pack()` flushes the stream *after* adding the last value, we only need to perform local cleanup*/ \
+  /*since `esdm_wstream_pack()` flushes the stream *after* adding the last value, we only need to wait for the background writes and perform local cleanup*/ \
   esdm_wstream_metadata_destroy(esdm_internal_stream_ptr->metadata); \
-  free(esdm_internal_stream_ptr->buffer); \
+  *esdm_internal_stream_ptr = (typeof(stream)){0}; \
+} while(0)
+
+/**
+ * Setup a stream for reading data from a dataset.
+ *
+ * @param [inout] stream pointer to one of the stream types `esdm_rstream_uint8_t` through `esdm_rstream_double_t`
+ * @param [in] dataset pointer to the dataset from which the data is to be read
+ * @param [in] dimCount must equal the dim count of the dataset, also the assumed size of the `offset` and `size` arrays
+ * @param [in] offset array of `dimCount` elements that provides the logical coordinates of the first value that will be streamed
+ * @param [in] size array of `dimCount` elements that provides the extends of the hypercube that is to be streamed
+ *
+ * The values are delivered in the same order in which `esdm_wstream_pack()` expects them, i.e. the last dimension varies fastest.
+ * The region is read in chunks of about one fragment in size.
+ * A background thread reads the next chunks while the application consumes the current one,
+ * so that I/O and computation overlap without any further effort by the caller.
+ * The values of the current chunk are found between `stream.iter` and `stream.iterEnd`, `esdm_rstream_next()` advances to the next chunk.
+ * After the last chunk, `stream.iter` is NULL.
+ * If a chunk cannot be read, the stream ends early, and `esdm_rstream_status()` reports the error.
+ * The fragments that provide the data are looked up when the stream is started,
+ * the background thread only reads from this list and never touches the dataset's own state,
+ * so the stream delivers the data as it was at that time, data that is written to the dataset later is not seen.
+ * The dataset must stay open until `esdm_rstream_end()` returns.
+ *
+ * Typical usage:
+ *
+ *     esdm_rstream_double_t stream;
+ *     esdm_rstream_start(&stream, dataset, 2, (int64_t[2]){50, 72}, (int64_t[2]){250, 36});
+ *     while(stream.iter) {
+ *         for(double* value = stream.iter; value < stream.iterEnd; value++) sum += *value;
+ *         esdm_rstream_next(stream);
+ *     }
+ *     esdm_rstream_end(stream);
+ *
+ * or, value by value:
+ *
+ *     for(int y = 50; y < 300; y++) {
+ *         for(int x = 72; x < 108; x++) {
+ *             double value;
+ *             esdm_rstream_unpack(stream, value);
+ *             consumeValueForLocation(x, y, value);
+ *         }
+ *     }
+ */
+#define esdm_rstream_start(stream, dataset, dimCount, offset, size) do { \
+  typeof(*stream)* const esdm_internal_stream_ptr = (stream); /*avoid multiple evaluation*/ \
+  esdm_rstream_metadata_t* esdm_internal_stream_metadata = esdm_rstream_metadata_create(dataset, dimCount, offset, size, smd_c_to_smd_type(*esdm_internal_stream_ptr->buffer)); \
+  *esdm_internal_stream_ptr = (typeof(*stream)){ .metadata = esdm_internal_stream_metadata }; \
+  esdm_rstream_next(*esdm_internal_stream_ptr); \
+} while(0)
+
+/**
+ * Query whether all data that a read stream has delivered so far was read successfully.
+ *
+ * @param[in] stream the stream to check, must not have been closed yet
+ *
+ * @return ESDM_SUCCESS, or the error of the chunk read that ended the stream early, e.g. ESDM_INCOMPLETE_DATA if part of the region has not been written and the dataset has no fill value
+ */
+#define esdm_rstream_status(stream) esdm_rstream_metadata_status((stream).metadata)
+
+/**
+ * Release the current chunk of a read stream and advance to the next one, blocking until its data is available.
+ *
+ * @param[in] stream the stream to advance
+ *
+ * After the last chunk has been released, `stream.iter`, `stream.iterEnd`, and `stream.buffer` are NULL.
+ */
+#define esdm_rstream_next(stream) do { \
+  typeof(stream)* const esdm_internal_rstream_ptr = &(stream); /*avoid multiple evaluation*/ \
+  int64_t esdm_internal_element_count; \
+  esdm_internal_rstream_ptr->buffer = esdm_rstream_metadata_next_chunk(esdm_internal_rstream_ptr->metadata, esdm_internal_rstream_ptr->buffer, &esdm_internal_element_count); \
+  esdm_internal_rstream_ptr->iter = esdm_internal_rstream_ptr->buffer; \
+  esdm_internal_rstream_ptr->iterEnd = esdm_internal_rstream_ptr->bufferEnd = esdm_internal_rstream_ptr->buffer ? esdm_internal_rstream_ptr->buffer + esdm_internal_element_count : NULL; \
+} while(0)
+
+/**
+ * Fetch a single value from a read stream.
+ *
+ * @param[in] stream the stream to read from
+ * @param[out] value an lvalue that receives the next value of the stream
+ *
+ * It is an error to fetch more values from the stream than what was requested in the corresponding `esdm_rstream_start()` call.
+ * After a read error, the remaining values are zero, check `esdm_rstream_status()` before closing the stream.
+ * See `esdm_rstream_start()` for a usage example.
+ */
+#define esdm_rstream_unpack(stream, value) do { \
+  typeof(stream)* const esdm_internal_stream_ptr = &(stream); /*avoid multiple evaluation*/ \
+  if(esdm_internal_stream_ptr->iter == esdm_internal_stream_ptr->iterEnd) esdm_rstream_next(*esdm_internal_stream_ptr); \
+  if(!esdm_internal_stream_ptr->iter) { \
+    if(esdm_rstream_status(*esdm_internal_stream_ptr) == ESDM_SUCCESS) { \
+      fprintf(stderr, "rstream attempt to read more data from a stream than defined at stream creation\n"); \
+      abort(); \
+    } \
+    (value) = 0; /*the stream has ended early due to a read error, which the caller detects with esdm_rstream_status()*/ \
+  } else { \
+    (value) = *esdm_internal_stream_ptr->iter++; \
+  } \
+} while(0)
+
+/**
+ * Close a read stream and perform any required cleanup.
+ *
+ * @param[in] stream the stream to close and destroy
+ *
+ * A stream may be closed before all of its data has been consumed, any outstanding prefetches are cancelled.
+ * See `esdm_rstream_start()` for a usage example.
+ */
+#define esdm_rstream_end(stream) do { \
+  typeof(stream)* const esdm_internal_stream_ptr = &(stream); /*avoid multiple evaluation*/ \
+  esdm_rstream_metadata_destroy(esdm_internal_stream_ptr->metadata); \
   *esdm_internal_stream_ptr = (typeof(stream)){0}; \
 } while(0)
 
@@ -128,6 +254,13 @@ esdm_wstream_metadata_t* esdm_wstream_metadata_create(esdm_dataset_t* dataset, i
  */
 int64_t esdm_wstream_metadata_max_chunk_size(esdm_wstream_metadata_t* metadata);
 
+/**
+ * Get the buffer for the first chunk of a stream, the buffer is owned by the stream metadata object.
+ *
+ * This is an internal function that should not be used directly by user code, use the `esdm_wstream_start()` macro instead.
+ */
+void* esdm_wstream_metadata_first_buffer(esdm_wstream_metadata_t* metadata);
+
 /**
  * Query the stream metadata object for the size of the next chunk that needs to be fed into the stream.
  *
@@ -137,20 +270,51 @@ int64_t esdm_wstream_metadata_next_chunk_size(esdm_wstream_metadata_t* metadata)
 
 /**
  * Forward a chunk of data for further processing from a stream.
+ * The chunk is handed to the backend's thread pool, and the function returns a free buffer for the next chunk,
+ * only waiting if all buffers of the stream are still being written.
  *
  * This is an internal function that should not be used directly by user code, use the `esdm_wstream_pack()` macro instead.
  *
  * `(streamType*)bufferEnd - (streamType*)buffer` should equal the last value returned by `esdm_wstream_metadata_next_chunk_size()`.
  */
-void esdm_wstream_flush(esdm_wstream_metadata_t* metadata, void* buffer, void* bufferEnd);
+void* esdm_wstream_flush(esdm_wstream_metadata_t* metadata, void* buffer, void* bufferEnd);
 
 /**
- * Get rid of a stream's metadata.
+ * Wait for all outstanding chunk writes, and get rid of a stream's metadata.
  *
  * This is an internal function that should not be used directly by user code, use the `esdm_wstream_commit()` macro instead.
  */
 void esdm_wstream_metadata_destroy(esdm_wstream_metadata_t* metadata);
 
+/**
+ * Create the opaque metadata object for a read stream, and start prefetching its first chunks.
+ *
+ * This is an internal function that should not be used directly by user code, use the `esdm_rstream_start()` macro instead.
+ */
+esdm_rstream_metadata_t* esdm_rstream_metadata_create(esdm_dataset_t* dataset, int64_t dimCount, int64_t* offset, int64_t* size, esdm_type_t type);
+
+/**
+ * Release the buffer of the previous chunk (if not NULL), and wait for the next chunk to become available.
+ * Returns NULL when all chunks have been delivered, or when the next chunk could not be read.
+ *
+ * This is an internal function that should not be used directly by user code, use the `esdm_rstream_next()` macro instead.
+ */
+void* esdm_rstream_metadata_next_chunk(esdm_rstream_metadata_t* metadata, void* previousBuffer, int64_t* out_elementCount);
+
+/**
+ * Get the first error that occurred while reading the chunks of a read stream, or ESDM_SUCCESS.
+ *
+ * This is an internal function that should not be used directly by user code, use the `esdm_rstream_status()` macro instead.
+ */
+esdm_status esdm_rstream_metadata_status(esdm_rstream_metadata_t* metadata);
+
+/**
+ * Cancel any outstanding prefetches and get rid of a read stream's metadata.
+ *
+ * This is an internal function that should not be used directly by user code, use the `esdm_rstream_end()` macro instead.
+ */
+void esdm_rstream_metadata_destroy(esdm_rstream_metadata_t* metadata);
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // Callback API for data processing within the backends ////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -108,6 +108,48 @@ esdm_status esdm_write(esdm_dataset_t *dataset, void *buf, esdm_dataspace_t *sub
 
 esdm_status esdm_read(esdm_dataset_t *dataset, void *buf, esdm_dataspace_t *subspace);
 
+/**
+ * Write several regions of a dataset at once.
+ * This is equivalent to calling esdm_write() for each region, but waits only once for all the resulting I/O.
+ *
+ * @param [in] dataset the dataset to write to
+ * @param [in] count the number of regions
+ * @param [in] bufs array of `count` pointers to the memory regions that shall be written
+ * @param [in] subspaces array of `count` dataspaces that describe the shape and location of the respective region
+ *
+ * @return status
+ */
+esdm_status esdm_write_multi(esdm_dataset_t *dataset, int64_t count, void **bufs, esdm_dataspace_t **subspaces);
+
+/**
+ * Read several regions of a dataset at once.
+ * Each fragment that is needed by any of the regions is loaded only once, and its data is copied to all the regions that need it.
+ * This is much more efficient than calling esdm_read() for each region if there are many small regions that share fragments.
+ *
+ * @param [in] dataset the dataset to read from
+ * @param [in] count the number of regions
+ * @param [out] bufs array of `count` pointers to the memory regions that shall be filled with data
+ * @param [in] subspaces array of `count` dataspaces that describe the shape and location of the respective region
+ *
+ * @return status
+ */
+esdm_status esdm_read_multi(esdm_dataset_t *dataset, int64_t count, void **bufs, esdm_dataspace_t **subspaces);
+
+/**
+ * Read a list of individual points from a dataset.
+ * The points are sorted by the fragments that contain them, so that each fragment is loaded only once, no matter how many of the points it contains.
+ * This is much more efficient than calling esdm_read() for each point, e.g. when sampling data along a path.
+ * Points that have not been written receive the fill value, if one is set.
+ *
+ * @param [in] dataset the dataset to read from
+ * @param [in] count the number of points
+ * @param [in] coords array of `count*dims` coordinates, the coordinates of the i-th point are found at `coords[i*dims]`
+ * @param [out] buf memory for `count` values of the dataset's type, the i-th value belongs to the i-th point
+ *
+ * @return status, ESDM_INCOMPLETE_DATA if a point has not been written and no fill value is set
+ */
+esdm_status esdm_read_points(esdm_dataset_t *dataset, int64_t count, const int64_t *coords, void *buf);
+
 /**
  * Identical to esdm_read except that it uses size/offset tuples instead of the subspace
  */
@@ -123,11 +165,35 @@ esdm_status esdm_read(esdm_dataset_t *dataset, void *buf, esdm_dataspace_t *subs
  * The processing is as follows:
  ** First run stream_func on each data, a stream function may output an intermediate result (return value). This function may be called multiple times and concurrently.
  ** The reduce function is called once per stream output on the master thread allowing to merge the intermediate results.
+ *
+ * The requested region is split into disjoint blocks, each block lies within a single fragment or within a data hole.
+ * `stream_func` is called on the backend threads as soon as the fragment of a block has been loaded,
+ * its `space` argument describes the block, and `buff` contains exactly the data of the block in the contiguous C layout of that dataspace.
+ * Data holes are passed to `stream_func` filled with the fill value, if no fill value is set, ESDM_INCOMPLETE_DATA is returned without calling any function.
+ * `reduce_func` receives the dataspace of the block that produced the respective output.
+ * At most "read stream window bytes" (see the configuration) of fragment data are kept in memory at any time,
+ * so the memory consumption does not depend on the size of the requested region.
  */
 typedef void* (*esdm_stream_func_t)(esdm_dataspace_t *space, void * buff, void * user_ptr, void* esdm_fill_value);
 typedef void (*esdm_reduce_func_t)(esdm_dataspace_t *space, void * user_ptr, void * stream_func_out);
 esdm_status esdm_read_stream(esdm_dataset_t *dataset, esdm_dataspace_t *space, void * user_ptr, esdm_stream_func_t stream_func, esdm_reduce_func_t reduce_func);
 
+/**
+ * Merges two intermediate results of a stream function into one, and returns the merged result.
+ * The function takes possession of both inputs, it may reuse one of them as the result.
+ * It is called concurrently on the backend threads, so it must be thread safe.
+ */
+typedef void* (*esdm_combine_func_t)(esdm_dataspace_t *space, void * user_ptr, void * a, void * b);
+
+/**
+ * Same as esdm_read_stream(), but the intermediate results are merged by a tree of `combine_func` calls that run in parallel on the backend threads.
+ * Whenever a block has been processed and another intermediate result is waiting, the two are combined right away,
+ * so the number of pending intermediate results stays bounded by the number of backend threads.
+ * `reduce_func` is called exactly once on the calling thread with the final result and the requested `space`,
+ * unless the region is empty, in which case it is not called at all.
+ */
+esdm_status esdm_read_stream_combine(esdm_dataset_t *dataset, esdm_dataspace_t *space, void * user_ptr, esdm_stream_func_t stream_func, esdm_combine_func_t combine_func, esdm_reduce_func_t reduce_func);
+
 // Auxiliary //////////////////////////////////////////////////////////////////
 
 //size_t esdm_sizeof(esdm_type_t type);
@@ -322,6 +388,19 @@ esdm_status esdm_dataset_rename(esdm_dataset_t *dataset, const char *name);
 
 esdm_status esdm_dataset_set_compression_hint(esdm_dataset_t * dataset, scil_user_hints_t const * hints);
 
+/*
+ Select the built-in lossless compression pipeline for the fragments that are subsequently written to the dataset.
+ The stages are applied in the given order, a typical choice for floating point data is
+ `{ESDM_CODEC_XOR, ESDM_CODEC_BYTE_SHUFFLE, ESDM_CODEC_LZ}`, for integer data `{ESDM_CODEC_DELTA, ESDM_CODEC_BYTE_SHUFFLE, ESDM_CODEC_LZ}`.
+ The pipeline does not depend on SCIL and takes precedence over the hints given to `esdm_dataset_set_compression_hint()`.
+ Fragments that do not shrink are stored uncompressed, compressed fragments are decompressed transparently on read.
+ Fragments that are larger than "codec block bytes" (see the configuration, 1 MiB by default) are compressed in independent blocks,
+ so that reading a small part of such a fragment only fetches and decompresses the blocks that contain it.
+ Like the compression hints, the pipeline is not stored with the dataset, it must be set again after the dataset has been reopened.
+ Passing a zero `stageCount` disables compression.
+ */
+esdm_status esdm_dataset_set_codec_hint(esdm_dataset_t * dataset, int64_t stageCount, esdm_codec_stage_t const * stages);
+
 void esdm_dataset_set_status_dirty(esdm_dataset_t * dataset);
 
 // Dataset
@@ -435,6 +514,7 @@ esdm_status esdm_dataset_commit(esdm_dataset_t *dataset);
 
 /**
  * Close a dataset object, if it isn't used anymore, it's metadata will be unloaded
+ * If reads have changed the access pattern of a committed dataset, the new pattern is appended to the metadata journal.
  *
  * This function is *not thread-safe*.
  * Only a single master thread must be used to call into ESDM.
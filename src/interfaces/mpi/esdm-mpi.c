@@ -4,6 +4,8 @@
 #include <esdm-grid.h>
 #include <esdm-internal.h>
 
+#include <unistd.h>
+
 
 static void check_hash_abort(MPI_Comm com, int hash, int rank){
   int ret;
@@ -23,6 +25,12 @@ static void check_hash_abort(MPI_Comm com, int hash, int rank){
   }
 }
 
+__attribute__((noreturn))
+void panic(const char* operation) {
+  fprintf(stderr, "failed %s, aborting...\n", operation);
+  abort();
+}
+
 int esdm_mpi_get_tasks_per_node() {
   MPI_Comm shared_comm;
   int count = 1;
@@ -34,6 +42,35 @@ int esdm_mpi_get_tasks_per_node() {
   return count;
 }
 
+esdm_status esdm_mpi_shm_cache_init(MPI_Comm com, int64_t bytes) {
+  MPI_Comm nodeComm;
+  int nodeRank;
+  if(MPI_SUCCESS != MPI_Comm_split_type(com, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &nodeComm)) return ESDM_ERROR;
+  MPI_Comm_rank(nodeComm, &nodeRank);
+
+  //the first process on each node creates the segment under a name that is unique on the node, and tells the others about it
+  static int counter = 0;
+  char name[64];
+  int localResult = ESDM_SUCCESS;
+  if(!nodeRank) {
+    snprintf(name, sizeof(name), "/esdm-cache-%ld-%d", (long)getpid(), counter++);
+    localResult = esdmI_shmCache_create(name, bytes);
+  }
+  MPI_Bcast(name, sizeof(name), MPI_CHAR, 0, nodeComm);
+  MPI_Bcast(&localResult, 1, MPI_INT, 0, nodeComm);
+  if(nodeRank && localResult == ESDM_SUCCESS) localResult = esdmI_shmCache_attach(name);
+
+  //the name is not needed anymore once everyone is attached, the segment will vanish when the last process detaches
+  MPI_Barrier(nodeComm);
+  if(!nodeRank) esdmI_shmCache_unlink(name);
+  MPI_Comm_free(&nodeComm);
+
+  int globalResult;
+  if(MPI_SUCCESS != MPI_Allreduce(&localResult, &globalResult, 1, MPI_INT, MPI_MAX, com)) panic("MPI_Allreduce");
+  if(globalResult != ESDM_SUCCESS) esdmI_shmCache_detach();
+  return globalResult;
+}
+
 esdm_status esdm_mpi_distribute_config_file(char *config_filename) {
   int mpi_rank;
   MPI_Comm_rank(MPI_COMM_WORLD, &mpi_rank);
@@ -233,138 +270,527 @@ esdm_status esdm_mpi_dataset_create(MPI_Comm com, esdm_container_t *c, const cha
 esdm_status esdm_mpi_dataset_ref(MPI_Comm com, esdm_dataset_t * d){
   ESDM_DEBUG(__func__);
   assert(d);
+  //The ranks must agree on whether the metadata is loaded, so a dataset that the metadata cache kept loaded is not revalidated per rank, but unloaded.
+  if(esdmI_mdCache_forgetDataset(d)){
+    esdmI_dataset_unload(d);
+  }
   if(d->status != ESDM_DATA_NOT_LOADED){
     d->refcount++;
     return ESDM_SUCCESS;
   }
 
-  char * buff;
-  int size;
+  // only rank 0 reads the metadata (the header, the binary fragment tables, and the journal), all other processes receive a copy
+  char * buff = NULL;
   int rank;
   int ret = MPI_Comm_rank(com, & rank);
   eassert(ret == MPI_SUCCESS);
-
+  int header[2] = {ESDM_SUCCESS, 0}; // status and size of the metadata
   if(rank == 0){
-    ret = esdm_dataset_open_md_load(d, & buff, & size);
-    if(ret != ESDM_SUCCESS){
-      size = -1;
-    }
-    size = size + 1; // broadcast string terminator as well
-    ret = MPI_Bcast(& size, 1, MPI_INT, 0, com);
-    eassert(ret == MPI_SUCCESS);
-
-    if(size > 0){
-      ret = MPI_Bcast(buff, size, MPI_CHAR, 0, com);
-      eassert(ret == MPI_SUCCESS);
-    }else{
-      return ret;
-    }
-  }else{
-    ret = MPI_Bcast(& size, 1, MPI_INT, 0, com);
-    eassert(ret == MPI_SUCCESS);
-    if (size == 0){
-      return ESDM_ERROR;
-    }
-
-    buff = ea_checked_malloc(size);
+    header[0] = esdmI_dataset_open_md_loadComplete(d, & buff, & header[1]); //all pages of a paged fragment table are broadcasted, so that the other ranks never read metadata themselves
+  }
+  ret = MPI_Bcast(header, 2, MPI_INT, 0, com);
+  eassert(ret == MPI_SUCCESS);
+  if(header[0] != ESDM_SUCCESS){
+    return header[0];
+  }
 
-    ret = MPI_Bcast(buff, size, MPI_CHAR, 0, com);
-    eassert(ret == MPI_SUCCESS);
+  if(rank != 0){
+    buff = ea_checked_malloc(header[1] + 1);
   }
-  ret = esdm_dataset_open_md_parse(d, buff, size);
+  ret = MPI_Bcast(buff, header[1] + 1, MPI_CHAR, 0, com); // broadcast string terminator as well
+  eassert(ret == MPI_SUCCESS);
+  ret = esdm_dataset_open_md_parse(d, buff, header[1]);
+  free(buff);
   if(ret != ESDM_SUCCESS){
     return ret;
   }
 
-  free(buff);
   d->refcount++;
   return ESDM_SUCCESS;
 }
 
-esdm_status esdm_mpi_dataset_open(MPI_Comm com, esdm_container_t *c, const char *name, esdm_dataset_t **out_dataset){
+esdm_status esdm_mpi_dataset_open_collective(MPI_Comm com, esdm_container_t *c, const char *name, esdm_dataset_t **out_dataset){
+  eassert(c != NULL);
+  eassert(name != NULL);
+  eassert(out_dataset != NULL);
+
+  int rank;
+  int ret = MPI_Comm_rank(com, & rank);
+  eassert(ret == MPI_SUCCESS);
   // compute hash to ensure all have the same value
-  //int hash;
-  //hash = ea_compute_hash_str(name) + ea_compute_hash_str(c->name);
-  esdm_dataset_t *d = NULL;
+  int hash = ea_compute_hash_str(name) + ea_compute_hash_str(c->name);
+  check_hash_abort(com, hash, rank);
+
   esdm_datasets_t * dsets = & c->dsets;
   for(int i=0; i < dsets->count; i++ ){
     if(strcmp(dsets->dset[i]->name, name) == 0){
-      d = dsets->dset[i];
-      *out_dataset = d;
-      return esdm_mpi_dataset_ref(com, d);
+      *out_dataset = dsets->dset[i];
+      return esdm_mpi_dataset_ref(com, *out_dataset);
     }
   }
   return ESDM_ERROR;
 }
 
+esdm_status esdm_mpi_dataset_open(MPI_Comm com, esdm_container_t *c, const char *name, esdm_dataset_t **out_dataset){
+  return esdm_mpi_dataset_open_collective(com, c, name, out_dataset);
+}
+
+//MPI counts are `int`, so large buffers are transferred in several messages.
+static const int64_t kMaxMessageSize = 1 << 30;
+static const int kFragmentTableTag = 4711;
+static const int kCollectiveDataTag = 4712;
+static const int kGridTag = 4713;
+
+static void sendBuffer(MPI_Comm com, int destination, int tag, const char* data, int64_t size) {
+  uint64_t mpiSize = size;  //MPI does not have a type for `int64_t` sizes
+  if(MPI_SUCCESS != MPI_Send(&mpiSize, 1, MPI_UINT64_T, destination, tag, com)) panic("MPI_Send");
+  for(int64_t position = 0; position < size; position += kMaxMessageSize) {
+    int count = size - position < kMaxMessageSize ? size - position : kMaxMessageSize;
+    if(MPI_SUCCESS != MPI_Send(data + position, count, MPI_BYTE, destination, tag, com)) panic("MPI_Send");
+  }
+}
+
+//returns a newly allocated buffer with the data sent by `sendBuffer()`
+static char* receiveBuffer(MPI_Comm com, int source, int tag, int64_t* out_size) {
+  uint64_t mpiSize;
+  if(MPI_SUCCESS != MPI_Recv(&mpiSize, 1, MPI_UINT64_T, source, tag, com, MPI_STATUS_IGNORE)) panic("MPI_Recv");
+  char* data = ea_checked_malloc(mpiSize + 1);
+  for(int64_t position = 0; position < (int64_t)mpiSize; position += kMaxMessageSize) {
+    int count = mpiSize - position < kMaxMessageSize ? mpiSize - position : kMaxMessageSize;
+    if(MPI_SUCCESS != MPI_Recv(data + position, count, MPI_BYTE, source, tag, com, MPI_STATUS_IGNORE)) panic("MPI_Recv");
+  }
+  *out_size = mpiSize;
+  return data;
+}
+
+//rank 0 passes the data in `*inout_data` and `*inout_size`, the other processes receive a newly allocated buffer and its size
+static void bcastBuffer(MPI_Comm com, char** inout_data, int64_t* inout_size) {
+  int rank;
+  if(MPI_SUCCESS != MPI_Comm_rank(com, &rank)) panic("MPI_Comm_rank");
+  uint64_t mpiSize = *inout_size;  //MPI does not have a type for `int64_t` sizes
+  if(MPI_SUCCESS != MPI_Bcast(&mpiSize, 1, MPI_UINT64_T, 0, com)) panic("MPI_Bcast");
+  if(rank) {
+    *inout_data = ea_checked_malloc(mpiSize + 1);
+    *inout_size = mpiSize;
+  }
+  for(int64_t position = 0; position < (int64_t)mpiSize; position += kMaxMessageSize) {
+    int count = mpiSize - position < kMaxMessageSize ? mpiSize - position : kMaxMessageSize;
+    if(MPI_SUCCESS != MPI_Bcast(*inout_data + position, count, MPI_BYTE, 0, com)) panic("MPI_Bcast");
+  }
+}
+
 esdm_status esdm_mpi_dataset_commit(MPI_Comm com, esdm_dataset_t *d){
   esdm_status ret;
-  int rank;
-  ret = MPI_Comm_rank(com, & rank);
+  int rank, procCount;
+  if(MPI_SUCCESS != MPI_Comm_rank(com, & rank)) return ESDM_ERROR;
+  if(MPI_SUCCESS != MPI_Comm_size(com, & procCount)) return ESDM_ERROR;
 
   // retrieve for all fragments the metadata and attach it to the metadata
-  if(rank == 0){
-    int procCount;
-    ret = MPI_Comm_size(com, & procCount);
-    int max_len = 10000000;
-    char * buff = ea_checked_malloc(max_len);
-    for(int p = 1 ; p < procCount; p++){
-      int size = max_len;
-      MPI_Status mstatus;
-      ret = MPI_Recv(buff, size, MPI_CHAR, MPI_ANY_SOURCE, 4711, com, & mstatus);
-      eassert(ret == MPI_SUCCESS);
-      int recvd_bytes = 0;
-      ret = MPI_Get_count(& mstatus, MPI_CHAR, & recvd_bytes);
-      eassert(ret == MPI_SUCCESS);
-      if (buff[0] != '[' || buff[recvd_bytes-2] != ']' || buff[recvd_bytes -1] != 0){
-        ESDM_ERROR_FMT("Buffer appears to be corrupted (%d bytes) \"%s\"\n", recvd_bytes, buff);
+  // The binary fragment tables are merged along a binomial tree: In the round with distance `step`, every process whose lowest set rank bit is `step` sends its merged table to `rank - step` and is done.
+  // This way, the root has all fragments after ceil(log2(procCount)) rounds, and no process handles more than that many messages.
+  int64_t size, fragmentCount = 0;
+  esdm_fragment_t ** fragments = rank ? esdmI_fragments_list(&d->fragments, & fragmentCount) : NULL; //the root already has its own fragments
+  char * buff = esdmI_fragmentTable_encode(d->dataspace->dims, fragmentCount, fragments, & size);
+  free(fragments);
+  for(int step = 1; step < procCount; step *= 2){
+    if(rank & step){
+      sendBuffer(com, rank - step, kFragmentTableTag, buff, size);
+      break;
+    }
+    if(rank + step < procCount){
+      int64_t childSize, mergedSize;
+      char * childBuff = receiveBuffer(com, rank + step, kFragmentTableTag, & childSize);
+      char * merged = esdmI_fragmentTable_merge(buff, size, childBuff, childSize, & mergedSize);
+      if(!merged){
+        ESDM_ERROR_FMT("Fragment table from rank %d appears to be corrupted (%"PRId64" bytes)\n", rank + step, childSize);
       }
+      free(childBuff);
+      free(buff);
+      buff = merged;
+      size = mergedSize;
+    }
+  }
 
-      json_t * elem = load_json(buff);
-      int json_frags = json_array_size(elem);
-
-      for (int i = 0; i < json_frags; i++) {
-        esdm_fragment_t * fragment;
-        json_t * frag_elem = json_array_get(elem, i);
-        ret = esdmI_create_fragment_from_metadata(d, frag_elem, & fragment);
-        if (ret != ESDM_SUCCESS){
-          MPI_Abort(com, 1);
-        }
-        ret = esdmI_fragments_add(&d->fragments, fragment);
-        if(ret == ESDM_INVALID_STATE_ERROR) {
-          //this happens when there is already a fragment with the exact same shape -> we don't need this fragment at all
-          esdm_fragment_destroy(fragment);
-          ret = ESDM_SUCCESS;
-        }
-        eassert(ret == ESDM_SUCCESS);
-      }
-      json_decref(elem);
+  if(rank == 0){
+    //fragments with a shape that we already have are dropped by the decoder
+    ret = esdmI_fragmentTable_decode(d, buff, size, NULL);
+    if (ret != ESDM_SUCCESS){
+      ESDM_ERROR_FMT("Merged fragment table appears to be corrupted (%"PRId64" bytes)\n", size);
     }
     free(buff);
+    if(d->fragments.uncommittedCount) d->status = ESDM_DATA_DIRTY;  //we may have received new fragments without writing any ourselves
     ret = esdm_dataset_commit(d);
-
-    MPI_Bcast(& ret, 1, MPI_INT, 0, com);
-    return ret;
   }else{
-    size_t size;
-    smd_string_stream_t * s = smd_string_stream_create();
-    esdmI_fragments_metadata_create(&d->fragments, s);
-    char * buff = smd_string_stream_close(s, & size);
-
-    ret = MPI_Send(buff, size + 1, MPI_CHAR, 0, 4711, com);
-    eassert(ret == MPI_SUCCESS);
     free(buff);
+    esdmI_fragments_markCommitted(&d->fragments); //rank 0 persists our fragments
+  }
 
-    MPI_Bcast(& ret, 1, MPI_INT, 0, com);
+  MPI_Bcast(& ret, 1, MPI_INT, 0, com);
+  return ret;
+}
 
-    return ret;
+//The aggregator writes the regions of all processes on its node.
+//If the regions tile their bounding box exactly, they are assembled into a single buffer and written with one `esdm_write()` call,
+//so that the fragmentation can cut the data into large fragments of the backends' preferred size.
+//Otherwise, the regions are written one by one.
+static esdm_status writeAggregated(esdm_dataset_t *dataset, int regionCount, int64_t *extends, char **data) {
+  int64_t dims = dataset->dataspace->dims;
+  esdm_type_t type = esdm_dataset_get_type(dataset);
+
+  //determine the bounding box and check whether it is covered exactly
+  int64_t boxStart[dims], boxEnd[dims], totalElements = 0;
+  esdmI_hypercube_t* regions[regionCount];
+  int nonEmptyCount = 0;
+  for(int i = 0; i < regionCount; i++) {
+    int64_t* offset = &extends[2*dims*i], *size = offset + dims;
+    regions[nonEmptyCount] = esdmI_hypercube_make(dims, offset, size);
+    int64_t elements = esdmI_hypercube_size(regions[nonEmptyCount]);
+    if(!elements) {
+      esdmI_hypercube_destroy(regions[nonEmptyCount]);
+      continue;
+    }
+    for(int64_t d = 0; d < dims; d++) {
+      if(!nonEmptyCount || offset[d] < boxStart[d]) boxStart[d] = offset[d];
+      if(!nonEmptyCount || offset[d] + size[d] > boxEnd[d]) boxEnd[d] = offset[d] + size[d];
+    }
+    data[nonEmptyCount] = data[i];
+    memmove(&extends[2*dims*nonEmptyCount], offset, 2*dims*sizeof*extends);
+    totalElements += elements;
+    nonEmptyCount++;
+  }
+  if(!nonEmptyCount) return ESDM_SUCCESS;
+
+  int64_t boxSize[dims], boxElements = 1;
+  for(int64_t d = 0; d < dims; d++) boxElements *= boxSize[d] = boxEnd[d] - boxStart[d];
+  bool exactCover = nonEmptyCount > 1 && boxElements == totalElements;
+  for(int i = 0; i < nonEmptyCount && exactCover; i++) {
+    for(int j = 0; j < i && exactCover; j++) exactCover = !esdmI_hypercube_doesIntersect(regions[i], regions[j]);
+  }
+  for(int i = 0; i < nonEmptyCount; i++) esdmI_hypercube_destroy(regions[i]);
+
+  esdm_status ret = ESDM_SUCCESS;
+  if(exactCover) {
+    esdm_dataspace_t* boxSpace;
+    ret = esdm_dataspace_create_full(dims, boxSize, boxStart, type, &boxSpace);
+    if(ret != ESDM_SUCCESS) return ret;
+    char* boxData = ea_checked_malloc(esdm_dataspace_total_bytes(boxSpace));
+    for(int i = 0; i < nonEmptyCount && ret == ESDM_SUCCESS; i++) {
+      esdm_dataspace_t* space;
+      ret = esdm_dataspace_create_full(dims, &extends[2*dims*i + dims], &extends[2*dims*i], type, &space);
+      if(ret != ESDM_SUCCESS) break;
+      ret = esdm_dataspace_copy_data(space, data[i], boxSpace, boxData);
+      esdm_dataspace_destroy(space);
+    }
+    if(ret == ESDM_SUCCESS) ret = esdm_write(dataset, boxData, boxSpace);
+    free(boxData);
+    esdm_dataspace_destroy(boxSpace);
+  } else {
+    for(int i = 0; i < nonEmptyCount && ret == ESDM_SUCCESS; i++) {
+      esdm_dataspace_t* space;
+      ret = esdm_dataspace_create_full(dims, &extends[2*dims*i + dims], &extends[2*dims*i], type, &space);
+      if(ret != ESDM_SUCCESS) break;
+      ret = esdm_write(dataset, data[i], space);
+      esdm_dataspace_destroy(space);
+    }
   }
+  return ret;
 }
 
-__attribute__((noreturn))
-void panic(const char* operation) {
-  fprintf(stderr, "failed %s, aborting...\n", operation);
-  abort();
+esdm_status esdm_mpi_write_collective(MPI_Comm com, esdm_dataset_t *dataset, void *buf, esdm_dataspace_t *memspace){
+  eassert(dataset);
+  eassert(memspace);
+  eassert(memspace->dims == dataset->dataspace->dims);
+  ESDM_DEBUG(__func__);
+
+  //the processes that share a node send their data to the first process on that node, which acts as the aggregator
+  MPI_Comm nodeComm;
+  int nodeRank, nodeSize;
+  if(MPI_SUCCESS != MPI_Comm_split_type(com, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &nodeComm)) return ESDM_ERROR;
+  if(MPI_SUCCESS != MPI_Comm_rank(nodeComm, &nodeRank)) panic("MPI_Comm_rank");
+  if(MPI_SUCCESS != MPI_Comm_size(nodeComm, &nodeSize)) panic("MPI_Comm_size");
+
+  //convert the local data to a contiguous buffer of the dataset's type, so that the aggregator does not need to know about our memory layout
+  int64_t dims = memspace->dims;
+  esdm_dataspace_t* packedSpace;
+  int localResult = esdm_dataspace_create_full(dims, memspace->size, memspace->offset, esdm_dataset_get_type(dataset), &packedSpace);
+  if(localResult != ESDM_SUCCESS) panic("esdm_dataspace_create_full");
+  int64_t packedBytes = esdm_dataspace_total_bytes(packedSpace);
+  char* packed = ea_checked_malloc(packedBytes + 1);
+  localResult = esdm_dataspace_copy_data(memspace, buf, packedSpace, packed);
+  if(localResult != ESDM_SUCCESS) packedBytes = 0;  //still take part in the communication, but don't contribute any data
+  int64_t localExtends[2*dims];
+  memcpy(localExtends, memspace->offset, dims*sizeof*localExtends);
+  for(int64_t d = 0; d < dims; d++) localExtends[dims + d] = packedBytes ? memspace->size[d] : 0;
+  esdm_dataspace_destroy(packedSpace);
+
+  int64_t* extends = nodeRank ? NULL : ea_checked_malloc(2*dims*nodeSize*sizeof*extends);
+  if(MPI_SUCCESS != MPI_Gather(localExtends, 2*dims, MPI_INT64_T, extends, 2*dims, MPI_INT64_T, 0, nodeComm)) panic("MPI_Gather");
+  if(nodeRank) {
+    sendBuffer(nodeComm, 0, kCollectiveDataTag, packed, packedBytes);
+    free(packed);
+  } else {
+    char** data = ea_checked_malloc(nodeSize*sizeof*data);
+    data[0] = packed;
+    for(int proc = 1; proc < nodeSize; proc++) {
+      int64_t size;
+      data[proc] = receiveBuffer(nodeComm, proc, kCollectiveDataTag, &size);
+    }
+    char** ownedData = ea_memdup(data, nodeSize*sizeof*data);  //writeAggregated() reorders `data`
+    int writeResult = writeAggregated(dataset, nodeSize, extends, data);
+    if(writeResult != ESDM_SUCCESS) localResult = writeResult;
+    for(int proc = 0; proc < nodeSize; proc++) free(ownedData[proc]);
+    free(ownedData);
+    free(data);
+    free(extends);
+  }
+  MPI_Comm_free(&nodeComm);
+
+  int globalResult;
+  if(MPI_SUCCESS != MPI_Allreduce(&localResult, &globalResult, 1, MPI_INT, MPI_MAX, com)) panic("MPI_Allreduce");
+  return globalResult;
+}
+
+//A fragment that is needed by one of the processes of a collective read, identified by its extends.
+typedef struct fragmentRequest_t {
+  const int64_t* extends; //offset followed by size
+  int64_t dims;
+  int rank;
+} fragmentRequest_t;
+
+static int compareFragmentRequests(const void* aVoid, const void* bVoid) {
+  const fragmentRequest_t* a = aVoid, *b = bVoid;
+  for(int64_t i = 0; i < 2*a->dims; i++) {
+    if(a->extends[i] != b->extends[i]) return a->extends[i] < b->extends[i] ? -1 : 1;
+  }
+  return a->rank - b->rank;
+}
+
+static bool sameFragment(const fragmentRequest_t* a, const fragmentRequest_t* b) {
+  return !memcmp(a->extends, b->extends, 2*a->dims*sizeof*a->extends);
+}
+
+//Fills the parts of the buffer that are not covered by any fragment with the fill value of the dataset.
+static esdm_status fillUncovered(esdm_dataset_t *dataset, void *buf, esdm_dataspace_t *memspace, esdmI_hypercubeSet_t* uncovered) {
+  if(esdmI_hypercubeSet_isEmpty(uncovered)) return ESDM_SUCCESS;
+  if(!esdm_dataset_is_fill_value_set(dataset)) return ESDM_INCOMPLETE_DATA;
+
+  //a dataspace with stride zero maps all logical elements to the single fill value element
+  esdm_type_t type = esdm_dataset_get_type(dataset);
+  int64_t dims = memspace->dims, size[dims], stride[dims];
+  for(int64_t d = 0; d < dims; d++) {
+    size[d] = INT64_MAX;
+    stride[d] = 0;
+  }
+  char fillValue[esdm_sizeof(type)];
+  esdm_status ret = esdm_dataset_get_fill_value(dataset, fillValue);
+  if(ret != ESDM_SUCCESS) return ret;
+  esdm_dataspace_t* fillSpace;
+  ret = esdm_dataspace_create(dims, size, type, &fillSpace);
+  if(ret != ESDM_SUCCESS) return ret;
+  esdm_dataspace_set_stride(fillSpace, stride);
+
+  esdmI_hypercubeList_t* list = esdmI_hypercubeSet_list(uncovered);
+  for(int64_t i = 0; i < list->count && ret == ESDM_SUCCESS; i++) {
+    ret = esdmI_dataspace_setExtends(fillSpace, list->cubes[i]);
+    if(ret == ESDM_SUCCESS) ret = esdm_dataspace_copy_data(fillSpace, fillValue, memspace, buf);
+  }
+  esdm_dataspace_destroy(fillSpace);
+  return ret;
+}
+
+//Copies the part of a fragment that lies within `region` between a contiguous message buffer and another buffer.
+//Returns the number of bytes in the message buffer.
+static int64_t transferIntersection(esdm_dataset_t *dataset, const int64_t* fragmentExtends, esdmI_hypercube_t* region, esdm_dataspace_t* otherSpace, void* otherData, char* message, bool toMessage) {
+  int64_t dims = dataset->dataspace->dims;
+  esdmI_hypercube_t* fragment = esdmI_hypercube_make(dims, (int64_t*)fragmentExtends, (int64_t*)fragmentExtends + dims);
+  esdmI_hypercube_t* intersection = esdmI_hypercube_makeIntersection(fragment, region);
+  esdmI_hypercube_destroy(fragment);
+  if(!intersection) return 0;
+
+  esdm_dataspace_t* messageSpace;
+  esdm_status ret = esdmI_dataspace_createFromHypercube(intersection, esdm_dataset_get_type(dataset), &messageSpace);
+  esdmI_hypercube_destroy(intersection);
+  eassert(ret == ESDM_SUCCESS);
+  int64_t bytes = esdm_dataspace_total_bytes(messageSpace);
+  if(message) {
+    ret = toMessage ? esdm_dataspace_copy_data(otherSpace, otherData, messageSpace, message) : esdm_dataspace_copy_data(messageSpace, message, otherSpace, otherData);
+    eassert(ret == ESDM_SUCCESS);
+  }
+  esdm_dataspace_destroy(messageSpace);
+  return bytes;
+}
+
+esdm_status esdm_mpi_read_collective(MPI_Comm com, esdm_dataset_t *dataset, void *buf, esdm_dataspace_t *memspace){
+  eassert(dataset);
+  eassert(memspace);
+  eassert(memspace->dims == dataset->dataspace->dims);
+  ESDM_DEBUG(__func__);
+
+  int rank, procCount;
+  if(MPI_SUCCESS != MPI_Comm_rank(com, &rank)) return ESDM_ERROR;
+  if(MPI_SUCCESS != MPI_Comm_size(com, &procCount)) return ESDM_ERROR;
+  int64_t dims = memspace->dims;
+  esdm_type_t type = esdm_dataset_get_type(dataset);
+  int localResult = ESDM_SUCCESS;
+
+  //determine the fragments that we need, and fill the holes right away
+  esdmI_hypercube_t* ownRegion;
+  esdmI_dataspace_getExtends(memspace, &ownRegion);
+  int64_t fragmentCount = 0;
+  esdm_fragment_t** fragments = NULL;
+  if(esdmI_hypercube_size(ownRegion)) {
+    esdmI_accessPattern_recordRead(&dataset->accessPattern, ownRegion);
+    esdmI_hypercubeSet_t* uncovered;
+    bool fullyCovered;
+    localResult = esdmI_dataset_fragmentsCoveringRegion(dataset, ownRegion, &fragmentCount, &fragments, &uncovered, &fullyCovered);
+    if(localResult == ESDM_SUCCESS) {
+      localResult = fillUncovered(dataset, buf, memspace, uncovered);
+      esdmI_hypercubeSet_destroy(uncovered);
+    } else {
+      fragmentCount = 0;
+    }
+  }
+  esdmI_hypercube_destroy(ownRegion);
+
+  //tell everyone about our region and the fragments we need
+  int64_t* localExtends = ea_checked_malloc(2*dims*(fragmentCount + 1)*sizeof*localExtends);
+  memcpy(localExtends, memspace->offset, dims*sizeof*localExtends);
+  memcpy(localExtends + dims, memspace->size, dims*sizeof*localExtends);
+  for(int64_t i = 0; i < fragmentCount; i++) {
+    memcpy(&localExtends[2*dims*(i + 1)], fragments[i]->dataspace->offset, dims*sizeof*localExtends);
+    memcpy(&localExtends[2*dims*(i + 1) + dims], fragments[i]->dataspace->size, dims*sizeof*localExtends);
+  }
+  free(fragments);
+  int localCount = 2*dims*(fragmentCount + 1);
+  int* counts = ea_checked_malloc(procCount*sizeof*counts);
+  int* displacements = ea_checked_malloc(procCount*sizeof*displacements);
+  if(MPI_SUCCESS != MPI_Allgather(&localCount, 1, MPI_INT, counts, 1, MPI_INT, com)) panic("MPI_Allgather");
+  int64_t totalCount = 0;
+  for(int proc = 0; proc < procCount; proc++) {
+    displacements[proc] = totalCount;
+    totalCount += counts[proc];
+    eassert(totalCount <= INT32_MAX && "`int` must be large enough to hold the extends of all requested fragments");
+  }
+  int64_t* allExtends = ea_checked_malloc(totalCount*sizeof*allExtends);
+  if(MPI_SUCCESS != MPI_Allgatherv(localExtends, localCount, MPI_INT64_T, allExtends, counts, displacements, MPI_INT64_T, com)) panic("MPI_Allgatherv");
+
+  //Sort the requests so that requests for the same fragment are adjacent.
+  //Each fragment is read by exactly one of the processes that need it, the one with the least bytes assigned so far.
+  //Every process computes the same assignment, so there is no need to communicate it.
+  esdmI_hypercube_t** regions = ea_checked_malloc(procCount*sizeof*regions);
+  int64_t requestCount = totalCount/(2*dims) - procCount;
+  fragmentRequest_t* requests = ea_checked_malloc((requestCount + 1)*sizeof*requests);
+  for(int proc = 0, i = 0; proc < procCount; proc++) {
+    int64_t* procExtends = &allExtends[displacements[proc]];
+    regions[proc] = esdmI_hypercube_make(dims, procExtends, procExtends + dims);
+    for(int64_t j = 1; j < counts[proc]/(2*dims); j++) {
+      requests[i++] = (fragmentRequest_t){ .extends = &procExtends[2*dims*j], .dims = dims, .rank = proc };
+    }
+  }
+  qsort(requests, requestCount, sizeof*requests, compareFragmentRequests);
+  int* readers = ea_checked_malloc((requestCount + 1)*sizeof*readers);  //the reader for the fragment of each request
+  int64_t* assignedBytes = ea_checked_calloc(procCount, sizeof*assignedBytes);
+  int64_t ownedCount = 0;
+  for(int64_t start = 0, end; start < requestCount; start = end) {
+    int reader = requests[start].rank;
+    for(end = start + 1; end < requestCount && sameFragment(&requests[start], &requests[end]); end++) {
+      if(assignedBytes[requests[end].rank] < assignedBytes[reader]) reader = requests[end].rank;
+    }
+    int64_t elements = 1;
+    for(int64_t d = 0; d < dims; d++) elements *= requests[start].extends[dims + d];
+    assignedBytes[reader] += elements*esdm_sizeof(type);
+    for(int64_t i = start; i < end; i++) readers[i] = reader;
+    if(reader == rank) ownedCount++;
+  }
+
+  //read the fragments that were assigned to us with a single scheduler call, so that the backends can work on them in parallel
+  //these reads are internal, the access pattern of the dataset only records the region that the user asked for
+  void** ownedData = ea_checked_malloc((ownedCount + 1)*sizeof*ownedData);
+  esdm_dataspace_t** ownedSpaces = ea_checked_malloc((ownedCount + 1)*sizeof*ownedSpaces);
+  int64_t* ownedRequests = ea_checked_malloc((ownedCount + 1)*sizeof*ownedRequests);  //the first request for each owned fragment
+  ownedCount = 0;
+  for(int64_t i = 0; i < requestCount; i++) {
+    if(readers[i] != rank || (i && sameFragment(&requests[i - 1], &requests[i]))) continue;
+    esdm_status ret = esdm_dataspace_create_full(dims, (int64_t*)requests[i].extends + dims, (int64_t*)requests[i].extends, type, &ownedSpaces[ownedCount]);
+    eassert(ret == ESDM_SUCCESS);
+    ownedData[ownedCount] = ea_checked_malloc(esdm_dataspace_total_bytes(ownedSpaces[ownedCount]));
+    ownedRequests[ownedCount++] = i;
+  }
+  if(ownedCount) {
+    esdm_status ret = esdm_scheduler_read_multi_blocking(esdmI_esdm(), dataset, ownedCount, ownedData, ownedSpaces, true);
+    if(ret != ESDM_SUCCESS) localResult = ret;
+  }
+
+  //Redistribute the data: Each request turns into one message part from the reader to the requesting process,
+  //which contains the intersection of the fragment with the region of the requesting process.
+  //The parts are ordered by request, which both sides know.
+  int* sendCounts = ea_checked_calloc(procCount, sizeof*sendCounts);
+  int* recvCounts = ea_checked_calloc(procCount, sizeof*recvCounts);
+  int* sendDisplacements = ea_checked_malloc(procCount*sizeof*sendDisplacements);
+  int* recvDisplacements = ea_checked_malloc(procCount*sizeof*recvDisplacements);
+  int64_t* partBytes = ea_checked_malloc((requestCount + 1)*sizeof*partBytes);
+  for(int64_t i = 0; i < requestCount; i++) {
+    partBytes[i] = 0;
+    if(readers[i] != rank && requests[i].rank != rank) continue;
+    partBytes[i] = transferIntersection(dataset, requests[i].extends, regions[requests[i].rank], NULL, NULL, NULL, true);
+    if(readers[i] == rank) sendCounts[requests[i].rank] += partBytes[i];
+    if(requests[i].rank == rank) recvCounts[readers[i]] += partBytes[i];
+  }
+  int64_t sendTotal = 0, recvTotal = 0;
+  for(int proc = 0; proc < procCount; proc++) {
+    sendDisplacements[proc] = sendTotal;
+    recvDisplacements[proc] = recvTotal;
+    sendTotal += sendCounts[proc];
+    recvTotal += recvCounts[proc];
+    eassert(sendTotal <= INT32_MAX && recvTotal <= INT32_MAX && "`int` must be large enough to hold the size of the redistributed data");
+  }
+  char* sendBuff = ea_checked_malloc(sendTotal + 1);
+  char* recvBuff = ea_checked_malloc(recvTotal + 1);
+  int* sendPositions = ea_memdup(sendDisplacements, procCount*sizeof*sendPositions);
+  for(int64_t i = 0, owned = -1; i < requestCount; i++) {
+    if(readers[i] != rank) continue;
+    if(owned < 0 || !sameFragment(&requests[ownedRequests[owned]], &requests[i])) owned++;
+    int destination = requests[i].rank;
+    transferIntersection(dataset, requests[i].extends, regions[destination], ownedSpaces[owned], ownedData[owned], sendBuff + sendPositions[destination], true);
+    sendPositions[destination] += partBytes[i];
+  }
+  if(MPI_SUCCESS != MPI_Alltoallv(sendBuff, sendCounts, sendDisplacements, MPI_BYTE, recvBuff, recvCounts, recvDisplacements, MPI_BYTE, com)) panic("MPI_Alltoallv");
+  int* recvPositions = ea_memdup(recvDisplacements, procCount*sizeof*recvPositions);
+  for(int64_t i = 0; i < requestCount; i++) {
+    if(requests[i].rank != rank) continue;
+    transferIntersection(dataset, requests[i].extends, regions[rank], memspace, buf, recvBuff + recvPositions[readers[i]], false);
+    recvPositions[readers[i]] += partBytes[i];
+  }
+
+  for(int64_t i = 0; i < ownedCount; i++) {
+    free(ownedData[i]);
+    esdm_dataspace_destroy(ownedSpaces[i]);
+  }
+  for(int proc = 0; proc < procCount; proc++) esdmI_hypercube_destroy(regions[proc]);
+  free(recvPositions);
+  free(sendPositions);
+  free(recvBuff);
+  free(sendBuff);
+  free(partBytes);
+  free(recvDisplacements);
+  free(sendDisplacements);
+  free(recvCounts);
+  free(sendCounts);
+  free(ownedRequests);
+  free(ownedSpaces);
+  free(ownedData);
+  free(assignedBytes);
+  free(readers);
+  free(requests);
+  free(regions);
+  free(allExtends);
+  free(localExtends);
+  free(displacements);
+  free(counts);
+
+  int globalResult;
+  if(MPI_SUCCESS != MPI_Allreduce(&localResult, &globalResult, 1, MPI_INT, MPI_MAX, com)) panic("MPI_Allreduce");
+  return globalResult;
 }
 
 esdm_status esdm_mpi_grid_bcast(MPI_Comm comm, esdm_dataset_t* dataset, esdm_grid_t** inout_grid) {
@@ -383,16 +809,10 @@ esdm_status esdm_mpi_grid_bcast(MPI_Comm comm, esdm_dataset_t* dataset, esdm_gri
     if(MPI_SUCCESS != MPI_Bcast(&datasetIdSize, 1, MPI_UINT64_T, 0, comm)) panic("MPI_Bcast");
     if(MPI_SUCCESS != MPI_Bcast(dataset->id, datasetIdSize + 1, MPI_BYTE, 0, comm)) panic("MPI_Bcast");
 
-    smd_string_stream_t* stream = smd_string_stream_create();
-    if(!stream) panic("memory allocation");
-    esdmI_grid_serialize(stream, *inout_grid);
-    size_t size;
-    char* serializedGrid = smd_string_stream_close(stream, &size);
-
-    uint64_t mpiSize = size;  //MPI does not have a type for `size_t`
-    if(MPI_SUCCESS != MPI_Bcast(&mpiSize, 1, MPI_UINT64_T, 0, comm)) panic("MPI_Bcast");
-    if(MPI_SUCCESS != MPI_Bcast(serializedGrid, mpiSize + 1, MPI_BYTE, 0, comm)) panic("MPI_Bcast");
-    free(serializedGrid);
+    int64_t size;
+    char* encodedGrid = esdmI_grid_encode(*inout_grid, false, &size);
+    bcastBuffer(comm, &encodedGrid, &size);
+    free(encodedGrid);
   } else {
     uint64_t rootDatasetIdSize;
     if(MPI_SUCCESS != MPI_Bcast(&rootDatasetIdSize, 1, MPI_UINT64_T, 0, comm)) panic("MPI_Bcast");
@@ -401,15 +821,13 @@ esdm_status esdm_mpi_grid_bcast(MPI_Comm comm, esdm_dataset_t* dataset, esdm_gri
     bool datasetIdMatches = !strcmp(rootDatasetId, dataset->id);
     free(rootDatasetId);
 
-    uint64_t stringSize;
-    if(MPI_SUCCESS != MPI_Bcast(&stringSize, 1, MPI_UINT64_T, 0, comm)) panic("MPI_Bcast");
-    char* string = ea_checked_malloc(stringSize + 1);
-    if(MPI_SUCCESS != MPI_Bcast(string, stringSize + 1, MPI_BYTE, 0, comm)) panic("MPI_Bcast");
+    int64_t size;
+    char* encodedGrid = NULL;
+    bcastBuffer(comm, &encodedGrid, &size);
 
     //TODO: Check whether we already have a grid with this ID, and merge the data into that grid in that case.
-    //      This requires that we know about the corresponding dataset here.
-    localResult = datasetIdMatches ? esdmI_grid_createFromString(string, dataset, inout_grid) : ESDM_INVALID_ARGUMENT_ERROR;
-    free(string);
+    localResult = datasetIdMatches ? esdmI_grid_createFromBinary(encodedGrid, size, dataset, inout_grid) : ESDM_INVALID_ARGUMENT_ERROR;
+    free(encodedGrid);
   }
 
   int globalResult;
@@ -423,48 +841,44 @@ esdm_status esdm_mpi_grid_commit(MPI_Comm comm, esdm_grid_t* grid) {
   int rank, procCount;
   if(MPI_SUCCESS != MPI_Comm_rank(comm, &rank)) return ESDM_ERROR;
   if(MPI_SUCCESS != MPI_Comm_size(comm, &procCount)) return ESDM_ERROR;
-  int result = ESDM_SUCCESS;
+  int localResult = ESDM_SUCCESS;
 
-  if(!rank) {
-    uint64_t* sizes = ea_checked_malloc(procCount*sizeof*sizes), dummy = 0;
-    if(MPI_SUCCESS != MPI_Gather(&dummy, 1, MPI_UINT64_T, sizes, 1, MPI_UINT64_T, 0, comm)) panic("MPI_Gather");
-
-    int* counts = ea_checked_malloc(procCount*sizeof*counts);
-    int* offsets = ea_checked_malloc(procCount*sizeof*offsets);
-    offsets[0] = counts[0] = 0;
-    for(int proc = 1; proc < procCount; proc++) {
-      counts[proc] = sizes[proc];
-      eassert(counts[proc] == sizes[proc] && "`int` must be large enough to hold the sizes of the serialized grids");
-      offsets[proc] = offsets[proc - 1] + counts[proc - 1];
-      eassert(INT_MAX - counts[proc] > offsets[proc] && "`int` must be large enough to hold the total size of the serialized grids");
+  // The grid encodings are merged along the same binomial tree as the fragment tables in esdm_mpi_dataset_commit().
+  // Each process only ships the cells that it has filled since the last commit, and the inner nodes of the tree merge the encodings without decoding them,
+  // so the root only has to decode each fragment once, and it does so in ceil(log2(procCount)) chunks.
+  int64_t size = 0;
+  char* encodedGrid = rank ? esdmI_grid_encode(grid, true, &size) : NULL;
+  for(int step = 1; step < procCount; step *= 2) {
+    if(rank & step) {
+      sendBuffer(comm, rank - step, kGridTag, encodedGrid, size);
+      break;
     }
-    int totalSize = offsets[procCount - 1] + counts[procCount - 1];
-    char* serializedGrids = ea_checked_malloc(totalSize*sizeof*serializedGrids);
-    if(MPI_SUCCESS != MPI_Gatherv(&dummy, 0, MPI_BYTE, serializedGrids, counts, offsets, MPI_BYTE, 0, comm)) panic("MPI_Gatherv");
-
-    for(int proc = 1; proc < procCount; proc++) {
-      result = esdmI_grid_mergeWithString(grid, serializedGrids + offsets[proc]);
-      if(result != ESDM_SUCCESS) break;
+    if(rank + step < procCount) {
+      int64_t childSize;
+      char* childGrid = receiveBuffer(comm, rank + step, kGridTag, &childSize);
+      esdm_status ret;
+      if(!rank) {
+        ret = esdmI_grid_mergeWithBinary(grid, childGrid, childSize);
+      } else {
+        char* merged;
+        int64_t mergedSize;
+        ret = esdmI_grid_mergeEncodings(encodedGrid, size, childGrid, childSize, &merged, &mergedSize);
+        if(ret == ESDM_SUCCESS) {
+          free(encodedGrid);
+          encodedGrid = merged;
+          size = mergedSize;
+        }
+      }
+      if(ret != ESDM_SUCCESS) {
+        ESDM_WARN_FMT("cannot merge the grid received from rank %d (%"PRId64" bytes)", rank + step, childSize);
+        if(ret > localResult) localResult = ret;
+      }
+      free(childGrid);
     }
-
-    free(serializedGrids);
-    free(offsets);
-    free(counts);
-    free(sizes);
-  } else {
-    smd_string_stream_t* stream = smd_string_stream_create();
-    if(!stream) panic("memory allocation");
-    esdmI_grid_serialize(stream, grid);
-    size_t size;
-    char* serializedGrid = smd_string_stream_close(stream, &size);
-
-    uint64_t mpiSize = size + 1, dummy;  //MPI does not have a type for `size_t`, +1 because we want to send the terminating null byte as well
-    if(MPI_SUCCESS != MPI_Gather(&mpiSize, 1, MPI_UINT64_T, &dummy, 1, MPI_UINT64_T, 0, comm)) panic("MPI_Gather");
-    if(MPI_SUCCESS != MPI_Gatherv(serializedGrid, mpiSize, MPI_BYTE, &dummy, NULL, NULL, MPI_BYTE, 0, comm)) panic("MPI_Gatherv");
-
-    free(serializedGrid);
   }
+  free(encodedGrid);
 
-  if(MPI_SUCCESS != MPI_Bcast(&result, 1, MPI_INT, 0, MPI_COMM_WORLD)) panic("MPI_Bcast");
-  return result;
+  int globalResult;
+  if(MPI_SUCCESS != MPI_Allreduce(&localResult, &globalResult, 1, MPI_INT, MPI_MAX, comm)) panic("MPI_Allreduce");
+  return globalResult;
 }
@@ -224,6 +224,14 @@ int esdmI_backend_fragment_write_stream_blocksize(esdm_backend_t * b, estream_wr
   return result;
 }
 
+int esdmI_backend_fragment_retrieve_range(esdm_backend_t * b, esdm_fragment_t *fragment, int64_t offset, int64_t size, void * buf) {
+  timer clock;
+  ea_start_timer(&clock);
+  int result = b->callbacks.fragment_retrieve_range(b, fragment, offset, size, buf);
+  gBackendTimes.fragment_retrieve_range += ea_stop_timer(clock);
+  return result;
+}
+
 esdm_backendTimes_t esdmI_performance_backend() {
   return gBackendTimes;
 }
@@ -243,6 +251,7 @@ esdm_backendTimes_t esdmI_performance_backend_add(const esdm_backendTimes_t* a,
     .mkfs = a->mkfs + b->mkfs,
     .fsck = a->fsck + b->fsck,
     .fragment_write_stream_blocksize = a->fragment_write_stream_blocksize + b->fragment_write_stream_blocksize,
+    .fragment_retrieve_range = a->fragment_retrieve_range + b->fragment_retrieve_range,
   };
 }
 
@@ -261,6 +270,7 @@ esdm_backendTimes_t esdmI_performance_backend_sub(const esdm_backendTimes_t* min
     .mkfs = minuend->mkfs - subtrahend->mkfs,
     .fsck = minuend->fsck - subtrahend->fsck,
     .fragment_write_stream_blocksize = minuend->fragment_write_stream_blocksize - subtrahend->fragment_write_stream_blocksize,
+    .fragment_retrieve_range = minuend->fragment_retrieve_range - subtrahend->fragment_retrieve_range,
   };
 }
 
@@ -281,6 +291,7 @@ void esdmI_performance_backend_print(FILE* stream, const char* linePrefix, const
   printTime(stream, linePrefix, indentation, diff, mkfs);
   printTime(stream, linePrefix, indentation, diff, fsck);
   printTime(stream, linePrefix, indentation, diff, fragment_write_stream_blocksize);
+  printTime(stream, linePrefix, indentation, diff, fragment_retrieve_range);
 }
 
 esdm_fragmentsTimes_t esdmI_performance_fragments_add(const esdm_fragmentsTimes_t* a, const esdm_fragmentsTimes_t* b) {
@@ -0,0 +1,83 @@
+/* This file is part of ESDM.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with ESDM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This test checks that the recorded access pattern of a dataset yields sensible fragment shapes.
+ */
+
+#include <esdm-internal.h>
+#include <test/util/test_util.h>
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void recordReads(esdmI_accessPattern_t* pattern, int64_t count, int64_t* offset, int64_t* size) {
+  esdmI_hypercube_t* region = esdmI_hypercube_make(3, offset, size);
+  for(int64_t i = 0; i < count; i++) esdmI_accessPattern_recordRead(pattern, region);
+  esdmI_hypercube_destroy(region);
+}
+
+int main() {
+  int64_t spaceSize[3] = {1000, 100, 100};
+  esdm_dataspace_t* space;
+  esdm_status ret = esdm_dataspace_create(3, spaceSize, SMD_DTYPE_DOUBLE, &space);
+  eassert(ret == ESDM_SUCCESS);
+
+  esdmI_accessPattern_t pattern;
+  esdmI_accessPattern_construct(&pattern);
+  int64_t edges[3];
+
+  //no reads recorded, so there must not be a recommendation
+  eassert(!esdmI_accessPattern_fragmentShape(&pattern, space, 8*1000, edges));
+
+  //time series reads at single grid points must yield fragments that extend along the time axis only
+  int64_t pointOffset[3] = {0, 42, 17}, pointSize[3] = {1000, 1, 1};
+  recordReads(&pattern, 16, pointOffset, pointSize);
+  eassert(esdmI_accessPattern_fragmentShape(&pattern, space, 8*1000, edges));
+  printf("time series reads: fragment shape (%"PRId64", %"PRId64", %"PRId64")\n", edges[0], edges[1], edges[2]);
+  eassert(edges[0] == 1000 && edges[1] == 1 && edges[2] == 1);
+
+  //the pattern must survive a round trip through the metadata
+  smd_string_stream_t* stream = smd_string_stream_create();
+  esdmI_accessPattern_serialize(stream, &pattern);
+  size_t jsonSize;
+  char* json = smd_string_stream_close(stream, &jsonSize);
+  esdmI_accessPattern_t loaded;
+  esdmI_accessPattern_construct(&loaded);
+  json_t* root = load_json(json);
+  ret = esdmI_accessPattern_loadJson(&loaded, root);
+  eassert(ret == ESDM_SUCCESS);
+  json_decref(root);
+  free(json);
+  int64_t loadedEdges[3];
+  eassert(esdmI_accessPattern_fragmentShape(&loaded, space, 8*1000, loadedEdges));
+  eassert(!memcmp(edges, loadedEdges, sizeof(edges)));
+  esdmI_accessPattern_destruct(&loaded);
+
+  //once full time slices dominate the pattern, the fragments must not extend along the time axis anymore
+  int64_t sliceOffset[3] = {5, 0, 0}, sliceSize[3] = {1, 100, 100};
+  recordReads(&pattern, 500, sliceOffset, sliceSize);
+  eassert(esdmI_accessPattern_fragmentShape(&pattern, space, 8*1000, edges));
+  printf("time slice reads: fragment shape (%"PRId64", %"PRId64", %"PRId64")\n", edges[0], edges[1], edges[2]);
+  eassert(edges[0] == 1 && edges[1]*edges[2] <= 1000);
+
+  esdmI_accessPattern_destruct(&pattern);
+  esdm_dataspace_destroy(space);
+  printf("\nOK\n");
+  return 0;
+}
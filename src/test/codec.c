@@ -0,0 +1,183 @@
+/* This file is part of ESDM.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with ESDM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This test checks the built-in compression pipeline:
+ * Every stage must reproduce its input for all element sizes, corrupted input must be rejected,
+ * and a smooth field written with a codec hint must be stored compressed and read back unchanged.
+ * The fragments are compressed in small blocks, so that a partial read must only fetch the blocks that it needs.
+ */
+
+#include <esdm.h>
+#include <esdm-internal.h>
+#include <test/util/test_util.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HEIGHT 200
+#define WIDTH 300
+
+static void checkRoundtrip(int64_t stageCount, const esdm_codec_stage_t* stages, int64_t elementSize, const void* data, int64_t size, int64_t* out_encodedSize) {
+  esdmI_codec_t* codec;
+  esdm_status ret = esdmI_codec_create(stageCount, stages, &codec);
+  eassert(ret == ESDM_SUCCESS);
+  void* encoded;
+  int64_t encodedSize;
+  ret = esdmI_codec_encode(codec, elementSize, data, size, &encoded, &encodedSize);
+  eassert(ret == ESDM_SUCCESS);
+  eassert(esdmI_codec_isEncoded(encoded, encodedSize));
+
+  char* decoded = ea_checked_malloc(size + 1);
+  ret = esdmI_codec_decode(encoded, encodedSize, decoded, size);
+  eassert(ret == ESDM_SUCCESS);
+  eassert(!memcmp(decoded, data, size));
+  eassert(esdmI_codec_decode(encoded, encodedSize, decoded, size + 1) == ESDM_INVALID_DATA_ERROR);
+
+  if(out_encodedSize) *out_encodedSize = encodedSize;
+  free(decoded);
+  free(encoded);
+  esdmI_codec_destroy(codec);
+}
+
+static float fieldValue(int64_t x, int64_t y) {
+  //a temperature like field with a resolution of 0.01 K
+  return roundf((280 + 20*sin(x*0.02)*cos(y*0.015))*100)/100;
+}
+
+static void init() {
+  esdm_status ret = esdm_load_config_str("{\"esdm\": {"
+    "\"codec block bytes\": 16384,"
+    "\"backends\": [{\"type\": \"POSIX\", \"id\": \"p1\", \"accessibility\": \"global\", \"target\": \"./_posix1\"}],"
+    "\"metadata\": {\"type\": \"metadummy\", \"id\": \"md\", \"target\": \"./_metadummy\"}"
+    "}}");
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_init();
+  eassert(ret == ESDM_SUCCESS);
+}
+
+int main(int argc, char const *argv[]) {
+  //single stages with all element sizes, including sizes that do not divide the data size
+  const esdm_codec_stage_t stages[] = {ESDM_CODEC_BYTE_SHUFFLE, ESDM_CODEC_BIT_SHUFFLE, ESDM_CODEC_DELTA, ESDM_CODEC_XOR, ESDM_CODEC_LZ};
+  unsigned char bytes[1000];
+  for(int64_t i = 0; i < (int64_t)sizeof(bytes); i++) bytes[i] = i*i%7 + i/100;
+  for(int stage = 0; stage < 5; stage++) {
+    for(int64_t elementSize = 1; elementSize <= 9; elementSize++) {
+      for(int64_t size = 0; size < (int64_t)sizeof(bytes); size += 37) checkRoundtrip(1, &stages[stage], elementSize, bytes, size, NULL);
+    }
+  }
+  eassert(!esdmI_codec_isEncoded(bytes, sizeof(bytes)));
+  esdmI_codec_t* codec;
+  eassert(esdmI_codec_create(0, stages, &codec) == ESDM_INVALID_ARGUMENT_ERROR);
+  eassert(esdmI_codec_create(1, (esdm_codec_stage_t[]){42}, &codec) == ESDM_INVALID_ARGUMENT_ERROR);
+
+  //full pipelines must compress a smooth field
+  float* field = ea_checked_malloc(HEIGHT*WIDTH*sizeof(*field));
+  for(int64_t x = 0; x < HEIGHT; x++) {
+    for(int64_t y = 0; y < WIDTH; y++) field[x*WIDTH + y] = fieldValue(x, y);
+  }
+  const esdm_codec_stage_t pipeline[] = {ESDM_CODEC_XOR, ESDM_CODEC_BYTE_SHUFFLE, ESDM_CODEC_LZ};
+  int64_t encodedSize;
+  checkRoundtrip(3, pipeline, sizeof(*field), field, HEIGHT*WIDTH*sizeof(*field), &encodedSize);
+  printf("compressed %zu bytes to %"PRId64" bytes\n", HEIGHT*WIDTH*sizeof(*field), encodedSize);
+  eassert(2*encodedSize < HEIGHT*WIDTH*sizeof(*field));
+
+  //write the field through a dataset with a codec hint
+  init();
+  esdm_status ret = esdm_mkfs(ESDM_FORMAT_PURGE_RECREATE, ESDM_ACCESSIBILITY_GLOBAL);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_mkfs(ESDM_FORMAT_PURGE_RECREATE, ESDM_ACCESSIBILITY_NODELOCAL);
+  eassert(ret == ESDM_SUCCESS);
+
+  esdm_container_t *container;
+  esdm_dataset_t *dataset;
+  esdm_simple_dspace_t space = esdm_dataspace_2d(HEIGHT, WIDTH, SMD_DTYPE_FLOAT);
+  ret = esdm_container_create("mycontainer", 1, &container);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_dataset_create(container, "mydataset", space.ptr, &dataset);
+  eassert(ret == ESDM_SUCCESS);
+  eassert(esdm_dataset_set_codec_hint(dataset, 1, (esdm_codec_stage_t[]){42}) == ESDM_INVALID_ARGUMENT_ERROR);
+  ret = esdm_dataset_set_codec_hint(dataset, 3, pipeline);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_write(dataset, field, space.ptr);
+  eassert(ret == ESDM_SUCCESS);
+
+  int64_t fragmentCount;
+  esdm_fragment_t** fragments = esdmI_fragments_list(&dataset->fragments, &fragmentCount);
+  eassert(fragmentCount > 0);
+  for(int64_t i = 0; i < fragmentCount; i++) {
+    eassert(fragments[i]->actual_bytes != -1);
+    eassert(fragments[i]->actual_bytes < fragments[i]->bytes);
+  }
+  free(fragments);
+
+  ret = esdm_dataset_commit(dataset);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_container_commit(container);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_dataset_close(dataset);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_container_close(container);
+  eassert(ret == ESDM_SUCCESS);
+  esdm_dataspace_destroy(space.ptr);
+  ret = esdm_finalize();
+  eassert(ret == ESDM_SUCCESS);
+
+  //read it back with a fresh instance, the compressed fragments must be decoded transparently
+  init();
+  ret = esdm_container_open("mycontainer", ESDM_MODE_FLAG_READ, &container);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_dataset_open(container, "mydataset", ESDM_MODE_FLAG_READ, &dataset);
+  eassert(ret == ESDM_SUCCESS);
+
+  //a small read only decodes the blocks it needs, it must not load the fragments
+  float region[10][20];
+  esdm_simple_dspace_t regionSpace = esdm_dataspace_2do(95, 10, 140, 20, SMD_DTYPE_FLOAT);
+  ret = esdm_read(dataset, region, regionSpace.ptr);
+  eassert(ret == ESDM_SUCCESS);
+  for(int64_t x = 0; x < 10; x++) {
+    for(int64_t y = 0; y < 20; y++) eassert(region[x][y] == field[(95 + x)*WIDTH + 140 + y]);
+  }
+  esdm_dataspace_destroy(regionSpace.ptr);
+  fragments = esdmI_fragments_list(&dataset->fragments, &fragmentCount);
+  int64_t blockedFragments = 0;
+  for(int64_t i = 0; i < fragmentCount; i++) {
+    eassert(fragments[i]->status == ESDM_DATA_NOT_LOADED);
+    if(fragments[i]->blocks) blockedFragments++;
+  }
+  eassert(blockedFragments > 0);
+  free(fragments);
+  float* readField = ea_checked_calloc(HEIGHT*WIDTH, sizeof(*readField));
+  space = esdm_dataspace_2d(HEIGHT, WIDTH, SMD_DTYPE_FLOAT);
+  ret = esdm_read(dataset, readField, space.ptr);
+  eassert(ret == ESDM_SUCCESS);
+  eassert(!memcmp(readField, field, HEIGHT*WIDTH*sizeof(*field)));
+
+  ret = esdm_dataset_close(dataset);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_container_close(container);
+  eassert(ret == ESDM_SUCCESS);
+  esdm_dataspace_destroy(space.ptr);
+  ret = esdm_finalize();
+  eassert(ret == ESDM_SUCCESS);
+
+  free(readField);
+  free(field);
+  printf("\nOK\n");
+  return 0;
+}
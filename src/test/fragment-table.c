@@ -0,0 +1,154 @@
+/* This file is part of ESDM.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with ESDM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This test encodes the fragments of a dataset as a binary fragment table, and decodes them again.
+ */
+
+#include <esdm.h>
+#include <esdm-internal.h>
+#include <test/util/test_util.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HEIGHT 10
+#define WIDTH 1000
+
+int main(int argc, char const *argv[]) {
+  uint64_t *data = ea_checked_malloc(HEIGHT * WIDTH * sizeof(*data));
+  for (int i = 0; i < HEIGHT * WIDTH; i++) data[i] = i;
+
+  esdm_status ret;
+  esdm_container_t *container = NULL;
+  esdm_dataset_t *dataset = NULL;
+
+  ret = esdm_init();
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_mkfs(ESDM_FORMAT_PURGE_RECREATE, ESDM_ACCESSIBILITY_GLOBAL);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_mkfs(ESDM_FORMAT_PURGE_RECREATE, ESDM_ACCESSIBILITY_NODELOCAL);
+  eassert(ret == ESDM_SUCCESS);
+
+  esdm_simple_dspace_t dataspace = esdm_dataspace_2d(HEIGHT, WIDTH, SMD_DTYPE_UINT64);
+  eassert(dataspace.ptr);
+  ret = esdm_container_create("mycontainer", 1, &container);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_dataset_create(container, "mydataset", dataspace.ptr, &dataset);
+  eassert(ret == ESDM_SUCCESS);
+
+  for (int row = 0; row < HEIGHT; row++) {
+    esdm_simple_dspace_t space = esdm_dataspace_2do(row, 1, 0, WIDTH, SMD_DTYPE_UINT64);
+    ret = esdm_write(dataset, data + row * WIDTH, space.ptr);
+    eassert(ret == ESDM_SUCCESS);
+    esdm_dataspace_destroy(space.ptr);
+  }
+
+  //encode all fragments and remember their JSON representation
+  int64_t fragmentCount, tableSize;
+  esdm_fragment_t **fragments = esdmI_fragments_list(&dataset->fragments, &fragmentCount);
+  eassert(fragmentCount >= HEIGHT);
+  char *table = esdmI_fragmentTable_encode(2, fragmentCount, fragments, &tableSize);
+  free(fragments);
+  printf("%"PRId64" fragments encoded in %"PRId64" bytes\n", fragmentCount, tableSize);
+  eassert(esdmI_fragmentTable_isTable(table, tableSize));
+
+  size_t jsonSize;
+  smd_string_stream_t *stream = smd_string_stream_create();
+  esdmI_fragments_metadata_create(&dataset->fragments, stream);
+  char *json = smd_string_stream_close(stream, &jsonSize);
+  printf("the JSON representation needs %zu bytes\n", jsonSize);
+  eassert(tableSize < (int64_t)jsonSize);
+
+  //corrupt tables must be rejected without adding anything
+  esdmI_fragments_purge(&dataset->fragments);
+  int64_t decodedSize;
+  ret = esdmI_fragmentTable_decode(dataset, table, tableSize - 1, &decodedSize);
+  eassert(ret == ESDM_INVALID_DATA_ERROR);
+  eassert(decodedSize == tableSize);  //the truncation must be detectable
+  eassert(g_hash_table_size(dataset->fragments.table) == 0);
+  table[4]++; //version byte
+  ret = esdmI_fragmentTable_decode(dataset, table, tableSize, &decodedSize);
+  eassert(ret == ESDM_INVALID_DATA_ERROR);
+  table[4]--;
+
+  //counts that exceed the table must be rejected before anything is allocated for them, this backend count is 2^64 - 1
+  char bogus[] = {'E', 'S', 'F', 'T', table[4], 0, 0, 0, 0, 0, 0, 0, 0, 2, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x01, 0};
+  bogus[5] = sizeof(bogus);
+  ret = esdmI_fragmentTable_decode(dataset, bogus, sizeof(bogus), &decodedSize);
+  eassert(ret == ESDM_INVALID_DATA_ERROR);
+  bogus[14] = 0x7f, bogus[15] = 0;  //127 backends in a table with 10 bytes left
+  ret = esdmI_fragmentTable_decode(dataset, bogus, sizeof(bogus), &decodedSize);
+  eassert(ret == ESDM_INVALID_DATA_ERROR);
+  eassert(g_hash_table_size(dataset->fragments.table) == 0);
+
+  //decoding restores the same fragments, decoding them twice does not create duplicates
+  ret = esdmI_fragmentTable_decode(dataset, table, tableSize, &decodedSize);
+  eassert(ret == ESDM_SUCCESS);
+  eassert(decodedSize == tableSize);
+  ret = esdmI_fragmentTable_decode(dataset, table, tableSize, NULL);
+  eassert(ret == ESDM_SUCCESS);
+  eassert(g_hash_table_size(dataset->fragments.table) == fragmentCount);
+
+  //merging two halves of the fragments yields a table that decodes to all fragments
+  fragments = esdmI_fragments_list(&dataset->fragments, &fragmentCount);
+  int64_t firstSize, secondSize, mergedSize;
+  char *first = esdmI_fragmentTable_encode(2, fragmentCount/2, fragments, &firstSize);
+  char *second = esdmI_fragmentTable_encode(2, fragmentCount - fragmentCount/2, fragments + fragmentCount/2, &secondSize);
+  free(fragments);
+  eassert(!esdmI_fragmentTable_merge(first, firstSize, second, secondSize - 1, &mergedSize));
+  char *merged = esdmI_fragmentTable_merge(first, firstSize, second, secondSize, &mergedSize);
+  eassert(merged);
+  eassert(mergedSize < firstSize + secondSize);
+  esdmI_fragments_purge(&dataset->fragments);
+  ret = esdmI_fragmentTable_decode(dataset, merged, mergedSize, &decodedSize);
+  eassert(ret == ESDM_SUCCESS);
+  eassert(decodedSize == mergedSize);
+  eassert(g_hash_table_size(dataset->fragments.table) == fragmentCount);
+  free(merged);
+  free(second);
+  free(first);
+
+  stream = smd_string_stream_create();
+  esdmI_fragments_metadata_create(&dataset->fragments, stream);
+  size_t decodedJsonSize;
+  char *decodedJson = smd_string_stream_close(stream, &decodedJsonSize);
+  eassert(decodedJsonSize == jsonSize);
+
+  //the decoded fragments must be readable
+  uint64_t *readData = ea_checked_malloc(HEIGHT * WIDTH * sizeof(*readData));
+  ret = esdm_read(dataset, readData, dataspace.ptr);
+  eassert(ret == ESDM_SUCCESS);
+  eassert(!memcmp(readData, data, HEIGHT * WIDTH * sizeof(*data)));
+
+  ret = esdm_dataset_commit(dataset);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_dataset_close(dataset);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_container_close(container);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_finalize();
+  eassert(ret == ESDM_SUCCESS);
+
+  free(readData);
+  free(decodedJson);
+  free(json);
+  free(table);
+  free(data);
+  printf("\nOK\n");
+  return 0;
+}
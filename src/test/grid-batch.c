@@ -0,0 +1,176 @@
+/* This file is part of ESDM.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with ESDM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This test checks the batch operations on grids:
+ * All cells of a grid with a subgrid are written with one esdm_write_grid_cells() call,
+ * unaligned regions are read with esdm_read_grid_region(),
+ * and a region read on a second grid must write back the cells that it had to fetch from the first grid.
+ */
+
+#include <esdm.h>
+#include <esdm-grid.h>
+#include <esdm-internal.h>
+#include <test/util/test_util.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SIZE 40
+
+static int64_t value(int64_t x, int64_t y) {
+  return x*1000 + y;
+}
+
+static void checkRegion(esdm_grid_t* grid, int64_t xOffset, int64_t xSize, int64_t yOffset, int64_t ySize) {
+  int64_t* buffer = ea_checked_malloc(xSize*ySize*sizeof(*buffer));
+  esdm_simple_dspace_t space = esdm_dataspace_2do(xOffset, xSize, yOffset, ySize, SMD_DTYPE_INT64);
+  esdm_status ret = esdm_read_grid_region(grid, space.ptr, buffer);
+  eassert(ret == ESDM_SUCCESS);
+  for(int64_t x = 0; x < xSize; x++) {
+    for(int64_t y = 0; y < ySize; y++) eassert(buffer[x*ySize + y] == value(xOffset + x, yOffset + y));
+  }
+  esdm_dataspace_destroy(space.ptr);
+  free(buffer);
+}
+
+int main(int argc, char const *argv[]) {
+  esdm_status ret = esdm_load_config_str("{\"esdm\": {"
+    "\"backends\": [{\"type\": \"POSIX\", \"id\": \"p1\", \"accessibility\": \"global\", \"target\": \"./_posix1\", \"max-threads-per-node\": 4}],"
+    "\"metadata\": {\"type\": \"metadummy\", \"id\": \"md\", \"target\": \"./_metadummy\"}"
+    "}}");
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_init();
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_mkfs(ESDM_FORMAT_PURGE_RECREATE, ESDM_ACCESSIBILITY_GLOBAL);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_mkfs(ESDM_FORMAT_PURGE_RECREATE, ESDM_ACCESSIBILITY_NODELOCAL);
+  eassert(ret == ESDM_SUCCESS);
+
+  esdm_container_t *container;
+  esdm_dataset_t *dataset;
+  esdm_simple_dspace_t space = esdm_dataspace_2d(SIZE, SIZE, SMD_DTYPE_INT64);
+  ret = esdm_container_create("mycontainer", 1, &container);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_dataset_create(container, "mydataset", space.ptr, &dataset);
+  eassert(ret == ESDM_SUCCESS);
+
+  //a 4x4 grid, the first cell is split into a 2x2 subgrid
+  esdm_grid_t* grid;
+  ret = esdm_grid_createSimple(dataset, 2, (int64_t[2]){SIZE, SIZE}, &grid);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_grid_subdivideFlexible(grid, 0, 4);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_grid_subdivideFlexible(grid, 1, 4);
+  eassert(ret == ESDM_SUCCESS);
+  esdm_grid_t* subgrid;
+  ret = esdm_grid_createSubgrid(grid, (int64_t[2]){0, 0}, &subgrid);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_grid_subdivideFlexible(subgrid, 0, 2);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_grid_subdivideFlexible(subgrid, 1, 2);
+  eassert(ret == ESDM_SUCCESS);
+
+  //setup the cells: the four cells of the subgrid and the fifteen other cells of the top level grid
+  const int64_t cellCount = 4 + 15;
+  esdm_dataspace_t* memspaces[cellCount];
+  void* buffers[cellCount];
+  int64_t cell = 0;
+  for(int64_t i = 0; i < 16; i++) {
+    bool isSubgridCell = !i;
+    for(int64_t j = 0; j < (isSubgridCell ? 4 : 1); j++) {
+      int64_t offset[2], size[2];
+      if(isSubgridCell) {
+        ret = esdm_grid_cellSize(subgrid, (int64_t[2]){j/2, j%2}, offset, size);
+      } else {
+        ret = esdm_grid_cellSize(grid, (int64_t[2]){i/4, i%4}, offset, size);
+      }
+      eassert(ret == ESDM_SUCCESS);
+      ret = esdm_dataspace_create_full(2, size, offset, SMD_DTYPE_INT64, &memspaces[cell]);
+      eassert(ret == ESDM_SUCCESS);
+      int64_t* data = ea_checked_malloc(size[0]*size[1]*sizeof(*data));
+      for(int64_t x = 0; x < size[0]; x++) {
+        for(int64_t y = 0; y < size[1]; y++) data[x*size[1] + y] = value(offset[0] + x, offset[1] + y);
+      }
+      buffers[cell++] = data;
+    }
+  }
+  eassert(cell == cellCount);
+
+  //an invalid cell must fail the whole batch before anything is written
+  esdm_simple_dspace_t badSpace = esdm_dataspace_2do(0, 3, 0, 3, SMD_DTYPE_INT64);
+  esdm_dataspace_t* badSpaces[2] = {memspaces[5], badSpace.ptr};
+  ret = esdm_write_grid_cells(grid, 2, badSpaces, buffers + 4);
+  eassert(ret == ESDM_INVALID_ARGUMENT_ERROR);
+  int64_t gridCount;
+  ret = esdm_dataset_grids(dataset, &gridCount, NULL);
+  eassert(ret == ESDM_SUCCESS);
+  eassert(gridCount == 0);
+
+  //write all cells at once
+  ret = esdm_write_grid_cells(grid, cellCount, memspaces, buffers);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_dataset_grids(dataset, &gridCount, NULL);
+  eassert(ret == ESDM_SUCCESS);
+  eassert(gridCount == 1);
+
+  //read regions that are not aligned with the cells, including the subgrid cells
+  checkRegion(grid, 0, SIZE, 0, SIZE);
+  checkRegion(grid, 3, 20, 7, 11);
+  checkRegion(grid, 12, 1, 0, SIZE);
+  eassert(esdm_read_grid_region(grid, badSpace.ptr, buffers[0]) == ESDM_SUCCESS);
+  esdm_simple_dspace_t outsideSpace = esdm_dataspace_2do(30, 20, 0, 5, SMD_DTYPE_INT64);
+  eassert(esdm_read_grid_region(grid, outsideSpace.ptr, buffers[0]) == ESDM_INVALID_ARGUMENT_ERROR);
+
+  //a region read on a second grid fetches its cells from the first grid and writes them back
+  esdm_grid_t* grid2;
+  ret = esdm_grid_createSimple(dataset, 2, (int64_t[2]){SIZE, SIZE}, &grid2);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_grid_subdivideFlexible(grid2, 0, 2);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_grid_subdivideFlexible(grid2, 1, 5);
+  eassert(ret == ESDM_SUCCESS);
+  checkRegion(grid2, 5, 10, 5, 30);
+  ret = esdm_dataset_grids(dataset, &gridCount, NULL);
+  eassert(ret == ESDM_SUCCESS);
+  eassert(gridCount == 1);
+  checkRegion(grid2, 0, SIZE, 0, SIZE);
+  ret = esdm_dataset_grids(dataset, &gridCount, NULL);
+  eassert(ret == ESDM_SUCCESS);
+  eassert(gridCount == 2);
+
+  //cleanup
+  for(int64_t i = 0; i < cellCount; i++) {
+    esdm_dataspace_destroy(memspaces[i]);
+    free(buffers[i]);
+  }
+  esdm_dataspace_destroy(badSpace.ptr);
+  esdm_dataspace_destroy(outsideSpace.ptr);
+  ret = esdm_dataset_commit(dataset);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_container_commit(container);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_dataset_close(dataset);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_container_close(container);
+  eassert(ret == ESDM_SUCCESS);
+  esdm_dataspace_destroy(space.ptr);
+  ret = esdm_finalize();
+  eassert(ret == ESDM_SUCCESS);
+
+  printf("\nOK\n");
+  return 0;
+}
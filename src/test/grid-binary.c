@@ -0,0 +1,198 @@
+/* This file is part of ESDM.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with ESDM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This test checks the binary grid encoding that is used to exchange grids between processes:
+ * A copy of a partially written grid with a subgrid is created from a full encoding,
+ * the cells that are written to the copy are shipped back in incremental encodings,
+ * and merging these encodings into the original grid must complete it.
+ */
+
+#include <esdm.h>
+#include <esdm-grid.h>
+#include <esdm-internal.h>
+#include <test/util/test_util.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SIZE 40
+#define CELLS (4 + 15)
+
+static int64_t value(int64_t x, int64_t y) {
+  return x*1000 + y;
+}
+
+static esdm_dataspace_t* memspaces[CELLS];
+static void* buffers[CELLS];
+
+//Creates the memspaces and buffers of the four cells of the subgrid and the fifteen other cells of the top level grid.
+static void setupCells(esdm_grid_t* grid, esdm_grid_t* subgrid) {
+  int64_t cell = 0;
+  for(int64_t i = 0; i < 16; i++) {
+    bool isSubgridCell = !i;
+    for(int64_t j = 0; j < (isSubgridCell ? 4 : 1); j++) {
+      int64_t offset[2], size[2];
+      esdm_status ret;
+      if(isSubgridCell) {
+        ret = esdm_grid_cellSize(subgrid, (int64_t[2]){j/2, j%2}, offset, size);
+      } else {
+        ret = esdm_grid_cellSize(grid, (int64_t[2]){i/4, i%4}, offset, size);
+      }
+      eassert(ret == ESDM_SUCCESS);
+      ret = esdm_dataspace_create_full(2, size, offset, SMD_DTYPE_INT64, &memspaces[cell]);
+      eassert(ret == ESDM_SUCCESS);
+      int64_t* data = ea_checked_malloc(size[0]*size[1]*sizeof(*data));
+      for(int64_t x = 0; x < size[0]; x++) {
+        for(int64_t y = 0; y < size[1]; y++) data[x*size[1] + y] = value(offset[0] + x, offset[1] + y);
+      }
+      buffers[cell++] = data;
+    }
+  }
+  eassert(cell == CELLS);
+}
+
+static void writeCells(esdm_grid_t* grid, int64_t first, int64_t last) {
+  esdm_status ret = esdm_write_grid_cells(grid, last - first, memspaces + first, buffers + first);
+  eassert(ret == ESDM_SUCCESS);
+}
+
+static int64_t gridCount(esdm_dataset_t* dataset) {
+  int64_t result;
+  esdm_status ret = esdm_dataset_grids(dataset, &result, NULL);
+  eassert(ret == ESDM_SUCCESS);
+  return result;
+}
+
+int main(int argc, char const *argv[]) {
+  esdm_status ret = esdm_load_config_str("{\"esdm\": {"
+    "\"backends\": [{\"type\": \"POSIX\", \"id\": \"p1\", \"accessibility\": \"global\", \"target\": \"./_posix1\"}],"
+    "\"metadata\": {\"type\": \"metadummy\", \"id\": \"md\", \"target\": \"./_metadummy\"}"
+    "}}");
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_init();
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_mkfs(ESDM_FORMAT_PURGE_RECREATE, ESDM_ACCESSIBILITY_GLOBAL);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_mkfs(ESDM_FORMAT_PURGE_RECREATE, ESDM_ACCESSIBILITY_NODELOCAL);
+  eassert(ret == ESDM_SUCCESS);
+
+  esdm_container_t *container;
+  esdm_dataset_t *dataset;
+  esdm_simple_dspace_t space = esdm_dataspace_2d(SIZE, SIZE, SMD_DTYPE_INT64);
+  ret = esdm_container_create("mycontainer", 1, &container);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_dataset_create(container, "mydataset", space.ptr, &dataset);
+  eassert(ret == ESDM_SUCCESS);
+
+  //a 4x4 grid, the first cell is split into a 2x2 subgrid
+  esdm_grid_t* grid, *subgrid;
+  ret = esdm_grid_createSimple(dataset, 2, (int64_t[2]){SIZE, SIZE}, &grid);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_grid_subdivideFlexible(grid, 0, 4);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_grid_subdivideFlexible(grid, 1, 4);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_grid_createSubgrid(grid, (int64_t[2]){0, 0}, &subgrid);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_grid_subdivideFlexible(subgrid, 0, 2);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_grid_subdivideFlexible(subgrid, 1, 2);
+  eassert(ret == ESDM_SUCCESS);
+  setupCells(grid, subgrid);
+
+  //the original grid has the cells of the subgrid and six other cells when it is copied
+  writeCells(grid, 0, 10);
+  int64_t size;
+  char* encoding = esdmI_grid_encode(grid, false, &size);
+  esdm_grid_t* copy;
+  ret = esdmI_grid_createFromBinary(encoding, size, dataset, &copy);
+  eassert(ret == ESDM_SUCCESS);
+  eassert(!strcmp(esdmI_grid_id(copy), esdmI_grid_id(grid)));
+  eassert(gridCount(dataset) == 0);
+  esdm_grid_t* dummy;
+  eassert(esdm_grid_createSubgrid(copy, (int64_t[2]){3, 3}, &dummy) == ESDM_INVALID_STATE_ERROR);  //the structure of the copy is fixed
+  eassert(esdmI_grid_createFromBinary(encoding, size - 1, dataset, &dummy) == ESDM_INVALID_DATA_ERROR);
+  free(encoding);
+
+  //the remaining cells are written to the copy in two steps, each incremental encoding contains only the new cells
+  writeCells(copy, 10, 15);
+  int64_t firstSize, secondSize, emptySize;
+  char* first = esdmI_grid_encode(copy, true, &firstSize);
+  writeCells(copy, 15, CELLS);
+  eassert(gridCount(dataset) == 1);
+  char* second = esdmI_grid_encode(copy, true, &secondSize);
+  char* empty = esdmI_grid_encode(copy, true, &emptySize);
+  eassert(emptySize < secondSize && secondSize < firstSize);
+  eassert(esdmI_grid_createFromBinary(first, firstSize, dataset, &dummy) == ESDM_INVALID_DATA_ERROR);  //an incremental encoding lacks the structure
+
+  //encodings of a different grid must not be merged
+  esdm_grid_t* otherGrid;
+  ret = esdm_grid_createSimple(dataset, 2, (int64_t[2]){SIZE, SIZE}, &otherGrid);
+  eassert(ret == ESDM_SUCCESS);
+  int64_t otherSize, mergedSize;
+  char* other = esdmI_grid_encode(otherGrid, false, &otherSize);
+  char* merged;
+  eassert(esdmI_grid_mergeWithBinary(grid, other, otherSize) == ESDM_INVALID_STATE_ERROR);
+  eassert(esdmI_grid_mergeEncodings(first, firstSize, other, otherSize, &merged, &mergedSize) == ESDM_INVALID_STATE_ERROR);
+  eassert(esdmI_grid_mergeEncodings(first, firstSize, second, 10, &merged, &mergedSize) == ESDM_INVALID_DATA_ERROR);
+  free(other);
+
+  //merge the incremental encodings without decoding them, and complete the original grid with the result
+  ret = esdmI_grid_mergeWithBinary(grid, empty, emptySize);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdmI_grid_mergeEncodings(first, firstSize, second, secondSize, &merged, &mergedSize);
+  eassert(ret == ESDM_SUCCESS);
+  eassert(gridCount(dataset) == 1);
+  ret = esdmI_grid_mergeWithBinary(grid, merged, mergedSize);
+  eassert(ret == ESDM_SUCCESS);
+  eassert(gridCount(dataset) == 2);
+  ret = esdmI_grid_mergeWithBinary(grid, merged, mergedSize);  //merging the same cells again does not change anything
+  eassert(ret == ESDM_SUCCESS);
+  free(merged);
+  free(empty);
+  free(second);
+  free(first);
+
+  //the merged cells are readable through the original grid
+  int64_t* data = ea_checked_malloc(SIZE*SIZE*sizeof(*data));
+  ret = esdm_read_grid_region(grid, space.ptr, data);
+  eassert(ret == ESDM_SUCCESS);
+  for(int64_t x = 0; x < SIZE; x++) {
+    for(int64_t y = 0; y < SIZE; y++) eassert(data[x*SIZE + y] == value(x, y));
+  }
+  free(data);
+
+  //cleanup
+  for(int64_t i = 0; i < CELLS; i++) {
+    esdm_dataspace_destroy(memspaces[i]);
+    free(buffers[i]);
+  }
+  ret = esdm_dataset_commit(dataset);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_container_commit(container);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_dataset_close(dataset);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_container_close(container);
+  eassert(ret == ESDM_SUCCESS);
+  esdm_dataspace_destroy(space.ptr);
+  ret = esdm_finalize();
+  eassert(ret == ESDM_SUCCESS);
+
+  printf("\nOK\n");
+  return 0;
+}
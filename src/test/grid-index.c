@@ -0,0 +1,175 @@
+/* This file is part of ESDM.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with ESDM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This test checks the selection of grids for reads on a dataset with one grid per timestep:
+ * A read within a timestep must use the grid of that timestep, a read across timesteps must combine their grids,
+ * and among several grids that contain a region the one with the smallest overhead must be selected.
+ */
+
+#include <esdm.h>
+#include <esdm-grid.h>
+#include <esdm-internal.h>
+#include <test/util/test_util.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define STEPS 100
+#define SIZE 20
+
+static int32_t value(int64_t t, int64_t x, int64_t y) {
+  return (t*SIZE + x)*SIZE + y;
+}
+
+static void checkRegion(esdm_dataset_t* dataset, int64_t tOffset, int64_t tSize, int64_t xOffset, int64_t xSize, int64_t yOffset, int64_t ySize) {
+  int32_t* data = ea_checked_malloc(tSize*xSize*ySize*sizeof(*data));
+  esdm_simple_dspace_t space = esdm_dataspace_3do(tOffset, tSize, xOffset, xSize, yOffset, ySize, SMD_DTYPE_INT32);
+  esdm_status ret = esdm_read(dataset, data, space.ptr);
+  eassert(ret == ESDM_SUCCESS);
+  for(int64_t t = 0; t < tSize; t++) {
+    for(int64_t x = 0; x < xSize; x++) {
+      for(int64_t y = 0; y < ySize; y++) eassert(data[(t*xSize + x)*ySize + y] == value(tOffset + t, xOffset + x, yOffset + y));
+    }
+  }
+  esdm_dataspace_destroy(space.ptr);
+  free(data);
+}
+
+//Returns the grids that the dataset selects for the region, the caller must free the array.
+static esdm_grid_t** selectGrids(esdm_dataset_t* dataset, int64_t tOffset, int64_t tSize, int64_t xOffset, int64_t xSize, int64_t yOffset, int64_t ySize, int64_t* out_count) {
+  esdmI_hypercube_t* region = esdmI_hypercube_make(3, (int64_t[3]){tOffset, xOffset, yOffset}, (int64_t[3]){tSize, xSize, ySize});
+  esdm_grid_t** result = esdmI_dataset_gridsCoveringRegion(dataset, region, out_count);
+  esdmI_hypercube_destroy(region);
+  return result;
+}
+
+static esdm_grid_t* writeTimestep(esdm_dataset_t* dataset, int64_t t, int64_t cellsPerAxis) {
+  esdm_grid_t* grid;
+  esdm_status ret = esdm_grid_create(dataset, 3, (int64_t[3]){t, 0, 0}, (int64_t[3]){1, SIZE, SIZE}, &grid);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_grid_subdivideFlexible(grid, 1, cellsPerAxis);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_grid_subdivideFlexible(grid, 2, cellsPerAxis);
+  eassert(ret == ESDM_SUCCESS);
+
+  const int64_t cellCount = cellsPerAxis*cellsPerAxis;
+  esdm_dataspace_t* memspaces[cellCount];
+  void* buffers[cellCount];
+  for(int64_t i = 0; i < cellCount; i++) {
+    int64_t offset[3], size[3];
+    ret = esdm_grid_cellSize(grid, (int64_t[3]){0, i/cellsPerAxis, i%cellsPerAxis}, offset, size);
+    eassert(ret == ESDM_SUCCESS);
+    ret = esdm_dataspace_create_full(3, size, offset, SMD_DTYPE_INT32, &memspaces[i]);
+    eassert(ret == ESDM_SUCCESS);
+    int32_t* data = ea_checked_malloc(size[1]*size[2]*sizeof(*data));
+    for(int64_t x = 0; x < size[1]; x++) {
+      for(int64_t y = 0; y < size[2]; y++) data[x*size[2] + y] = value(t, offset[1] + x, offset[2] + y);
+    }
+    buffers[i] = data;
+  }
+  ret = esdm_write_grid_cells(grid, cellCount, memspaces, buffers);
+  eassert(ret == ESDM_SUCCESS);
+  for(int64_t i = 0; i < cellCount; i++) {
+    esdm_dataspace_destroy(memspaces[i]);
+    free(buffers[i]);
+  }
+  return grid;
+}
+
+int main(int argc, char const *argv[]) {
+  esdm_status ret = esdm_load_config_str("{\"esdm\": {"
+    "\"backends\": [{\"type\": \"POSIX\", \"id\": \"p1\", \"accessibility\": \"global\", \"target\": \"./_posix1\"}],"
+    "\"metadata\": {\"type\": \"metadummy\", \"id\": \"md\", \"target\": \"./_metadummy\"}"
+    "}}");
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_init();
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_mkfs(ESDM_FORMAT_PURGE_RECREATE, ESDM_ACCESSIBILITY_GLOBAL);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_mkfs(ESDM_FORMAT_PURGE_RECREATE, ESDM_ACCESSIBILITY_NODELOCAL);
+  eassert(ret == ESDM_SUCCESS);
+
+  esdm_container_t *container;
+  esdm_dataset_t *dataset;
+  esdm_simple_dspace_t space = esdm_dataspace_3d(STEPS, SIZE, SIZE, SMD_DTYPE_INT32);
+  ret = esdm_container_create("mycontainer", 1, &container);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_dataset_create(container, "mydataset", space.ptr, &dataset);
+  eassert(ret == ESDM_SUCCESS);
+
+  //one grid of 2x2 cells per timestep, written in a shuffled order
+  esdm_grid_t* grids[STEPS];
+  for(int64_t i = 0; i < STEPS; i++) {
+    int64_t t = i*37%STEPS;
+    grids[t] = writeTimestep(dataset, t, 2);
+  }
+  int64_t gridCount;
+  ret = esdm_dataset_grids(dataset, &gridCount, NULL);
+  eassert(ret == ESDM_SUCCESS);
+  eassert(gridCount == STEPS);
+
+  //a read within a timestep uses the grid of that timestep
+  esdm_grid_t** selected = selectGrids(dataset, 37, 1, 5, 10, 5, 10, &gridCount);
+  eassert(selected && gridCount == 1 && selected[0] == grids[37]);
+  free(selected);
+  checkRegion(dataset, 37, 1, 5, 10, 5, 10);
+
+  //a read across timesteps combines their grids
+  selected = selectGrids(dataset, 10, 11, 0, SIZE, 3, 7, &gridCount);
+  eassert(selected && gridCount == 11);
+  for(int64_t i = 0; i < gridCount; i++) {
+    bool found = false;
+    for(int64_t t = 10; t <= 20; t++) found = found || selected[i] == grids[t];
+    eassert(found);
+  }
+  free(selected);
+  checkRegion(dataset, 10, 11, 0, SIZE, 3, 7);
+  checkRegion(dataset, 0, STEPS, 0, SIZE, 0, SIZE);
+
+  //a second, coarser grid for timestep 50: it wins a tie by being more recent, but it is not selected when the fine grid fetches less data
+  esdm_grid_t* coarseGrid = writeTimestep(dataset, 50, 1);
+  selected = selectGrids(dataset, 50, 1, 0, SIZE, 0, SIZE, &gridCount);
+  eassert(selected && gridCount == 1 && selected[0] == coarseGrid);
+  free(selected);
+  selected = selectGrids(dataset, 50, 1, 2, 5, 2, 5, &gridCount);
+  eassert(selected && gridCount == 1 && selected[0] == grids[50]);
+  free(selected);
+  checkRegion(dataset, 49, 3, 2, 5, 2, 5);
+
+  //incomplete grids are not considered, and each timestep is covered by one grid only
+  esdm_grid_t* partialGrid;
+  ret = esdm_grid_create(dataset, 3, (int64_t[3]){0, 0, 0}, (int64_t[3]){STEPS, SIZE, SIZE}, &partialGrid);
+  eassert(ret == ESDM_SUCCESS);
+  selected = selectGrids(dataset, 0, STEPS, 0, SIZE, 0, SIZE, &gridCount);
+  eassert(selected && gridCount == STEPS);
+  free(selected);
+
+  ret = esdm_dataset_commit(dataset);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_container_commit(container);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_dataset_close(dataset);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_container_close(container);
+  eassert(ret == ESDM_SUCCESS);
+  esdm_dataspace_destroy(space.ptr);
+  ret = esdm_finalize();
+  eassert(ret == ESDM_SUCCESS);
+
+  printf("\nOK\n");
+  return 0;
+}
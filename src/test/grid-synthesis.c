@@ -0,0 +1,187 @@
+/* This file is part of ESDM.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with ESDM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This test checks that grids are synthesized from the fragments of datasets that are written with plain esdm_write() calls:
+ * A rectilinear decomposition must get a grid after it has been read once, and the grid must be stored with the next commit.
+ * A staggered decomposition must not get a grid.
+ * A reopened dataset whose fragment metadata spans several pages must get a grid for the region of a partial read,
+ * without fetching the pages that the reads do not touch.
+ */
+
+#include <esdm.h>
+#include <esdm-grid.h>
+#include <esdm-internal.h>
+#include <test/util/test_util.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define HEIGHT 60
+#define WIDTH 80
+#define BLOCK_HEIGHT 2
+#define BLOCK_WIDTH 4  //the paged dataset is written in 600 blocks of this size, which needs several fragment pages
+
+static int32_t value(int64_t x, int64_t y) {
+  return x*WIDTH + y;
+}
+
+static void init() {
+  esdm_status ret = esdm_load_config_str("{\"esdm\": {"
+    "\"grid synthesis min fragments\": 4,"
+    "\"backends\": [{\"type\": \"POSIX\", \"id\": \"p1\", \"accessibility\": \"global\", \"target\": \"./_posix1\"}],"
+    "\"metadata\": {\"type\": \"metadummy\", \"id\": \"md\", \"target\": \"./_metadummy\"}"
+    "}}");
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_init();
+  eassert(ret == ESDM_SUCCESS);
+}
+
+static void writeBlock(esdm_dataset_t* dataset, int64_t xOffset, int64_t xSize, int64_t yOffset, int64_t ySize) {
+  int32_t* data = ea_checked_malloc(xSize*ySize*sizeof(*data));
+  for(int64_t x = 0; x < xSize; x++) {
+    for(int64_t y = 0; y < ySize; y++) data[x*ySize + y] = value(xOffset + x, yOffset + y);
+  }
+  esdm_simple_dspace_t space = esdm_dataspace_2do(xOffset, xSize, yOffset, ySize, SMD_DTYPE_INT32);
+  esdm_status ret = esdm_write(dataset, data, space.ptr);
+  eassert(ret == ESDM_SUCCESS);
+  esdm_dataspace_destroy(space.ptr);
+  free(data);
+}
+
+static void checkRegion(esdm_dataset_t* dataset, int64_t xOffset, int64_t xSize, int64_t yOffset, int64_t ySize) {
+  int32_t* data = ea_checked_malloc(xSize*ySize*sizeof(*data));
+  esdm_simple_dspace_t space = esdm_dataspace_2do(xOffset, xSize, yOffset, ySize, SMD_DTYPE_INT32);
+  esdm_status ret = esdm_read(dataset, data, space.ptr);
+  eassert(ret == ESDM_SUCCESS);
+  for(int64_t x = 0; x < xSize; x++) {
+    for(int64_t y = 0; y < ySize; y++) eassert(data[x*ySize + y] == value(xOffset + x, yOffset + y));
+  }
+  esdm_dataspace_destroy(space.ptr);
+  free(data);
+}
+
+static int64_t gridCount(esdm_dataset_t* dataset) {
+  int64_t result;
+  esdm_status ret = esdm_dataset_grids(dataset, &result, NULL);
+  eassert(ret == ESDM_SUCCESS);
+  return result;
+}
+
+int main(int argc, char const *argv[]) {
+  init();
+  esdm_status ret = esdm_mkfs(ESDM_FORMAT_PURGE_RECREATE, ESDM_ACCESSIBILITY_GLOBAL);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_mkfs(ESDM_FORMAT_PURGE_RECREATE, ESDM_ACCESSIBILITY_NODELOCAL);
+  eassert(ret == ESDM_SUCCESS);
+
+  esdm_container_t *container;
+  esdm_dataset_t *rectilinear, *staggered, *paged;
+  esdm_simple_dspace_t space = esdm_dataspace_2d(HEIGHT, WIDTH, SMD_DTYPE_INT32);
+  ret = esdm_container_create("mycontainer", 1, &container);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_dataset_create(container, "rectilinear", space.ptr, &rectilinear);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_dataset_create(container, "staggered", space.ptr, &staggered);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_dataset_create(container, "paged", space.ptr, &paged);
+  eassert(ret == ESDM_SUCCESS);
+
+  //the rows are split at 20, the columns at 30 and 50
+  const int64_t rowBounds[] = {0, 20, HEIGHT}, columnBounds[] = {0, 30, 50, WIDTH};
+  for(int64_t i = 0; i < 2; i++) {
+    for(int64_t j = 0; j < 3; j++) writeBlock(rectilinear, rowBounds[i], rowBounds[i + 1] - rowBounds[i], columnBounds[j], columnBounds[j + 1] - columnBounds[j]);
+  }
+  //the columns are split at different positions in the upper and the lower half
+  writeBlock(staggered, 0, HEIGHT/2, 0, 40);
+  writeBlock(staggered, 0, HEIGHT/2, 40, WIDTH - 40);
+  writeBlock(staggered, HEIGHT/2, HEIGHT/2, 0, 20);
+  writeBlock(staggered, HEIGHT/2, HEIGHT/2, 20, 40);
+  writeBlock(staggered, HEIGHT/2, HEIGHT/2, 60, WIDTH - 60);
+  for(int64_t x = 0; x < HEIGHT; x += BLOCK_HEIGHT) {
+    for(int64_t y = 0; y < WIDTH; y += BLOCK_WIDTH) writeBlock(paged, x, BLOCK_HEIGHT, y, BLOCK_WIDTH);
+  }
+  ret = esdm_dataset_commit(rectilinear);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_dataset_commit(staggered);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_dataset_commit(paged);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_container_commit(container);
+  eassert(ret == ESDM_SUCCESS);
+  eassert(gridCount(rectilinear) == 0);
+  eassert(gridCount(staggered) == 0);
+
+  //the first read scans the fragments and starts the analysis, the next read picks up its result
+  checkRegion(rectilinear, 0, HEIGHT, 0, WIDTH);
+  checkRegion(staggered, 0, HEIGHT, 0, WIDTH);
+  esdmI_gridSynthesis_wait();
+  checkRegion(rectilinear, 10, 30, 25, 40);
+  checkRegion(staggered, 10, 30, 25, 40);
+  eassert(gridCount(rectilinear) == 1);
+  eassert(gridCount(staggered) == 0);
+  checkRegion(rectilinear, 0, HEIGHT, 0, WIDTH);
+
+  //the grid is stored with the next commit
+  ret = esdm_dataset_commit(rectilinear);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_dataset_close(rectilinear);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_dataset_close(staggered);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_dataset_close(paged);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_container_close(container);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_finalize();
+  eassert(ret == ESDM_SUCCESS);
+
+  init();
+  ret = esdm_container_open("mycontainer", ESDM_MODE_FLAG_READ, &container);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_dataset_open(container, "rectilinear", ESDM_MODE_FLAG_READ, &rectilinear);
+  eassert(ret == ESDM_SUCCESS);
+  eassert(gridCount(rectilinear) == 1);
+  checkRegion(rectilinear, 5, 50, 0, 70);
+
+  //small reads of the paged dataset only decode some pages, the analysis only sees the fragments of the read region
+  ret = esdm_dataset_open(container, "paged", ESDM_MODE_FLAG_READ, &paged);
+  eassert(ret == ESDM_SUCCESS);
+  eassert(paged->fragmentPages);
+  checkRegion(paged, 1, 3, 2, 5);
+  eassert(paged->fragmentPages);
+  eassert(esdmI_fragmentPages_loadedCount(paged->fragmentPages) < esdmI_fragmentPages_pageCount(paged->fragmentPages));
+  esdmI_gridSynthesis_wait();
+  checkRegion(paged, HEIGHT - 3, 3, WIDTH - 7, 7);
+  eassert(gridCount(paged) == 1);
+  eassert(paged->fragmentPages);
+  eassert(esdmI_fragmentPages_fetchedCount(paged->fragmentPages) < esdmI_fragmentPages_pageCount(paged->fragmentPages));
+  checkRegion(paged, 0, 4, 0, 8);  //the region of the synthesized grid
+  checkRegion(paged, 11, 17, 13, 19);
+  ret = esdm_dataset_close(paged);
+  eassert(ret == ESDM_SUCCESS);
+
+  ret = esdm_dataset_close(rectilinear);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_container_close(container);
+  eassert(ret == ESDM_SUCCESS);
+  esdm_dataspace_destroy(space.ptr);
+  ret = esdm_finalize();
+  eassert(ret == ESDM_SUCCESS);
+
+  printf("\nOK\n");
+  return 0;
+}
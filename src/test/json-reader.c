@@ -0,0 +1,151 @@
+/* This file is part of ESDM.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with ESDM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This test checks the streaming JSON reader, and parses a large legacy JSON fragment array with it.
+ */
+
+#include <esdm.h>
+#include <esdm-internal.h>
+#include <test/util/test_util.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FRAGMENTS 10000 //enough to be parsed in several chunks
+
+static void testReader() {
+  const char json[] = "{\"ints\":[1, -2,3], \"text\":\"a\\\"b\\u00e9\\ud83d\\ude00\", \"nothing\":null,\n\"nested\":{\"k\":[true,false,{}]},\"real\":0.5}";
+  esdmI_jsonReader_t reader;
+  esdmI_jsonReader_init(&reader, json, strlen(json));
+
+  eassert(esdmI_jsonReader_next(&reader) == ESDMI_JSON_OBJECT_START);
+  eassert(esdmI_jsonReader_nextKey(&reader));
+  eassert(esdmI_jsonReader_keyIs(&reader, "ints"));
+  int64_t *ints, count;
+  eassert(esdmI_jsonReader_readIntArray(&reader, &ints, &count));
+  eassert(count == 3 && ints[0] == 1 && ints[1] == -2 && ints[2] == 3);
+  free(ints);
+
+  eassert(esdmI_jsonReader_nextKey(&reader));
+  eassert(esdmI_jsonReader_keyIs(&reader, "text"));
+  char *text = esdmI_jsonReader_readString(&reader);
+  eassert(text && !strcmp(text, "a\"b\xc3\xa9\xf0\x9f\x98\x80"));
+  free(text);
+
+  eassert(esdmI_jsonReader_nextKey(&reader));
+  eassert(esdmI_jsonReader_keyIs(&reader, "nothing"));
+  eassert(esdmI_jsonReader_next(&reader) == ESDMI_JSON_NULL);
+
+  eassert(esdmI_jsonReader_nextKey(&reader));
+  eassert(esdmI_jsonReader_keyIs(&reader, "nested"));
+  const char *start;
+  int64_t length;
+  eassert(esdmI_jsonReader_skipValue(&reader, &start, &length));
+  eassert(length == strlen("{\"k\":[true,false,{}]}") && !memcmp(start, "{\"k\":[true,false,{}]}", length));
+
+  eassert(esdmI_jsonReader_nextKey(&reader));
+  eassert(esdmI_jsonReader_keyIs(&reader, "real"));
+  eassert(esdmI_jsonReader_peek(&reader) == ESDMI_JSON_NUMBER);
+  double real;
+  eassert(esdmI_jsonReader_readDouble(&reader, &real));
+  eassert(real == 0.5);
+  eassert(!esdmI_jsonReader_nextKey(&reader));
+  eassert(reader.ok);
+  eassert(esdmI_jsonReader_next(&reader) == ESDMI_JSON_END);
+
+  //errors are sticky
+  esdmI_jsonReader_init(&reader, "[0.5, 1]", 8);
+  eassert(esdmI_jsonReader_next(&reader) == ESDMI_JSON_ARRAY_START);
+  int64_t integer;
+  eassert(!esdmI_jsonReader_readInt(&reader, &integer));
+  eassert(!reader.ok);
+  eassert(esdmI_jsonReader_next(&reader) == ESDMI_JSON_INVALID);
+
+  //truncated input
+  esdmI_jsonReader_init(&reader, "{\"a\":[1,2", 9);
+  eassert(esdmI_jsonReader_next(&reader) == ESDMI_JSON_OBJECT_START);
+  eassert(esdmI_jsonReader_nextKey(&reader));
+  eassert(!esdmI_jsonReader_skipValue(&reader, NULL, NULL));
+}
+
+//Serializes a dataset with many fragments in the JSON format that was used before the binary fragment table, and parses it again.
+static void testLegacyFragments() {
+  esdm_status ret;
+  esdm_container_t *container = NULL;
+  ret = esdm_container_create("mycontainer", 1, &container);
+  eassert(ret == ESDM_SUCCESS);
+
+  esdm_simple_dspace_t dataspace = esdm_dataspace_2d(FRAGMENTS, 2, SMD_DTYPE_UINT64);
+  esdm_dataset_t *dataset;
+  esdm_dataset_init(container, "legacy", dataspace.ptr, &dataset);
+  dataset->id = ea_checked_strdup("legacy");
+  esdm_backend_t *backend = esdm_get_modules()->data_backends[0];
+  for (int i = 0; i < FRAGMENTS; i++) {
+    esdm_dataspace_t *space;
+    ret = esdm_dataspace_create_full(2, (int64_t[2]){1, 2}, (int64_t[2]){i, 0}, SMD_DTYPE_UINT64, &space);
+    eassert(ret == ESDM_SUCCESS);
+    char id[32];
+    sprintf(id, "0123456789%d", i);
+    esdm_fragment_t *fragment = esdmI_fragment_createLoaded(dataset, space, id, backend, 16, NULL);
+    ret = esdmI_dataset_addLoadedFragment(dataset, fragment);
+    eassert(ret == ESDM_SUCCESS);
+  }
+
+  smd_string_stream_t *stream = smd_string_stream_create();
+  esdmI_dataset_metadata_create(dataset, stream);
+  size_t size;
+  char *md = smd_string_stream_close(stream, &size);
+
+  esdm_dataset_t *copy;
+  esdm_dataset_init(container, "copy", NULL, &copy);
+  ret = esdm_dataset_open_md_parse(copy, md, size);
+  eassert(ret == ESDM_SUCCESS);
+  eassert(g_hash_table_size(copy->fragments.table) == FRAGMENTS);
+  eassert(copy->dataspace->dims == 2 && copy->dataspace->size[0] == FRAGMENTS);
+
+  esdm_simple_dspace_t last = esdm_dataspace_2do(FRAGMENTS - 1, 1, 0, 2, SMD_DTYPE_UINT64);
+  esdm_fragment_t *fragment = esdmI_dataset_lookupFragmentForShape(copy, last.ptr);
+  eassert(fragment);
+  eassert(!strcmp(fragment->id, "0123456789" "9999"));
+  eassert(fragment->actual_bytes == 16);
+  esdm_dataspace_destroy(last.ptr);
+
+  free(md);
+  esdmI_dataset_destroy(copy);
+  esdmI_dataset_destroy(dataset);
+  esdm_dataspace_destroy(dataspace.ptr);
+  ret = esdm_container_close(container);
+  eassert(ret == ESDM_SUCCESS);
+}
+
+int main(int argc, char const *argv[]) {
+  testReader();
+
+  esdm_status ret = esdm_init();
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_mkfs(ESDM_FORMAT_PURGE_RECREATE, ESDM_ACCESSIBILITY_GLOBAL);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_mkfs(ESDM_FORMAT_PURGE_RECREATE, ESDM_ACCESSIBILITY_NODELOCAL);
+  eassert(ret == ESDM_SUCCESS);
+  testLegacyFragments();
+  ret = esdm_finalize();
+  eassert(ret == ESDM_SUCCESS);
+
+  printf("\nOK\n");
+  return 0;
+}
@@ -0,0 +1,136 @@
+/* This file is part of ESDM.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with ESDM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This test writes a dataset that consists of many small fragments, reopens it, and checks
+ * that reading a small region only decodes the page of the fragment table that contains the region.
+ * The metadata backend can read parts of the snapshot, so opening the dataset must not even read the pages.
+ */
+
+#include <esdm.h>
+#include <esdm-internal.h>
+#include <test/util/test_util.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define EDGE 32 //the dataset consists of EDGE*EDGE fragments with a single element each, which are split into four pages
+
+int main(int argc, char const *argv[]) {
+  uint64_t *data = ea_checked_malloc(EDGE * EDGE * sizeof(*data));
+  for (int i = 0; i < EDGE * EDGE; i++) data[i] = i;
+
+  esdm_status ret;
+  esdm_container_t *container = NULL;
+  esdm_dataset_t *dataset = NULL;
+
+  ret = esdm_init();
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_mkfs(ESDM_FORMAT_PURGE_RECREATE, ESDM_ACCESSIBILITY_GLOBAL);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_mkfs(ESDM_FORMAT_PURGE_RECREATE, ESDM_ACCESSIBILITY_NODELOCAL);
+  eassert(ret == ESDM_SUCCESS);
+
+  esdm_simple_dspace_t dataspace = esdm_dataspace_2d(EDGE, EDGE, SMD_DTYPE_UINT64);
+  eassert(dataspace.ptr);
+  ret = esdm_container_create("mycontainer", 1, &container);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_dataset_create(container, "mydataset", dataspace.ptr, &dataset);
+  eassert(ret == ESDM_SUCCESS);
+
+  for (int y = 0; y < EDGE; y++) {
+    for (int x = 0; x < EDGE; x++) {
+      esdm_simple_dspace_t space = esdm_dataspace_2do(y, 1, x, 1, SMD_DTYPE_UINT64);
+      ret = esdm_write(dataset, data + y * EDGE + x, space.ptr);
+      eassert(ret == ESDM_SUCCESS);
+      esdm_dataspace_destroy(space.ptr);
+    }
+  }
+  eassert(g_hash_table_size(dataset->fragments.table) == EDGE * EDGE);
+  ret = esdm_container_commit(container);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_dataset_close(dataset);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_container_close(container);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_finalize();
+  eassert(ret == ESDM_SUCCESS);
+
+  //opening the dataset must not decode any fragments
+  ret = esdm_init();
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_container_open("mycontainer", ESDM_MODE_FLAG_READ, &container);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_dataset_open(container, "mydataset", ESDM_MODE_FLAG_READ, &dataset);
+  eassert(ret == ESDM_SUCCESS);
+  eassert(dataset->fragmentPages);
+  eassert(esdmI_fragmentPages_pageCount(dataset->fragmentPages) == 4);
+  eassert(esdmI_fragmentPages_fetchedCount(dataset->fragmentPages) == 0);
+  eassert(dataset->snapshotBytes > esdmI_fragmentPages_tableSize(dataset->fragmentPages));
+  eassert(g_hash_table_size(dataset->fragments.table) == 0);
+
+  //reading a single element decodes a single page
+  uint64_t value = 0;
+  esdm_simple_dspace_t space = esdm_dataspace_2do(EDGE - 1, 1, EDGE - 1, 1, SMD_DTYPE_UINT64);
+  ret = esdm_read(dataset, &value, space.ptr);
+  eassert(ret == ESDM_SUCCESS);
+  esdm_dataspace_destroy(space.ptr);
+  eassert(value == EDGE * EDGE - 1);
+  printf("decoded %u of %d fragments\n", g_hash_table_size(dataset->fragments.table), EDGE * EDGE);
+  eassert(esdmI_fragmentPages_loadedCount(dataset->fragmentPages) == 1);
+  eassert(esdmI_fragmentPages_fetchedCount(dataset->fragmentPages) == 1);  //the pages outside the read region have not been read from the snapshot
+  eassert(g_hash_table_size(dataset->fragments.table) == EDGE * EDGE / 4);
+  eassert(dataset->fragments.uncommittedCount == 0); //decoded fragments must not be written to the journal again
+
+  //a read of more fragments starts the grid synthesis, which must not fetch the other pages either
+  uint64_t corner[4 * 4];
+  space = esdm_dataspace_2do(EDGE - 4, 4, EDGE - 4, 4, SMD_DTYPE_UINT64);
+  ret = esdm_read(dataset, corner, space.ptr);
+  eassert(ret == ESDM_SUCCESS);
+  esdmI_gridSynthesis_wait();
+  ret = esdm_read(dataset, corner, space.ptr);  //picks up the result of the analysis
+  eassert(ret == ESDM_SUCCESS);
+  esdm_dataspace_destroy(space.ptr);
+  eassert(corner[4 * 4 - 1] == EDGE * EDGE - 1);
+  eassert(dataset->fragmentPages);
+  eassert(esdmI_fragmentPages_fetchedCount(dataset->fragmentPages) == 1);
+  eassert(esdmI_fragmentPages_loadedCount(dataset->fragmentPages) == 1);
+
+  //reading everything decodes the remaining pages
+  uint64_t *readData = ea_checked_malloc(EDGE * EDGE * sizeof(*readData));
+  ret = esdm_read(dataset, readData, dataspace.ptr);
+  eassert(ret == ESDM_SUCCESS);
+  eassert(!dataset->fragmentPages);
+  eassert(g_hash_table_size(dataset->fragments.table) == EDGE * EDGE);
+  int mismatches = 0;
+  for (int i = 0; i < EDGE * EDGE; i++) {
+    if (readData[i] != data[i]) mismatches++;
+  }
+  printf("Mismatches: %d\n", mismatches);
+  eassert(mismatches == 0);
+
+  ret = esdm_dataset_close(dataset);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_container_close(container);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_finalize();
+  eassert(ret == ESDM_SUCCESS);
+
+  free(readData);
+  free(data);
+  printf("\nOK\n");
+  return 0;
+}
@@ -0,0 +1,143 @@
+/* This file is part of ESDM.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with ESDM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This test reopens a container and a dataset through the metadata cache:
+ * The second open is served from the cache, touching the metadata on disk invalidates the cached objects,
+ * and a cache without any room evicts everything right away.
+ */
+
+#include <esdm.h>
+#include <esdm-internal.h>
+#include <test/util/test_util.h>
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define HEIGHT 10
+#define WIDTH 100
+
+static void init(const char* cacheBytes) {
+  char config[1024];
+  sprintf(config, "{\"esdm\": {"
+    "\"metadata cache bytes\": %s,"
+    "\"backends\": [{\"type\": \"POSIX\", \"id\": \"p1\", \"accessibility\": \"global\", \"target\": \"./_posix1\"}],"
+    "\"metadata\": {\"type\": \"metadummy\", \"id\": \"md\", \"target\": \"./_metadummy\"}"
+    "}}", cacheBytes);
+  esdm_status ret = esdm_load_config_str(config);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_init();
+  eassert(ret == ESDM_SUCCESS);
+}
+
+static void openAndCheck(esdm_container_t **out_container, esdm_dataset_t **out_dataset, uint64_t *readData) {
+  esdm_status ret = esdm_container_open("mycontainer", ESDM_MODE_FLAG_READ, out_container);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_dataset_open(*out_container, "mydataset", ESDM_MODE_FLAG_READ, out_dataset);
+  eassert(ret == ESDM_SUCCESS);
+
+  esdm_simple_dspace_t space = esdm_dataspace_2d(HEIGHT, WIDTH, SMD_DTYPE_UINT64);
+  memset(readData, 0, HEIGHT * WIDTH * sizeof(*readData));
+  ret = esdm_read(*out_dataset, readData, space.ptr);
+  eassert(ret == ESDM_SUCCESS);
+  for (int i = 0; i < HEIGHT * WIDTH; i++) eassert(readData[i] == i);
+  esdm_dataspace_destroy(space.ptr);
+}
+
+static void closeBoth(esdm_container_t *container, esdm_dataset_t *dataset) {
+  esdm_status ret = esdm_dataset_close(dataset);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_container_close(container);
+  eassert(ret == ESDM_SUCCESS);
+}
+
+int main(int argc, char const *argv[]) {
+  uint64_t *data = ea_checked_malloc(HEIGHT * WIDTH * sizeof(*data));
+  uint64_t *readData = ea_checked_malloc(HEIGHT * WIDTH * sizeof(*readData));
+  for (int i = 0; i < HEIGHT * WIDTH; i++) data[i] = i;
+
+  esdm_status ret;
+  esdm_container_t *container = NULL;
+  esdm_dataset_t *dataset = NULL;
+  int64_t hits, misses, invalidations, evictions, bytes;
+  int64_t oldHits, oldMisses, oldInvalidations, oldEvictions;
+
+  init("1048576");
+  ret = esdm_mkfs(ESDM_FORMAT_PURGE_RECREATE, ESDM_ACCESSIBILITY_GLOBAL);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_mkfs(ESDM_FORMAT_PURGE_RECREATE, ESDM_ACCESSIBILITY_NODELOCAL);
+  eassert(ret == ESDM_SUCCESS);
+
+  esdm_simple_dspace_t dataspace = esdm_dataspace_2d(HEIGHT, WIDTH, SMD_DTYPE_UINT64);
+  ret = esdm_container_create("mycontainer", 1, &container);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_dataset_create(container, "mydataset", dataspace.ptr, &dataset);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_write(dataset, data, dataspace.ptr);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_dataset_commit(dataset);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_container_commit(container);
+  eassert(ret == ESDM_SUCCESS);
+  closeBoth(container, dataset);
+  esdmI_mdCache_getStats(&oldHits, &oldMisses, &oldInvalidations, &oldEvictions, &bytes);
+  eassert(bytes > 0);
+
+  //the closed objects are still cached, so reopening them must not go to the metadata backend
+  openAndCheck(&container, &dataset, readData);
+  esdmI_mdCache_getStats(&hits, &misses, &invalidations, &evictions, &bytes);
+  printf("reopen: %"PRId64" hits, %"PRId64" misses\n", hits - oldHits, misses - oldMisses);
+  eassert(hits == oldHits + 2 && misses == oldMisses);
+  closeBoth(container, dataset);
+
+  //somebody else rewrote the container metadata, the cached container and its datasets must be discarded
+  struct timespec times[2] = {{.tv_sec = 1000000000}, {.tv_sec = 1000000000}};
+  eassert(!utimensat(AT_FDCWD, "./_metadummy/containers/mycontainer.md", times, 0));
+  esdmI_mdCache_getStats(&oldHits, &oldMisses, &oldInvalidations, &oldEvictions, NULL);
+  openAndCheck(&container, &dataset, readData);
+  esdmI_mdCache_getStats(&hits, &misses, &invalidations, &evictions, NULL);
+  printf("stale reopen: %"PRId64" hits, %"PRId64" misses, %"PRId64" invalidations\n", hits - oldHits, misses - oldMisses, invalidations - oldInvalidations);
+  eassert(hits == oldHits && invalidations == oldInvalidations + 1 && misses == oldMisses + 2);
+  closeBoth(container, dataset);
+
+  ret = esdm_finalize();
+  eassert(ret == ESDM_SUCCESS);
+  esdmI_mdCache_getStats(NULL, NULL, NULL, NULL, &bytes);
+  eassert(bytes == 0);
+
+  //a cache without room must evict every object as soon as it is closed, but everything must still work
+  init("1");
+  esdmI_mdCache_getStats(&oldHits, &oldMisses, &oldInvalidations, &oldEvictions, NULL);
+  openAndCheck(&container, &dataset, readData);
+  closeBoth(container, dataset);
+  openAndCheck(&container, &dataset, readData);
+  closeBoth(container, dataset);
+  esdmI_mdCache_getStats(&hits, &misses, &invalidations, &evictions, &bytes);
+  printf("tiny cache: %"PRId64" hits, %"PRId64" misses, %"PRId64" evictions\n", hits - oldHits, misses - oldMisses, evictions - oldEvictions);
+  eassert(hits == oldHits && evictions >= oldEvictions + 4 && bytes == 0);
+  ret = esdm_finalize();
+  eassert(ret == ESDM_SUCCESS);
+
+  esdm_dataspace_destroy(dataspace.ptr);
+  free(readData);
+  free(data);
+  printf("\nOK\n");
+  return 0;
+}
@@ -0,0 +1,202 @@
+/* This file is part of ESDM.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with ESDM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This test commits a dataset after every timestep, checks that the commits only append to the metadata journal,
+ * and that the data can be read back after reopening the dataset from snapshot and journal.
+ * Completed grids and changes of the access pattern must be journaled as well, without a new snapshot.
+ * Reads of a read-only session must add to the access pattern when the dataset is closed.
+ */
+
+#include <esdm.h>
+#include <esdm-internal.h>
+#include <test/util/test_util.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define STEPS 20
+#define WIDTH 100
+
+int main(int argc, char const *argv[]) {
+  uint64_t *data = ea_checked_malloc(STEPS * WIDTH * sizeof(*data));
+  for (int i = 0; i < STEPS * WIDTH; i++) data[i] = i;
+
+  esdm_status ret;
+  esdm_container_t *container = NULL;
+  esdm_dataset_t *dataset = NULL;
+
+  ret = esdm_init();
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_mkfs(ESDM_FORMAT_PURGE_RECREATE, ESDM_ACCESSIBILITY_GLOBAL);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_mkfs(ESDM_FORMAT_PURGE_RECREATE, ESDM_ACCESSIBILITY_NODELOCAL);
+  eassert(ret == ESDM_SUCCESS);
+
+  esdm_simple_dspace_t dataspace = esdm_dataspace_2d(STEPS, WIDTH, SMD_DTYPE_UINT64);
+  eassert(dataspace.ptr);
+  ret = esdm_container_create("mycontainer", 1, &container);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_dataset_create(container, "mydataset", dataspace.ptr, &dataset);
+  eassert(ret == ESDM_SUCCESS);
+
+  //the first commit writes the snapshot, all later commits only append the new fragments
+  int64_t snapshotBytes = 0;
+  for (int step = 0; step < STEPS; step++) {
+    esdm_simple_dspace_t space = esdm_dataspace_2do(step, 1, 0, WIDTH, SMD_DTYPE_UINT64);
+    ret = esdm_write(dataset, data + step * WIDTH, space.ptr);
+    eassert(ret == ESDM_SUCCESS);
+    esdm_dataspace_destroy(space.ptr);
+    ret = esdm_dataset_commit(dataset);
+    eassert(ret == ESDM_SUCCESS);
+    if (!step) {
+      ret = esdm_container_commit(container);
+      eassert(ret == ESDM_SUCCESS);
+      snapshotBytes = dataset->snapshotBytes;
+      eassert(snapshotBytes > 0);
+      eassert(dataset->journalBytes == 0);
+    }
+    eassert(dataset->fragments.uncommittedCount == 0);
+  }
+  printf("snapshot: %"PRId64" bytes, journal: %"PRId64" bytes\n", dataset->snapshotBytes, dataset->journalBytes);
+  eassert(dataset->snapshotBytes == snapshotBytes);
+  eassert(dataset->journalBytes > 0);
+
+  //changing anything but the fragments forces a new snapshot, which absorbs the journal
+  uint64_t fillValue = 42;
+  ret = esdm_dataset_set_fill_value(dataset, &fillValue);
+  eassert(ret == ESDM_SUCCESS);
+  dataset->status = ESDM_DATA_DIRTY;
+  ret = esdm_dataset_commit(dataset);
+  eassert(ret == ESDM_SUCCESS);
+  eassert(dataset->journalBytes == 0);
+  eassert(dataset->snapshotBytes > snapshotBytes);
+
+  //append some more steps to the journal
+  for (int step = 0; step < STEPS; step++) {
+    esdm_simple_dspace_t space = esdm_dataspace_2do(step, 1, WIDTH / 2, WIDTH / 2, SMD_DTYPE_UINT64);
+    ret = esdm_write(dataset, data + step * WIDTH + WIDTH / 2, space.ptr);
+    eassert(ret == ESDM_SUCCESS);
+    esdm_dataspace_destroy(space.ptr);
+    ret = esdm_dataset_commit(dataset);
+    eassert(ret == ESDM_SUCCESS);
+  }
+  eassert(dataset->journalBytes > 0);
+
+  //a completed grid and a read are appended to the journal, too
+  int64_t snapshotBytesBefore = dataset->snapshotBytes, journalBytesBefore = dataset->journalBytes;
+  esdm_grid_t *grid;
+  ret = esdm_grid_createSimple(dataset, 2, (int64_t[2]){STEPS, WIDTH}, &grid);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_grid_subdivideFlexible(grid, 0, 2);
+  eassert(ret == ESDM_SUCCESS);
+  for (int64_t i = 0; i < 2; i++) {
+    int64_t offset[2], size[2];
+    ret = esdm_grid_cellSize(grid, (int64_t[2]){i, 0}, offset, size);
+    eassert(ret == ESDM_SUCCESS);
+    esdm_dataspace_t *cellSpace;
+    ret = esdm_dataspace_create_full(2, size, offset, SMD_DTYPE_UINT64, &cellSpace);
+    eassert(ret == ESDM_SUCCESS);
+    ret = esdm_write_grid(grid, cellSpace, data + offset[0] * WIDTH);
+    eassert(ret == ESDM_SUCCESS);
+    esdm_dataspace_destroy(cellSpace);
+  }
+  int64_t gridCount;
+  ret = esdm_dataset_grids(dataset, &gridCount, NULL);
+  eassert(ret == ESDM_SUCCESS);
+  eassert(gridCount == 1);
+  uint64_t value;
+  esdm_simple_dspace_t valueSpace = esdm_dataspace_2do(3, 1, 7, 1, SMD_DTYPE_UINT64);
+  ret = esdm_read(dataset, &value, valueSpace.ptr);
+  eassert(ret == ESDM_SUCCESS);
+  eassert(value == 3 * WIDTH + 7);
+  dataset->status = ESDM_DATA_DIRTY;
+  ret = esdm_dataset_commit(dataset);
+  eassert(ret == ESDM_SUCCESS);
+  eassert(dataset->snapshotBytes == snapshotBytesBefore);
+  eassert(dataset->journalBytes > journalBytesBefore);
+  ret = esdm_dataset_grids(dataset, &gridCount, NULL); //the read may have added a synthesized grid
+  eassert(ret == ESDM_SUCCESS);
+  int64_t committedGridCount = gridCount;
+  guint fragmentCount = g_hash_table_size(dataset->fragments.table);
+
+  ret = esdm_dataset_close(dataset);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_container_close(container);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_finalize();
+  eassert(ret == ESDM_SUCCESS);
+
+  //reopen, this replays the journal on top of the snapshot
+  ret = esdm_init();
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_container_open("mycontainer", ESDM_MODE_FLAG_READ, &container);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_dataset_open(container, "mydataset", ESDM_MODE_FLAG_READ, &dataset);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdmI_dataset_loadFragments(dataset, NULL); //the fragments of the snapshot are only decoded on demand
+  eassert(ret == ESDM_SUCCESS);
+  eassert(g_hash_table_size(dataset->fragments.table) == fragmentCount);
+  eassert(dataset->journalBytes > 0);
+  eassert(esdm_dataset_is_fill_value_set(dataset));
+  ret = esdm_dataset_grids(dataset, &gridCount, NULL);
+  eassert(ret == ESDM_SUCCESS);
+  eassert(gridCount == committedGridCount);
+  eassert(dataset->accessPattern.shapeCount == 1);
+  eassert(dataset->accessPattern.sizes[0] == 1 && dataset->accessPattern.sizes[1] == 1);
+
+  uint64_t *readData = ea_checked_malloc(STEPS * WIDTH * sizeof(*readData));
+  ret = esdm_read(dataset, readData, dataspace.ptr);
+  eassert(ret == ESDM_SUCCESS);
+  int mismatches = 0;
+  for (int i = 0; i < STEPS * WIDTH; i++) {
+    if (readData[i] != data[i]) mismatches++;
+  }
+  printf("Mismatches: %d\n", mismatches);
+  eassert(mismatches == 0);
+  eassert(dataset->accessPattern.shapeCount == 2);
+  snapshotBytes = dataset->snapshotBytes;
+  int64_t journalBytes = dataset->journalBytes;
+
+  //the dataset is not dirty, but closing it must append the changed access pattern to the journal
+  ret = esdm_dataset_close(dataset);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_container_close(container);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_finalize();
+  eassert(ret == ESDM_SUCCESS);
+
+  ret = esdm_init();
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_container_open("mycontainer", ESDM_MODE_FLAG_READ, &container);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_dataset_open(container, "mydataset", ESDM_MODE_FLAG_READ, &dataset);
+  eassert(ret == ESDM_SUCCESS);
+  eassert(dataset->snapshotBytes == snapshotBytes);
+  eassert(dataset->journalBytes > journalBytes);
+  eassert(dataset->accessPattern.shapeCount == 2);
+  ret = esdm_dataset_close(dataset);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_container_close(container);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_finalize();
+  eassert(ret == ESDM_SUCCESS);
+
+  free(readData);
+  free(data);
+  printf("\nOK\n");
+  return 0;
+}
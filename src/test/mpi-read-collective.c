@@ -0,0 +1,129 @@
+/* This file is part of ESDM.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with ESDM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This test opens a dataset with esdm_mpi_dataset_open_collective() and reads it with esdm_mpi_read_collective(),
+ * where every process reads the entire dataset and a region that overlaps with its neighbors.
+ * The last row of the dataset is never written and must be filled with the fill value.
+ */
+
+#include <esdm-mpi.h>
+#include <esdm-internal.h>
+#include <test/util/test_util.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HEIGHT 16
+#define WIDTH 100
+
+int main(int argc, char** argv) {
+  MPI_Init(&argc, &argv);
+  int rank, procCount;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &procCount);
+
+  esdm_mpi_init_manual();
+  esdm_status ret = esdm_mpi_distribute_config_file("esdm.conf");
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_init();
+  eassert(ret == ESDM_SUCCESS);
+  if(!rank) {
+    ret = esdm_mkfs(ESDM_FORMAT_PURGE_RECREATE, ESDM_ACCESSIBILITY_GLOBAL);
+    eassert(ret == ESDM_SUCCESS);
+    ret = esdm_mkfs(ESDM_FORMAT_PURGE_RECREATE, ESDM_ACCESSIBILITY_NODELOCAL);
+    eassert(ret == ESDM_SUCCESS);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  //rank 0 writes each row as a separate fragment, except for the last one
+  esdm_container_t *container;
+  ret = esdm_mpi_container_create(MPI_COMM_WORLD, "mycontainer", 1, &container);
+  eassert(ret == ESDM_SUCCESS);
+  esdm_simple_dspace_t dataspace = esdm_dataspace_2d(HEIGHT, WIDTH, SMD_DTYPE_UINT64);
+  esdm_dataset_t *dataset;
+  ret = esdm_mpi_dataset_create(MPI_COMM_WORLD, container, "mydataset", dataspace.ptr, &dataset);
+  eassert(ret == ESDM_SUCCESS);
+  uint64_t fillValue = 42424242;
+  ret = esdm_dataset_set_fill_value(dataset, &fillValue);
+  eassert(ret == ESDM_SUCCESS);
+  if(!rank) {
+    uint64_t row[WIDTH];
+    for(int y = 0; y < HEIGHT - 1; y++) {
+      for(int x = 0; x < WIDTH; x++) row[x] = y*WIDTH + x;
+      esdm_simple_dspace_t space = esdm_dataspace_2do(y, 1, 0, WIDTH, SMD_DTYPE_UINT64);
+      ret = esdm_write(dataset, row, space.ptr);
+      eassert(ret == ESDM_SUCCESS);
+      esdm_dataspace_destroy(space.ptr);
+    }
+  }
+  ret = esdm_mpi_dataset_commit(MPI_COMM_WORLD, dataset);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_mpi_container_commit(MPI_COMM_WORLD, container);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_dataset_close(dataset);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_container_close(container);
+  eassert(ret == ESDM_SUCCESS);
+
+  ret = esdm_mpi_container_open(MPI_COMM_WORLD, "mycontainer", 0, &container);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_mpi_dataset_open_collective(MPI_COMM_WORLD, container, "mydataset", &dataset);
+  eassert(ret == ESDM_SUCCESS);
+
+  //everyone reads everything
+  uint64_t *data = ea_checked_malloc(HEIGHT*WIDTH*sizeof(*data));
+  ret = esdm_mpi_read_collective(MPI_COMM_WORLD, dataset, data, dataspace.ptr);
+  eassert(ret == ESDM_SUCCESS);
+  for(int i = 0; i < HEIGHT*WIDTH; i++) eassert(data[i] == (i < (HEIGHT - 1)*WIDTH ? i : fillValue));
+
+  //overlapping blocks of four rows, read into a strided buffer of a different type
+  int firstRow = rank % (HEIGHT - 3);
+  esdm_simple_dspace_t block = esdm_dataspace_2do(firstRow, 4, 10, 20, SMD_DTYPE_DOUBLE);
+  int64_t stride[2] = {1, 4};
+  ret = esdm_dataspace_set_stride(block.ptr, stride);
+  eassert(ret == ESDM_SUCCESS);
+  double blockData[4*20];
+  ret = esdm_mpi_read_collective(MPI_COMM_WORLD, dataset, blockData, block.ptr);
+  eassert(ret == ESDM_SUCCESS);
+  for(int y = 0; y < 4; y++) {
+    for(int x = 0; x < 20; x++) {
+      int row = firstRow + y;
+      double expected = row < HEIGHT - 1 ? row*WIDTH + 10 + x : fillValue;
+      eassert(blockData[x*4 + y] == expected);
+    }
+  }
+  esdm_dataspace_destroy(block.ptr);
+
+  //processes without a region take part as well
+  esdm_simple_dspace_t empty = esdm_dataspace_2do(0, 0, 0, WIDTH, SMD_DTYPE_UINT64);
+  ret = esdm_mpi_read_collective(MPI_COMM_WORLD, dataset, rank ? NULL : data, rank ? empty.ptr : dataspace.ptr);
+  eassert(ret == ESDM_SUCCESS);
+  esdm_dataspace_destroy(empty.ptr);
+
+  free(data);
+  ret = esdm_dataset_close(dataset);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_container_close(container);
+  eassert(ret == ESDM_SUCCESS);
+  esdm_dataspace_destroy(dataspace.ptr);
+
+  esdm_mpi_finalize();
+  if(!rank) printf("\nOK\n");
+  MPI_Finalize();
+  return 0;
+}
@@ -0,0 +1,124 @@
+/* This file is part of ESDM.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with ESDM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This test writes a dataset with esdm_mpi_write_collective(), where every process contributes a block of rows.
+ * The blocks of the processes on a node are aggregated into a single fragment.
+ * CMake runs it with four processes, which must result in one fragment per node instead of one per process.
+ */
+
+#include <esdm-mpi.h>
+#include <esdm-internal.h>
+#include <test/util/test_util.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ROWS 8
+#define WIDTH 100
+
+int main(int argc, char** argv) {
+  MPI_Init(&argc, &argv);
+  int rank, procCount;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &procCount);
+
+  esdm_mpi_init_manual();
+  esdm_status ret = esdm_mpi_distribute_config_file("esdm.conf");
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_init();
+  eassert(ret == ESDM_SUCCESS);
+  if(!rank) {
+    ret = esdm_mkfs(ESDM_FORMAT_PURGE_RECREATE, ESDM_ACCESSIBILITY_GLOBAL);
+    eassert(ret == ESDM_SUCCESS);
+    ret = esdm_mkfs(ESDM_FORMAT_PURGE_RECREATE, ESDM_ACCESSIBILITY_NODELOCAL);
+    eassert(ret == ESDM_SUCCESS);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  //count the nodes, each of which has one aggregator
+  MPI_Comm nodeComm;
+  int nodeRank, isAggregator, nodeCount;
+  MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &nodeComm);
+  MPI_Comm_rank(nodeComm, &nodeRank);
+  MPI_Comm_free(&nodeComm);
+  isAggregator = !nodeRank;
+  MPI_Allreduce(&isAggregator, &nodeCount, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+
+  esdm_container_t *container;
+  ret = esdm_mpi_container_create(MPI_COMM_WORLD, "mycontainer", 1, &container);
+  eassert(ret == ESDM_SUCCESS);
+  esdm_simple_dspace_t dataspace = esdm_dataspace_2d(ROWS*procCount, WIDTH, SMD_DTYPE_UINT64);
+  esdm_dataset_t *dataset;
+  ret = esdm_mpi_dataset_create(MPI_COMM_WORLD, container, "mydataset", dataspace.ptr, &dataset);
+  eassert(ret == ESDM_SUCCESS);
+
+  //write our rows as 32 bit integers to check the conversion to the dataset type as well
+  uint32_t *data = ea_checked_malloc(ROWS*WIDTH*sizeof(*data));
+  for(int i = 0; i < ROWS*WIDTH; i++) data[i] = rank*ROWS*WIDTH + i;
+  esdm_simple_dspace_t memspace = esdm_dataspace_2do(rank*ROWS, ROWS, 0, WIDTH, SMD_DTYPE_UINT32);
+  ret = esdm_mpi_write_collective(MPI_COMM_WORLD, dataset, data, memspace.ptr);
+  eassert(ret == ESDM_SUCCESS);
+  esdm_dataspace_destroy(memspace.ptr);
+  free(data);
+
+  //processes without data take part as well
+  esdm_simple_dspace_t empty = esdm_dataspace_2do(0, 0, 0, WIDTH, SMD_DTYPE_UINT64);
+  ret = esdm_mpi_write_collective(MPI_COMM_WORLD, dataset, NULL, empty.ptr);
+  eassert(ret == ESDM_SUCCESS);
+  esdm_dataspace_destroy(empty.ptr);
+
+  ret = esdm_mpi_dataset_commit(MPI_COMM_WORLD, dataset);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_mpi_container_commit(MPI_COMM_WORLD, container);
+  eassert(ret == ESDM_SUCCESS);
+
+  if(!rank) {
+    //the data of each node is small enough for a single fragment, which spans the rows of all its processes
+    int64_t fragmentCount;
+    esdm_fragment_t **fragments = esdmI_fragments_list(&dataset->fragments, &fragmentCount);
+    printf("%d processes on %d nodes wrote %"PRId64" fragments\n", procCount, nodeCount, fragmentCount);
+    eassert(fragmentCount == nodeCount);
+    int64_t rowCount = 0;
+    for(int64_t i = 0; i < fragmentCount; i++) {
+      int64_t const *size = esdm_dataspace_get_size(fragments[i]->dataspace);
+      eassert(size[1] == WIDTH);
+      eassert(size[0] % ROWS == 0);
+      rowCount += size[0];
+    }
+    eassert(rowCount == ROWS*procCount);
+    if(procCount > nodeCount) eassert(fragmentCount < procCount);
+    free(fragments);
+
+    uint64_t *readData = ea_checked_malloc(ROWS*procCount*WIDTH*sizeof(*readData));
+    ret = esdm_read(dataset, readData, dataspace.ptr);
+    eassert(ret == ESDM_SUCCESS);
+    for(int i = 0; i < ROWS*procCount*WIDTH; i++) eassert(readData[i] == i);
+    free(readData);
+  }
+
+  ret = esdm_dataset_close(dataset);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_container_close(container);
+  eassert(ret == ESDM_SUCCESS);
+  esdm_dataspace_destroy(dataspace.ptr);
+
+  esdm_mpi_finalize();
+  if(!rank) printf("\nOK\n");
+  MPI_Finalize();
+  return 0;
+}
@@ -0,0 +1,150 @@
+/* This file is part of ESDM.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with ESDM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This test feeds synthetic I/O timings into the online latency/throughput fit of the backends,
+ * and checks the fitted parameters and the automatic fragment size that is derived from them:
+ * Samples of different sizes must reproduce the latency and throughput they were generated with.
+ * Samples of equal size must keep the latency of the configured performance model, and only fit the throughput.
+ * If the configured latency exceeds the measured times, the latency is dropped, and the configured maximum fragment size is used.
+ * The fit is stored in the metadata backend by esdm_finalize(), and must be restored by the next esdm_init().
+ */
+
+#include <esdm.h>
+#include <esdm-internal.h>
+#include <test/util/test_util.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MiB (1024.0 * 1024)
+#define EFFICIENCY 0.9
+
+static bool isClose(double value, double expected) {
+  double difference = value > expected ? value - expected : expected - value;
+  return difference <= 1e-3 * expected;
+}
+
+//The fragment size at which the fraction EFFICIENCY of the streaming bandwidth is reached.
+static double expectedFragmentSize(double latency, double throughput) {
+  return EFFICIENCY / (1 - EFFICIENCY) * latency * throughput;
+}
+
+static void recordSamples(esdm_backend_t *backend, int count, double latency, double throughput, bool varySize) {
+  for (int i = 0; i < count; i++) {
+    int64_t bytes = (varySize ? 1 + i % 16 : 1) * MiB;
+    esdmI_performance_recordBackendIo(backend, bytes, latency + bytes / throughput);
+  }
+}
+
+static void printModel(const char *name, esdm_backend_t *backend) {
+  double latency, throughput;
+  esdmI_performance_backendModel(backend, &latency, &throughput);
+  printf("%s: latency = %g s, throughput = %g MiB/s, fragment size = %" PRId64 " bytes\n", name, latency, throughput / MiB, esdmI_backend_fragmentSize(backend));
+}
+
+static const char *kConfig = "{\"esdm\": {"
+    "\"backends\": ["
+      "{\"type\": \"POSIX\", \"id\": \"varied\", \"accessibility\": \"global\", \"target\": \"./_posix1\", \"max-fragment-size\": \"auto\"},"
+      "{\"type\": \"POSIX\", \"id\": \"equal\", \"accessibility\": \"global\", \"target\": \"./_posix2\", \"max-fragment-size\": \"auto\","
+        "\"performance-model\": {\"latency\": 0.002, \"throughput\": 1000.0}},"
+      "{\"type\": \"POSIX\", \"id\": \"slow\", \"accessibility\": \"global\", \"target\": \"./_posix3\", \"max-fragment-size\": \"auto\","
+        "\"performance-model\": {\"latency\": 1.0, \"throughput\": 1000.0}}"
+    "],"
+    "\"metadata\": {\"type\": \"metadummy\", \"id\": \"md\", \"target\": \"./_metadummy\"}"
+    "}}";
+
+int main(int argc, char const *argv[]) {
+  //start without the models stored by previous runs of this test
+  esdm_status ret = esdm_load_config_str(kConfig);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_init();
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_mkfs(ESDM_FORMAT_PURGE_RECREATE, ESDM_ACCESSIBILITY_GLOBAL);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_finalize();
+  eassert(ret == ESDM_SUCCESS);
+
+  ret = esdm_load_config_str(kConfig);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_init();
+  eassert(ret == ESDM_SUCCESS);
+
+  esdm_backend_t *varied = esdmI_get_backend("varied");
+  esdm_backend_t *equal = esdmI_get_backend("equal");
+  esdm_backend_t *slow = esdmI_get_backend("slow");
+  eassert(varied && equal && slow);
+  double latency, throughput;
+
+  //without samples, the configured performance model is used
+  eassert(!esdmI_performance_backendModel(equal, &latency, &throughput));
+  eassert(isClose(latency, 0.002) && isClose(throughput, 1000 * MiB));
+  eassert(isClose(esdmI_backend_fragmentSize(equal), expectedFragmentSize(0.002, 1000 * MiB)));
+
+  //samples of different sizes determine both parameters
+  recordSamples(varied, 4, 0.01, 200 * MiB, true);
+  eassert(!esdmI_performance_backendModel(varied, &latency, &throughput));  //too few samples to trust a fit
+  recordSamples(varied, 60, 0.01, 200 * MiB, true);
+  printModel("varied sizes", varied);
+  eassert(esdmI_performance_backendModel(varied, &latency, &throughput));
+  eassert(isClose(latency, 0.01));
+  eassert(isClose(throughput, 200 * MiB));
+  eassert(isClose(esdmI_backend_fragmentSize(varied), expectedFragmentSize(0.01, 200 * MiB)));
+
+  //equal sizes cannot separate latency and throughput, the configured latency is kept
+  recordSamples(equal, 32, 0.005, 200 * MiB, false);
+  printModel("equal sizes", equal);
+  eassert(esdmI_performance_backendModel(equal, &latency, &throughput));
+  double meanTime = 0.005 + MiB / (200 * MiB);
+  eassert(isClose(latency, 0.002));
+  eassert(isClose(throughput, MiB / (meanTime - latency)));
+  eassert(isClose(esdmI_backend_fragmentSize(equal), expectedFragmentSize(latency, throughput)));
+
+  //the configured latency exceeds the measured times, so there is no latency, and all fragment sizes are equally efficient
+  recordSamples(slow, 32, 0.005, 200 * MiB, false);
+  printModel("equal sizes, configured latency too high", slow);
+  eassert(esdmI_performance_backendModel(slow, &latency, &throughput));
+  eassert(latency == 0);
+  eassert(isClose(throughput, MiB / meanTime));
+  eassert(esdmI_backend_fragmentSize(slow) == slow->config->max_fragment_size);
+  int64_t variedFragmentSize = esdmI_backend_fragmentSize(varied);
+
+  ret = esdm_finalize();
+  eassert(ret == ESDM_SUCCESS);
+
+  //a new process continues with the stored fit instead of the configured performance model
+  ret = esdm_load_config_str(kConfig);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_init();
+  eassert(ret == ESDM_SUCCESS);
+  varied = esdmI_get_backend("varied");
+  equal = esdmI_get_backend("equal");
+  eassert(varied && equal);
+  printModel("restored", varied);
+  eassert(esdmI_performance_backendModel(varied, &latency, &throughput));
+  eassert(isClose(latency, 0.01));
+  eassert(isClose(throughput, 200 * MiB));
+  eassert(esdmI_backend_fragmentSize(varied) == variedFragmentSize);
+  eassert(esdmI_performance_backendModel(equal, &latency, &throughput));
+  eassert(isClose(latency, 0.002));
+  eassert(isClose(throughput, MiB / (meanTime - latency)));
+
+  ret = esdm_finalize();
+  eassert(ret == ESDM_SUCCESS);
+
+  printf("\nOK\n");
+  return 0;
+}
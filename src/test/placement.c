@@ -0,0 +1,131 @@
+/* This file is part of ESDM.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with ESDM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This test checks how esdm_modules_makeBackendRecommendation() distributes the data of a write across backends of unequal speed:
+ * Idle backends receive shares proportional to their throughput.
+ * Queued work delays a backend, so that it receives less data, and all selected backends are expected to finish at the same time.
+ * A backend whose queue is full enough to take longer than the write on the other backends is not used at all,
+ * and the returned fragment size follows the backends that are actually used.
+ */
+
+#include <esdm.h>
+#include <esdm-internal.h>
+#include <test/util/test_util.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MiB (1024.0 * 1024)
+
+static const char *kConfig = "{\"esdm\": {"
+  "\"backends\": ["
+    "{\"type\": \"POSIX\", \"id\": \"fast\", \"accessibility\": \"global\", \"target\": \"./_posix1\", \"max-fragment-size\": 10485760,"
+      "\"performance-model\": {\"latency\": 0.0, \"throughput\": 300.0}},"
+    "{\"type\": \"POSIX\", \"id\": \"slow\", \"accessibility\": \"global\", \"target\": \"./_posix2\", \"max-fragment-size\": 20971520,"
+      "\"performance-model\": {\"latency\": 0.0, \"throughput\": 100.0}}"
+  "],"
+  "\"metadata\": {\"type\": \"metadummy\", \"id\": \"md\", \"target\": \"./_metadummy\"}"
+  "}}";
+
+static bool isClose(double value, double expected) {
+  double difference = value > expected ? value - expected : expected - value;
+  return difference <= 1e-6;
+}
+
+//Returns the share of the given backend, or zero if it was not selected.
+static double shareOf(esdm_backend_t *backend, int64_t count, esdm_backend_t **backends, double *shares) {
+  for (int64_t i = 0; i < count; i++) {
+    if (backends[i] == backend) return shares[i];
+  }
+  return 0;
+}
+
+static void recommend(esdm_dataspace_t *space, esdm_backend_t *fast, esdm_backend_t *slow, double *out_fastShare, double *out_slowShare, int64_t *out_count, int64_t *out_maxFragmentSize) {
+  double *shares;
+  esdm_backend_t **backends = esdm_modules_makeBackendRecommendation(esdm_get_modules(), space, out_count, out_maxFragmentSize, &shares);
+  eassert(backends);
+  double sum = 0;
+  for (int64_t i = 0; i < *out_count; i++) sum += shares[i];
+  eassert(isClose(sum, 1));
+  *out_fastShare = shareOf(fast, *out_count, backends, shares);
+  *out_slowShare = shareOf(slow, *out_count, backends, shares);
+  printf("fast: %g, slow: %g, fragment size: %" PRId64 "\n", *out_fastShare, *out_slowShare, *out_maxFragmentSize);
+  free(backends);
+  free(shares);
+}
+
+int main(int argc, char const *argv[]) {
+  //start without the I/O models stored by previous tests, so that the configured performance models are used
+  esdm_status ret = esdm_load_config_str(kConfig);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_init();
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_mkfs(ESDM_FORMAT_PURGE_RECREATE, ESDM_ACCESSIBILITY_GLOBAL);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_finalize();
+  eassert(ret == ESDM_SUCCESS);
+
+  ret = esdm_load_config_str(kConfig);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_init();
+  eassert(ret == ESDM_SUCCESS);
+
+  esdm_backend_t *fast = esdmI_get_backend("fast");
+  esdm_backend_t *slow = esdmI_get_backend("slow");
+  eassert(fast && slow);
+
+  //400 MiB of doubles
+  esdm_dataspace_t *space;
+  ret = esdm_dataspace_create(1, (int64_t[1]){400 * MiB / 8}, SMD_DTYPE_DOUBLE, &space);
+  eassert(ret == ESDM_SUCCESS);
+  double fastShare, slowShare;
+  int64_t count, maxFragmentSize;
+
+  //idle backends share the data according to their throughput, and the fragments must fit both of them
+  recommend(space, fast, slow, &fastShare, &slowShare, &count, &maxFragmentSize);
+  eassert(count == 2);
+  eassert(isClose(fastShare, 0.75) && isClose(slowShare, 0.25));
+  eassert(maxFragmentSize == 10 * MiB);
+
+  //300 MiB queued on the fast backend delay it by one second, both backends finish after (400 MiB + 300 MiB/s*1 s)/(400 MiB/s) = 1.75 s
+  atomic_store(&fast->queuedBytes, (int64_t)(300 * MiB));
+  recommend(space, fast, slow, &fastShare, &slowShare, &count, &maxFragmentSize);
+  eassert(count == 2);
+  eassert(isClose(fastShare, 300 * 0.75 / 400) && isClose(slowShare, 100 * 1.75 / 400));
+
+  //with 300 GiB queued, the slow backend alone finishes long before the fast one has drained its queue
+  atomic_store(&fast->queuedBytes, (int64_t)(300 * 1024 * MiB));
+  recommend(space, fast, slow, &fastShare, &slowShare, &count, &maxFragmentSize);
+  eassert(count == 1);
+  eassert(fastShare == 0 && isClose(slowShare, 1));
+  eassert(maxFragmentSize == 20 * MiB);
+
+  //if every backend is busy, the one that becomes available first is used
+  atomic_store(&slow->queuedBytes, (int64_t)(300 * 1024 * MiB));
+  recommend(space, fast, slow, &fastShare, &slowShare, &count, &maxFragmentSize);
+  eassert(count == 1);
+  eassert(isClose(fastShare, 1) && slowShare == 0);
+
+  atomic_store(&fast->queuedBytes, 0);
+  atomic_store(&slow->queuedBytes, 0);
+  esdm_dataspace_destroy(space);
+  ret = esdm_finalize();
+  eassert(ret == ESDM_SUCCESS);
+
+  printf("\nOK\n");
+  return 0;
+}
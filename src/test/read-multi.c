@@ -0,0 +1,115 @@
+/* This file is part of ESDM.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with ESDM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This test writes a dataset in several patches with esdm_write_multi() and reads many small regions back with esdm_read_multi().
+ */
+
+#include <esdm.h>
+#include <esdm-internal.h>
+#include <test/util/test_util.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define HEIGHT 64
+#define WIDTH 1024
+#define PATCHES 4
+#define COLUMNS 100
+
+int main(int argc, char const *argv[]) {
+  uint64_t *data = ea_checked_malloc(HEIGHT * WIDTH * sizeof(*data));
+  for (int y = 0; y < HEIGHT; y++) {
+    for (int x = 0; x < WIDTH; x++) {
+      data[y * WIDTH + x] = y * WIDTH + x;
+    }
+  }
+
+  esdm_status ret;
+  esdm_container_t *container = NULL;
+  esdm_dataset_t *dataset = NULL;
+
+  ret = esdm_init();
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_mkfs(ESDM_FORMAT_PURGE_RECREATE, ESDM_ACCESSIBILITY_GLOBAL);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_mkfs(ESDM_FORMAT_PURGE_RECREATE, ESDM_ACCESSIBILITY_NODELOCAL);
+  eassert(ret == ESDM_SUCCESS);
+
+  esdm_simple_dspace_t dataspace = esdm_dataspace_2d(HEIGHT, WIDTH, SMD_DTYPE_UINT64);
+  eassert(dataspace.ptr);
+  ret = esdm_container_create("mycontainer", 1, &container);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_dataset_create(container, "mydataset", dataspace.ptr, &dataset);
+  eassert(ret == ESDM_SUCCESS);
+
+  //write the data as horizontal stripes
+  void *writeBufs[PATCHES];
+  esdm_dataspace_t *writeSpaces[PATCHES];
+  for (int i = 0; i < PATCHES; i++) {
+    int64_t rows = HEIGHT / PATCHES;
+    writeBufs[i] = data + i * rows * WIDTH;
+    writeSpaces[i] = esdm_dataspace_2do(i * rows, rows, 0, WIDTH, SMD_DTYPE_UINT64).ptr;
+  }
+  ret = esdm_write_multi(dataset, PATCHES, writeBufs, writeSpaces);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_dataset_commit(dataset);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_container_commit(container);
+  eassert(ret == ESDM_SUCCESS);
+
+  //read many columns, each of which needs data from all the stripes
+  esdm_statistics_t statsBefore = esdm_read_stats();
+  uint64_t *columns = ea_checked_malloc(COLUMNS * HEIGHT * sizeof(*columns));
+  void *readBufs[COLUMNS];
+  esdm_dataspace_t *readSpaces[COLUMNS];
+  for (int i = 0; i < COLUMNS; i++) {
+    readBufs[i] = columns + i * HEIGHT;
+    readSpaces[i] = esdm_dataspace_2do(0, HEIGHT, (i * 37) % WIDTH, 1, SMD_DTYPE_UINT64).ptr;
+  }
+  ret = esdm_read_multi(dataset, COLUMNS, readBufs, readSpaces);
+  eassert(ret == ESDM_SUCCESS);
+  esdm_statistics_t statsAfter = esdm_read_stats();
+
+  int mismatches = 0;
+  for (int i = 0; i < COLUMNS; i++) {
+    for (int y = 0; y < HEIGHT; y++) {
+      if (columns[i * HEIGHT + y] != data[y * WIDTH + (i * 37) % WIDTH]) mismatches++;
+    }
+  }
+  printf("Mismatches: %d\n", mismatches);
+  eassert(mismatches == 0);
+
+  //the columns share their fragments, so we must not have read more fragments than a single full read would need
+  printf("Fragments read for %d columns: %"PRIu64"\n", COLUMNS, statsAfter.fragments - statsBefore.fragments);
+  eassert(statsAfter.fragments - statsBefore.fragments <= (uint64_t)g_hash_table_size(dataset->fragments.table));
+  eassert(statsAfter.requests - statsBefore.requests == COLUMNS);
+
+  for (int i = 0; i < PATCHES; i++) esdm_dataspace_destroy(writeSpaces[i]);
+  for (int i = 0; i < COLUMNS; i++) esdm_dataspace_destroy(readSpaces[i]);
+
+  ret = esdm_dataset_close(dataset);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_container_close(container);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_finalize();
+  eassert(ret == ESDM_SUCCESS);
+
+  free(columns);
+  free(data);
+  printf("\nOK\n");
+  return 0;
+}
@@ -0,0 +1,123 @@
+/* This file is part of ESDM.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with ESDM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This test writes a dataset in several patches and reads points along a zigzag path with esdm_read_points().
+ */
+
+#include <esdm.h>
+#include <esdm-internal.h>
+#include <test/util/test_util.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define HEIGHT 64
+#define WIDTH 1024
+#define PATCHES 4
+#define POINTS 1000
+
+int main(int argc, char const *argv[]) {
+  uint64_t *data = ea_checked_malloc(HEIGHT * WIDTH * sizeof(*data));
+  for (int y = 0; y < HEIGHT; y++) {
+    for (int x = 0; x < WIDTH; x++) {
+      data[y * WIDTH + x] = y * WIDTH + x;
+    }
+  }
+
+  esdm_status ret;
+  esdm_container_t *container = NULL;
+  esdm_dataset_t *dataset = NULL;
+
+  ret = esdm_init();
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_mkfs(ESDM_FORMAT_PURGE_RECREATE, ESDM_ACCESSIBILITY_GLOBAL);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_mkfs(ESDM_FORMAT_PURGE_RECREATE, ESDM_ACCESSIBILITY_NODELOCAL);
+  eassert(ret == ESDM_SUCCESS);
+
+  esdm_simple_dspace_t dataspace = esdm_dataspace_2d(HEIGHT, WIDTH, SMD_DTYPE_UINT64);
+  eassert(dataspace.ptr);
+  ret = esdm_container_create("mycontainer", 1, &container);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_dataset_create(container, "mydataset", dataspace.ptr, &dataset);
+  eassert(ret == ESDM_SUCCESS);
+
+  //write all but the last stripe, so that some points are not covered
+  for (int i = 0; i < PATCHES - 1; i++) {
+    int64_t rows = HEIGHT / PATCHES;
+    esdm_simple_dspace_t space = esdm_dataspace_2do(i * rows, rows, 0, WIDTH, SMD_DTYPE_UINT64);
+    ret = esdm_write(dataset, data + i * rows * WIDTH, space.ptr);
+    eassert(ret == ESDM_SUCCESS);
+    esdm_dataspace_destroy(space.ptr);
+  }
+  ret = esdm_dataset_commit(dataset);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_container_commit(container);
+  eassert(ret == ESDM_SUCCESS);
+
+  //sample the data along a zigzag path through the dataset
+  int64_t *coords = ea_checked_malloc(2 * POINTS * sizeof(*coords));
+  uint64_t *values = ea_checked_malloc(POINTS * sizeof(*values));
+  int missingPoints = 0;
+  for (int i = 0; i < POINTS; i++) {
+    int phase = i % (2 * HEIGHT - 2);
+    coords[2 * i] = phase < HEIGHT ? phase : 2 * HEIGHT - 2 - phase;
+    coords[2 * i + 1] = (int64_t)i * WIDTH / POINTS;
+    if (coords[2 * i] >= HEIGHT / PATCHES * (PATCHES - 1)) missingPoints++;
+  }
+  eassert(missingPoints > 0);
+
+  //without a fill value, reading the uncovered points must fail
+  ret = esdm_read_points(dataset, POINTS, coords, values);
+  eassert(ret == ESDM_INCOMPLETE_DATA);
+
+  uint64_t fillValue = 42;
+  ret = esdm_dataset_set_fill_value(dataset, &fillValue);
+  eassert(ret == ESDM_SUCCESS);
+
+  esdm_statistics_t statsBefore = esdm_read_stats();
+  ret = esdm_read_points(dataset, POINTS, coords, values);
+  eassert(ret == ESDM_SUCCESS);
+  esdm_statistics_t statsAfter = esdm_read_stats();
+
+  int mismatches = 0;
+  for (int i = 0; i < POINTS; i++) {
+    int64_t y = coords[2 * i], x = coords[2 * i + 1];
+    uint64_t expected = y >= HEIGHT / PATCHES * (PATCHES - 1) ? fillValue : data[y * WIDTH + x];
+    if (values[i] != expected) mismatches++;
+  }
+  printf("Mismatches: %d\n", mismatches);
+  eassert(mismatches == 0);
+
+  //each fragment must have been read at most once
+  printf("Fragments read for %d points: %"PRIu64"\n", POINTS, statsAfter.fragments - statsBefore.fragments);
+  eassert(statsAfter.fragments - statsBefore.fragments <= (uint64_t)g_hash_table_size(dataset->fragments.table));
+  eassert(statsAfter.requests - statsBefore.requests == 1);
+
+  ret = esdm_dataset_close(dataset);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_container_close(container);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_finalize();
+  eassert(ret == ESDM_SUCCESS);
+
+  free(values);
+  free(coords);
+  free(data);
+  printf("\nOK\n");
+  return 0;
+}
@@ -0,0 +1,134 @@
+/* This file is part of ESDM.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with ESDM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This test reads a dataset back through the read stream API:
+ * The small fragment size forces the stream to use several chunks, which are prefetched in the background.
+ * Each stream must be recorded as a single read of its whole region, the chunk reads of the background thread are not user requests.
+ * Reading a region that has not been written must end the stream early with an error status.
+ */
+
+#include <esdm.h>
+#include <esdm-internal.h>
+#include <esdm-stream.h>
+#include <test/util/test_util.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define HEIGHT 200
+#define WIDTH 200
+
+int main(int argc, char const *argv[]) {
+  esdm_status ret = esdm_load_config_str("{\"esdm\": {"
+    "\"backends\": [{\"type\": \"POSIX\", \"id\": \"p1\", \"accessibility\": \"global\", \"target\": \"./_posix1\", \"max-fragment-size\": 65536}],"
+    "\"metadata\": {\"type\": \"metadummy\", \"id\": \"md\", \"target\": \"./_metadummy\"}"
+    "}}");
+  eassert(ret == ESDM_SUCCESS);
+  esdm_loglevel(ESDM_LOGLEVEL_WARNING); //stop the esdm_mkfs() call from spamming us with infos about deleted objects
+  ret = esdm_init();
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_mkfs(ESDM_FORMAT_PURGE_RECREATE, ESDM_ACCESSIBILITY_GLOBAL);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_mkfs(ESDM_FORMAT_PURGE_RECREATE, ESDM_ACCESSIBILITY_NODELOCAL);
+  eassert(ret == ESDM_SUCCESS);
+
+  uint64_t *data = ea_checked_malloc(HEIGHT * WIDTH * sizeof(*data));
+  for (int i = 0; i < HEIGHT * WIDTH; i++) data[i] = i;
+
+  esdm_container_t *container = NULL;
+  esdm_dataset_t *dataset = NULL;
+  esdm_simple_dspace_t dataspace = esdm_dataspace_2d(HEIGHT, WIDTH, SMD_DTYPE_UINT64);
+  ret = esdm_container_create("mycontainer", 1, &container);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_dataset_create(container, "mydataset", dataspace.ptr, &dataset);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_write(dataset, data, dataspace.ptr);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_dataset_commit(dataset);
+  eassert(ret == ESDM_SUCCESS);
+
+  //value by value over the entire dataset
+  int64_t offset[2] = {0, 0}, size[2] = {HEIGHT, WIDTH};
+  esdm_rstream_uint64_t stream;
+  esdm_rstream_start(&stream, dataset, 2, offset, size);
+  for (int x = 0; x < HEIGHT; x++) {
+    for (int y = 0; y < WIDTH; y++) {
+      uint64_t value;
+      esdm_rstream_unpack(stream, value);
+      eassert(value == x * WIDTH + y);
+    }
+  }
+  esdm_rstream_next(stream);
+  eassert(!stream.iter);
+  eassert(esdm_rstream_status(stream) == ESDM_SUCCESS);
+  esdm_rstream_end(stream);
+
+  //chunk by chunk over a subregion
+  int64_t subOffset[2] = {13, 7}, subSize[2] = {150, 101};
+  int64_t chunks = 0, values = 0;
+  esdm_rstream_start(&stream, dataset, 2, subOffset, subSize);
+  while (stream.iter) {
+    for (uint64_t *value = stream.iter; value < stream.iterEnd; value++, values++) {
+      int64_t x = subOffset[0] + values / subSize[1], y = subOffset[1] + values % subSize[1];
+      eassert(*value == x * WIDTH + y);
+    }
+    chunks++;
+    esdm_rstream_next(stream);
+  }
+  esdm_rstream_end(stream);
+  printf("subregion: %"PRId64" values in %"PRId64" chunks\n", values, chunks);
+  eassert(values == subSize[0] * subSize[1]);
+  eassert(chunks > 1);
+
+  //only the two stream regions have been recorded as reads, not the chunks
+  eassert(dataset->accessPattern.shapeCount == 2);
+  for (int64_t i = 0; i < dataset->accessPattern.shapeCount; i++) {
+    int64_t *shape = dataset->accessPattern.sizes + 2*i;
+    eassert((shape[0] == HEIGHT && shape[1] == WIDTH) || (shape[0] == subSize[0] && shape[1] == subSize[1]));
+  }
+
+  //closing a stream early must cancel the prefetching
+  esdm_rstream_start(&stream, dataset, 2, offset, size);
+  eassert(stream.iter && stream.iter[0] == 0);
+  esdm_rstream_end(stream);
+
+  //a dataset without data and without fill value cannot be read, the stream must end and report the error
+  esdm_dataset_t *emptyDataset = NULL;
+  ret = esdm_dataset_create(container, "emptydataset", dataspace.ptr, &emptyDataset);
+  eassert(ret == ESDM_SUCCESS);
+  esdm_rstream_start(&stream, emptyDataset, 2, offset, size);
+  eassert(!stream.iter);
+  eassert(esdm_rstream_status(stream) == ESDM_INCOMPLETE_DATA);
+  uint64_t value = 42;
+  esdm_rstream_unpack(stream, value);
+  eassert(value == 0);
+  esdm_rstream_end(stream);
+  ret = esdm_dataset_close(emptyDataset);
+  eassert(ret == ESDM_SUCCESS);
+
+  ret = esdm_dataset_close(dataset);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_container_close(container);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_finalize();
+  eassert(ret == ESDM_SUCCESS);
+
+  esdm_dataspace_destroy(dataspace.ptr);
+  free(data);
+  printf("\nOK\n");
+  return 0;
+}
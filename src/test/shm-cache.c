@@ -0,0 +1,159 @@
+/* This file is part of ESDM.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with ESDM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This test reads a dataset through the shared memory fragment cache:
+ * The first read fills the cache, the second read is served from it, and a cache that is too small evicts its oldest entries.
+ * Finally, many more small fragments than the cache has slots are stored, and the newest ones must still be cached.
+ */
+
+#include <esdm.h>
+#include <esdm-internal.h>
+#include <test/util/test_util.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define HEIGHT 10
+#define WIDTH 1000
+#define SMALL_FRAGMENTS 5000
+#define NEWEST_FRAGMENTS 10
+
+static void unloadAll(esdm_dataset_t *dataset) {
+  int64_t count;
+  esdm_fragment_t **fragments = esdmI_fragments_list(&dataset->fragments, &count);
+  for (int64_t i = 0; i < count; i++) {
+    esdm_status ret = esdm_fragment_unload(fragments[i]);
+    eassert(ret == ESDM_SUCCESS);
+  }
+  free(fragments);
+}
+
+static void readAndCheck(esdm_dataset_t *dataset, esdm_dataspace_t *space, uint64_t *readData) {
+  unloadAll(dataset);
+  memset(readData, 0, HEIGHT * WIDTH * sizeof(*readData));
+  esdm_status ret = esdm_read(dataset, readData, space);
+  eassert(ret == ESDM_SUCCESS);
+  for (int i = 0; i < HEIGHT * WIDTH; i++) eassert(readData[i] == i);
+}
+
+static void createCache(int64_t bytes) {
+  char name[64];
+  sprintf(name, "/esdm-test-cache-%ld", (long)getpid());
+  esdm_status ret = esdmI_shmCache_create(name, bytes);
+  eassert(ret == ESDM_SUCCESS);
+  esdmI_shmCache_unlink(name); //nobody else needs to attach
+  eassert(esdmI_shmCache_isAttached());
+}
+
+int main(int argc, char const *argv[]) {
+  uint64_t *data = ea_checked_malloc(HEIGHT * WIDTH * sizeof(*data));
+  uint64_t *readData = ea_checked_malloc(HEIGHT * WIDTH * sizeof(*readData));
+  for (int i = 0; i < HEIGHT * WIDTH; i++) data[i] = i;
+
+  esdm_status ret;
+  esdm_container_t *container = NULL;
+  esdm_dataset_t *dataset = NULL;
+
+  ret = esdm_init();
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_mkfs(ESDM_FORMAT_PURGE_RECREATE, ESDM_ACCESSIBILITY_GLOBAL);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_mkfs(ESDM_FORMAT_PURGE_RECREATE, ESDM_ACCESSIBILITY_NODELOCAL);
+  eassert(ret == ESDM_SUCCESS);
+
+  esdm_simple_dspace_t dataspace = esdm_dataspace_2d(HEIGHT, WIDTH, SMD_DTYPE_UINT64);
+  ret = esdm_container_create("mycontainer", 1, &container);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_dataset_create(container, "mydataset", dataspace.ptr, &dataset);
+  eassert(ret == ESDM_SUCCESS);
+  for (int row = 0; row < HEIGHT; row++) {
+    esdm_simple_dspace_t space = esdm_dataspace_2do(row, 1, 0, WIDTH, SMD_DTYPE_UINT64);
+    ret = esdm_write(dataset, data + row * WIDTH, space.ptr);
+    eassert(ret == ESDM_SUCCESS);
+    esdm_dataspace_destroy(space.ptr);
+  }
+  ret = esdm_dataset_commit(dataset);
+  eassert(ret == ESDM_SUCCESS);
+  int64_t fragmentCount = g_hash_table_size(dataset->fragments.table);
+
+  //the first read loads from the backend and fills the cache, the second one is served from the cache
+  createCache(1024 * 1024);
+  int64_t hits, misses, stores, evictions;
+  readAndCheck(dataset, dataspace.ptr, readData);
+  esdmI_shmCache_getStats(&hits, &misses, &stores, &evictions);
+  printf("first read: %"PRId64" hits, %"PRId64" misses, %"PRId64" stores\n", hits, misses, stores);
+  eassert(hits == 0 && misses == fragmentCount && stores == fragmentCount);
+  readAndCheck(dataset, dataspace.ptr, readData);
+  esdmI_shmCache_getStats(&hits, &misses, &stores, &evictions);
+  printf("second read: %"PRId64" hits, %"PRId64" misses, %"PRId64" stores\n", hits, misses, stores);
+  eassert(hits == fragmentCount && misses == fragmentCount && evictions == 0);
+  esdmI_shmCache_detach();
+
+  //a cache with room for about three rows must evict the older rows, but the data must still be correct
+  createCache(3 * WIDTH * sizeof(*data) + 100);
+  readAndCheck(dataset, dataspace.ptr, readData);
+  readAndCheck(dataset, dataspace.ptr, readData);
+  esdmI_shmCache_getStats(&hits, &misses, &stores, &evictions);
+  printf("small cache: %"PRId64" hits, %"PRId64" misses, %"PRId64" stores, %"PRId64" evictions\n", hits, misses, stores, evictions);
+  eassert(evictions > 0);
+  eassert(hits + misses == 2 * fragmentCount);
+  esdmI_shmCache_detach();
+
+  //a cache with plenty of space for small fragments runs out of slots first, so storing must drop the oldest entries to free slots
+  createCache(1024 * 1024);
+  int64_t count;
+  esdm_fragment_t **fragments = esdmI_fragments_list(&dataset->fragments, &count);
+  esdm_simple_dspace_t smallSpace = esdm_dataspace_1d(1, SMD_DTYPE_UINT64);
+  esdm_fragment_t small = *fragments[0]; //only the backend is used from the real fragment
+  small.dataspace = smallSpace.ptr;
+  char id[32];
+  small.id = id;
+  for (uint64_t i = 0; i < SMALL_FRAGMENTS; i++) {
+    sprintf(id, "small-%"PRIu64, i);
+    small.buf = &i;
+    esdmI_shmCache_store(&small);
+  }
+  esdmI_shmCache_getStats(&hits, &misses, &stores, &evictions);
+  printf("small fragments: %"PRId64" stores, %"PRId64" evictions\n", stores, evictions);
+  eassert(stores == SMALL_FRAGMENTS);
+  eassert(evictions > 0);
+  for (uint64_t i = SMALL_FRAGMENTS - NEWEST_FRAGMENTS; i < SMALL_FRAGMENTS; i++) {
+    uint64_t value = 0;
+    sprintf(id, "small-%"PRIu64, i);
+    small.buf = &value;
+    eassert(esdmI_shmCache_load(&small));
+    eassert(value == i);
+  }
+  esdmI_shmCache_detach();
+  esdm_dataspace_destroy(smallSpace.ptr);
+  free(fragments);
+
+  ret = esdm_dataset_close(dataset);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_container_close(container);
+  eassert(ret == ESDM_SUCCESS);
+  ret = esdm_finalize();
+  eassert(ret == ESDM_SUCCESS);
+
+  esdm_dataspace_destroy(dataspace.ptr);
+  free(readData);
+  free(data);
+  printf("\nOK\n");
+  return 0;
+}
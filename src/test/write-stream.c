@@ -20,6 +20,7 @@
 
 #include <test/util/test_util.h>
 
+#include <esdm-grid.h>
 #include <esdm-internal.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -62,6 +63,13 @@ int main(int argc, char const *argv[]) {
     }
   }
   esdm_wstream_commit(stream);
+
+  //the stream must have recorded its fragments as a complete grid, so that the read below can use it
+  int64_t gridCount;
+  status = esdm_dataset_grids(dataset, &gridCount, NULL);
+  eassert(status == ESDM_SUCCESS);
+  eassert(gridCount == 1);
+
   status = esdm_container_commit(container);
   eassert(status == ESDM_SUCCESS);
   status = esdm_dataset_commit(dataset);
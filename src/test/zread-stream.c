@@ -47,13 +47,34 @@ static void* stream_func(esdm_dataspace_t *space, void * buff, void * user_ptr,
   int64_t const* s = esdm_dataspace_get_size(space);
   int64_t const* o = esdm_dataspace_get_offset(space);
 
-  int idx;
-  int x_end = s[0] + o[0];
-  int y_end = s[1] + o[1];
-  for (int x = o[0]; x < x_end; x++) {
-    for (int y = o[1]; y < y_end; y++) {
-      idx = y * 10 + x;
-      if (a[idx] != b[idx]) {
+  //the buffer contains only the block described by space, the expected data covers the entire 10x20 dataset
+  for (int64_t x = 0; x < s[0]; x++) {
+    for (int64_t y = 0; y < s[1]; y++) {
+      if (a[x * s[1] + y] != b[(o[0] + x) * 20 + o[1] + y]) {
+        mismatches++;
+      }
+    }
+  }
+
+  my_tmp_result_t * tmp = ea_checked_malloc(sizeof(my_tmp_result_t));
+  tmp->mismatches = mismatches;
+  tmp->checked = s[0] * s[1];
+  return tmp;
+}
+
+//the same check for a stream that requests the data as doubles, the uint64_t values of the dataset must be converted
+static void* stream_func_double(esdm_dataspace_t *space, void * buff, void * user_ptr, void* esdm_fill_value){
+  my_user_data_t * up = (my_user_data_t*) user_ptr;
+  double *a = (double *) buff;
+  uint64_t *b = up->expected_buf;
+  size_t mismatches = 0;
+
+  eassert(esdm_dataspace_get_type(space) == SMD_DTYPE_DOUBLE);
+  int64_t const* s = esdm_dataspace_get_size(space);
+  int64_t const* o = esdm_dataspace_get_offset(space);
+  for (int64_t x = 0; x < s[0]; x++) {
+    for (int64_t y = 0; y < s[1]; y++) {
+      if (a[x * s[1] + y] != (double)b[(o[0] + x) * 20 + o[1] + y]) {
         mismatches++;
       }
     }
@@ -73,6 +94,15 @@ static void reduce_func(esdm_dataspace_t *space, void * user_ptr, void * stream_
   free(stream_func_out);
 }
 
+static void* combine_func(esdm_dataspace_t *space, void * user_ptr, void * a, void * b){
+  my_tmp_result_t * tmpA = (my_tmp_result_t*) a;
+  my_tmp_result_t * tmpB = (my_tmp_result_t*) b;
+  tmpA->mismatches += tmpB->mismatches;
+  tmpA->checked += tmpB->checked;
+  free(tmpB);
+  return tmpA;
+}
+
 int main(int argc, char const *argv[]) {
   // prepare data
   uint64_t *buf_w = ea_checked_malloc(10 * 20 * sizeof(uint64_t));
@@ -104,6 +134,21 @@ int main(int argc, char const *argv[]) {
   status = esdm_read_stream(dataset, space.ptr, & user_data, stream_func, reduce_func);
   eassert(status == ESDM_SUCCESS);
 
+  //the same again, merging the intermediate results on the backend threads
+  my_user_data_t combined_data = {0, 0, buf_w};
+  status = esdm_read_stream_combine(dataset, space.ptr, & combined_data, stream_func, combine_func, reduce_func);
+  eassert(status == ESDM_SUCCESS);
+  eassert(combined_data.mismatches == 0);
+  eassert(combined_data.checked == 200);
+
+  //a stream in a different type than the dataset's receives converted blocks
+  esdm_simple_dspace_t doubleSpace = esdm_dataspace_2d(10, 20, SMD_DTYPE_DOUBLE);
+  my_user_data_t double_data = {0, 0, buf_w};
+  status = esdm_read_stream(dataset, doubleSpace.ptr, & double_data, stream_func_double, reduce_func);
+  eassert(status == ESDM_SUCCESS);
+  eassert(double_data.mismatches == 0);
+  eassert(double_data.checked == 200);
+
   status = esdm_dataset_close(dataset);
   eassert(status == ESDM_SUCCESS);
   status = esdm_container_close(container);
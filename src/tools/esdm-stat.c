@@ -19,5 +19,102 @@
  * @brief Inspect ESDM object.
  */
 
-int main(int argc, char *argv[argc + 1]) {
+#include <esdm-internal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <tools/option.h>
+
+typedef struct {
+  char *config_file;
+  char *container;
+  char *dataset;
+} tool_options_t;
+
+static tool_options_t o = {
+.config_file = NULL,
+.container = NULL,
+.dataset = NULL};
+
+static void parse_args(int argc, char **argv) {
+  option_help options[] = {
+  {'c', "config", "The configuration file", OPTION_OPTIONAL_ARGUMENT, 's', &o.config_file},
+  {'C', "container", "The container of the dataset to inspect", OPTION_OPTIONAL_ARGUMENT, 's', &o.container},
+  {'D', "dataset", "Print the metadata of this dataset as JSON, including all fragments", OPTION_OPTIONAL_ARGUMENT, 's', &o.dataset},
+  LAST_OPTION};
+
+  int print_help = 0;
+  option_parse(argc, argv, options, &print_help);
+  if (print_help) {
+    option_print_help(options, 0);
+    exit(0);
+  }
+}
+
+static void print_backends(esdm_modules_t *modules) {
+  for (int i = 0; i < modules->data_backend_count; i++) {
+    esdm_backend_t *b = modules->data_backends[i];
+    //esdm-stat does not perform any I/O, so a fitted model is the one that previous runs have stored in the metadata backend
+    double latency, throughput;
+    bool measured = esdmI_performance_backendModel(b, &latency, &throughput);
+    const char *source = measured ? "fitted to the I/O of previous runs" : "static estimate of the performance model, no fit stored yet";
+
+    printf("backend %s (%s): %s\n", b->config->id, b->config->type, b->config->target);
+    printf("\taccessibility: %s\n", b->config->data_accessibility == ESDM_ACCESSIBILITY_GLOBAL ? "global" : "node-local");
+    printf("\tthreads: %d\n", b->threads);
+    printf("\tlatency: %g s (%s)\n", latency, source);
+    printf("\tthroughput: %g MiB/s (%s)\n", throughput / 1024 / 1024, source);
+    if (b->config->fragment_size_efficiency > 0) {
+      printf("\tfragment size: %"PRId64" bytes (auto, efficiency %g, %s)\n", esdmI_backend_fragmentSize(b), b->config->fragment_size_efficiency, source);
+    } else {
+      printf("\tfragment size: %"PRId64" bytes\n", esdmI_backend_fragmentSize(b));
+    }
+  }
+}
+
+//The persistent metadata stores the fragments in a binary table, so we print the JSON representation instead.
+static void print_dataset(const char *container_name, const char *dataset_name) {
+  esdm_container_t *container;
+  esdm_status ret = esdm_container_open(container_name, ESDM_MODE_FLAG_READ, &container);
+  if (ret != ESDM_SUCCESS) ESDM_ERROR_FMT("Cannot open the container %s", container_name);
+  esdm_dataset_t *dataset;
+  ret = esdm_dataset_open(container, dataset_name, ESDM_MODE_FLAG_READ, &dataset);
+  if (ret != ESDM_SUCCESS) ESDM_ERROR_FMT("Cannot open the dataset %s", dataset_name);
+
+  size_t size;
+  smd_string_stream_t *stream = smd_string_stream_create();
+  esdmI_dataset_metadata_create(dataset, stream);
+  char *json = smd_string_stream_close(stream, &size);
+  printf("%s\n", json);
+  free(json);
+
+  esdm_dataset_close(dataset);
+  esdm_container_close(container);
+}
+
+int main(int argc, char **argv) {
+  parse_args(argc, argv);
+
+  if (o.config_file) {
+    char *config = NULL;
+    if (ea_read_file(o.config_file, &config)) {
+      fprintf(stderr, "Cannot read the configuration file %s\n", o.config_file);
+      return 1;
+    }
+    esdm_load_config_str(config);
+  }
+
+  int ret = esdm_init();
+  if (ret != ESDM_SUCCESS) ESDM_ERROR("Cannot initialize");
+
+  if (o.dataset) {
+    if (!o.container) ESDM_ERROR("Please specify the container of the dataset with -C");
+    print_dataset(o.container, o.dataset);
+  } else {
+    print_backends(esdm_get_modules());
+  }
+
+  ret = esdm_finalize();
+  if (ret != ESDM_SUCCESS) ESDM_ERROR("Error in finalize");
+
+  return 0;
 }